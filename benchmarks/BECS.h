@@ -1,8 +1,16 @@
 #pragma once
 #include <benchmark/benchmark.h>
 
+#include <lutra-ecs/CommandBuffer.h>
 #include <lutra-ecs/ECSManager.h>
+#include <lutra-ecs/SnapshotFile.h>
+#include <lutra-ecs/SystemScheduler.h>
 
+#include <filesystem>
+#include <memory_resource>
+#include <span>
+#include <string>
+#include <tuple>
 #include <vector>
 
 static constexpr uint32_t entity_count = 1024 * 1024;
@@ -11,22 +19,26 @@ namespace becs
 {
 	using EntityID = lcs::Handle<uint32_t, 8>;
 
-	template <lcs::ComponentType ct>
+	/* chunk_width only applies to chunked components */
+	template <lcs::ComponentType ct, uint32_t width = 64>
 	struct ECSSetup
 	{
 		struct Position
 		{
 			static constexpr lcs::ComponentType component_type = ct;
+			static constexpr uint32_t chunk_width = width;
 			int x, y;
 		};
 		struct Velocity
 		{
 			static constexpr lcs::ComponentType component_type = ct;
+			static constexpr uint32_t chunk_width = width;
 			int x, y;
 		};
 		struct Player
 		{
 			static constexpr lcs::ComponentType component_type = ct;
+			static constexpr uint32_t chunk_width = width;
 			bool is_happy;
 			bool is_hungry;
 			bool is_here;
@@ -79,12 +91,32 @@ namespace becs
 	{
 		std::sort(std::begin(list), std::end(list), [](EntityID e1, EntityID e2) -> bool { return e1.GetIndex() < e2.GetIndex(); });
 	}
+
+	/* Exports the stats of one container as counters prefixed with name */
+	void AddStatsCounters(benchmark::State& state, const std::string& name, const lcs::ContainerStats& stats)
+	{
+		state.counters[name + "_count"] = double(stats.dense_count);
+		state.counters[name + "_sparse"] = double(stats.sparse_capacity);
+		state.counters[name + "_MiB"] = double(stats.bytes_allocated) / (1024.0 * 1024.0);
+		state.counters[name + "_fill"] = stats.fill_ratio;
+		if (stats.free_list_length > 0) state.counters[name + "_free"] = double(stats.free_list_length);
+	}
+
+	/* Exports the stats of a component and the memory of the whole world */
+	template <typename T, typename ECS>
+	void AddMemoryCounters(benchmark::State& state, const std::string& name, ECS& ecs)
+	{
+		AddStatsCounters(state, name, ecs.template Stats<T>());
+		const auto report = ecs.MemoryReport();
+		state.counters["total_MiB"] = double(report.total_bytes) / (1024.0 * 1024.0);
+		if (report.entities.free_list_length > 0) state.counters["entities_free"] = double(report.entities.free_list_length);
+	}
 }
 
-template <lcs::ComponentType ct>
-static void BenchmarkECSIteration(benchmark::State& state, bool use_random_ordering)
+template <lcs::ComponentType ct, uint32_t chunk_width = 64>
+static void BenchmarkECSIteration(benchmark::State& state, bool use_random_ordering, bool use_joined_view = false, bool sort_by_entity = false)
 {
-	using Setup = becs::ECSSetup<ct>;
+	using Setup = becs::ECSSetup<ct, chunk_width>;
 	using ECS = typename Setup::ECS;
 	using EntityID = becs::EntityID;
 	using Position = typename Setup::Position;
@@ -111,7 +143,6 @@ static void BenchmarkECSIteration(benchmark::State& state, bool use_random_order
 	{
 		const EntityID e = entities_with_component[i];
 		ecs.template AddComponent<Position>(e, { 1, (int)i });
-		ecs.template AddComponent<Velocity>(e, { 0, 1 });
 	}
 
 	if (use_random_ordering)
@@ -125,27 +156,1423 @@ static void BenchmarkECSIteration(benchmark::State& state, bool use_random_order
 		ecs.template AddComponent<Velocity>(e, { 0, 1 });
 	}
 
-	for (auto _ : state)
+	if constexpr (ct == lcs::ComponentType::Component)
+	{
+		if (sort_by_entity)
+		{
+			ecs.template SortByEntity<Position>();
+			ecs.template SortByEntity<Velocity>();
+		}
+	}
+
+	if (use_joined_view)
 	{
-		for (auto [e, p] : ecs.template CView<Position>())
+		for (auto _ : state)
 		{
-			if (ecs.template HasComponent<Velocity>(e))
+			for (auto [e, p, v] : ecs.template View<Position, Velocity>())
 			{
-				Velocity& v = ecs.template GetComponent<Velocity>(e);
 				p.x += v.x;
 				p.y += v.y;
 			}
 		}
 	}
+	else
+	{
+		for (auto _ : state)
+		{
+			for (auto [e, p] : ecs.template CView<Position>())
+			{
+				if (ecs.template HasComponent<Velocity>(e))
+				{
+					Velocity& v = ecs.template GetComponent<Velocity>(e);
+					p.x += v.x;
+					p.y += v.y;
+				}
+			}
+		}
+	}
 
+	becs::AddMemoryCounters<Position>(state, "Position", ecs);
 	ecs.Clear();
 }
 
 static void ECSIterationNormal(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::Component>(state, false); }
 static void ECSIterationChunked(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::ComponentChunked>(state, false); }
 
+static void ECSIterationArchetype(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::Archetype>(state, false); }
+
+static void ECSIterationChunked128(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::ComponentChunked, 128>(state, false); }
+static void ECSIterationChunked256(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::ComponentChunked, 256>(state, false); }
+static void ECSIterationChunked512(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::ComponentChunked, 512>(state, false); }
+static void ECSIterationJoinedChunked128(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::ComponentChunked, 128>(state, false, true); }
+static void ECSIterationJoinedChunked256(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::ComponentChunked, 256>(state, false, true); }
+static void ECSIterationJoinedChunked512(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::ComponentChunked, 512>(state, false, true); }
+
 static void ECSIterationRndNormal(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::Component>(state, true); }
 static void ECSIterationRndChunked(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::ComponentChunked>(state, true); }
+static void ECSIterationRndArchetype(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::Archetype>(state, true); }
+
+static void ECSIterationJoinedNormal(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::Component>(state, false, true); }
+static void ECSIterationJoinedChunked(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::ComponentChunked>(state, false, true); }
+static void ECSIterationJoinedArchetype(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::Archetype>(state, false, true); }
+
+static void ECSIterationRndJoinedNormal(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::Component>(state, true, true); }
+static void ECSIterationRndJoinedChunked(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::ComponentChunked>(state, true, true); }
+static void ECSIterationRndJoinedArchetype(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::Archetype>(state, true, true); }
+static void ECSIterationRndJoinedSortedNormal(benchmark::State& state) { BenchmarkECSIteration<lcs::ComponentType::Component>(state, true, true, true); }
+
+namespace becs
+{
+	/* A normal and a chunked component, joining them goes through JoinedView */
+	struct MixedJoinSetup
+	{
+		struct Position { static constexpr lcs::ComponentType component_type = lcs::ComponentType::Component; int x, y; };
+		struct Velocity { static constexpr lcs::ComponentType component_type = lcs::ComponentType::ComponentChunked; int x, y; };
+
+		using ECS = lcs::ECSManager<EntityID, Position, Velocity>;
+	};
+}
+
+/* Probes and marks both sets per match.
+ * range(0) percent of the entities have a Velocity, read_only hands both components out as const and marks nothing */
+static void BenchmarkECSIterationJoinedMixed(benchmark::State& state, bool read_only)
+{
+	using Setup = becs::MixedJoinSetup;
+	using ECS = Setup::ECS;
+	using EntityID = becs::EntityID;
+	using Position = Setup::Position;
+	using Velocity = Setup::Velocity;
+
+	const uint32_t component_count = uint32_t(uint64_t(entity_count) * state.range(0) / 100);
+
+	ECS ecs{};
+	std::vector<EntityID> entities(entity_count);
+	ecs.CreateEntities(entity_count, entities);
+	for (uint32_t i = 0; i < entity_count; i++) ecs.AddComponent<Position>(entities[i], { 1, int(i) });
+	for (const EntityID e : becs::SelectNRandomEntriesFrom(entities, component_count)) ecs.AddComponent<Velocity>(e, { 0, 1 });
+
+	int sum = 0;
+	for (auto _ : state)
+	{
+		if (read_only)
+		{
+			for (auto [e, p, v] : ecs.View<const Position, const Velocity>()) sum += p.y * v.y;
+		}
+		else
+		{
+			for (auto [e, p, v] : ecs.View<Position, Velocity>())
+			{
+				p.x += v.x;
+				p.y += v.y;
+			}
+		}
+	}
+	benchmark::DoNotOptimize(sum);
+}
+
+static void ECSIterationJoinedMixed(benchmark::State& state) { BenchmarkECSIterationJoinedMixed(state, false); }
+static void ECSIterationJoinedMixedReadOnly(benchmark::State& state) { BenchmarkECSIterationJoinedMixed(state, true); }
+
+/* Every frame removes and re-adds range(0) per mille of the components at random, then restores entity order */
+static void BenchmarkECSResort(benchmark::State& state, bool incremental)
+{
+	using Setup = becs::ECSSetup<lcs::ComponentType::Component>;
+	using ECS = typename Setup::ECS;
+	using EntityID = becs::EntityID;
+	using Position = typename Setup::Position;
+
+	const uint32_t churn_count = uint32_t(uint64_t(entity_count) * state.range(0) / 1000);
+	const size_t step_budget = size_t(state.range(1));
+
+	ECS ecs{};
+	std::vector<EntityID> entities(entity_count);
+	ecs.CreateEntities(entity_count, entities);
+	for (uint32_t i = 0; i < entity_count; i++)
+	{
+		ecs.template AddComponent<Position>(entities[i], { 1, (int)i });
+	}
+
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		const std::vector<EntityID> churned = becs::SelectNRandomEntriesFrom(entities, churn_count);
+		for (const EntityID e : churned) ecs.template RemoveComponent<Position>(e);
+		for (const EntityID e : churned) ecs.template AddComponent<Position>(e, { 1, 1 });
+		state.ResumeTiming();
+
+		if (incremental) benchmark::DoNotOptimize(ecs.template SortByEntityIncremental<Position>(step_budget));
+		else ecs.template SortByEntity<Position>();
+	}
+}
+
+static void ECSResortFull(benchmark::State& state) { BenchmarkECSResort(state, false); }
+static void ECSResortIncremental(benchmark::State& state) { BenchmarkECSResort(state, true); }
+
+static void BenchmarkECSGroupIteration(benchmark::State& state, bool use_random_ordering)
+{
+	using Setup = becs::ECSSetup<lcs::ComponentType::Component>;
+	using ECS = typename Setup::ECS;
+	using EntityID = becs::EntityID;
+	using Position = typename Setup::Position;
+	using Velocity = typename Setup::Velocity;
+
+	const float component_fraction = float(state.range(0)) / 100.0f;
+	const uint32_t component_count = uint32_t(float(entity_count) * component_fraction);
+
+	ECS ecs{};
+	auto& group = *ecs.Group<Position, Velocity>();
+
+	std::vector<EntityID> entities(entity_count);
+	for (uint32_t i = 0; i < entity_count; i++)
+	{
+		entities[i] = ecs.CreateEntity();
+	}
+	std::vector<EntityID> entities_with_component = becs::SelectNRandomEntriesFrom(entities, component_count);
+
+	if (!use_random_ordering)
+	{
+		becs::Sort(entities_with_component);
+	}
+
+	for (uint32_t i = 0; i < component_count; i++)
+	{
+		ecs.AddComponent<Position>(entities_with_component[i], { 1, (int)i });
+	}
+
+	if (use_random_ordering)
+	{
+		becs::Shuffle(entities_with_component);
+	}
+
+	for (uint32_t i = 0; i < component_count; i++)
+	{
+		ecs.AddComponent<Velocity>(entities_with_component[i], { 0, 1 });
+	}
+
+	for (auto _ : state)
+	{
+		for (auto [e, p, v] : group)
+		{
+			p.x += v.x;
+			p.y += v.y;
+		}
+	}
+
+	ecs.Clear();
+}
+
+static void ECSIterationGroup(benchmark::State& state) { BenchmarkECSGroupIteration(state, false); }
+static void ECSIterationRndGroup(benchmark::State& state) { BenchmarkECSGroupIteration(state, true); }
+
+/* Runs on a pool of its own with state.range(2) workers, 0 runs every task on the calling thread */
+template <lcs::ComponentType ct>
+static void BenchmarkECSParallelIteration(benchmark::State& state)
+{
+	using Setup = becs::ECSSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using EntityID = becs::EntityID;
+	using Position = typename Setup::Position;
+	using Velocity = typename Setup::Velocity;
+
+	const float component_fraction = float(state.range(0)) / 100.0f;
+	const uint32_t component_count = uint32_t(float(entity_count) * component_fraction);
+	const uint32_t grain_size = uint32_t(state.range(1));
+	const uint32_t worker_count = uint32_t(state.range(2));
+
+	ECS ecs{};
+	lcs::ThreadPool pool{ worker_count };
+
+	std::vector<EntityID> entities(entity_count);
+	for (uint32_t i = 0; i < entity_count; i++)
+	{
+		entities[i] = ecs.CreateEntity();
+	}
+	std::vector<EntityID> entities_with_component = becs::SelectNRandomEntriesFrom(entities, component_count);
+	becs::Sort(entities_with_component);
+
+	for (uint32_t i = 0; i < component_count; i++)
+	{
+		const EntityID e = entities_with_component[i];
+		ecs.template AddComponent<Position>(e, { 1, (int)i });
+		ecs.template AddComponent<Velocity>(e, { 0, 1 });
+	}
+
+	for (auto _ : state)
+	{
+		ecs.template View<Position, Velocity>().ParallelForEach([](EntityID, Position& p, Velocity& v)
+			{
+				p.x += v.x;
+				p.y += v.y;
+			}, grain_size, pool);
+	}
+
+	ecs.Clear();
+}
+
+static void ECSParallelIterationNormal(benchmark::State& state) { BenchmarkECSParallelIteration<lcs::ComponentType::Component>(state); }
+static void ECSParallelIterationChunked(benchmark::State& state) { BenchmarkECSParallelIteration<lcs::ComponentType::ComponentChunked>(state); }
+static void ECSParallelIterationArchetype(benchmark::State& state) { BenchmarkECSParallelIteration<lcs::ComponentType::Archetype>(state); }
+
+namespace becs
+{
+	template <lcs::ComponentType ct>
+	struct KinematicsSetup
+	{
+		struct Transform
+		{
+			static constexpr lcs::ComponentType component_type = ct;
+			float x, y, z, scale;
+			static constexpr std::tuple soa_fields{ &Transform::x, &Transform::y, &Transform::z, &Transform::scale };
+		};
+		struct Motion
+		{
+			static constexpr lcs::ComponentType component_type = ct;
+			float x, y, z, drag;
+			static constexpr std::tuple soa_fields{ &Motion::x, &Motion::y, &Motion::z, &Motion::drag };
+		};
+
+		using ECS = lcs::ECSManager<EntityID, Transform, Motion>;
+	};
+}
+
+/* Spawns a wave of entities with two components, one call per entity or through the bulk API */
+template <lcs::ComponentType ct>
+static void BenchmarkECSSpawn(benchmark::State& state, bool use_bulk)
+{
+	using Setup = becs::ECSSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using EntityID = becs::EntityID;
+	using Position = typename Setup::Position;
+	using Velocity = typename Setup::Velocity;
+
+	const uint32_t spawn_count = uint32_t(state.range(0));
+	const std::vector<Position> positions(spawn_count, Position{ 1, 2 });
+	const std::vector<Velocity> velocities(spawn_count, Velocity{ 0, 1 });
+	std::vector<EntityID> entities(spawn_count);
+
+	const auto spawn = [&](ECS& ecs)
+		{
+			if (use_bulk)
+			{
+				ecs.CreateEntities(spawn_count, entities);
+				ecs.template AddComponents<Position>(entities, positions);
+				ecs.template AddComponents<Velocity>(entities, velocities);
+			}
+			else
+			{
+				for (uint32_t i = 0; i < spawn_count; i++)
+				{
+					entities[i] = ecs.CreateEntity();
+					ecs.template AddComponent<Position>(entities[i], Position(positions[i]));
+					ecs.template AddComponent<Velocity>(entities[i], Velocity(velocities[i]));
+				}
+			}
+		};
+
+	for (auto _ : state)
+	{
+		ECS ecs{};
+		spawn(ecs);
+		benchmark::DoNotOptimize(entities.data());
+	}
+	state.SetItemsProcessed(state.iterations() * spawn_count);
+
+	ECS ecs{};
+	spawn(ecs);
+	becs::AddMemoryCounters<Position>(state, "Position", ecs);
+}
+
+static void ECSSpawnNormal(benchmark::State& state) { BenchmarkECSSpawn<lcs::ComponentType::Component>(state, false); }
+static void ECSSpawnBulkNormal(benchmark::State& state) { BenchmarkECSSpawn<lcs::ComponentType::Component>(state, true); }
+static void ECSSpawnChunked(benchmark::State& state) { BenchmarkECSSpawn<lcs::ComponentType::ComponentChunked>(state, false); }
+static void ECSSpawnBulkChunked(benchmark::State& state) { BenchmarkECSSpawn<lcs::ComponentType::ComponentChunked>(state, true); }
+
+/* Builds a short-lived world, creates and destroys a wave of entities and drops the world again, as a frame-local or
+ * scratch world would. The world allocates from the heap or from a monotonic arena over a buffer reused every frame */
+template <lcs::ComponentType ct>
+static void BenchmarkECSChurn(benchmark::State& state, bool use_arena)
+{
+	using Setup = becs::ECSSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using EntityID = becs::EntityID;
+
+	const uint32_t spawn_count = uint32_t(state.range(0));
+	std::vector<EntityID> entities(spawn_count);
+	std::vector<std::byte> arena_buffer(size_t(64) * 1024 * 1024);
+
+	for (auto _ : state)
+	{
+		std::pmr::monotonic_buffer_resource arena(arena_buffer.data(), arena_buffer.size(), std::pmr::new_delete_resource());
+		ECS ecs = use_arena ? ECS(&arena) : ECS(std::pmr::new_delete_resource());
+		for (uint32_t i = 0; i < spawn_count; i++)
+		{
+			entities[i] = Setup::CreatePlayer(ecs, int(i), 0);
+		}
+		for (uint32_t i = 0; i < spawn_count; i++)
+		{
+			ecs.DestroyEntity(entities[i]);
+		}
+		benchmark::DoNotOptimize(entities.data());
+	}
+	state.SetItemsProcessed(state.iterations() * spawn_count);
+}
+
+static void ECSChurnMallocNormal(benchmark::State& state) { BenchmarkECSChurn<lcs::ComponentType::Component>(state, false); }
+static void ECSChurnArenaNormal(benchmark::State& state) { BenchmarkECSChurn<lcs::ComponentType::Component>(state, true); }
+static void ECSChurnMallocChunked(benchmark::State& state) { BenchmarkECSChurn<lcs::ComponentType::ComponentChunked>(state, false); }
+static void ECSChurnArenaChunked(benchmark::State& state) { BenchmarkECSChurn<lcs::ComponentType::ComponentChunked>(state, true); }
+
+/* Toggles Velocity on every 10th entity while iterating, through per-frame scratch vectors or a command buffer */
+static void BenchmarkECSDeferredChanges(benchmark::State& state, bool use_command_buffer)
+{
+	using Setup = becs::ECSSetup<lcs::ComponentType::Component>;
+	using ECS = typename Setup::ECS;
+	using EntityID = becs::EntityID;
+	using Position = typename Setup::Position;
+	using Velocity = typename Setup::Velocity;
+	using Player = typename Setup::Player;
+
+	ECS ecs{};
+	std::vector<EntityID> entities(entity_count);
+	ecs.CreateEntities(entity_count, entities);
+	for (uint32_t i = 0; i < entity_count; i++)
+	{
+		ecs.AddComponent<Position>(entities[i], { (int)i, 0 });
+	}
+
+	lcs::CommandBuffer<EntityID, Position, Velocity, Player> commands{};
+	for (auto _ : state)
+	{
+		if (use_command_buffer)
+		{
+			for (auto [e, p] : ecs.CView<Position>())
+			{
+				if (p.x % 10 != 0) continue;
+				if (ecs.HasComponent<Velocity>(e)) commands.RemoveComponent<Velocity>(e);
+				else commands.AddComponent(e, Velocity{ 0, 1 });
+			}
+			commands.Flush(ecs);
+		}
+		else
+		{
+			std::vector<EntityID> to_remove{};
+			std::vector<EntityID> to_add{};
+			for (auto [e, p] : ecs.CView<Position>())
+			{
+				if (p.x % 10 != 0) continue;
+				if (ecs.HasComponent<Velocity>(e)) to_remove.push_back(e);
+				else to_add.push_back(e);
+			}
+			for (const EntityID e : to_remove) ecs.RemoveComponent<Velocity>(e);
+			for (const EntityID e : to_add) ecs.AddComponent<Velocity>(e, { 0, 1 });
+		}
+	}
+}
+
+static void ECSDeferredChangesScratch(benchmark::State& state) { BenchmarkECSDeferredChanges(state, false); }
+static void ECSDeferredChangesCommandBuffer(benchmark::State& state) { BenchmarkECSDeferredChanges(state, true); }
+
+namespace becs
+{
+	template <lcs::ChangeTracking tracking>
+	struct ChangeSetup
+	{
+		struct Replicated
+		{
+			static constexpr lcs::ComponentType component_type = lcs::ComponentType::ComponentChunked;
+			static constexpr lcs::ChangeTracking change_tracking = tracking;
+			int x, y;
+		};
+
+		using ECS = lcs::ECSManager<EntityID, Replicated>;
+	};
+}
+
+/* Writes to a random subset of entities every frame, then syncs every component, or only the changed ones when tracked */
+template <lcs::ChangeTracking tracking>
+static void BenchmarkECSChangedSync(benchmark::State& state)
+{
+	using Setup = becs::ChangeSetup<tracking>;
+	using ECS = typename Setup::ECS;
+	using EntityID = becs::EntityID;
+	using Replicated = typename Setup::Replicated;
+
+	const uint32_t changed_count = uint32_t(uint64_t(entity_count) * state.range(0) / 1000);
+
+	ECS ecs{};
+	std::vector<EntityID> entities(entity_count);
+	ecs.CreateEntities(entity_count, entities);
+	for (uint32_t i = 0; i < entity_count; i++)
+	{
+		ecs.template AddComponent<Replicated>(entities[i], { (int)i, 0 });
+	}
+	const std::vector<EntityID> written = becs::SelectNRandomEntriesFrom(entities, changed_count);
+
+	uint32_t last_sync = ecs.AdvanceTick();
+	int64_t checksum = 0;
+	for (auto _ : state)
+	{
+		for (const EntityID e : written)
+		{
+			ecs.template WriteComponent<Replicated>(e).y++;
+		}
+
+		if constexpr (tracking != lcs::ChangeTracking::None)
+		{
+			for (auto [e, r] : ecs.template Changed<Replicated>(last_sync)) checksum += r.y;
+		}
+		else
+		{
+			for (auto [e, r] : ecs.template CView<Replicated>()) checksum += r.y;
+		}
+		last_sync = ecs.AdvanceTick();
+	}
+	benchmark::DoNotOptimize(checksum);
+}
+
+static void ECSChangedSyncScan(benchmark::State& state) { BenchmarkECSChangedSync<lcs::ChangeTracking::None>(state); }
+static void ECSChangedSyncPerChunk(benchmark::State& state) { BenchmarkECSChangedSync<lcs::ChangeTracking::PerChunk>(state); }
+static void ECSChangedSyncPerSlot(benchmark::State& state) { BenchmarkECSChangedSync<lcs::ChangeTracking::PerSlot>(state); }
+
+/* Integrates a single field, the case struct-of-arrays storage is meant for */
+template <lcs::ComponentType ct>
+static void BenchmarkECSFieldIntegration(benchmark::State& state)
+{
+	using Setup = becs::KinematicsSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using Transform = typename Setup::Transform;
+	using Motion = typename Setup::Motion;
+
+	ECS ecs{};
+	for (uint32_t i = 0; i < entity_count; i++)
+	{
+		const becs::EntityID e = ecs.CreateEntity();
+		ecs.template AddComponent<Transform>(e, { float(i), 0.0f, 0.0f, 1.0f });
+		ecs.template AddComponent<Motion>(e, { 1.0f, 0.0f, 0.0f, 0.0f });
+	}
+
+	constexpr float dt = 1.0f / 60.0f;
+	if constexpr (ct == lcs::ComponentType::SoA)
+	{
+		/* Both sets were filled in the same order, so their dense arrays line up */
+		for (auto _ : state)
+		{
+			std::span<float> px = ecs.template ComponentField<&Transform::x>();
+			std::span<const float> vx = ecs.template ComponentField<&Motion::x>();
+			for (size_t i = 0; i < px.size(); i++)
+			{
+				px[i] += vx[i] * dt;
+			}
+			benchmark::DoNotOptimize(px.data());
+		}
+	}
+	else
+	{
+		auto& group = *ecs.template Group<Transform, Motion>();
+		for (auto _ : state)
+		{
+			for (auto [e, p, v] : group)
+			{
+				p.x += v.x * dt;
+			}
+			benchmark::DoNotOptimize(&group);
+		}
+	}
+
+	ecs.Clear();
+}
+
+static void ECSFieldIntegrationNormal(benchmark::State& state) { BenchmarkECSFieldIntegration<lcs::ComponentType::Component>(state); }
+static void ECSFieldIntegrationSoA(benchmark::State& state) { BenchmarkECSFieldIntegration<lcs::ComponentType::SoA>(state); }
+
+/* Integrates a chunked component through the iterator, or per chunk with a kernel the compiler can vectorize.
+ * Mostly occupied chunks run the same kernel with free slots masked out of the update, sparse chunks visit their set bits. */
+static void BenchmarkECSChunkKernel(benchmark::State& state, bool use_chunk_api)
+{
+	using Setup = becs::KinematicsSetup<lcs::ComponentType::ComponentChunked>;
+	using ECS = Setup::ECS;
+	using Transform = Setup::Transform;
+	using EntityID = becs::EntityID;
+
+	ECS ecs{};
+	std::vector<EntityID> entities(entity_count);
+	ecs.CreateEntities(entity_count, entities);
+	const uint32_t component_count = uint32_t(uint64_t(entity_count) * state.range(0) / 100);
+	for (const EntityID e : becs::SelectNRandomEntriesFrom(entities, component_count))
+	{
+		ecs.AddComponent<Transform>(e, { 0.0f, 1.0f, 0.0f, 1.0f });
+	}
+
+	constexpr float dt = 1.0f / 60.0f;
+	for (auto _ : state)
+	{
+		if (use_chunk_api)
+		{
+			ecs.ForEachChunk<Transform>([&](Transform* data, const EntityID*, const auto& mask, auto is_full)
+				{
+					constexpr uint32_t width = lcs::SparseSetChunked<EntityID, Transform>::entries_per_chunk;
+					if constexpr (is_full)
+					{
+						for (uint32_t i = 0; i < width; i++) data[i].x += data[i].y * dt;
+					}
+					else if (mask.PopCount() < width / 4)
+					{
+						for (const uint8_t i : mask) data[i].x += data[i].y * dt;
+					}
+					else
+					{
+						const uint64_t bits = mask.mask;
+						for (uint32_t i = 0; i < width; i++) data[i].x += data[i].y * (dt * float((bits >> i) & 1));
+					}
+				});
+		}
+		else
+		{
+			for (auto [e, t] : ecs.CView<Transform>()) t.x += t.y * dt;
+		}
+		benchmark::ClobberMemory();
+	}
+}
+
+static void ECSChunkKernelIterator(benchmark::State& state) { BenchmarkECSChunkKernel(state, false); }
+static void ECSChunkKernelForEachChunk(benchmark::State& state) { BenchmarkECSChunkKernel(state, true); }
+
+/* Iterates the live entities after destroying a random subset, leaving a fragmented index space */
+static void BenchmarkECSEntityIteration(benchmark::State& state)
+{
+	using ECS = becs::ECSSetup<lcs::ComponentType::Component>::ECS;
+	using EntityID = becs::EntityID;
+
+	ECS ecs{};
+	std::vector<EntityID> entities(entity_count);
+	ecs.CreateEntities(entity_count, entities);
+	const uint32_t destroy_count = entity_count - uint32_t(uint64_t(entity_count) * state.range(0) / 100);
+	for (const EntityID e : becs::SelectNRandomEntriesFrom(entities, destroy_count))
+	{
+		ecs.DestroyEntity(e);
+	}
+
+	const ECS& const_ecs = ecs;
+	for (auto _ : state)
+	{
+		uint64_t checksum = 0;
+		for (const EntityID e : const_ecs.Entities()) checksum += e.GetIndex();
+		benchmark::DoNotOptimize(checksum);
+	}
+}
+
+static void ECSEntityIteration(benchmark::State& state) { BenchmarkECSEntityIteration(state); }
+
+namespace becs
+{
+	/* Many component types of which every entity only has a few */
+	template <uint32_t I, lcs::ComponentType ct = lcs::ComponentType::Component>
+	struct Slot
+	{
+		static constexpr lcs::ComponentType component_type = ct;
+		int value;
+	};
+
+	template <typename Indices, lcs::ComponentType ct = lcs::ComponentType::Component>
+	struct ManyTypesSetup;
+
+	template <uint32_t... I, lcs::ComponentType ct>
+	struct ManyTypesSetup<std::integer_sequence<uint32_t, I...>, ct>
+	{
+		using ECS = lcs::ECSManager<EntityID, Slot<I, ct>...>;
+		static constexpr uint32_t type_count = sizeof...(I);
+
+		/* Adds Slot<first> and Slot<first + 1>, wrapping around */
+		inline static void AddPair(ECS& ecs, EntityID e, uint32_t first)
+		{
+			((I == first % type_count || I == (first + 1) % type_count ? (void)ecs.template AddComponent<Slot<I, ct>>(e, { int(I) }) : void()), ...);
+		}
+	};
+}
+
+/* Destroys a random part of the population and respawns it, every entity has 2 of 32 component types */
+template <lcs::ComponentType ct>
+static void BenchmarkECSDespawn(benchmark::State& state)
+{
+	using Setup = becs::ManyTypesSetup<std::make_integer_sequence<uint32_t, 32>, ct>;
+	using ECS = Setup::ECS;
+	using EntityID = becs::EntityID;
+
+	const uint32_t despawn_count = uint32_t(state.range(0));
+	ECS ecs{};
+	std::vector<EntityID> entities(entity_count);
+	ecs.CreateEntities(entity_count, entities);
+	for (uint32_t i = 0; i < entity_count; i++)
+	{
+		Setup::AddPair(ecs, entities[i], i);
+	}
+
+	std::vector<EntityID> respawned(despawn_count);
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		const std::vector<EntityID> despawned = becs::SelectNRandomEntriesFrom(entities, despawn_count);
+		state.ResumeTiming();
+
+		for (const EntityID e : despawned)
+		{
+			ecs.DestroyEntity(e);
+		}
+
+		state.PauseTiming();
+		ecs.CreateEntities(despawn_count, respawned);
+		for (uint32_t i = 0; i < despawn_count; i++)
+		{
+			Setup::AddPair(ecs, respawned[i], respawned[i].GetIndex());
+			entities[respawned[i].GetIndex()] = respawned[i];
+		}
+		state.ResumeTiming();
+	}
+}
+
+static void ECSDespawn(benchmark::State& state) { BenchmarkECSDespawn<lcs::ComponentType::Component>(state); }
+static void ECSDespawnChunked(benchmark::State& state) { BenchmarkECSDespawn<lcs::ComponentType::ComponentChunked>(state); }
+
+/* Destroys a random part of 1M entities with two components, one call per entity or in a single batch */
+template <lcs::ComponentType ct>
+static void BenchmarkECSUnload(benchmark::State& state, bool use_bulk)
+{
+	using Setup = becs::KinematicsSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using Transform = typename Setup::Transform;
+	using Motion = typename Setup::Motion;
+	using EntityID = becs::EntityID;
+
+	const uint32_t destroy_count = uint32_t(uint64_t(entity_count) * state.range(0) / 100);
+	std::vector<EntityID> entities(entity_count);
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		ECS ecs{};
+		ecs.CreateEntities(entity_count, entities);
+		for (const EntityID e : entities)
+		{
+			ecs.template AddComponent<Transform>(e, { 0.0f, 0.0f, 0.0f, 1.0f });
+			ecs.template AddComponent<Motion>(e, { 1.0f, 0.0f, 0.0f, 0.0f });
+		}
+		const std::vector<EntityID> destroyed = becs::SelectNRandomEntriesFrom(entities, destroy_count);
+		state.ResumeTiming();
+
+		if (use_bulk)
+		{
+			ecs.DestroyEntities(destroyed);
+		}
+		else
+		{
+			for (const EntityID e : destroyed) ecs.DestroyEntity(e);
+		}
+
+		state.PauseTiming();
+		becs::AddMemoryCounters<Transform>(state, "Transform", ecs);
+		ecs.Clear();
+		state.ResumeTiming();
+	}
+}
+
+static void ECSUnloadNormal(benchmark::State& state) { BenchmarkECSUnload<lcs::ComponentType::Component>(state, false); }
+static void ECSUnloadBulkNormal(benchmark::State& state) { BenchmarkECSUnload<lcs::ComponentType::Component>(state, true); }
+static void ECSUnloadChunked(benchmark::State& state) { BenchmarkECSUnload<lcs::ComponentType::ComponentChunked>(state, false); }
+static void ECSUnloadBulkChunked(benchmark::State& state) { BenchmarkECSUnload<lcs::ComponentType::ComponentChunked>(state, true); }
+
+namespace becs
+{
+	template <lcs::ComponentType ct>
+	struct TagSetup
+	{
+		struct IsVisible { static constexpr lcs::ComponentType component_type = ct; };
+		struct IsMoving { static constexpr lcs::ComponentType component_type = ct; };
+		struct IsSleeping { static constexpr lcs::ComponentType component_type = ct; };
+
+		using ECS = lcs::ECSManager<EntityID, IsVisible, IsMoving, IsSleeping>;
+	};
+}
+
+/* Counts the entities that are visible and moving but not sleeping, each tag is on a random part of 1M entities */
+template <lcs::ComponentType ct>
+static void BenchmarkECSTagQuery(benchmark::State& state)
+{
+	using Setup = becs::TagSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using IsVisible = typename Setup::IsVisible;
+	using IsMoving = typename Setup::IsMoving;
+	using IsSleeping = typename Setup::IsSleeping;
+	using EntityID = becs::EntityID;
+
+	const uint32_t tagged_count = uint32_t(uint64_t(entity_count) * state.range(0) / 100);
+	ECS ecs{};
+	std::vector<EntityID> entities(entity_count);
+	ecs.CreateEntities(entity_count, entities);
+	for (const EntityID e : becs::SelectNRandomEntriesFrom(entities, tagged_count)) ecs.template AddTag<IsVisible>(e);
+	for (const EntityID e : becs::SelectNRandomEntriesFrom(entities, tagged_count)) ecs.template AddTag<IsMoving>(e);
+	for (const EntityID e : becs::SelectNRandomEntriesFrom(entities, tagged_count)) ecs.template AddTag<IsSleeping>(e);
+
+	for (auto _ : state)
+	{
+		uint32_t count = 0;
+		if constexpr (ct == lcs::ComponentType::TagBitset)
+		{
+			count = ecs.template QueryTags<IsVisible, IsMoving>(lcs::Exclude<IsSleeping>{}).Count();
+		}
+		else
+		{
+			for (const EntityID e : ecs.template TView<IsVisible>())
+			{
+				count += ecs.template HasTag<IsMoving>(e) && !ecs.template HasTag<IsSleeping>(e);
+			}
+		}
+		benchmark::DoNotOptimize(count);
+	}
+	becs::AddMemoryCounters<IsVisible>(state, "IsVisible", ecs);
+}
+
+static void ECSTagQuerySparse(benchmark::State& state) { BenchmarkECSTagQuery<lcs::ComponentType::Tag>(state); }
+static void ECSTagQueryBitset(benchmark::State& state) { BenchmarkECSTagQuery<lcs::ComponentType::TagBitset>(state); }
+
+/* Restores 1M entities with two components, from a mapped snapshot or by re-creating them through the public API */
+template <lcs::ComponentType ct>
+static void BenchmarkECSRestore(benchmark::State& state, bool use_snapshot)
+{
+	using Setup = becs::KinematicsSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using Transform = typename Setup::Transform;
+	using Motion = typename Setup::Motion;
+	using EntityID = becs::EntityID;
+
+	const std::vector<Transform> transforms(entity_count, Transform{ 0.0f, 0.0f, 0.0f, 1.0f });
+	const std::vector<Motion> motions(entity_count, Motion{ 1.0f, 0.0f, 0.0f, 0.0f });
+	std::vector<EntityID> entities(entity_count);
+
+	const std::string path = (std::filesystem::temp_directory_path() / "lcs_benchmark_snapshot.bin").string();
+	{
+		ECS saved{};
+		saved.CreateEntities(entity_count, entities);
+		saved.template AddComponents<Transform>(entities, transforms);
+		saved.template AddComponents<Motion>(entities, motions);
+		saved.SaveSnapshot(path.c_str());
+	}
+
+	ECS ecs{};
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		ecs.Clear();
+		state.ResumeTiming();
+
+		if (use_snapshot)
+		{
+			const bool loaded = lcs::LoadSnapshot(ecs, path.c_str());
+			benchmark::DoNotOptimize(loaded);
+		}
+		else
+		{
+			ecs.CreateEntities(entity_count, entities);
+			ecs.template AddComponents<Transform>(entities, transforms);
+			ecs.template AddComponents<Motion>(entities, motions);
+		}
+	}
+	std::filesystem::remove(path);
+}
+
+static void ECSRestoreRebuildNormal(benchmark::State& state) { BenchmarkECSRestore<lcs::ComponentType::Component>(state, false); }
+static void ECSRestoreSnapshotNormal(benchmark::State& state) { BenchmarkECSRestore<lcs::ComponentType::Component>(state, true); }
+static void ECSRestoreRebuildChunked(benchmark::State& state) { BenchmarkECSRestore<lcs::ComponentType::ComponentChunked>(state, false); }
+static void ECSRestoreSnapshotChunked(benchmark::State& state) { BenchmarkECSRestore<lcs::ComponentType::ComponentChunked>(state, true); }
+
+/* Saves 1M entities with two components after changing one in every 1000 of them, as a full snapshot or as a delta */
+template <lcs::ComponentType ct>
+static void BenchmarkECSSaveAfterChange(benchmark::State& state, bool use_delta)
+{
+	using Setup = becs::KinematicsSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using Transform = typename Setup::Transform;
+	using Motion = typename Setup::Motion;
+	using EntityID = becs::EntityID;
+
+	const std::vector<Transform> transforms(entity_count, Transform{ 0.0f, 0.0f, 0.0f, 1.0f });
+	const std::vector<Motion> motions(entity_count, Motion{ 1.0f, 0.0f, 0.0f, 0.0f });
+	std::vector<EntityID> entities(entity_count);
+
+	ECS ecs{};
+	ecs.CreateEntities(entity_count, entities);
+	ecs.template AddComponents<Transform>(entities, transforms);
+	ecs.template AddComponents<Motion>(entities, motions);
+
+	const std::string path = (std::filesystem::temp_directory_path() / "lcs_benchmark_delta.bin").string();
+	ecs.SaveSnapshot(path.c_str());
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		for (uint32_t i = 0; i < entity_count; i += 1000) ecs.template WriteComponent<Transform>(entities[i]).x += 1.0f;
+		state.ResumeTiming();
+
+		const bool saved = use_delta ? ecs.SaveDeltaSnapshot(path.c_str()) : ecs.SaveSnapshot(path.c_str());
+		benchmark::DoNotOptimize(saved);
+	}
+	state.counters["file_MiB"] = double(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+	std::filesystem::remove(path);
+}
+
+static void ECSSaveFullNormal(benchmark::State& state) { BenchmarkECSSaveAfterChange<lcs::ComponentType::Component>(state, false); }
+static void ECSSaveDeltaNormal(benchmark::State& state) { BenchmarkECSSaveAfterChange<lcs::ComponentType::Component>(state, true); }
+static void ECSSaveFullChunked(benchmark::State& state) { BenchmarkECSSaveAfterChange<lcs::ComponentType::ComponentChunked>(state, false); }
+static void ECSSaveDeltaChunked(benchmark::State& state) { BenchmarkECSSaveAfterChange<lcs::ComponentType::ComponentChunked>(state, true); }
+
+/* Saves a delta of 1M entities after the same sparse changes and a view pass reading both components.
+ * The read-only pass lists them as const and adds nothing to the delta, the mutable pass marks every entry it hands out */
+template <lcs::ComponentType ct>
+static void BenchmarkECSSaveDeltaAfterView(benchmark::State& state, bool read_only)
+{
+	using Setup = becs::KinematicsSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using Transform = typename Setup::Transform;
+	using Motion = typename Setup::Motion;
+	using EntityID = becs::EntityID;
+
+	const std::vector<Transform> transforms(entity_count, Transform{ 0.0f, 0.0f, 0.0f, 1.0f });
+	const std::vector<Motion> motions(entity_count, Motion{ 1.0f, 0.0f, 0.0f, 0.0f });
+	std::vector<EntityID> entities(entity_count);
+
+	ECS ecs{};
+	ecs.CreateEntities(entity_count, entities);
+	ecs.template AddComponents<Transform>(entities, transforms);
+	ecs.template AddComponents<Motion>(entities, motions);
+
+	const std::string path = (std::filesystem::temp_directory_path() / "lcs_benchmark_view_delta.bin").string();
+	ecs.SaveSnapshot(path.c_str());
+	float sum = 0.0f;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		for (uint32_t i = 0; i < entity_count; i += 1000) ecs.template WriteComponent<Transform>(entities[i]).x += 1.0f;
+		if (read_only) for (auto [e, t, m] : ecs.template View<const Transform, const Motion>()) sum += t.x * m.x;
+		else for (auto [e, t, m] : ecs.template View<Transform, Motion>()) sum += t.x * m.x;
+		state.ResumeTiming();
+
+		const bool saved = ecs.SaveDeltaSnapshot(path.c_str());
+		benchmark::DoNotOptimize(saved);
+	}
+	benchmark::DoNotOptimize(sum);
+	state.counters["file_MiB"] = double(std::filesystem::file_size(path)) / (1024.0 * 1024.0);
+	std::filesystem::remove(path);
+}
+
+static void ECSSaveDeltaAfterReadViewNormal(benchmark::State& state) { BenchmarkECSSaveDeltaAfterView<lcs::ComponentType::Component>(state, true); }
+static void ECSSaveDeltaAfterWriteViewNormal(benchmark::State& state) { BenchmarkECSSaveDeltaAfterView<lcs::ComponentType::Component>(state, false); }
+static void ECSSaveDeltaAfterReadViewChunked(benchmark::State& state) { BenchmarkECSSaveDeltaAfterView<lcs::ComponentType::ComponentChunked>(state, true); }
+static void ECSSaveDeltaAfterWriteViewChunked(benchmark::State& state) { BenchmarkECSSaveDeltaAfterView<lcs::ComponentType::ComponentChunked>(state, false); }
+
+namespace becs
+{
+	/* Four float components on every entity, for frames of systems with and without conflicts */
+	struct SystemsSetup
+	{
+		struct Health { static constexpr lcs::ComponentType component_type = lcs::ComponentType::Component; float value; };
+		struct Regen { static constexpr lcs::ComponentType component_type = lcs::ComponentType::Component; float value; };
+		struct Armor { static constexpr lcs::ComponentType component_type = lcs::ComponentType::Component; float value; };
+		struct Rust { static constexpr lcs::ComponentType component_type = lcs::ComponentType::Component; float value; };
+
+		using ECS = lcs::ECSManager<EntityID, Health, Regen, Armor, Rust>;
+	};
+}
+
+/* A frame of six systems over 1M entities, called one after another or through the scheduler.
+ * Two chains of three systems, Regen -> Health -> read Health and Rust -> Armor -> read Armor, run side by side */
+static void BenchmarkECSSystems(benchmark::State& state, bool use_scheduler)
+{
+	using Setup = becs::SystemsSetup;
+	using ECS = Setup::ECS;
+	using Health = Setup::Health;
+	using Regen = Setup::Regen;
+	using Armor = Setup::Armor;
+	using Rust = Setup::Rust;
+
+	ECS ecs{};
+	std::vector<becs::EntityID> entities(entity_count);
+	ecs.CreateEntities(entity_count, entities);
+	ecs.AddComponents<Health>(entities, std::vector<Health>(entity_count, Health{ 1.0f }));
+	ecs.AddComponents<Regen>(entities, std::vector<Regen>(entity_count, Regen{ 0.1f }));
+	ecs.AddComponents<Armor>(entities, std::vector<Armor>(entity_count, Armor{ 1.0f }));
+	ecs.AddComponents<Rust>(entities, std::vector<Rust>(entity_count, Rust{ 0.01f }));
+
+	float health_sum = 0.0f;
+	float armor_sum = 0.0f;
+	const auto grow_regen = [](ECS& ecs) { for (auto [e, r] : ecs.CView<Regen>()) r.value *= 1.0001f; };
+	const auto heal = [](ECS& ecs) { for (auto [e, h, r] : ecs.View<Health, const Regen>()) h.value += r.value; };
+	const auto sum_health = [&](ECS& ecs) { float sum = 0.0f; for (auto [e, h] : ecs.CView<const Health>()) sum += h.value; health_sum = sum; };
+	const auto grow_rust = [](ECS& ecs) { for (auto [e, r] : ecs.CView<Rust>()) r.value *= 1.0001f; };
+	const auto corrode = [](ECS& ecs) { for (auto [e, a, r] : ecs.View<Armor, const Rust>()) a.value -= r.value; };
+	const auto sum_armor = [&](ECS& ecs) { float sum = 0.0f; for (auto [e, a] : ecs.CView<const Armor>()) sum += a.value; armor_sum = sum; };
+
+	lcs::SystemScheduler<ECS> scheduler{};
+	scheduler.AddSystem("GrowRegen", lcs::Reads<>{}, lcs::Writes<Regen>{}, grow_regen);
+	scheduler.AddSystem("GrowRust", lcs::Reads<>{}, lcs::Writes<Rust>{}, grow_rust);
+	scheduler.AddSystem("Heal", lcs::Reads<Regen>{}, lcs::Writes<Health>{}, heal);
+	scheduler.AddSystem("Corrode", lcs::Reads<Rust>{}, lcs::Writes<Armor>{}, corrode);
+	scheduler.AddSystem("SumHealth", lcs::Reads<Health>{}, lcs::Writes<>{}, sum_health);
+	scheduler.AddSystem("SumArmor", lcs::Reads<Armor>{}, lcs::Writes<>{}, sum_armor);
+
+	for (auto _ : state)
+	{
+		if (use_scheduler)
+		{
+			scheduler.Run(ecs);
+		}
+		else
+		{
+			grow_regen(ecs);
+			grow_rust(ecs);
+			heal(ecs);
+			corrode(ecs);
+			sum_health(ecs);
+			sum_armor(ecs);
+		}
+		benchmark::DoNotOptimize(health_sum);
+		benchmark::DoNotOptimize(armor_sum);
+	}
+	if (use_scheduler) state.counters["critical_path_ms"] = scheduler.CriticalPathMicroseconds() / 1000.0;
+}
+
+static void ECSSystemsSequential(benchmark::State& state) { BenchmarkECSSystems(state, false); }
+static void ECSSystemsScheduled(benchmark::State& state) { BenchmarkECSSystems(state, true); }
+
+/* Joins three components over 1M entities with 50% and 30% of them holding the two smaller ones, in steady state.
+ * The view probes the other containers for every candidate of the smallest one, the cached query walks its rows */
+template <lcs::ComponentType ct>
+static void BenchmarkECSQuery(benchmark::State& state, bool use_cache)
+{
+	using Setup = becs::ECSSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using EntityID = becs::EntityID;
+	using Position = typename Setup::Position;
+	using Velocity = typename Setup::Velocity;
+	using Player = typename Setup::Player;
+
+	srand(7);
+	ECS ecs{};
+	std::vector<EntityID> entities(entity_count);
+	ecs.CreateEntities(entity_count, entities);
+	for (const EntityID e : entities) ecs.template AddComponent<Position>(e, { 0, 0 });
+	std::vector<EntityID> moving = becs::SelectNRandomEntriesFrom(entities, entity_count / 2);
+	becs::Sort(moving);
+	for (const EntityID e : moving) ecs.template AddComponent<Velocity>(e, { 1, 1 });
+	std::vector<EntityID> players = becs::SelectNRandomEntriesFrom(entities, entity_count / 10 * 3);
+	becs::Sort(players);
+	for (const EntityID e : players) ecs.template AddComponent<Player>(e, { true, false, true, false });
+
+	auto query = ecs.template Query<Position, Velocity, Player>();
+	for (auto _ : state)
+	{
+		if (use_cache)
+		{
+			for (auto [e, p, v, player] : query) p.x += v.x;
+		}
+		else
+		{
+			for (auto [e, p, v, player] : ecs.template View<Position, Velocity, Player>()) p.x += v.x;
+		}
+	}
+	state.counters["matches"] = double(query.Size());
+}
+
+static void ECSQueryViewNormal(benchmark::State& state) { BenchmarkECSQuery<lcs::ComponentType::Component>(state, false); }
+static void ECSQueryCachedNormal(benchmark::State& state) { BenchmarkECSQuery<lcs::ComponentType::Component>(state, true); }
+static void ECSQueryViewChunked(benchmark::State& state) { BenchmarkECSQuery<lcs::ComponentType::ComponentChunked>(state, false); }
+static void ECSQueryCachedChunked(benchmark::State& state) { BenchmarkECSQuery<lcs::ComponentType::ComponentChunked>(state, true); }
+
+/* A consumer mirroring which of 1M entities hold Velocity, while 1% of them gain or lose it every frame.
+ * Polling compares every entity to the mirror, the event consumer only applies the drained batches */
+template <lcs::ComponentType ct>
+static void BenchmarkECSReactive(benchmark::State& state, bool use_events)
+{
+	using Setup = becs::ECSSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using EntityID = becs::EntityID;
+	using Velocity = typename Setup::Velocity;
+
+	srand(7);
+	ECS ecs{};
+	std::vector<EntityID> entities(entity_count);
+	ecs.CreateEntities(entity_count, entities);
+	for (uint32_t i = 0; i < entity_count; i += 2) ecs.template AddComponent<Velocity>(entities[i], { 1, 1 });
+	std::vector<EntityID> toggled = becs::SelectNRandomEntriesFrom(entities, entity_count / 100);
+
+	std::vector<uint8_t> mirror(entity_count, 0);
+	for (const EntityID e : entities) mirror[e.GetIndex()] = ecs.template HasComponent<Velocity>(e);
+	if (use_events) ecs.template Events<Velocity>().Enable();
+
+	size_t updates = 0;
+	for (auto _ : state)
+	{
+		for (const EntityID e : toggled)
+		{
+			if (ecs.template HasComponent<Velocity>(e)) ecs.template RemoveComponent<Velocity>(e);
+			else ecs.template AddComponent<Velocity>(e, { 1, 1 });
+		}
+
+		if (use_events)
+		{
+			ecs.template Events<Velocity>().Drain([&](std::span<const EntityID> added, std::span<const EntityID> removed, bool)
+				{
+					for (const EntityID e : removed) mirror[e.GetIndex()] = 0;
+					for (const EntityID e : added) mirror[e.GetIndex()] = ecs.template HasComponent<Velocity>(e);
+					updates += added.size() + removed.size();
+				});
+		}
+		else
+		{
+			for (const EntityID e : entities)
+			{
+				const uint8_t present = ecs.template HasComponent<Velocity>(e);
+				if (mirror[e.GetIndex()] == present) continue;
+				mirror[e.GetIndex()] = present;
+				updates++;
+			}
+		}
+	}
+	state.counters["updates_per_frame"] = benchmark::Counter(double(updates), benchmark::Counter::kAvgIterations);
+}
+
+static void ECSReactivePollNormal(benchmark::State& state) { BenchmarkECSReactive<lcs::ComponentType::Component>(state, false); }
+static void ECSReactiveEventsNormal(benchmark::State& state) { BenchmarkECSReactive<lcs::ComponentType::Component>(state, true); }
+static void ECSReactivePollChunked(benchmark::State& state) { BenchmarkECSReactive<lcs::ComponentType::ComponentChunked>(state, false); }
+static void ECSReactiveEventsChunked(benchmark::State& state) { BenchmarkECSReactive<lcs::ComponentType::ComponentChunked>(state, true); }
+
+namespace becs
+{
+	/* Position, Velocity and Player stored as ct, plus a sparse tag */
+	template <lcs::ComponentType ct>
+	struct SuiteSetup
+	{
+		using Position = typename ECSSetup<ct>::Position;
+		using Velocity = typename ECSSetup<ct>::Velocity;
+		using Player = typename ECSSetup<ct>::Player;
+		struct IsVisible
+		{
+			static constexpr lcs::ComponentType component_type = lcs::ComponentType::Tag;
+		};
+
+		using ECS = lcs::ECSManager<EntityID, Position, Velocity, Player, IsVisible>;
+	};
+
+	/* 0 .. count - 1 in random order, benchmarks walk it in a cycle to pick the entities they change */
+	std::vector<uint32_t> ShuffledIndices(uint32_t count)
+	{
+		std::vector<uint32_t> indices(count);
+		for (uint32_t i = 0; i < count; i++) indices[i] = i;
+		for (uint32_t i = count - 1; i > 0; i--) std::swap(indices[i], indices[rand() % (i + 1)]);
+		return indices;
+	}
+}
+
+/* Destroys range(0) random entities of 1M and spawns as many with Position and Velocity every iteration */
+template <lcs::ComponentType ct>
+static void BenchmarkECSEntityChurn(benchmark::State& state)
+{
+	using Setup = becs::SuiteSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using EntityID = becs::EntityID;
+	using Position = typename Setup::Position;
+	using Velocity = typename Setup::Velocity;
+
+	srand(7);
+	const uint32_t churn_count = uint32_t(state.range(0));
+	ECS ecs{};
+	std::vector<EntityID> entities(entity_count);
+	ecs.CreateEntities(entity_count, entities);
+	for (const EntityID e : entities)
+	{
+		ecs.template AddComponent<Position>(e, { 0, 0 });
+		ecs.template AddComponent<Velocity>(e, { 1, 1 });
+	}
+	const std::vector<uint32_t> order = becs::ShuffledIndices(entity_count);
+
+	size_t cursor = 0;
+	for (auto _ : state)
+	{
+		for (uint32_t i = 0; i < churn_count; i++)
+		{
+			const uint32_t slot = order[(cursor + i) % entity_count];
+			ecs.DestroyEntity(entities[slot]);
+		}
+		for (uint32_t i = 0; i < churn_count; i++)
+		{
+			const uint32_t slot = order[(cursor + i) % entity_count];
+			entities[slot] = ecs.CreateEntity();
+			ecs.template AddComponent<Position>(entities[slot], { int(i), 0 });
+			ecs.template AddComponent<Velocity>(entities[slot], { 1, 1 });
+		}
+		cursor += churn_count;
+	}
+	state.SetItemsProcessed(state.iterations() * churn_count);
+	becs::AddMemoryCounters<Position>(state, "Position", ecs);
+}
+
+static void ECSEntityChurnNormal(benchmark::State& state) { BenchmarkECSEntityChurn<lcs::ComponentType::Component>(state); }
+static void ECSEntityChurnChunked(benchmark::State& state) { BenchmarkECSEntityChurn<lcs::ComponentType::ComponentChunked>(state); }
+
+/* Adds or removes Velocity on range(0) random entities of 1M every iteration, the entities themselves stay */
+template <lcs::ComponentType ct>
+static void BenchmarkECSComponentChurn(benchmark::State& state)
+{
+	using Setup = becs::SuiteSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using EntityID = becs::EntityID;
+	using Position = typename Setup::Position;
+	using Velocity = typename Setup::Velocity;
+
+	srand(7);
+	const uint32_t churn_count = uint32_t(state.range(0));
+	ECS ecs{};
+	std::vector<EntityID> entities(entity_count);
+	ecs.CreateEntities(entity_count, entities);
+	for (uint32_t i = 0; i < entity_count; i++)
+	{
+		ecs.template AddComponent<Position>(entities[i], { 0, 0 });
+		if (i % 2 == 0) ecs.template AddComponent<Velocity>(entities[i], { 1, 1 });
+	}
+	const std::vector<uint32_t> order = becs::ShuffledIndices(entity_count);
+
+	size_t cursor = 0;
+	for (auto _ : state)
+	{
+		for (uint32_t i = 0; i < churn_count; i++)
+		{
+			const EntityID e = entities[order[(cursor + i) % entity_count]];
+			if (ecs.template HasComponent<Velocity>(e)) ecs.template RemoveComponent<Velocity>(e);
+			else ecs.template AddComponent<Velocity>(e, { 1, 1 });
+		}
+		cursor += churn_count;
+	}
+	state.SetItemsProcessed(state.iterations() * churn_count);
+	becs::AddMemoryCounters<Velocity>(state, "Velocity", ecs);
+}
+
+static void ECSComponentChurnNormal(benchmark::State& state) { BenchmarkECSComponentChurn<lcs::ComponentType::Component>(state); }
+static void ECSComponentChurnChunked(benchmark::State& state) { BenchmarkECSComponentChurn<lcs::ComponentType::ComponentChunked>(state); }
+
+/* GetComponent on range(0)% of 1M entities holding Position, in random order */
+template <lcs::ComponentType ct>
+static void BenchmarkECSRandomGet(benchmark::State& state)
+{
+	using Setup = becs::SuiteSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using EntityID = becs::EntityID;
+	using Position = typename Setup::Position;
+
+	srand(7);
+	const uint32_t holder_count = uint32_t(uint64_t(entity_count) * state.range(0) / 100);
+	ECS ecs{};
+	std::vector<EntityID> entities(entity_count);
+	ecs.CreateEntities(entity_count, entities);
+	std::vector<EntityID> holders = becs::SelectNRandomEntriesFrom(entities, holder_count);
+	for (const EntityID e : holders) ecs.template AddComponent<Position>(e, { 1, 2 });
+	becs::Shuffle(holders);
+
+	for (auto _ : state)
+	{
+		int64_t sum = 0;
+		for (const EntityID e : holders) sum += ecs.template GetComponent<Position>(e).x;
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * holder_count);
+	becs::AddMemoryCounters<Position>(state, "Position", ecs);
+}
+
+static void ECSRandomGetNormal(benchmark::State& state) { BenchmarkECSRandomGet<lcs::ComponentType::Component>(state); }
+static void ECSRandomGetChunked(benchmark::State& state) { BenchmarkECSRandomGet<lcs::ComponentType::ComponentChunked>(state); }
+
+/* Walks all 1M entities and keeps those with Position and Velocity but without Player, each held by half of them.
+ * HasComponent reads the entity signature, so this measures the filter independent of where the components live */
+template <lcs::ComponentType ct>
+static void BenchmarkECSHasFilter(benchmark::State& state)
+{
+	using Setup = becs::SuiteSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using EntityID = becs::EntityID;
+	using Position = typename Setup::Position;
+	using Velocity = typename Setup::Velocity;
+	using Player = typename Setup::Player;
+
+	srand(7);
+	ECS ecs{};
+	std::vector<EntityID> entities(entity_count);
+	ecs.CreateEntities(entity_count, entities);
+	for (const EntityID e : becs::SelectNRandomEntriesFrom(entities, entity_count / 2)) ecs.template AddComponent<Position>(e, { 0, 0 });
+	for (const EntityID e : becs::SelectNRandomEntriesFrom(entities, entity_count / 2)) ecs.template AddComponent<Velocity>(e, { 1, 1 });
+	for (const EntityID e : becs::SelectNRandomEntriesFrom(entities, entity_count / 2)) ecs.template AddComponent<Player>(e, { true, false, true, false });
+
+	uint32_t matches = 0;
+	for (auto _ : state)
+	{
+		matches = 0;
+		for (const EntityID e : entities)
+		{
+			matches += ecs.template HasComponent<Position>(e) && ecs.template HasComponent<Velocity>(e) && !ecs.template HasComponent<Player>(e);
+		}
+		benchmark::DoNotOptimize(matches);
+	}
+	state.SetItemsProcessed(state.iterations() * entity_count);
+	state.counters["matches"] = double(matches);
+}
+
+static void ECSHasFilterNormal(benchmark::State& state) { BenchmarkECSHasFilter<lcs::ComponentType::Component>(state); }
+static void ECSHasFilterChunked(benchmark::State& state) { BenchmarkECSHasFilter<lcs::ComponentType::ComponentChunked>(state); }
+
+/* Iterates a tag held by range(0)% of 1M entities and reads the Position of every tagged entity */
+template <lcs::ComponentType ct>
+static void BenchmarkECSTagIteration(benchmark::State& state)
+{
+	using Setup = becs::SuiteSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using EntityID = becs::EntityID;
+	using Position = typename Setup::Position;
+	using IsVisible = typename Setup::IsVisible;
+
+	srand(7);
+	const uint32_t tagged_count = uint32_t(uint64_t(entity_count) * state.range(0) / 100);
+	ECS ecs{};
+	std::vector<EntityID> entities(entity_count);
+	ecs.CreateEntities(entity_count, entities);
+	for (const EntityID e : entities) ecs.template AddComponent<Position>(e, { 1, 2 });
+	for (const EntityID e : becs::SelectNRandomEntriesFrom(entities, tagged_count)) ecs.template AddTag<IsVisible>(e);
+
+	for (auto _ : state)
+	{
+		int64_t sum = 0;
+		for (const EntityID e : ecs.template TView<IsVisible>()) sum += ecs.template GetComponent<Position>(e).y;
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed(state.iterations() * tagged_count);
+}
+
+static void ECSTagIterationNormal(benchmark::State& state) { BenchmarkECSTagIteration<lcs::ComponentType::Component>(state); }
+static void ECSTagIterationChunked(benchmark::State& state) { BenchmarkECSTagIteration<lcs::ComponentType::ComponentChunked>(state); }
+
+/* Clears a world of 1M entities with Position, Velocity and Player, range(0)% of them holding each component */
+template <lcs::ComponentType ct>
+static void BenchmarkECSClear(benchmark::State& state)
+{
+	using Setup = becs::SuiteSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using EntityID = becs::EntityID;
+	using Position = typename Setup::Position;
+	using Velocity = typename Setup::Velocity;
+	using Player = typename Setup::Player;
+
+	srand(7);
+	const uint32_t holder_count = uint32_t(uint64_t(entity_count) * state.range(0) / 100);
+	ECS ecs{};
+	std::vector<EntityID> entities(entity_count);
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		ecs.CreateEntities(entity_count, entities);
+		for (uint32_t i = 0; i < holder_count; i++)
+		{
+			const EntityID e = entities[uint64_t(i) * entity_count / holder_count];
+			ecs.template AddComponent<Position>(e, { 0, 0 });
+			ecs.template AddComponent<Velocity>(e, { 1, 1 });
+			ecs.template AddComponent<Player>(e, { true, false, true, false });
+		}
+		state.ResumeTiming();
+
+		ecs.Clear();
+	}
+	state.SetItemsProcessed(state.iterations() * entity_count);
+}
+
+static void ECSClearNormal(benchmark::State& state) { BenchmarkECSClear<lcs::ComponentType::Component>(state); }
+static void ECSClearChunked(benchmark::State& state) { BenchmarkECSClear<lcs::ComponentType::ComponentChunked>(state); }
+
+/* Joined Position and Velocity iteration over range(0) entities, half of them holding each component.
+ * Items are the joined entities, about a quarter of range(0) */
+template <lcs::ComponentType ct>
+static void BenchmarkECSScaling(benchmark::State& state)
+{
+	using Setup = becs::SuiteSetup<ct>;
+	using ECS = typename Setup::ECS;
+	using EntityID = becs::EntityID;
+	using Position = typename Setup::Position;
+	using Velocity = typename Setup::Velocity;
+
+	srand(7);
+	const uint32_t count = uint32_t(state.range(0));
+	ECS ecs{};
+	std::vector<EntityID> entities(count);
+	ecs.CreateEntities(count, entities);
+	std::vector<EntityID> moving = becs::SelectNRandomEntriesFrom(entities, count / 2);
+	std::vector<EntityID> placed = becs::SelectNRandomEntriesFrom(entities, count / 2);
+	becs::Sort(moving);
+	becs::Sort(placed);
+	for (const EntityID e : placed) ecs.template AddComponent<Position>(e, { 0, 0 });
+	for (const EntityID e : moving) ecs.template AddComponent<Velocity>(e, { 1, 1 });
+
+	int64_t joined_count = 0;
+	for (auto _ : state)
+	{
+		for (auto [e, p, v] : ecs.template View<Position, Velocity>())
+		{
+			p.x += v.x;
+			p.y += v.y;
+			joined_count++;
+		}
+	}
+	state.SetItemsProcessed(joined_count);
+	becs::AddMemoryCounters<Position>(state, "Position", ecs);
+}
+
+static void ECSScalingNormal(benchmark::State& state) { BenchmarkECSScaling<lcs::ComponentType::Component>(state); }
+static void ECSScalingChunked(benchmark::State& state) { BenchmarkECSScaling<lcs::ComponentType::ComponentChunked>(state); }
+
+/* Sparse index memory of many component types, where every type only covers the entities of a few archetypes.
+ * Entities are created in blocks, each block gets the 4 component types of one archetype. */
+static void SparseIndexMemory(benchmark::State& state)
+{
+	using EntityID = becs::EntityID;
+	using Set = lcs::SparseSet<EntityID, int>;
+
+	const uint32_t set_count = uint32_t(state.range(0));
+	const uint32_t capacity = uint32_t(state.range(1));
+	constexpr uint32_t components_per_entity = 4;
+	constexpr uint32_t block_size = 16 * 1024;
+	const uint32_t archetype_count = set_count / components_per_entity;
+
+	size_t sparse_bytes = 0;
+	for (auto _ : state)
+	{
+		std::vector<Set> sets(set_count);
+		for (Set& set : sets)
+		{
+			set.ReserveSparseSize(capacity);
+		}
+
+		for (uint32_t i = 0; i < capacity; i++)
+		{
+			const EntityID e = EntityID::CreateNew(i);
+			const uint32_t archetype = (i / block_size) % archetype_count;
+			for (uint32_t c = 0; c < components_per_entity; c++)
+			{
+				sets[archetype * components_per_entity + c].Add(e, int(i));
+			}
+		}
+
+		sparse_bytes = 0;
+		for (const Set& set : sets)
+		{
+			sparse_bytes += set.SparseMemoryUsage();
+		}
+	}
+
+	/* A flat index array per set, as every set held before paging */
+	const size_t flat_bytes = size_t(set_count) * capacity * sizeof(EntityID::data_t);
+	state.counters["sparse_MiB"] = double(sparse_bytes) / (1024.0 * 1024.0);
+	state.counters["flat_MiB"] = double(flat_bytes) / (1024.0 * 1024.0);
+}
 
 static void ECSIterationSTD(benchmark::State& state)
 {
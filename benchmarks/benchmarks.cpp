@@ -5,31 +5,253 @@
 BENCHMARK(ECSIterationSTD);
 BENCHMARK(ECSIterationNormal)->Args({ 100 });
 BENCHMARK(ECSIterationChunked)->Args({ 100 });
+BENCHMARK(ECSIterationArchetype)->Args({ 100 });
 BENCHMARK(ECSIterationNormal)->Args({ 90 });
 BENCHMARK(ECSIterationChunked)->Args({ 90 });
+BENCHMARK(ECSIterationArchetype)->Args({ 90 });
 BENCHMARK(ECSIterationNormal)->Args({ 70 });
 BENCHMARK(ECSIterationChunked)->Args({ 70 });
+BENCHMARK(ECSIterationArchetype)->Args({ 70 });
 BENCHMARK(ECSIterationNormal)->Args({ 50 });
 BENCHMARK(ECSIterationChunked)->Args({ 50 });
+BENCHMARK(ECSIterationArchetype)->Args({ 50 });
 BENCHMARK(ECSIterationNormal)->Args({ 30 });
 BENCHMARK(ECSIterationChunked)->Args({ 30 });
+BENCHMARK(ECSIterationArchetype)->Args({ 30 });
 BENCHMARK(ECSIterationNormal)->Args({ 10 });
 BENCHMARK(ECSIterationChunked)->Args({ 10 });
+BENCHMARK(ECSIterationArchetype)->Args({ 10 });
 BENCHMARK(ECSIterationNormal)->Args({ 1 });
 BENCHMARK(ECSIterationChunked)->Args({ 1 });
+BENCHMARK(ECSIterationArchetype)->Args({ 1 });
+BENCHMARK(ECSIterationChunked128)->Args({ 100 });
+BENCHMARK(ECSIterationChunked256)->Args({ 100 });
+BENCHMARK(ECSIterationChunked512)->Args({ 100 });
+BENCHMARK(ECSIterationChunked128)->Args({ 50 });
+BENCHMARK(ECSIterationChunked256)->Args({ 50 });
+BENCHMARK(ECSIterationChunked512)->Args({ 50 });
+BENCHMARK(ECSIterationChunked128)->Args({ 10 });
+BENCHMARK(ECSIterationChunked256)->Args({ 10 });
+BENCHMARK(ECSIterationChunked512)->Args({ 10 });
+BENCHMARK(ECSIterationChunked128)->Args({ 1 });
+BENCHMARK(ECSIterationChunked256)->Args({ 1 });
+BENCHMARK(ECSIterationChunked512)->Args({ 1 });
+BENCHMARK(ECSIterationJoinedChunked)->Args({ 100 });
+BENCHMARK(ECSIterationJoinedChunked128)->Args({ 100 });
+BENCHMARK(ECSIterationJoinedChunked256)->Args({ 100 });
+BENCHMARK(ECSIterationJoinedChunked512)->Args({ 100 });
+BENCHMARK(ECSIterationJoinedChunked)->Args({ 50 });
+BENCHMARK(ECSIterationJoinedChunked128)->Args({ 50 });
+BENCHMARK(ECSIterationJoinedChunked256)->Args({ 50 });
+BENCHMARK(ECSIterationJoinedChunked512)->Args({ 50 });
+BENCHMARK(ECSIterationJoinedChunked)->Args({ 10 });
+BENCHMARK(ECSIterationJoinedChunked128)->Args({ 10 });
+BENCHMARK(ECSIterationJoinedChunked256)->Args({ 10 });
+BENCHMARK(ECSIterationJoinedChunked512)->Args({ 10 });
+BENCHMARK(ECSIterationJoinedChunked)->Args({ 1 });
+BENCHMARK(ECSIterationJoinedChunked128)->Args({ 1 });
+BENCHMARK(ECSIterationJoinedChunked256)->Args({ 1 });
+BENCHMARK(ECSIterationJoinedChunked512)->Args({ 1 });
 BENCHMARK(ECSIterationRndNormal)->Args({ 100 });
 BENCHMARK(ECSIterationRndChunked)->Args({ 100 });
+BENCHMARK(ECSIterationRndArchetype)->Args({ 100 });
 BENCHMARK(ECSIterationRndNormal)->Args({ 90 });
 BENCHMARK(ECSIterationRndChunked)->Args({ 90 });
+BENCHMARK(ECSIterationRndArchetype)->Args({ 90 });
 BENCHMARK(ECSIterationRndNormal)->Args({ 70 });
 BENCHMARK(ECSIterationRndChunked)->Args({ 70 });
+BENCHMARK(ECSIterationRndArchetype)->Args({ 70 });
 BENCHMARK(ECSIterationRndNormal)->Args({ 50 });
 BENCHMARK(ECSIterationRndChunked)->Args({ 50 });
+BENCHMARK(ECSIterationRndArchetype)->Args({ 50 });
 BENCHMARK(ECSIterationRndNormal)->Args({ 30 });
 BENCHMARK(ECSIterationRndChunked)->Args({ 30 });
+BENCHMARK(ECSIterationRndArchetype)->Args({ 30 });
 BENCHMARK(ECSIterationRndNormal)->Args({ 10 });
 BENCHMARK(ECSIterationRndChunked)->Args({ 10 });
+BENCHMARK(ECSIterationRndArchetype)->Args({ 10 });
 BENCHMARK(ECSIterationRndNormal)->Args({ 1 });
 BENCHMARK(ECSIterationRndChunked)->Args({ 1 });
+BENCHMARK(ECSIterationRndArchetype)->Args({ 1 });
+BENCHMARK(ECSIterationJoinedNormal)->Args({ 100 });
+BENCHMARK(ECSIterationJoinedArchetype)->Args({ 100 });
+BENCHMARK(ECSIterationGroup)->Args({ 100 });
+BENCHMARK(ECSIterationJoinedNormal)->Args({ 90 });
+BENCHMARK(ECSIterationJoinedChunked)->Args({ 90 });
+BENCHMARK(ECSIterationJoinedArchetype)->Args({ 90 });
+BENCHMARK(ECSIterationGroup)->Args({ 90 });
+BENCHMARK(ECSIterationJoinedNormal)->Args({ 70 });
+BENCHMARK(ECSIterationJoinedChunked)->Args({ 70 });
+BENCHMARK(ECSIterationJoinedArchetype)->Args({ 70 });
+BENCHMARK(ECSIterationGroup)->Args({ 70 });
+BENCHMARK(ECSIterationJoinedNormal)->Args({ 50 });
+BENCHMARK(ECSIterationJoinedArchetype)->Args({ 50 });
+BENCHMARK(ECSIterationGroup)->Args({ 50 });
+BENCHMARK(ECSIterationJoinedNormal)->Args({ 30 });
+BENCHMARK(ECSIterationJoinedChunked)->Args({ 30 });
+BENCHMARK(ECSIterationJoinedArchetype)->Args({ 30 });
+BENCHMARK(ECSIterationGroup)->Args({ 30 });
+BENCHMARK(ECSIterationJoinedNormal)->Args({ 10 });
+BENCHMARK(ECSIterationJoinedArchetype)->Args({ 10 });
+BENCHMARK(ECSIterationGroup)->Args({ 10 });
+BENCHMARK(ECSIterationJoinedNormal)->Args({ 1 });
+BENCHMARK(ECSIterationJoinedArchetype)->Args({ 1 });
+BENCHMARK(ECSIterationGroup)->Args({ 1 });
+BENCHMARK(ECSIterationRndJoinedNormal)->Args({ 100 });
+BENCHMARK(ECSIterationRndJoinedChunked)->Args({ 100 });
+BENCHMARK(ECSIterationRndJoinedArchetype)->Args({ 100 });
+BENCHMARK(ECSIterationRndGroup)->Args({ 100 });
+BENCHMARK(ECSIterationRndJoinedSortedNormal)->Args({ 100 });
+BENCHMARK(ECSIterationRndJoinedNormal)->Args({ 90 });
+BENCHMARK(ECSIterationRndJoinedChunked)->Args({ 90 });
+BENCHMARK(ECSIterationRndJoinedArchetype)->Args({ 90 });
+BENCHMARK(ECSIterationRndGroup)->Args({ 90 });
+BENCHMARK(ECSIterationRndJoinedNormal)->Args({ 70 });
+BENCHMARK(ECSIterationRndJoinedChunked)->Args({ 70 });
+BENCHMARK(ECSIterationRndJoinedArchetype)->Args({ 70 });
+BENCHMARK(ECSIterationRndGroup)->Args({ 70 });
+BENCHMARK(ECSIterationRndJoinedNormal)->Args({ 50 });
+BENCHMARK(ECSIterationRndJoinedChunked)->Args({ 50 });
+BENCHMARK(ECSIterationRndJoinedArchetype)->Args({ 50 });
+BENCHMARK(ECSIterationRndGroup)->Args({ 50 });
+BENCHMARK(ECSIterationRndJoinedSortedNormal)->Args({ 50 });
+BENCHMARK(ECSIterationRndJoinedNormal)->Args({ 30 });
+BENCHMARK(ECSIterationRndJoinedChunked)->Args({ 30 });
+BENCHMARK(ECSIterationRndJoinedArchetype)->Args({ 30 });
+BENCHMARK(ECSIterationRndGroup)->Args({ 30 });
+BENCHMARK(ECSIterationRndJoinedNormal)->Args({ 10 });
+BENCHMARK(ECSIterationRndJoinedChunked)->Args({ 10 });
+BENCHMARK(ECSIterationRndJoinedArchetype)->Args({ 10 });
+BENCHMARK(ECSIterationRndGroup)->Args({ 10 });
+BENCHMARK(ECSIterationRndJoinedSortedNormal)->Args({ 10 });
+BENCHMARK(ECSIterationRndJoinedNormal)->Args({ 1 });
+BENCHMARK(ECSIterationRndJoinedChunked)->Args({ 1 });
+BENCHMARK(ECSIterationRndJoinedArchetype)->Args({ 1 });
+BENCHMARK(ECSIterationJoinedMixed)->Args({ 100 });
+BENCHMARK(ECSIterationJoinedMixedReadOnly)->Args({ 100 });
+BENCHMARK(ECSIterationJoinedMixed)->Args({ 10 });
+BENCHMARK(ECSIterationJoinedMixedReadOnly)->Args({ 10 });
+BENCHMARK(ECSIterationRndGroup)->Args({ 1 });
+BENCHMARK(ECSResortFull)->Args({ 1, 0 })->Iterations(20)->Unit(benchmark::kMillisecond);
+BENCHMARK(ECSResortFull)->Args({ 10, 0 })->Iterations(20)->Unit(benchmark::kMillisecond);
+BENCHMARK(ECSResortIncremental)->Args({ 1, 65536 })->Iterations(20)->Unit(benchmark::kMillisecond);
+BENCHMARK(ECSResortIncremental)->Args({ 10, 65536 })->Iterations(20)->Unit(benchmark::kMillisecond);
+BENCHMARK(SparseIndexMemory)->Args({ 64, 1024 * 1024 })->Unit(benchmark::kMillisecond);
+BENCHMARK(SparseIndexMemory)->Args({ 200, 4 * 1024 * 1024 })->Unit(benchmark::kMillisecond);
+BENCHMARK(ECSSpawnNormal)->Args({ 100000 });
+BENCHMARK(ECSSpawnBulkNormal)->Args({ 100000 });
+BENCHMARK(ECSSpawnChunked)->Args({ 100000 });
+BENCHMARK(ECSSpawnBulkChunked)->Args({ 100000 });
+BENCHMARK(ECSChurnMallocNormal)->Args({ 10000 });
+BENCHMARK(ECSChurnArenaNormal)->Args({ 10000 });
+BENCHMARK(ECSChurnMallocChunked)->Args({ 10000 });
+BENCHMARK(ECSChurnArenaChunked)->Args({ 10000 });
+BENCHMARK(ECSDeferredChangesScratch);
+BENCHMARK(ECSDeferredChangesCommandBuffer);
+BENCHMARK(ECSChangedSyncScan)->Args({ 1 });
+BENCHMARK(ECSChangedSyncPerChunk)->Args({ 1 });
+BENCHMARK(ECSChangedSyncPerSlot)->Args({ 1 });
+BENCHMARK(ECSChangedSyncScan)->Args({ 10 });
+BENCHMARK(ECSChangedSyncPerChunk)->Args({ 10 });
+BENCHMARK(ECSChangedSyncPerSlot)->Args({ 10 });
+BENCHMARK(ECSChangedSyncScan)->Args({ 100 });
+BENCHMARK(ECSChangedSyncPerChunk)->Args({ 100 });
+BENCHMARK(ECSChangedSyncPerSlot)->Args({ 100 });
+BENCHMARK(ECSChunkKernelIterator)->Args({ 100 });
+BENCHMARK(ECSChunkKernelForEachChunk)->Args({ 100 });
+BENCHMARK(ECSChunkKernelIterator)->Args({ 50 });
+BENCHMARK(ECSChunkKernelForEachChunk)->Args({ 50 });
+BENCHMARK(ECSChunkKernelIterator)->Args({ 10 });
+BENCHMARK(ECSChunkKernelForEachChunk)->Args({ 10 });
+BENCHMARK(ECSEntityIteration)->Args({ 90 });
+BENCHMARK(ECSEntityIteration)->Args({ 50 });
+BENCHMARK(ECSEntityIteration)->Args({ 10 });
+BENCHMARK(ECSEntityIteration)->Args({ 1 });
+BENCHMARK(ECSDespawn)->Args({ 100000 })->Iterations(20);
+BENCHMARK(ECSDespawnChunked)->Args({ 100000 })->Iterations(20);
+BENCHMARK(ECSUnloadNormal)->Args({ 50 })->Iterations(10);
+BENCHMARK(ECSUnloadBulkNormal)->Args({ 50 })->Iterations(10);
+BENCHMARK(ECSUnloadChunked)->Args({ 50 })->Iterations(10);
+BENCHMARK(ECSUnloadBulkChunked)->Args({ 50 })->Iterations(10);
+BENCHMARK(ECSUnloadNormal)->Args({ 5 })->Iterations(10);
+BENCHMARK(ECSUnloadBulkNormal)->Args({ 5 })->Iterations(10);
+BENCHMARK(ECSTagQuerySparse)->Args({ 50 });
+BENCHMARK(ECSTagQueryBitset)->Args({ 50 });
+BENCHMARK(ECSTagQuerySparse)->Args({ 10 });
+BENCHMARK(ECSTagQueryBitset)->Args({ 10 });
+BENCHMARK(ECSRestoreRebuildNormal);
+BENCHMARK(ECSRestoreSnapshotNormal);
+BENCHMARK(ECSRestoreRebuildChunked);
+BENCHMARK(ECSRestoreSnapshotChunked);
+BENCHMARK(ECSSaveFullNormal);
+BENCHMARK(ECSSaveDeltaNormal);
+BENCHMARK(ECSSaveFullChunked);
+BENCHMARK(ECSSaveDeltaChunked);
+BENCHMARK(ECSSaveDeltaAfterReadViewNormal);
+BENCHMARK(ECSSaveDeltaAfterWriteViewNormal);
+BENCHMARK(ECSSaveDeltaAfterReadViewChunked);
+BENCHMARK(ECSSaveDeltaAfterWriteViewChunked);
+BENCHMARK(ECSSystemsSequential)->UseRealTime();
+BENCHMARK(ECSSystemsScheduled)->UseRealTime();
+BENCHMARK(ECSQueryViewNormal);
+BENCHMARK(ECSQueryCachedNormal);
+BENCHMARK(ECSQueryViewChunked);
+BENCHMARK(ECSQueryCachedChunked);
+BENCHMARK(ECSReactivePollNormal);
+BENCHMARK(ECSReactiveEventsNormal);
+BENCHMARK(ECSReactivePollChunked);
+BENCHMARK(ECSReactiveEventsChunked);
+BENCHMARK(ECSEntityChurnNormal)->Args({ 10000 });
+BENCHMARK(ECSEntityChurnChunked)->Args({ 10000 });
+BENCHMARK(ECSComponentChurnNormal)->Args({ 10000 });
+BENCHMARK(ECSComponentChurnChunked)->Args({ 10000 });
+BENCHMARK(ECSRandomGetNormal)->Args({ 100 });
+BENCHMARK(ECSRandomGetChunked)->Args({ 100 });
+BENCHMARK(ECSRandomGetNormal)->Args({ 10 });
+BENCHMARK(ECSRandomGetChunked)->Args({ 10 });
+BENCHMARK(ECSHasFilterNormal);
+BENCHMARK(ECSHasFilterChunked);
+BENCHMARK(ECSTagIterationNormal)->Args({ 50 });
+BENCHMARK(ECSTagIterationChunked)->Args({ 50 });
+BENCHMARK(ECSTagIterationNormal)->Args({ 5 });
+BENCHMARK(ECSTagIterationChunked)->Args({ 5 });
+BENCHMARK(ECSClearNormal)->Args({ 100 })->Iterations(20)->Unit(benchmark::kMillisecond);
+BENCHMARK(ECSClearChunked)->Args({ 100 })->Iterations(20)->Unit(benchmark::kMillisecond);
+BENCHMARK(ECSClearNormal)->Args({ 10 })->Iterations(20)->Unit(benchmark::kMillisecond);
+BENCHMARK(ECSClearChunked)->Args({ 10 })->Iterations(20)->Unit(benchmark::kMillisecond);
+BENCHMARK(ECSScalingNormal)->RangeMultiplier(4)->Range(1 << 10, 1 << 22)->Arg(16000000);
+BENCHMARK(ECSScalingChunked)->RangeMultiplier(4)->Range(1 << 10, 1 << 22)->Arg(16000000);
+BENCHMARK(ECSFieldIntegrationNormal);
+BENCHMARK(ECSFieldIntegrationSoA);
+BENCHMARK(ECSParallelIterationNormal)->Args({ 100, 1024, 0 })->UseRealTime();
+BENCHMARK(ECSParallelIterationChunked)->Args({ 100, 1024, 0 })->UseRealTime();
+BENCHMARK(ECSParallelIterationArchetype)->Args({ 100, 1024, 0 })->UseRealTime();
+BENCHMARK(ECSParallelIterationNormal)->Args({ 100, 1024, 1 })->UseRealTime();
+BENCHMARK(ECSParallelIterationChunked)->Args({ 100, 1024, 1 })->UseRealTime();
+BENCHMARK(ECSParallelIterationArchetype)->Args({ 100, 1024, 1 })->UseRealTime();
+BENCHMARK(ECSParallelIterationNormal)->Args({ 100, 1024, 3 })->UseRealTime();
+BENCHMARK(ECSParallelIterationChunked)->Args({ 100, 1024, 3 })->UseRealTime();
+BENCHMARK(ECSParallelIterationArchetype)->Args({ 100, 1024, 3 })->UseRealTime();
+BENCHMARK(ECSParallelIterationNormal)->Args({ 100, 1024, 7 })->UseRealTime();
+BENCHMARK(ECSParallelIterationChunked)->Args({ 100, 1024, 7 })->UseRealTime();
+BENCHMARK(ECSParallelIterationArchetype)->Args({ 100, 1024, 7 })->UseRealTime();
+BENCHMARK(ECSParallelIterationNormal)->Args({ 100, 16384, 0 })->UseRealTime();
+BENCHMARK(ECSParallelIterationChunked)->Args({ 100, 16384, 0 })->UseRealTime();
+BENCHMARK(ECSParallelIterationArchetype)->Args({ 100, 16384, 0 })->UseRealTime();
+BENCHMARK(ECSParallelIterationNormal)->Args({ 100, 16384, 3 })->UseRealTime();
+BENCHMARK(ECSParallelIterationChunked)->Args({ 100, 16384, 3 })->UseRealTime();
+BENCHMARK(ECSParallelIterationArchetype)->Args({ 100, 16384, 3 })->UseRealTime();
+BENCHMARK(ECSParallelIterationNormal)->Args({ 10, 1024, 0 })->UseRealTime();
+BENCHMARK(ECSParallelIterationChunked)->Args({ 10, 1024, 0 })->UseRealTime();
+BENCHMARK(ECSParallelIterationArchetype)->Args({ 10, 1024, 0 })->UseRealTime();
+BENCHMARK(ECSParallelIterationNormal)->Args({ 10, 1024, 3 })->UseRealTime();
+BENCHMARK(ECSParallelIterationChunked)->Args({ 10, 1024, 3 })->UseRealTime();
+BENCHMARK(ECSParallelIterationArchetype)->Args({ 10, 1024, 3 })->UseRealTime();
+BENCHMARK(ECSParallelIterationNormal)->Args({ 10, 16384, 0 })->UseRealTime();
+BENCHMARK(ECSParallelIterationChunked)->Args({ 10, 16384, 0 })->UseRealTime();
+BENCHMARK(ECSParallelIterationArchetype)->Args({ 10, 16384, 0 })->UseRealTime();
+BENCHMARK(ECSParallelIterationNormal)->Args({ 10, 16384, 3 })->UseRealTime();
+BENCHMARK(ECSParallelIterationChunked)->Args({ 10, 16384, 3 })->UseRealTime();
+BENCHMARK(ECSParallelIterationArchetype)->Args({ 10, 16384, 3 })->UseRealTime();
 
 BENCHMARK_MAIN();
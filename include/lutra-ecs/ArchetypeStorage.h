@@ -0,0 +1,517 @@
+#pragma once
+#include <lutra-ecs/ContainerStats.h>
+#include <lutra-ecs/Handle.h>
+#include <lutra-ecs/Snapshot.h>
+#include <lutra-ecs/TypeTraits.h>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cinttypes>
+#include <memory_resource>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace lcs
+{
+	/* Archetype storage, entities with the same set of components share a table.
+	 * Every table stores one column per component, and adding or removing a component moves the entity's row to another table. */
+	template <typename handle_t, typename... Ts>
+	class ArchetypeStorage
+	{
+	public:
+		using handle_type = handle_t;
+		using data_t = handle_t::data_t;
+		using signature_t = uint64_t;
+
+		static constexpr size_t component_count = sizeof...(Ts);
+		static_assert(component_count <= sizeof(signature_t) * 8);
+
+		template <typename T>
+		static constexpr signature_t component_bit = signature_t(1) << internal_ecs::index_of<T, Ts...>;
+
+		struct Table
+		{
+			explicit Table(std::pmr::memory_resource* resource) : owners(resource), columns(std::pmr::vector<Ts>(resource)...), dirty(resource) {};
+
+			template <typename T>
+			inline std::pmr::vector<T>& Column() { return std::get<std::pmr::vector<T>>(columns); };
+			inline data_t RowCount() const { return data_t(owners.size()); };
+
+			signature_t signature{};
+			std::pmr::vector<handle_t> owners{};
+			std::tuple<std::pmr::vector<Ts>...> columns{};
+			std::array<data_t, component_count> add_edges{};
+			std::array<data_t, component_count> remove_edges{};
+			DirtyBlocks<> dirty{}; /* Over rows */
+		};
+
+		ArchetypeStorage() { root_edges.fill(invalid_index); };
+		explicit ArchetypeStorage(std::pmr::memory_resource* resource) : records(resource), tables(resource), table_lookup(resource), record_dirty(resource) { root_edges.fill(invalid_index); };
+
+		template <typename T> inline void Add(handle_t handle, T&& data);
+		/* Get and TryGet don't mark the row, Write does */
+		template <typename T> inline T& Get(handle_t handle);
+		template <typename T> inline T* TryGet(handle_t handle);
+		template <typename T> inline T& Write(handle_t handle) { MarkChanged(handle); return Get<T>(handle); };
+		template <typename T> inline void Remove(handle_t handle);
+		template <typename T> inline bool Has(handle_t handle) const;
+		/* Record writes for delta snapshots, several threads may mark at once */
+		inline void MarkChanged(handle_t handle);
+		inline void MarkTableChanged(data_t table_index) { Table& table = tables[table_index]; table.dirty.MarkRangeConcurrent(0, table.RowCount()); };
+		template <typename T> inline data_t Size() const { return component_sizes[internal_ecs::index_of<T, Ts...>]; };
+
+		inline void RemoveIfPresent(handle_t handle);
+
+		inline data_t SparseSize() const { return data_t(records.size()); };
+		inline data_t TableCount() const { return data_t(tables.size()); };
+		inline Table& GetTable(data_t table_index) { return tables[table_index]; };
+
+		/* Rows of every table, fill_ratio is their share of the row capacity. The table lookup is an estimate */
+		inline ContainerStats Stats() const;
+		/* The column of T in every table */
+		template <typename T> inline ContainerStats ColumnStats() const;
+
+		inline void ReserveSparseSize(data_t new_size);
+		inline void Clear();
+
+		/* Stores every table with its columns and edges, the table lookup is rebuilt on load */
+		inline void Save(SnapshotWriter& writer) const;
+		inline void Load(SnapshotReader& reader);
+		/* Stores the records and table rows written since the last snapshot, tables are only ever added between clears.
+		 * Views mark the tables they enter, writes through Get, TryGet or table columns have to be reported with MarkChanged */
+		inline void SaveDelta(SnapshotWriter& writer);
+		inline void LoadDelta(SnapshotReader& reader);
+		inline void ResetDirty();
+
+	private:
+		constexpr static data_t invalid_index{ data_t(-1) };
+
+		struct Record
+		{
+			data_t table_index{ invalid_index };
+			data_t row{ invalid_index };
+		};
+
+		inline data_t findOrCreateTable(signature_t signature);
+		inline data_t moveEntity(handle_t handle, data_t to_table_index);
+		inline void removeRow(data_t table_index, data_t row);
+
+		template <size_t I>
+		inline data_t getAddTarget(data_t table_index);
+		template <size_t I>
+		inline data_t getRemoveTarget(data_t table_index);
+
+		inline void assertValidInputHandle(handle_t handle) const;
+		/* Whether records and table rows point at each other, columns and component_sizes match the signatures
+		 * and every edge leads to a table, checked on load */
+		inline bool hasValidIndices() const;
+
+		std::pmr::vector<Record> records{};
+		std::pmr::vector<Table> tables{};
+		std::pmr::unordered_map<signature_t, data_t> table_lookup{};
+		std::array<data_t, component_count> root_edges{};
+		std::array<data_t, component_count> component_sizes{};
+		DirtyBlocks<> record_dirty{};
+	};
+
+	/* Reference to the column of a single component, so archetype components can be used like the other containers */
+	template <typename Storage, typename T>
+	class ArchetypeColumnRef
+	{
+	public:
+		using handle_t = Storage::handle_type;
+		using data_t = Storage::data_t;
+
+		ArchetypeColumnRef(Storage& storage) : storage(storage) {};
+
+		inline void Add(handle_t handle, T&& data) { storage.template Add<T>(handle, std::forward<T>(data)); };
+		inline T& Get(handle_t handle) { return storage.template Get<T>(handle); };
+		inline T* TryGet(handle_t handle) { return storage.template TryGet<T>(handle); };
+		inline T& Write(handle_t handle) { return storage.template Write<T>(handle); };
+		inline void Remove(handle_t handle) { storage.template Remove<T>(handle); };
+		inline bool Has(handle_t handle) const { return storage.template Has<T>(handle); };
+		inline void MarkChanged(handle_t handle) { storage.MarkChanged(handle); };
+		inline data_t Size() const { return storage.template Size<T>(); };
+		inline data_t DenseSize() const { return storage.template Size<T>(); };
+		inline ContainerStats Stats() const { return storage.template ColumnStats<T>(); };
+
+	private:
+		Storage& storage;
+	};
+
+	template <typename handle_t, typename... Ts> template <typename T>
+	void ArchetypeStorage<handle_t, Ts...>::Add(handle_t handle, T&& data)
+	{
+		using Tp = std::remove_cvref_t<T>;
+		constexpr size_t component_index = internal_ecs::index_of<Tp, Ts...>;
+		const auto handle_index = handle.GetIndex();
+		assert(handle_index < SparseSize()); /* Invalid index or missing reservation */
+		assert(!Has<Tp>(handle));
+
+		const data_t to_table_index = getAddTarget<component_index>(records[handle_index].table_index);
+		[[maybe_unused]] const data_t row = moveEntity(handle, to_table_index);
+		tables[to_table_index].template Column<Tp>().emplace_back(std::forward<T>(data));
+		assert(tables[to_table_index].template Column<Tp>().size() == row + 1);
+		component_sizes[component_index]++;
+	}
+
+	template <typename handle_t, typename... Ts> template <typename T>
+	T& ArchetypeStorage<handle_t, Ts...>::Get(handle_t handle)
+	{
+		assertValidInputHandle(handle);
+		assert(Has<T>(handle));
+		const Record record = records[handle.GetIndex()];
+		return tables[record.table_index].template Column<T>()[record.row];
+	}
+
+	template <typename handle_t, typename... Ts> template <typename T>
+	T* ArchetypeStorage<handle_t, Ts...>::TryGet(handle_t handle)
+	{
+		const auto handle_index = handle.GetIndex();
+		assert(handle_index < SparseSize());
+		const Record record = records[handle_index];
+		if (record.table_index == invalid_index) return nullptr;
+
+		Table& table = tables[record.table_index];
+		if ((table.signature & component_bit<T>) == 0) return nullptr;
+		assert(table.owners[record.row].GetValidationID() == handle.GetValidationID()); /* Check for stale handle */
+		return &table.template Column<T>()[record.row];
+	}
+
+	template <typename handle_t, typename... Ts> template <typename T>
+	void ArchetypeStorage<handle_t, Ts...>::Remove(handle_t handle)
+	{
+		constexpr size_t component_index = internal_ecs::index_of<T, Ts...>;
+		assertValidInputHandle(handle);
+		assert(Has<T>(handle));
+
+		const auto handle_index = handle.GetIndex();
+		const data_t to_table_index = getRemoveTarget<component_index>(records[handle_index].table_index);
+		if (to_table_index == invalid_index)
+		{
+			/* Last component of the entity */
+			removeRow(records[handle_index].table_index, records[handle_index].row);
+			records[handle_index] = {};
+			record_dirty.Mark(handle_index);
+		}
+		else
+		{
+			moveEntity(handle, to_table_index);
+		}
+		component_sizes[component_index]--;
+	}
+
+	template <typename handle_t, typename... Ts> template <typename T>
+	bool ArchetypeStorage<handle_t, Ts...>::Has(handle_t handle) const
+	{
+		const auto handle_index = handle.GetIndex();
+		assert(handle_index < SparseSize());
+		const Record record = records[handle_index];
+		if (record.table_index == invalid_index) return false;
+		assert(tables[record.table_index].owners[record.row].GetValidationID() == handle.GetValidationID()); /* Check for stale handle */
+		return (tables[record.table_index].signature & component_bit<T>) != 0;
+	}
+
+	template <typename handle_t, typename... Ts>
+	void ArchetypeStorage<handle_t, Ts...>::RemoveIfPresent(handle_t handle)
+	{
+		if constexpr (component_count > 0)
+		{
+			const auto handle_index = handle.GetIndex();
+			assert(handle_index < SparseSize());
+			const Record record = records[handle_index];
+			if (record.table_index == invalid_index) return;
+
+			const signature_t signature = tables[record.table_index].signature;
+			[&]<size_t... I>(std::index_sequence<I...>) { ((component_sizes[I] -= ((signature >> I) & 1)), ...); }(std::index_sequence_for<Ts...>{});
+			removeRow(record.table_index, record.row);
+			records[handle_index] = {};
+			record_dirty.Mark(handle_index);
+		}
+	}
+
+	template <typename handle_t, typename... Ts>
+	inline void ArchetypeStorage<handle_t, Ts...>::ReserveSparseSize(data_t new_size)
+	{
+		if constexpr (component_count > 0)
+		{
+			assert(new_size > SparseSize());
+			records.resize(size_t(new_size));
+		}
+	}
+
+	template <typename handle_t, typename... Ts>
+	inline void ArchetypeStorage<handle_t, Ts...>::Clear()
+	{
+		records.clear();
+		tables.clear();
+		table_lookup.clear();
+		root_edges.fill(invalid_index);
+		component_sizes.fill(0);
+		record_dirty.MarkCleared();
+	}
+
+	template <typename handle_t, typename... Ts>
+	inline void ArchetypeStorage<handle_t, Ts...>::Save(SnapshotWriter& writer) const
+	{
+		writer.WriteArray(std::span<const Record>(records));
+		writer.Write(uint64_t(tables.size()));
+		for (const Table& table : tables)
+		{
+			writer.Write(table.signature);
+			writer.WriteArray(std::span<const handle_t>(table.owners));
+			std::apply([&](const auto&... column) { (writer.WriteArray(std::span(column.data(), column.size())), ...); }, table.columns);
+			writer.Write(table.add_edges);
+			writer.Write(table.remove_edges);
+		}
+		writer.Write(root_edges);
+		writer.Write(component_sizes);
+	}
+
+	template <typename handle_t, typename... Ts>
+	inline void ArchetypeStorage<handle_t, Ts...>::Load(SnapshotReader& reader)
+	{
+		Clear();
+		reader.ReadArray(records);
+		const uint64_t table_count = reader.Read<uint64_t>();
+		for (uint64_t table_index = 0; table_index < table_count && !reader.Failed(); table_index++)
+		{
+			Table& table = tables.emplace_back(tables.get_allocator().resource());
+			table.signature = reader.Read<signature_t>();
+			reader.ReadArray(table.owners);
+			std::apply([&](auto&... column) { (reader.ReadArray(column), ...); }, table.columns);
+			table.add_edges = reader.Read<std::array<data_t, component_count>>();
+			table.remove_edges = reader.Read<std::array<data_t, component_count>>();
+			table_lookup.emplace(table.signature, data_t(table_index));
+		}
+		root_edges = reader.Read<std::array<data_t, component_count>>();
+		component_sizes = reader.Read<std::array<data_t, component_count>>();
+		if (!hasValidIndices()) reader.Fail();
+		ResetDirty();
+	}
+
+	template <typename handle_t, typename... Ts>
+	void ArchetypeStorage<handle_t, Ts...>::MarkChanged(handle_t handle)
+	{
+		assertValidInputHandle(handle);
+		const Record record = records[handle.GetIndex()];
+		tables[record.table_index].dirty.MarkConcurrent(record.row);
+	}
+
+	template <typename handle_t, typename... Ts>
+	inline void ArchetypeStorage<handle_t, Ts...>::SaveDelta(SnapshotWriter& writer)
+	{
+		writer.WriteDirty(std::span<const Record>(records), record_dirty);
+		writer.Write(uint64_t(tables.size()));
+		for (const Table& table : tables)
+		{
+			writer.Write(table.signature);
+			writer.WriteDirty(std::span<const handle_t>(table.owners), table.dirty);
+			std::apply([&](const auto&... column) { (writer.WriteDirty(std::span(column.data(), column.size()), table.dirty), ...); }, table.columns);
+			writer.Write(table.add_edges);
+			writer.Write(table.remove_edges);
+		}
+		writer.Write(root_edges);
+		writer.Write(component_sizes);
+		ResetDirty();
+	}
+
+	template <typename handle_t, typename... Ts>
+	inline void ArchetypeStorage<handle_t, Ts...>::LoadDelta(SnapshotReader& reader)
+	{
+		/* Tables of the stream replace the existing ones after a clear */
+		reader.ReadDirty<Record>(internal_ecs::max_snapshot_entries<handle_t>, [&](bool cleared, size_t size) { if (cleared) Clear(); records.resize(size); },
+			[&](size_t first, std::span<const Record> values) { std::copy(values.begin(), values.end(), records.begin() + first); });
+		const uint64_t table_count = reader.Read<uint64_t>();
+		if (table_count < tables.size()) reader.Fail();
+		for (uint64_t table_index = 0; table_index < table_count && !reader.Failed(); table_index++)
+		{
+			if (table_index == tables.size()) tables.emplace_back(tables.get_allocator().resource());
+			Table& table = tables[table_index];
+			table.signature = reader.Read<signature_t>();
+			reader.ReadDirty(table.owners, internal_ecs::max_snapshot_entries<handle_t>);
+			std::apply([&](auto&... column) { (reader.ReadDirty(column, internal_ecs::max_snapshot_entries<handle_t>), ...); }, table.columns);
+			table.add_edges = reader.Read<std::array<data_t, component_count>>();
+			table.remove_edges = reader.Read<std::array<data_t, component_count>>();
+			table_lookup[table.signature] = data_t(table_index);
+		}
+		root_edges = reader.Read<std::array<data_t, component_count>>();
+		component_sizes = reader.Read<std::array<data_t, component_count>>();
+		if (!hasValidIndices()) reader.Fail();
+		ResetDirty();
+	}
+
+	template <typename handle_t, typename... Ts>
+	bool ArchetypeStorage<handle_t, Ts...>::hasValidIndices() const
+	{
+		const auto leads_to_table = [&](data_t table_index) { return table_index == invalid_index || table_index < tables.size(); };
+		if (!std::ranges::all_of(root_edges, leads_to_table)) return false;
+
+		constexpr signature_t all_components = (signature_t(0) | ... | component_bit<Ts>);
+		std::array<data_t, component_count> column_sizes{};
+		size_t row_count = 0;
+		for (data_t table_index = 0; table_index < TableCount(); table_index++)
+		{
+			const Table& table = tables[table_index];
+			const data_t rows = table.RowCount();
+			if ((table.signature & ~all_components) != 0 || !std::ranges::all_of(table.add_edges, leads_to_table) || !std::ranges::all_of(table.remove_edges, leads_to_table)) return false;
+			if (!((std::get<std::pmr::vector<Ts>>(table.columns).size() == ((table.signature & component_bit<Ts>) != 0 ? rows : 0)) && ...)) return false;
+			((column_sizes[internal_ecs::index_of<Ts, Ts...>] += (table.signature & component_bit<Ts>) != 0 ? rows : 0), ...);
+
+			for (data_t row = 0; row < rows; row++)
+			{
+				const data_t handle_index = table.owners[row].GetIndex();
+				if (handle_index >= records.size() || records[handle_index].table_index != table_index || records[handle_index].row != row) return false;
+			}
+			row_count += rows;
+		}
+
+		/* Every row reaches its own record, so there are no other records if the counts match */
+		const size_t record_count = size_t(std::ranges::count_if(records, [](const Record& record) { return record.table_index != invalid_index; }));
+		return record_count == row_count && column_sizes == component_sizes;
+	}
+
+	template <typename handle_t, typename... Ts>
+	ContainerStats ArchetypeStorage<handle_t, Ts...>::Stats() const
+	{
+		using LookupEntry = typename decltype(table_lookup)::value_type;
+		uint64_t rows = 0;
+		uint64_t row_capacity = 0;
+		size_t bytes = internal_ecs::CapacityBytes(records) + internal_ecs::CapacityBytes(tables) + record_dirty.MemoryUsage()
+			+ table_lookup.bucket_count() * sizeof(void*) + table_lookup.size() * (sizeof(LookupEntry) + 2 * sizeof(void*));
+		for (const Table& table : tables)
+		{
+			rows += table.owners.size();
+			row_capacity += table.owners.capacity();
+			bytes += internal_ecs::CapacityBytes(table.owners) + table.dirty.MemoryUsage();
+			std::apply([&](const auto&... column) { ((bytes += internal_ecs::CapacityBytes(column)), ...); }, table.columns);
+		}
+		return { rows, SparseSize(), bytes, internal_ecs::FillRatio(rows, row_capacity), 0 };
+	}
+
+	template <typename handle_t, typename... Ts> template <typename T>
+	ContainerStats ArchetypeStorage<handle_t, Ts...>::ColumnStats() const
+	{
+		uint64_t slots = 0;
+		size_t bytes = 0;
+		for (const Table& table : tables)
+		{
+			const std::pmr::vector<T>& column = std::get<std::pmr::vector<T>>(table.columns);
+			slots += column.capacity();
+			bytes += internal_ecs::CapacityBytes(column);
+		}
+		return { Size<T>(), SparseSize(), bytes, internal_ecs::FillRatio(Size<T>(), slots), 0 };
+	}
+
+	template <typename handle_t, typename... Ts>
+	inline void ArchetypeStorage<handle_t, Ts...>::ResetDirty()
+	{
+		record_dirty.Reset();
+		for (Table& table : tables) table.dirty.Reset(table.RowCount());
+	}
+
+	template <typename handle_t, typename... Ts>
+	inline ArchetypeStorage<handle_t, Ts...>::data_t ArchetypeStorage<handle_t, Ts...>::findOrCreateTable(signature_t signature)
+	{
+		const auto it = table_lookup.find(signature);
+		if (it != table_lookup.end()) return it->second;
+
+		const data_t table_index = data_t(tables.size());
+		Table& table = tables.emplace_back(tables.get_allocator().resource());
+		table.signature = signature;
+		table.add_edges.fill(invalid_index);
+		table.remove_edges.fill(invalid_index);
+		table_lookup.emplace(signature, table_index);
+		return table_index;
+	}
+
+	/* Moves the components the two tables have in common to a new row in the target table, returns the new row */
+	template <typename handle_t, typename... Ts>
+	inline ArchetypeStorage<handle_t, Ts...>::data_t ArchetypeStorage<handle_t, Ts...>::moveEntity(handle_t handle, data_t to_table_index)
+	{
+		Record& record = records[handle.GetIndex()];
+		Table& to_table = tables[to_table_index];
+		const data_t to_row = to_table.RowCount();
+		to_table.owners.push_back(handle);
+		to_table.dirty.Mark(to_row);
+		record_dirty.Mark(handle.GetIndex());
+
+		if (record.table_index != invalid_index)
+		{
+			Table& from_table = tables[record.table_index];
+			const signature_t shared_signature = from_table.signature & to_table.signature;
+			[&]<size_t... I>(std::index_sequence<I...>)
+			{
+				((((shared_signature >> I) & 1) ? (void)std::get<I>(to_table.columns).push_back(std::move(std::get<I>(from_table.columns)[record.row])) : void()), ...);
+			}(std::index_sequence_for<Ts...>{});
+			removeRow(record.table_index, record.row);
+		}
+
+		record = { to_table_index, to_row };
+		return to_row;
+	}
+
+	/* Swap-removes a row from every column of the table */
+	template <typename handle_t, typename... Ts>
+	inline void ArchetypeStorage<handle_t, Ts...>::removeRow(data_t table_index, data_t row)
+	{
+		Table& table = tables[table_index];
+		const data_t back_row = table.RowCount() - 1;
+		if (row != back_row)
+		{
+			const handle_t back_handle = table.owners[back_row];
+			table.owners[row] = back_handle;
+			records[back_handle.GetIndex()].row = row;
+			record_dirty.Mark(back_handle.GetIndex());
+			table.dirty.Mark(row);
+		}
+		table.owners.pop_back();
+
+		[&]<size_t... I>(std::index_sequence<I...>)
+		{
+			(((table.signature >> I) & 1 ? (void)(
+				(row != back_row ? (void)(std::get<I>(table.columns)[row] = std::move(std::get<I>(table.columns)[back_row])) : void()),
+				std::get<I>(table.columns).pop_back()) : void()), ...);
+		}(std::index_sequence_for<Ts...>{});
+	}
+
+	template <typename handle_t, typename... Ts> template <size_t I>
+	inline ArchetypeStorage<handle_t, Ts...>::data_t ArchetypeStorage<handle_t, Ts...>::getAddTarget(data_t table_index)
+	{
+		data_t& edge = (table_index == invalid_index) ? root_edges[I] : tables[table_index].add_edges[I];
+		if (edge != invalid_index) return edge;
+
+		const signature_t signature = (table_index == invalid_index) ? 0 : tables[table_index].signature;
+		const data_t target = findOrCreateTable(signature | (signature_t(1) << I));
+
+		/* Table creation may have moved the tables, so the edge is looked up again */
+		((table_index == invalid_index) ? root_edges[I] : tables[table_index].add_edges[I]) = target;
+		return target;
+	}
+
+	template <typename handle_t, typename... Ts> template <size_t I>
+	inline ArchetypeStorage<handle_t, Ts...>::data_t ArchetypeStorage<handle_t, Ts...>::getRemoveTarget(data_t table_index)
+	{
+		const data_t edge = tables[table_index].remove_edges[I];
+		if (edge != invalid_index) return edge;
+
+		const signature_t signature = tables[table_index].signature & ~(signature_t(1) << I);
+		if (signature == 0) return invalid_index;
+
+		const data_t target = findOrCreateTable(signature);
+		tables[table_index].remove_edges[I] = target;
+		return target;
+	}
+
+	template <typename handle_t, typename... Ts>
+	inline void ArchetypeStorage<handle_t, Ts...>::assertValidInputHandle(handle_t handle) const
+	{
+		[[maybe_unused]] const auto handle_index = handle.GetIndex();
+		assert(handle_index < SparseSize());
+		assert(records[handle_index].table_index != invalid_index);
+		assert(records[handle_index].row < tables[records[handle_index].table_index].RowCount());
+		assert(tables[records[handle_index].table_index].owners[records[handle_index].row].GetValidationID() == handle.GetValidationID()); /* Check for stale handle */
+	}
+}
@@ -1,14 +1,26 @@
 #pragma once
+#include <array>
 #include <cassert>
 #include <cinttypes>
+#include <cstddef>
 #include <bit>
+#include <type_traits>
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define LUTRA_ECS_SSE2
+#include <emmintrin.h>
+#endif
 
 namespace lcs
 {
 	template <typename T>
 	struct BitMask
 	{
+		using index_t = uint8_t;
 		static constexpr uint8_t bit_count = sizeof(T) * 8;
+		static constexpr size_t word_count = 1;
+
+		inline static BitMask Full() { return { T(~T(0)) }; };
 
 		inline void SetBit(uint8_t bit)
 		{
@@ -28,6 +40,17 @@ namespace lcs
 		}
 
 		inline bool IsZero() const { return mask == T(0); };
+		inline uint32_t PopCount() const { return uint32_t(std::popcount(mask)); };
+		/* Index of the lowest set bit, bit_count if none is set */
+		inline uint32_t FirstSet() const { return uint32_t(std::countr_zero(mask)); };
+
+		inline T& Word([[maybe_unused]] size_t word_index) { assert(word_index == 0); return mask; };
+		inline T Word([[maybe_unused]] size_t word_index) const { assert(word_index == 0); return mask; };
+
+		inline BitMask& operator&=(BitMask other) { mask &= other.mask; return *this; };
+		friend inline BitMask operator& (BitMask a, BitMask b) { return { T(a.mask & b.mask) }; };
+		/* Bits of this mask that are not set in other */
+		inline BitMask& AndNot(BitMask other) { mask &= T(~other.mask); return *this; };
 
 		class Iterator
 		{
@@ -99,11 +122,196 @@ namespace lcs
 			Iterator it{};
 		};
 
-		inline Iterator begin() { return Iterator::Create(*this); };
-		inline Iterator end() { return Iterator::Create(BitMask(T(0))); };
-		inline RIterator rbegin() { return RIterator(Iterator::CreateReverse(*this)); };
-		inline RIterator rend() { return RIterator(Iterator::CreateReverse(BitMask(T(0)))); };
+		inline Iterator begin() const { return Iterator::Create(*this); };
+		inline Iterator end() const { return Iterator::Create(BitMask(T(0))); };
+		inline RIterator rbegin() const { return RIterator(Iterator::CreateReverse(*this)); };
+		inline RIterator rend() const { return RIterator(Iterator::CreateReverse(BitMask(T(0)))); };
 
 		T mask{};
 	};
-}
\ No newline at end of file
+
+	/* Bit mask spanning several 64 bit words, for chunks wider than 64 entries.
+	 * With SSE2 the words are handled two at a time (pand/pandn/por, zero tests through pcmpeqb and pmovmskb), an odd last
+	 * word and builds without SSE2 use plain word loops. SSE2 has no popcount, PopCount adds up std::popcount per word */
+	template <size_t bits>
+	struct WideBitMask
+	{
+		static_assert(bits % 64 == 0 && bits > 64);
+
+		using word_t = uint64_t;
+		using index_t = uint16_t;
+		static constexpr size_t bit_count = bits;
+		static constexpr size_t word_count = bits / 64;
+
+		inline static WideBitMask Full() { WideBitMask result; result.words.fill(~word_t(0)); return result; };
+
+		inline void SetBit(index_t bit)
+		{
+			assert(bit < bit_count);
+			words[bit / 64] |= word_t(1) << (bit % 64);
+		}
+
+		inline void ClearBit(index_t bit)
+		{
+			assert(bit < bit_count);
+			words[bit / 64] &= ~(word_t(1) << (bit % 64));
+		}
+
+		inline bool IsBitSet(index_t bit) const
+		{
+			return (words[bit / 64] & (word_t(1) << (bit % 64))) != 0;
+		}
+
+		inline bool IsZero() const
+		{
+#if defined(LUTRA_ECS_SSE2)
+			__m128i any = _mm_setzero_si128();
+			for (size_t i = 0; i < pair_count * 2; i += 2) any = _mm_or_si128(any, loadPair(&words[i]));
+			if constexpr (word_count % 2 != 0) { if (words[word_count - 1] != 0) return false; }
+			return isZeroPair(any);
+#else
+			word_t any = 0;
+			for (size_t i = 0; i < word_count; i++) any |= words[i];
+			return any == 0;
+#endif
+		}
+
+		inline uint32_t PopCount() const
+		{
+			uint32_t count = 0;
+			for (size_t i = 0; i < word_count; i++) count += uint32_t(std::popcount(words[i]));
+			return count;
+		}
+
+		/* Index of the lowest set bit, bit_count if none is set */
+		inline uint32_t FirstSet() const
+		{
+#if defined(LUTRA_ECS_SSE2)
+			for (size_t i = 0; i < pair_count * 2; i += 2)
+			{
+				if (isZeroPair(loadPair(&words[i]))) continue;
+				const size_t word_index = words[i] != 0 ? i : i + 1;
+				return uint32_t(word_index * 64 + std::countr_zero(words[word_index]));
+			}
+			if constexpr (word_count % 2 != 0)
+			{
+				if (words[word_count - 1] != 0) return uint32_t((word_count - 1) * 64 + std::countr_zero(words[word_count - 1]));
+			}
+			return uint32_t(bit_count);
+#else
+			for (size_t i = 0; i < word_count; i++)
+			{
+				if (words[i] != 0) return uint32_t(i * 64 + std::countr_zero(words[i]));
+			}
+			return uint32_t(bit_count);
+#endif
+		}
+
+		inline word_t& Word(size_t word_index) { return words[word_index]; };
+		inline word_t Word(size_t word_index) const { return words[word_index]; };
+
+		inline WideBitMask& operator&=(const WideBitMask& other)
+		{
+#if defined(LUTRA_ECS_SSE2)
+			for (size_t i = 0; i < pair_count * 2; i += 2) storePair(&words[i], _mm_and_si128(loadPair(&words[i]), loadPair(&other.words[i])));
+			if constexpr (word_count % 2 != 0) words[word_count - 1] &= other.words[word_count - 1];
+#else
+			for (size_t i = 0; i < word_count; i++) words[i] &= other.words[i];
+#endif
+			return *this;
+		};
+		friend inline WideBitMask operator& (WideBitMask a, const WideBitMask& b) { return a &= b; };
+
+		/* Bits of this mask that are not set in other */
+		inline WideBitMask& AndNot(const WideBitMask& other)
+		{
+#if defined(LUTRA_ECS_SSE2)
+			/* _mm_andnot_si128(a, b) is ~a & b */
+			for (size_t i = 0; i < pair_count * 2; i += 2) storePair(&words[i], _mm_andnot_si128(loadPair(&other.words[i]), loadPair(&words[i])));
+			if constexpr (word_count % 2 != 0) words[word_count - 1] &= ~other.words[word_count - 1];
+#else
+			for (size_t i = 0; i < word_count; i++) words[i] &= ~other.words[i];
+#endif
+			return *this;
+		};
+
+		/* Walks the set bits from low to high, the iterator keeps its own copy of the words.
+		 * The word being walked is kept apart, so stepping within a word works like the single word iterator */
+		class Iterator
+		{
+		public:
+			inline Iterator() {};
+
+			inline static Iterator Create(const WideBitMask& mask)
+			{
+				Iterator it{};
+				it.words = mask.words;
+				it.word_index = 0;
+				it.current = it.words[0];
+				if (it.current == 0) it.nextWord();
+				return it;
+			}
+
+			inline index_t operator*() const { return index_t(word_index * 64 + std::countr_zero(current)); }
+
+			inline Iterator& operator++()
+			{
+				current &= current - 1;
+				if (current == 0) nextWord();
+				return *this;
+			}
+
+			inline Iterator operator++(int)
+			{
+				Iterator tmp = *this; ++(*this); return tmp;
+			}
+
+			inline bool IsZero() const { return current == 0; };
+			friend bool operator== (const Iterator& a, const Iterator& b) { return a.current == b.current && a.word_index == b.word_index; };
+			friend bool operator!= (const Iterator& a, const Iterator& b) { return !(a == b); };
+
+		private:
+			inline void nextWord()
+			{
+				for (word_index++; word_index < word_count; word_index++)
+				{
+					current = words[word_index];
+					if (current != 0) return;
+				}
+			}
+
+			std::array<word_t, word_count> words{};
+			word_t current{ 0 };
+			size_t word_index{ word_count };
+		};
+
+		inline Iterator begin() const { return Iterator::Create(*this); };
+		inline Iterator end() const { return Iterator(); };
+
+		std::array<word_t, word_count> words{};
+
+	private:
+#if defined(LUTRA_ECS_SSE2)
+		static constexpr size_t pair_count = word_count / 2;
+
+		/* The words are only 8 byte aligned, so pairs are loaded and stored unaligned */
+		inline static __m128i loadPair(const word_t* pair) { return _mm_loadu_si128(reinterpret_cast<const __m128i*>(pair)); };
+		inline static void storePair(word_t* pair, __m128i value) { _mm_storeu_si128(reinterpret_cast<__m128i*>(pair), value); };
+		inline static bool isZeroPair(__m128i value) { return _mm_movemask_epi8(_mm_cmpeq_epi8(value, _mm_setzero_si128())) == 0xFFFF; };
+#endif
+	};
+
+	namespace internal_ecs
+	{
+		/* Mask with one bit per entry of a chunk, a plain word for 64 entry chunks */
+		template <size_t bits>
+		using ChunkMask = std::conditional_t<bits == 64, BitMask<uint64_t>, WideBitMask<bits>>;
+
+		/* Smallest mask holding one bit per component type */
+		template <size_t bits>
+		using SignatureMask = std::conditional_t<bits <= 8, BitMask<uint8_t>,
+			std::conditional_t<bits <= 16, BitMask<uint16_t>,
+			std::conditional_t<bits <= 32, BitMask<uint32_t>,
+			std::conditional_t<bits <= 64, BitMask<uint64_t>, WideBitMask<(bits + 63) / 64 * 64>>>>>;
+	}
+}
@@ -0,0 +1,149 @@
+#pragma once
+#include <lutra-ecs/Views.h>
+#include <array>
+#include <cinttypes>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace lcs
+{
+	/* Entities having every component in Ts, kept as one row of owner and component pointers per match.
+	 * Every container counts its structural changes in Version(), the rows are rebuilt on the next access after any of the
+	 * versions moved. In steady state iterating is a walk over the rows without a single lookup.
+	 * Like views, begin and ForEach mark the components of every row as written, except those listed as const. */
+	template <typename EntityID, typename... Ts>
+	class CachedQuery
+	{
+		static_assert(sizeof...(Ts) > 0);
+		static_assert(((!internal_ecs::is_tag<Ts>) && ...), "Use TView or QueryTags for tags");
+		static_assert(((Ts::component_type != ComponentType::Archetype) && ...), "Archetype views already walk cached tables");
+
+		template <typename T>
+		using SetType = internal_ecs::ComponentContainer<EntityID, T>;
+		template <typename T>
+		using Pointer = internal_ecs::ComponentPointer<EntityID, T>;
+		template <typename T>
+		using Reference = internal_ecs::ComponentReference<EntityID, T>;
+		using Indices = std::index_sequence_for<Ts...>;
+		using Row = std::tuple<EntityID, Pointer<Ts>...>;
+		static constexpr bool writes = ((!std::is_const_v<Ts>) || ...);
+
+	public:
+		using data_t = EntityID::data_t;
+
+		CachedQuery(SetType<Ts>&... sets) : sets(&sets...) {};
+
+		/* Rebuilds the rows if any container changed its structure since the last build */
+		inline void Refresh() { if (IsStale()) rebuild(Indices{}); };
+		inline bool IsStale() const { return !built || currentVersions(Indices{}) != versions; };
+
+		inline data_t Size() { Refresh(); return data_t(rows.size()); };
+		inline uint64_t BuildCount() const { return build_count; };
+
+		class Iterator
+		{
+		public:
+			/* Accessors */
+			inline std::tuple<EntityID, Reference<Ts>...> operator*() const { return dereference(Indices{}); }
+
+			inline EntityID GetOwner() const { return std::get<0>(*row); }
+
+			/* Prefix increment */
+			inline Iterator& operator++() { row++; return *this; }
+
+			/* Postfix increment */
+			inline Iterator operator++(int) { Iterator tmp = *this; ++(*this); return tmp; }
+
+			friend bool operator== (const Iterator& a, const Iterator& b) { return a.row == b.row; };
+			friend bool operator!= (const Iterator& a, const Iterator& b) { return a.row != b.row; };
+
+		private:
+			inline explicit Iterator(const Row* row) : row(row) {};
+
+			template <size_t... I>
+			inline std::tuple<EntityID, Reference<Ts>...> dereference(std::index_sequence<I...>) const
+			{
+				return std::tuple<EntityID, Reference<Ts>...>(std::get<0>(*row), *std::get<I + 1>(*row)...);
+			}
+
+			const Row* row;
+
+			friend class CachedQuery;
+		};
+
+		inline Iterator begin();
+		inline Iterator end() { return Iterator(rows.data() + rows.size()); };
+
+		/* Calls fn(EntityID, Reference<Ts>...) for every match */
+		template <typename F>
+		inline void ForEach(F&& fn);
+
+	private:
+		template <size_t... I>
+		inline void markRow(const Row& row, std::index_sequence<I...>) { ((std::is_const_v<Ts> ? void() : std::get<I>(sets)->MarkChanged(std::get<0>(row))), ...); };
+
+		template <size_t... I>
+		inline std::array<uint64_t, sizeof...(Ts)> currentVersions(std::index_sequence<I...>) const { return { std::get<I>(sets)->Version()... }; };
+
+		/* The smallest container drives the build, the others are probed once per candidate */
+		template <size_t... I>
+		inline void rebuild(std::index_sequence<I...>);
+
+		std::tuple<SetType<Ts>*...> sets;
+		std::array<uint64_t, sizeof...(Ts)> versions{};
+		bool built{ false };
+		uint64_t build_count{ 0 };
+		std::vector<Row> rows{};
+	};
+
+	template <typename EntityID, typename... Ts>
+	CachedQuery<EntityID, Ts...>::Iterator CachedQuery<EntityID, Ts...>::begin()
+	{
+		Refresh();
+		if constexpr (writes)
+		{
+			for (const Row& row : rows) markRow(row, Indices{});
+		}
+		return Iterator(rows.data());
+	}
+
+	template <typename EntityID, typename... Ts> template <typename F>
+	void CachedQuery<EntityID, Ts...>::ForEach(F&& fn)
+	{
+		Refresh();
+		for (const Row& row : rows)
+		{
+			if constexpr (writes) markRow(row, Indices{});
+			std::apply([&](EntityID owner, Pointer<Ts>... components) { fn(owner, *components...); }, row);
+		}
+	}
+
+	template <typename EntityID, typename... Ts> template <size_t... I>
+	void CachedQuery<EntityID, Ts...>::rebuild(std::index_sequence<I...>)
+	{
+		size_t driver = 0;
+		size_t smallest_size = size_t(-1);
+		((std::get<I>(sets)->DenseSize() < smallest_size ? (smallest_size = std::get<I>(sets)->DenseSize(), driver = I) : 0), ...);
+
+		rows.clear();
+		internal_ecs::VisitIndex<sizeof...(Ts)>(driver, [&]<size_t D>()
+			{
+				auto& driver_set = *std::get<D>(sets);
+				for (auto cursor = driver_set.begin(); cursor != driver_set.end(); ++cursor)
+				{
+					const EntityID owner = cursor.GetOwner();
+					std::tuple<Pointer<Ts>...> components{};
+					std::get<D>(components) = cursor.operator->();
+					if (((I == D || (std::get<I>(components) = std::get<I>(sets)->TryGet(owner)) != nullptr) && ...))
+					{
+						rows.emplace_back(owner, std::get<I>(components)...);
+					}
+				}
+			});
+
+		versions = currentVersions(Indices{});
+		built = true;
+		build_count++;
+	}
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <cstddef>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+namespace lcs
+{
+	/* Entities a container added or removed since the last drain, recorded only while enabled.
+	 * Recording is a push_back, consumers drain the buffers once per frame instead of being called for every change.
+	 * The lists are in the order of the changes but not merged, an entity can be in both and more than once.
+	 * Applying Removed first and then the entries of Added that are still current and still have the component
+	 * always gives the final state. Clear and snapshot loads drop the buffers and set WasReset, consumers then rebuild. */
+	template <typename handle_t>
+	class ChangeEvents
+	{
+	public:
+		ChangeEvents() {};
+		explicit ChangeEvents(std::pmr::memory_resource* resource) : added(resource), removed(resource) {};
+
+		inline void Enable() { enabled = true; };
+		/* Stops recording and drops the buffered events */
+		inline void Disable() { enabled = false; Discard(); };
+		inline bool IsEnabled() const { return enabled; };
+
+		inline void RecordAdd(handle_t handle) { if (enabled) added.push_back(handle); };
+		inline void RecordAdds(std::span<const handle_t> handles) { if (enabled) added.insert(added.end(), handles.begin(), handles.end()); };
+		inline void RecordRemove(handle_t handle) { if (enabled) removed.push_back(handle); };
+		inline void RecordRemoves(std::span<const handle_t> handles) { if (enabled) removed.insert(removed.end(), handles.begin(), handles.end()); };
+		inline void RecordReset() { if (enabled) { added.clear(); removed.clear(); reset = true; } };
+
+		inline std::span<const handle_t> Added() const { return added; };
+		inline std::span<const handle_t> Removed() const { return removed; };
+		inline bool WasReset() const { return reset; };
+		inline bool IsEmpty() const { return added.empty() && removed.empty() && !reset; };
+
+		/* Calls fn(std::span<const handle_t> added, std::span<const handle_t> removed, bool was_reset) and forgets the events.
+		 * The buffers keep their capacity, so steady state recording doesn't allocate */
+		template <typename F>
+		inline void Drain(F&& fn) { fn(Added(), Removed(), reset); Discard(); };
+		inline void Discard() { added.clear(); removed.clear(); reset = false; };
+		inline size_t MemoryUsage() const { return (added.capacity() + removed.capacity()) * sizeof(handle_t); };
+
+	private:
+		std::pmr::vector<handle_t> added;
+		std::pmr::vector<handle_t> removed;
+		bool reset{ false };
+		bool enabled{ false };
+	};
+}
@@ -0,0 +1,278 @@
+#pragma once
+#include <lutra-ecs/ECSManager.h>
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <tuple>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+namespace lcs
+{
+	/* Records structural changes so they can be applied after iteration.
+	 * Flush applies everything in one pass, in this order: creations, component removals, component additions, destructions.
+	 * Every step is sorted by entity index. New components go in through AddComponents, removals through RemoveComponents and
+	 * RemoveTags and destructions through DestroyEntities, added tags one entity at a time. Of several adds of one component to an entity the last one recorded wins,
+	 * and an entity that already has the component gets it overwritten. The buffer keeps its memory between flushes. */
+	template <typename handle_t, typename... Ts>
+	class CommandBuffer
+	{
+	public:
+		using EntityID = handle_t;
+		using data_t = handle_t::data_t;
+		using ECS = ECSManager<handle_t, Ts...>;
+
+		/* Entity created by the buffer, only valid for recording into the same buffer */
+		struct PendingEntity
+		{
+			data_t index;
+		};
+
+		CommandBuffer() {};
+
+		inline PendingEntity CreateEntity() { return { pending_entity_count++ }; };
+		inline void DestroyEntity(EntityID id) { destroys.push_back(id); };
+
+		template <typename T> inline void AddComponent(EntityID id, T&& component);
+		template <typename T> inline void AddComponent(PendingEntity entity, T&& component);
+		template <typename T> inline void RemoveComponent(EntityID id) { std::get<TypeCommands<T>>(commands).removes.push_back(id); };
+
+		template <typename T> inline void AddTag(EntityID id) { AddComponent(id, T{}); };
+		template <typename T> inline void AddTag(PendingEntity entity) { AddComponent(entity, T{}); };
+		template <typename T> inline void RemoveTag(EntityID id) { RemoveComponent<T>(id); };
+
+		/* Moves all commands of other to the back of this buffer */
+		inline void Append(CommandBuffer& other);
+
+		inline void Flush(ECS& ecs);
+		inline bool Empty() const;
+		inline void Clear();
+
+	private:
+		template <typename T>
+		struct TypeCommands
+		{
+			std::vector<std::pair<EntityID, T>> adds{};
+			std::vector<std::pair<data_t, T>> pending_adds{};
+			std::vector<EntityID> removes{};
+
+			/* Adds of entities without the component, handed to AddComponents in one go */
+			std::vector<EntityID> new_ids{};
+			std::vector<T> new_components{};
+		};
+
+		template <typename T> inline void flushRemoves(ECS& ecs);
+		template <typename T> inline void flushAdds(ECS& ecs);
+
+		inline static bool lessByIndex(EntityID a, EntityID b) { return a.GetIndex() < b.GetIndex(); };
+		inline static void sortUnique(std::vector<EntityID>& ids);
+
+		std::tuple<TypeCommands<Ts>...> commands{};
+		std::vector<EntityID> destroys{};
+		std::vector<EntityID> created{};
+		data_t pending_entity_count{ 0 };
+	};
+
+	template <typename handle_t, typename... Ts> template <typename T>
+	void CommandBuffer<handle_t, Ts...>::AddComponent(EntityID id, T&& component)
+	{
+		using Tp = std::remove_cvref_t<T>;
+		std::get<TypeCommands<Tp>>(commands).adds.emplace_back(id, std::forward<T>(component));
+	}
+
+	template <typename handle_t, typename... Ts> template <typename T>
+	void CommandBuffer<handle_t, Ts...>::AddComponent(PendingEntity entity, T&& component)
+	{
+		using Tp = std::remove_cvref_t<T>;
+		assert(entity.index < pending_entity_count);
+		std::get<TypeCommands<Tp>>(commands).pending_adds.emplace_back(entity.index, std::forward<T>(component));
+	}
+
+	template <typename handle_t, typename... Ts>
+	void CommandBuffer<handle_t, Ts...>::Append(CommandBuffer& other)
+	{
+		const data_t pending_offset = pending_entity_count;
+		std::apply([&](auto&... type_commands)
+			{
+				([&](auto& own, auto& others)
+					{
+						own.adds.insert(own.adds.end(), std::make_move_iterator(others.adds.begin()), std::make_move_iterator(others.adds.end()));
+						for (auto& [index, component] : others.pending_adds)
+						{
+							own.pending_adds.emplace_back(index + pending_offset, std::move(component));
+						}
+						own.removes.insert(own.removes.end(), others.removes.begin(), others.removes.end());
+					}(type_commands, std::get<std::remove_reference_t<decltype(type_commands)>>(other.commands)), ...);
+			}, commands);
+		destroys.insert(destroys.end(), other.destroys.begin(), other.destroys.end());
+		pending_entity_count += other.pending_entity_count;
+		other.Clear();
+	}
+
+	template <typename handle_t, typename... Ts>
+	void CommandBuffer<handle_t, Ts...>::Flush(ECS& ecs)
+	{
+		created.resize(pending_entity_count);
+		if (pending_entity_count > 0) ecs.CreateEntities(pending_entity_count, created);
+
+		(flushRemoves<Ts>(ecs), ...);
+		(flushAdds<Ts>(ecs), ...);
+
+		sortUnique(destroys);
+		ecs.DestroyEntities(destroys);
+
+		Clear();
+	}
+
+	template <typename handle_t, typename... Ts>
+	bool CommandBuffer<handle_t, Ts...>::Empty() const
+	{
+		const bool no_type_commands = std::apply([](const auto&... c) { return ((c.adds.empty() && c.pending_adds.empty() && c.removes.empty()) && ...); }, commands);
+		return no_type_commands && destroys.empty() && pending_entity_count == 0;
+	}
+
+	template <typename handle_t, typename... Ts>
+	void CommandBuffer<handle_t, Ts...>::Clear()
+	{
+		std::apply([](auto&... c) { ((c.adds.clear(), c.pending_adds.clear(), c.removes.clear()), ...); }, commands);
+		destroys.clear();
+		created.clear();
+		pending_entity_count = 0;
+	}
+
+	template <typename handle_t, typename... Ts> template <typename T>
+	void CommandBuffer<handle_t, Ts...>::flushRemoves(ECS& ecs)
+	{
+		auto& removes = std::get<TypeCommands<T>>(commands).removes;
+		sortUnique(removes);
+
+		/* Several systems may remove the same component, so missing components are skipped */
+		if constexpr (internal_ecs::is_tag<T>)
+		{
+			std::erase_if(removes, [&](EntityID id) { return !ecs.template HasTag<T>(id); });
+			if (!removes.empty()) ecs.template RemoveTags<T>(removes);
+		}
+		else
+		{
+			std::erase_if(removes, [&](EntityID id) { return !ecs.template HasComponent<T>(id); });
+			if (!removes.empty()) ecs.template RemoveComponents<T>(removes);
+		}
+	}
+
+	template <typename handle_t, typename... Ts> template <typename T>
+	void CommandBuffer<handle_t, Ts...>::flushAdds(ECS& ecs)
+	{
+		auto& type_commands = std::get<TypeCommands<T>>(commands);
+		for (auto& [index, component] : type_commands.pending_adds)
+		{
+			type_commands.adds.emplace_back(created[index], std::move(component));
+		}
+
+		/* Commands recorded while iterating a view often arrive in order already.
+		 * The stable sort keeps adds of the same entity in the order they were recorded, several systems may add to one entity */
+		auto& adds = type_commands.adds;
+		const auto less = [](const auto& a, const auto& b) { return lessByIndex(a.first, b.first); };
+		if (!std::is_sorted(adds.begin(), adds.end(), less)) std::stable_sort(adds.begin(), adds.end(), less);
+
+		auto& new_ids = type_commands.new_ids;
+		auto& new_components = type_commands.new_components;
+		new_ids.clear();
+		new_components.clear();
+		for (size_t i = 0; i < adds.size(); i++)
+		{
+			auto& [id, component] = adds[i];
+			if (i + 1 < adds.size() && adds[i + 1].first.GetIndex() == id.GetIndex()) continue; /* The last add wins */
+
+			if constexpr (internal_ecs::is_tag<T>)
+			{
+				if (!ecs.template HasTag<T>(id)) ecs.template AddTag<T>(id);
+			}
+			else if (ecs.template HasComponent<T>(id))
+			{
+				ecs.template WriteComponent<T>(id) = std::move(component);
+			}
+			else
+			{
+				new_ids.push_back(id);
+				new_components.push_back(std::move(component));
+			}
+		}
+		if constexpr (!internal_ecs::is_tag<T>)
+		{
+			if (!new_ids.empty()) ecs.template AddComponents<T>(new_ids, new_components);
+		}
+	}
+
+	template <typename handle_t, typename... Ts>
+	void CommandBuffer<handle_t, Ts...>::sortUnique(std::vector<EntityID>& ids)
+	{
+		if (!std::is_sorted(ids.begin(), ids.end(), lessByIndex)) std::sort(ids.begin(), ids.end(), lessByIndex);
+		ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+	}
+
+	/* One command buffer per recording thread, for systems running on a thread pool.
+	 * Local() hands out the buffer of the calling thread, Flush merges all of them into a single sorted flush. */
+	template <typename handle_t, typename... Ts>
+	class ParallelCommandBuffer
+	{
+	public:
+		using CommandBufferType = CommandBuffer<handle_t, Ts...>;
+		using ECS = typename CommandBufferType::ECS;
+
+		ParallelCommandBuffer() : id(next_id++) {};
+
+		ParallelCommandBuffer(const ParallelCommandBuffer&) = delete;
+		ParallelCommandBuffer& operator=(const ParallelCommandBuffer&) = delete;
+
+		inline CommandBufferType& Local();
+		inline void Flush(ECS& ecs);
+
+	private:
+		struct LocalCache
+		{
+			uint64_t owner_id{ 0 };
+			CommandBufferType* buffer{ nullptr };
+		};
+
+		/* Ids instead of addresses, so a new instance at the address of a destroyed one misses the cache */
+		inline static std::atomic<uint64_t> next_id{ 1 };
+		inline static thread_local LocalCache local_cache{};
+
+		const uint64_t id;
+		std::mutex mutex{};
+		std::unordered_map<std::thread::id, CommandBufferType*> thread_buffers{};
+		std::vector<std::unique_ptr<CommandBufferType>> buffers{};
+		CommandBufferType merged{};
+	};
+
+	template <typename handle_t, typename... Ts>
+	ParallelCommandBuffer<handle_t, Ts...>::CommandBufferType& ParallelCommandBuffer<handle_t, Ts...>::Local()
+	{
+		if (local_cache.owner_id == id) return *local_cache.buffer;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		CommandBufferType*& buffer = thread_buffers[std::this_thread::get_id()];
+		if (!buffer)
+		{
+			buffers.push_back(std::make_unique<CommandBufferType>());
+			buffer = buffers.back().get();
+		}
+		local_cache = { id, buffer };
+		return *buffer;
+	}
+
+	template <typename handle_t, typename... Ts>
+	void ParallelCommandBuffer<handle_t, Ts...>::Flush(ECS& ecs)
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		for (const auto& buffer : buffers)
+		{
+			merged.Append(*buffer);
+		}
+		merged.Flush(ecs);
+	}
+}
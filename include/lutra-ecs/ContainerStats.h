@@ -0,0 +1,27 @@
+#pragma once
+#include <cinttypes>
+#include <cstddef>
+
+namespace lcs
+{
+	/* Size and memory of a single container, from Stats().
+	 * bytes_allocated counts the capacity of every array the container owns, dirty blocks and event buffers included.
+	 * fill_ratio is occupied over allocated dense slots: chunk slots for chunked sets, bits for bitsets
+	 * and the capacity of the dense arrays for packed containers. A container without dense slots reports 1 */
+	struct ContainerStats
+	{
+		uint64_t dense_count{ 0 }; /* Entries held */
+		uint64_t sparse_capacity{ 0 }; /* Entity indices the sparse side covers */
+		uint64_t bytes_allocated{ 0 };
+		double fill_ratio{ 1.0 };
+		uint64_t free_list_length{ 0 }; /* Freed indices waiting to be reused, only the entity free list has one */
+	};
+
+	namespace internal_ecs
+	{
+		template <typename Vector>
+		inline size_t CapacityBytes(const Vector& vector) { return vector.capacity() * sizeof(typename Vector::value_type); }
+
+		inline double FillRatio(uint64_t occupied, uint64_t slots) { return slots == 0 ? 1.0 : double(occupied) / double(slots); }
+	}
+}
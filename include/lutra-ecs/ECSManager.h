@@ -1,11 +1,19 @@
 #pragma once
+#include <lutra-ecs/CachedQuery.h>
 #include <lutra-ecs/SparseSet.h>
 #include <lutra-ecs/SparseSetChunked.h>
 #include <lutra-ecs/HandleFreeList.h>
+#include <lutra-ecs/OwningGroup.h>
+#include <lutra-ecs/Snapshot.h>
 #include <lutra-ecs/SparseTagSet.h>
 #include <lutra-ecs/Views.h>
 #include <algorithm>
 #include <array>
+#include <cassert>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <span>
 #include <type_traits>
 #include <vector>
 #include <tuple>
@@ -17,43 +25,267 @@ namespace lcs
 	{
 	public:
 		using EntityID = handle_t;
+		using ArchetypeStorageType = internal_ecs::GetArchetypeStorage<EntityID, Ts...>::Storage;
 
 		ECSManager() { reserveComponentStorage(reserved_component_count); };
+		/* All entity and component storage is allocated from resource, which has to outlive the manager */
+		explicit ECSManager(std::pmr::memory_resource* resource);
+
+		/* Groups point into the containers they own, so copies and moves create the same groups again on the new manager */
+		inline ECSManager(const ECSManager& other);
+		inline ECSManager(ECSManager&& other) noexcept;
+		inline ECSManager& operator=(const ECSManager& other);
+		inline ECSManager& operator=(ECSManager&& other) noexcept;
 
 		inline EntityID CreateEntity();
+		inline void CreateEntities(EntityID::data_t count, std::span<EntityID> out);
 		inline void DestroyEntity(EntityID entity);
-		inline const HandleFreeList<EntityID>& Entities() { return entity_id_generator; };
+		/* Destroys every entity in ids, which must be unique. Components are removed in one batch per container */
+		inline void DestroyEntities(std::span<const EntityID> ids);
+		inline const HandleFreeList<EntityID>& Entities() const { return entity_id_generator; };
 		//inline const IndexFreeList::OccupiedIndicesContainer<true> EntitiesReverse() { return entity_id_generator.OccupiedIndicesReverse(); };
 		inline EntityID::data_t GetEntityCount();
 
 		/* Component */
 		template <typename T> inline bool HasComponent(EntityID id);
-		template <typename T> inline T& GetComponent(EntityID id);
-		template <typename T> inline std::remove_reference<T>::type& AddComponent(EntityID id, T&& component);
+		template <typename... Us> inline bool HasAll(EntityID id);
+		/* GetComponent is a plain read, WriteComponent also stamps and marks the component as written */
+		template <typename T> inline decltype(auto) GetComponent(EntityID id);
+		template <typename T> inline decltype(auto) WriteComponent(EntityID id);
+		template <typename T> inline decltype(auto) AddComponent(EntityID id, T&& component);
+		template <typename T> inline void AddComponents(std::span<const EntityID> ids, std::span<const T> components);
 		template <typename T> inline void RemoveComponent(EntityID id);
+		/* Removes T from every entity in ids, which must be unique and have T, in one batch where the container supports it */
+		template <typename T> inline void RemoveComponents(std::span<const EntityID> ids);
 		template <typename T> inline EntityID::data_t GetComponentCount();
-		template <typename T> inline ComponentView<EntityID, T> CView();
+		/* Views mark the components they hand out as written for delta snapshots. Components listed as const,
+		 * View<Position, const Velocity>, are handed out read-only and not marked, read-only passes list all of them as const */
+		template <typename T> inline internal_ecs::GetComponentView<EntityID, ArchetypeStorageType, T>::View CView();
+		template <typename... Us> inline internal_ecs::GetJoinedView<EntityID, ArchetypeStorageType, Us...>::View View();
+		/* Same entities as View, cached until one of the containers changes structurally. Keep it alive across frames */
+		template <typename... Us> inline CachedQuery<EntityID, Us...> Query();
+		template <typename... Us, typename F> inline void ParallelForEach(F&& fn, uint32_t grain_size = default_grain_size);
+		/* The group owning Us, created on first use. A set can only be owned by a single group: nullptr if one of the sets
+		 * is already owned by a group of other components or of the same components in another order, which is left as it is */
+		template <typename... Us> inline OwningGroup<EntityID, Us...>* Group();
+		template <typename T> inline ChangedView<EntityID, T> Changed(uint32_t since_tick);
+		template <typename T> inline void MarkChanged(EntityID id);
+		/* Entities that gained or lost T, recording starts with Events<T>().Enable() */
+		template <typename T> inline ChangeEvents<EntityID>& Events();
+		template <typename T, typename F> inline void ForEachChunk(F&& fn);
+		/* Dense array of one field of a SoA component. ComponentField marks every entry as written, ReadComponentField is read-only */
+		template <auto member> inline auto ComponentField();
+		template <auto member> inline auto ReadComponentField();
+		template <typename T> inline std::span<const EntityID> ComponentOwners();
+		template <typename T> inline bool SortByEntity();
+		template <typename T> inline bool SortByEntityIncremental(size_t max_steps);
+
+		/* Change ticks, stamped by chunked components that set change_tracking on Add, WriteComponent, MarkChanged, ForEachChunk
+		 * and by views handing them out mutably, views over const T and GetComponent or TryGet do not stamp.
+		 * A system that iterates Changed<T>(last_tick) and then sets last_tick = AdvanceTick() sees every change once */
+		inline uint32_t CurrentTick() const { return current_tick; };
+		inline uint32_t AdvanceTick();
 
 		/* Tag */
 		template <typename T> inline bool HasTag(EntityID id);
 		template <typename T> inline void AddTag(EntityID id);
 		template <typename T> inline void RemoveTag(EntityID id);
-		template <typename T> inline TagView<EntityID, T> TView();
+		/* Same as RemoveComponents for tags */
+		template <typename T> inline void RemoveTags(std::span<const EntityID> ids);
+		template <typename T> inline internal_ecs::GetTagView<EntityID, T> TView();
+		/* Entities with every tag in Us and none in Vs, all of them TagBitset tags: QueryTags<A, B>(Exclude<C>{}) */
+		template <typename... Us, typename... Vs> inline TagQuery<EntityID, sizeof...(Us), sizeof...(Vs)> QueryTags(Exclude<Vs...> = {}) const;
+		/* Same with at least one tag in Ws as well: QueryTags<A>(AnyOf<B, C>{}, Exclude<D>{}), Us may be empty */
+		template <typename... Us, typename... Ws, typename... Vs> inline TagQuery<EntityID, sizeof...(Us), sizeof...(Vs), sizeof...(Ws)> QueryTags(AnyOf<Ws...>, Exclude<Vs...> = {}) const;
 		/* template <typename T> inline u32 GetTagCount(); */
 
 		inline void Clear();
 
+		/* Memory of every container, components in the order of Ts */
+		struct MemoryStats
+		{
+			ContainerStats entities; /* The entity free list and the signatures */
+			std::array<ContainerStats, sizeof...(Ts)> components; /* Archetype components report their columns, which archetypes includes */
+			ContainerStats archetypes;
+			uint64_t total_bytes;
+		};
+		template <typename T> inline ContainerStats Stats();
+		inline MemoryStats MemoryReport();
+
+		/* Snapshots of every entity, component and tag, which all have to be trivially copyable. Owning groups are not stored.
+		 * Loading bulk copies every array, it replaces the whole world and returns false with an empty manager
+		 * if the snapshot is truncated, was saved with other types or its indices disagree: every sparse, chunk, record and
+		 * free chain index is range checked against what it points at, and each container against the signatures.
+		 * Component values are not checked, a damaged value loads as it is. Loading into a manager with groups returns false
+		 * and leaves it untouched, create the groups after loading. Loading from a path is in SnapshotFile.h */
+		inline bool SaveSnapshot(const char* path);
+		inline void SaveSnapshot(SnapshotWriter& writer);
+		inline bool LoadSnapshot(SnapshotReader& reader);
+
+		/* Delta snapshots store the blocks written since the previous full or delta snapshot, so their cost scales with the change.
+		 * A world is restored by loading the full snapshot and applying its deltas in order. Views and queries over non-const
+		 * components, groups, ForEachChunk, ComponentField and WriteComponent mark what they hand out, writes through
+		 * GetComponent, TryGet, DenseData or GetChunk have to be reported with MarkChanged.
+		 * Applying returns false and leaves the world untouched for a delta of another base or out of order or while there are groups,
+		 * and returns false with an empty manager if the delta is truncated or leaves indices that disagree.
+		 * The indices are checked as on loading, which walks every index array of the world and not only the written blocks */
+		inline bool SaveDeltaSnapshot(const char* path);
+		inline void SaveDeltaSnapshot(SnapshotWriter& writer);
+		inline bool ApplyDeltaSnapshot(SnapshotReader& reader);
+
 	private:
+		using ComponentSets = internal_ecs::GetComponentSets<EntityID, Ts...>::Sets;
+
+		/* One bit per type in Ts, set while the entity has the component or tag */
+		using Signature = internal_ecs::SignatureMask<sizeof...(Ts)>;
+		using ContainerRemover = void (ECSManager::*)(EntityID);
+
+		template <typename T>
+		static constexpr size_t signature_bit = internal_ecs::index_of<std::remove_cvref_t<T>, Ts...>;
+
+		template <typename... Us>
+		inline static Signature makeSignature() { Signature signature{}; (signature.SetBit(typename Signature::index_t(signature_bit<Us>)), ...); return signature; };
+		inline static Signature archetypeSignature();
+
+		using ContainerBatchRemover = void (ECSManager::*)(std::span<const EntityID>);
+
+		template <typename T> inline void removeFromContainer(EntityID id) { getContainer<T>().Remove(id); };
+		template <typename T> inline void removeManyFromContainer(std::span<const EntityID> ids) { if constexpr (T::component_type != ComponentType::Archetype) getContainer<T>().RemoveMany(ids); };
+		/* RemoveComponents and RemoveTags, archetype columns are left one entity at a time */
+		template <typename T> inline void removeMany(std::span<const EntityID> ids);
+
+		/* Indexed by signature bit, archetype components are removed together through the archetype storage */
+		static constexpr std::array<ContainerRemover, sizeof...(Ts)> container_removers{ (Ts::component_type == ComponentType::Archetype ? nullptr : &ECSManager::removeFromContainer<Ts>)... };
+		static constexpr std::array<ContainerBatchRemover, sizeof...(Ts)> container_batch_removers{ (Ts::component_type == ComponentType::Archetype ? nullptr : &ECSManager::removeManyFromContainer<Ts>)... };
+
+		inline const Signature& getSignature(EntityID id) const;
+		inline Signature& writeSignature(EntityID id) { signature_dirty.Mark(id.GetIndex()); return signatures[id.GetIndex()]; };
+
+		template <size_t... I>
+		inline static ComponentSets makeComponentSets(std::pmr::memory_resource* resource, std::index_sequence<I...>) { return ComponentSets(std::tuple_element_t<I, ComponentSets>(resource)...); };
+
+		struct SnapshotHeader
+		{
+			uint32_t magic{ 0x5353434c }; /* "LCSS" */
+			uint32_t version{ 1 };
+			uint32_t handle_bits{ EntityID::handle_bits };
+			uint32_t validation_bits{ EntityID::validation_bits };
+
+			friend bool operator==(const SnapshotHeader&, const SnapshotHeader&) = default;
+		};
+
+		/* Full snapshots get a random base id and sequence 0, every delta continues the sequence of its base */
+		struct SnapshotOrigin
+		{
+			uint64_t base_id{ 0 };
+			uint64_t sequence{ 0 };
+		};
+
+		/* Layout of every type in Ts, snapshots only load into managers with the same layouts */
+		struct SnapshotTypeInfo
+		{
+			uint32_t size;
+			uint32_t alignment;
+			uint32_t component_type;
+			uint32_t chunk_width;
+
+			friend bool operator==(const SnapshotTypeInfo&, const SnapshotTypeInfo&) = default;
+		};
+		static constexpr std::array<SnapshotTypeInfo, sizeof...(Ts)> snapshot_types{ SnapshotTypeInfo{ uint32_t(sizeof(Ts)), uint32_t(alignof(Ts)), uint32_t(Ts::component_type), internal_ecs::GetChunkWidth<Ts>() }... };
+
+		template <typename T> inline decltype(auto) getContainer();
+		inline void resetDirty();
+
+		/* Groups are type erased, each keeps the function that creates it again on another manager */
+		struct GroupEntry
+		{
+			std::shared_ptr<void> group;
+			void (*recreate)(ECSManager&);
+		};
+		template <typename... Us> inline static void recreateGroup(ECSManager& ecs);
+		/* The copied or moved containers still carry the hooks of the groups in source_groups */
+		inline void recreateGroups(const std::vector<GroupEntry>& source_groups);
+		/* Whether the loaded signatures, free list and containers agree, the containers checked their own indices while loading */
+		inline bool hasValidIndices();
+		template <typename T> inline bool ownersAreCurrent();
 		inline void reserveComponentStorage(EntityID::data_t new_size);
-		inline void growComponentStorageIfNecessary();
+		inline void growComponentStorageIfNecessary(EntityID::data_t new_entity_count = 1);
 
 	private:
 		HandleFreeList<EntityID> entity_id_generator{};
-		std::tuple<typename internal_ecs::GetComponentContainer<EntityID, Ts, Ts::component_type>::Container... > component_sets{};
+		std::pmr::vector<Signature> signatures{};
+		DirtyBlocks<> signature_dirty{};
+		ComponentSets component_sets{};
+		ArchetypeStorageType archetypes{};
+		std::vector<GroupEntry> groups{};
+		uint32_t current_tick{ 1 };
+		SnapshotOrigin snapshot_origin{};
 		EntityID::data_t reserved_component_count{ 8 };
 		static constexpr uint32_t component_grow_factor = 2;
+		static constexpr uint32_t default_grain_size = 4096;
 	};
 
+	template <typename EntityID, typename... Ts>
+	ECSManager<EntityID, Ts...>::ECSManager(std::pmr::memory_resource* resource)
+		: entity_id_generator(resource), signatures(resource), signature_dirty(resource), component_sets(makeComponentSets(resource, std::make_index_sequence<std::tuple_size_v<ComponentSets>>{})), archetypes(resource)
+	{
+		reserveComponentStorage(reserved_component_count);
+	}
+
+	template <typename EntityID, typename... Ts>
+	ECSManager<EntityID, Ts...>::ECSManager(const ECSManager& other)
+		: entity_id_generator(other.entity_id_generator), signatures(other.signatures), signature_dirty(other.signature_dirty), component_sets(other.component_sets), archetypes(other.archetypes),
+		current_tick(other.current_tick), snapshot_origin(other.snapshot_origin), reserved_component_count(other.reserved_component_count)
+	{
+		recreateGroups(other.groups);
+	}
+
+	template <typename EntityID, typename... Ts>
+	ECSManager<EntityID, Ts...>::ECSManager(ECSManager&& other) noexcept
+		: entity_id_generator(std::move(other.entity_id_generator)), signatures(std::move(other.signatures)), signature_dirty(std::move(other.signature_dirty)), component_sets(std::move(other.component_sets)), archetypes(std::move(other.archetypes)),
+		current_tick(other.current_tick), snapshot_origin(other.snapshot_origin), reserved_component_count(other.reserved_component_count)
+	{
+		recreateGroups(other.groups);
+		other.groups.clear();
+	}
+
+	template <typename EntityID, typename... Ts>
+	ECSManager<EntityID, Ts...>& ECSManager<EntityID, Ts...>::operator=(const ECSManager& other)
+	{
+		if (this == &other) return *this;
+
+		groups.clear();
+		entity_id_generator = other.entity_id_generator;
+		signatures = other.signatures;
+		signature_dirty = other.signature_dirty;
+		component_sets = other.component_sets;
+		archetypes = other.archetypes;
+		current_tick = other.current_tick;
+		snapshot_origin = other.snapshot_origin;
+		reserved_component_count = other.reserved_component_count;
+		recreateGroups(other.groups);
+		return *this;
+	}
+
+	template <typename EntityID, typename... Ts>
+	ECSManager<EntityID, Ts...>& ECSManager<EntityID, Ts...>::operator=(ECSManager&& other) noexcept
+	{
+		if (this == &other) return *this;
+
+		groups.clear();
+		entity_id_generator = std::move(other.entity_id_generator);
+		signatures = std::move(other.signatures);
+		signature_dirty = std::move(other.signature_dirty);
+		component_sets = std::move(other.component_sets);
+		archetypes = std::move(other.archetypes);
+		current_tick = other.current_tick;
+		snapshot_origin = other.snapshot_origin;
+		reserved_component_count = other.reserved_component_count;
+		recreateGroups(other.groups);
+		other.groups.clear();
+		return *this;
+	}
+
 	template <typename EntityID, typename... Ts>
 	inline EntityID ECSManager<EntityID, Ts...>::CreateEntity()
 	{
@@ -61,98 +293,326 @@ namespace lcs
 		return entity_id_generator.GetNextHandle();
 	}
 
+	template <typename EntityID, typename... Ts>
+	inline void ECSManager<EntityID, Ts...>::CreateEntities(EntityID::data_t count, std::span<EntityID> out)
+	{
+		assert(out.size() >= count);
+		growComponentStorageIfNecessary(count);
+		entity_id_generator.GetNextHandles(out.first(count));
+	}
+
 	template <typename EntityID, typename... Ts>
 	inline void ECSManager<EntityID, Ts...>::DestroyEntity(EntityID id)
 	{
-		/* Remove components */
-		( std::get<typename internal_ecs::GetComponentContainer<EntityID, Ts, Ts::component_type>::Container>(component_sets).RemoveIfPresent(id), ...);
+		/* Only visits the containers holding a component of the entity */
+		Signature& signature = writeSignature(id);
+		assert(entity_id_generator.IsCurrent(id));
+		if (!(signature & archetypeSignature()).IsZero()) archetypes.RemoveIfPresent(id);
+
+		Signature remaining = signature;
+		remaining.AndNot(archetypeSignature());
+		while (!remaining.IsZero())
+		{
+			const auto bit = typename Signature::index_t(remaining.FirstSet());
+			remaining.ClearBit(bit);
+			(this->*container_removers[bit])(id);
+		}
+		signature = {};
 
 		entity_id_generator.FreeHandle(id);
 	}
 
+	template <typename EntityID, typename... Ts>
+	inline void ECSManager<EntityID, Ts...>::DestroyEntities(std::span<const EntityID> ids)
+	{
+		/* Sort the entities into one batch per container through their signatures */
+		std::array<std::vector<EntityID>, sizeof...(Ts)> batches{};
+		for (const EntityID id : ids)
+		{
+			Signature& signature = writeSignature(id);
+			assert(entity_id_generator.IsCurrent(id));
+			if (!(signature & archetypeSignature()).IsZero()) archetypes.RemoveIfPresent(id);
+
+			Signature remaining = signature;
+			remaining.AndNot(archetypeSignature());
+			while (!remaining.IsZero())
+			{
+				const auto bit = typename Signature::index_t(remaining.FirstSet());
+				remaining.ClearBit(bit);
+				batches[bit].push_back(id);
+			}
+			signature = {};
+		}
+
+		for (size_t bit = 0; bit < batches.size(); bit++)
+		{
+			if (!batches[bit].empty()) (this->*container_batch_removers[bit])(batches[bit]);
+		}
+		entity_id_generator.FreeHandles(ids);
+	}
+
 	template <typename EntityID, typename... Ts>
 	inline EntityID::data_t ECSManager<EntityID, Ts...>::GetEntityCount()
 	{
-		return entity_id_generator.UsedHandleCount();
+		return entity_id_generator.UsedIndexCount();
 	}
 
 	template <typename EntityID, typename... Ts> template <typename T>
 	inline bool ECSManager<EntityID, Ts...>::HasComponent(EntityID id)
 	{
-		using SetType = typename internal_ecs::GetComponentContainer<EntityID, T, T::component_type>::Container;
-		SetType& set = std::get<SetType>(component_sets);
-		return set.Has(id);
+		return getSignature(id).IsBitSet(typename Signature::index_t(signature_bit<T>));
+	}
+
+	template <typename EntityID, typename... Ts> template <typename... Us>
+	inline bool ECSManager<EntityID, Ts...>::HasAll(EntityID id)
+	{
+		return makeSignature<Us...>().AndNot(getSignature(id)).IsZero();
 	}
 
 	template <typename EntityID, typename... Ts> template <typename T>
-	inline T& ECSManager<EntityID, Ts...>::GetComponent(EntityID id)
+	inline decltype(auto) ECSManager<EntityID, Ts...>::GetComponent(EntityID id)
 	{
-		using SetType = typename internal_ecs::GetComponentContainer<EntityID, T, T::component_type>::Container;
-		SetType& set = std::get<SetType>(component_sets);
-		return set.Get(id);
+		return getContainer<T>().Get(id);
 	}
 
 	template <typename EntityID, typename... Ts> template <typename T>
-	inline std::remove_reference<T>::type& ECSManager<EntityID, Ts...>::AddComponent(EntityID id, T&& component)
+	inline decltype(auto) ECSManager<EntityID, Ts...>::WriteComponent(EntityID id)
+	{
+		return getContainer<T>().Write(id);
+	}
+
+	template <typename EntityID, typename... Ts> template <typename T>
+	inline decltype(auto) ECSManager<EntityID, Ts...>::AddComponent(EntityID id, T&& component)
 	{
 		using Tp = std::remove_reference<T>::type;
-		using SetType = typename internal_ecs::GetComponentContainer<EntityID, T, T::component_type>::Container;
-		SetType& set = std::get<SetType>(component_sets);
-		set.Add(id, std::forward<T>(component));
+		getContainer<Tp>().Add(id, std::forward<T>(component));
+		writeSignature(id).SetBit(typename Signature::index_t(signature_bit<Tp>));
 		return GetComponent<Tp>(id);
 	}
 
+	template <typename EntityID, typename... Ts> template <typename T>
+	inline void ECSManager<EntityID, Ts...>::AddComponents(std::span<const EntityID> ids, std::span<const T> components)
+	{
+		static_assert(!internal_ecs::is_tag<T>, "Use AddTag for tags");
+		assert(ids.size() == components.size());
+
+		auto&& container = getContainer<T>();
+		if constexpr (requires { container.AddMany(ids, components); })
+		{
+			container.AddMany(ids, components);
+		}
+		else
+		{
+			for (size_t i = 0; i < ids.size(); i++)
+			{
+				container.Add(ids[i], T(components[i]));
+			}
+		}
+		for (const EntityID id : ids)
+		{
+			writeSignature(id).SetBit(typename Signature::index_t(signature_bit<T>));
+		}
+	}
+
 	template <typename EntityID, typename... Ts> template <typename T>
 	inline void ECSManager<EntityID, Ts...>::RemoveComponent(EntityID id)
 	{
 		assert(HasComponent<T>(id));
-		using SetType = typename internal_ecs::GetComponentContainer<EntityID, T, T::component_type>::Container;
-		SetType& set = std::get<SetType>(component_sets);
-		return set.Remove(id);
+		getContainer<T>().Remove(id);
+		writeSignature(id).ClearBit(typename Signature::index_t(signature_bit<T>));
+	}
+
+	template <typename EntityID, typename... Ts> template <typename T>
+	inline void ECSManager<EntityID, Ts...>::RemoveComponents(std::span<const EntityID> ids)
+	{
+		static_assert(!internal_ecs::is_tag<T>, "Use RemoveTags for tags");
+		removeMany<T>(ids);
 	}
 
 	template <typename EntityID, typename... Ts> template <typename T>
 	inline EntityID::data_t ECSManager<EntityID, Ts...>::GetComponentCount()
 	{
-		using SetType = typename internal_ecs::GetComponentContainer<EntityID, T, T::component_type>::Container;
-		SetType& set = std::get<SetType>(component_sets);
-		return set.Size();
+		return getContainer<T>().Size();
+	}
+
+	template <typename EntityID, typename... Ts> template <typename T>
+	inline internal_ecs::GetComponentView<EntityID, typename ECSManager<EntityID, Ts...>::ArchetypeStorageType, T>::View ECSManager<EntityID, Ts...>::CView()
+	{
+		using ViewType = typename internal_ecs::GetComponentView<EntityID, ArchetypeStorageType, T>::View;
+		if constexpr (T::component_type == ComponentType::Archetype) return ViewType(archetypes);
+		else return ViewType(getContainer<T>());
+	}
+
+	template <typename EntityID, typename... Ts> template <typename... Us>
+	inline internal_ecs::GetJoinedView<EntityID, typename ECSManager<EntityID, Ts...>::ArchetypeStorageType, Us...>::View ECSManager<EntityID, Ts...>::View()
+	{
+		using ViewType = typename internal_ecs::GetJoinedView<EntityID, ArchetypeStorageType, Us...>::View;
+		if constexpr (((Us::component_type == ComponentType::Archetype) && ...)) return ViewType(archetypes);
+		else return ViewType(getContainer<Us>()...);
+	}
+
+	template <typename EntityID, typename... Ts> template <typename... Us>
+	inline CachedQuery<EntityID, Us...> ECSManager<EntityID, Ts...>::Query()
+	{
+		return CachedQuery<EntityID, Us...>(getContainer<Us>()...);
+	}
+
+	template <typename EntityID, typename... Ts> template <typename... Us, typename F>
+	inline void ECSManager<EntityID, Ts...>::ParallelForEach(F&& fn, uint32_t grain_size)
+	{
+		View<Us...>().ParallelForEach(std::forward<F>(fn), grain_size, ThreadPool::Default());
+	}
+
+	template <typename EntityID, typename... Ts> template <typename... Us>
+	inline OwningGroup<EntityID, Us...>* ECSManager<EntityID, Ts...>::Group()
+	{
+		static_assert(((Us::component_type == ComponentType::Component) && ...), "Only SparseSet components can be grouped");
+		using GroupType = OwningGroup<EntityID, Us...>;
+
+		/* The group is found through the hook it installs on every owned set */
+		if (((getContainer<Us>().GetHook().key == GroupType::Key()) && ...))
+		{
+			return static_cast<GroupType*>(getContainer<std::tuple_element_t<0, std::tuple<Us...>>>().GetHook().context);
+		}
+		if (!GroupType::CanOwn(getContainer<Us>()...)) return nullptr;
+
+		auto group = std::make_shared<GroupType>(getContainer<Us>()...);
+		groups.push_back({ group, &ECSManager::recreateGroup<Us...> });
+		return group.get();
+	}
+
+	template <typename EntityID, typename... Ts> template <typename T>
+	inline ChangedView<EntityID, T> ECSManager<EntityID, Ts...>::Changed(uint32_t since_tick)
+	{
+		return ChangedView<EntityID, T>(getContainer<T>(), since_tick);
+	}
+
+	template <typename EntityID, typename... Ts> template <typename T>
+	inline void ECSManager<EntityID, Ts...>::MarkChanged(EntityID id)
+	{
+		getContainer<T>().MarkChanged(id);
+	}
+
+	template <typename EntityID, typename... Ts> template <typename T>
+	inline ChangeEvents<EntityID>& ECSManager<EntityID, Ts...>::Events()
+	{
+		static_assert(T::component_type == ComponentType::Component || T::component_type == ComponentType::ComponentChunked || T::component_type == ComponentType::Tag,
+			"Only SparseSet, SparseSetChunked and SparseTagSet record events");
+		return getContainer<T>().Events();
+	}
+
+	template <typename EntityID, typename... Ts> template <typename T, typename F>
+	inline void ECSManager<EntityID, Ts...>::ForEachChunk(F&& fn)
+	{
+		static_assert(T::component_type == ComponentType::ComponentChunked, "Only chunked components can be iterated per chunk");
+		getContainer<T>().ForEachChunk(std::forward<F>(fn));
+	}
+
+	template <typename EntityID, typename... Ts>
+	inline uint32_t ECSManager<EntityID, Ts...>::AdvanceTick()
+	{
+		current_tick++;
+		std::apply([this](auto&... sets)
+			{
+				([&](auto& set) { if constexpr (requires { set.SetTick(current_tick); }) set.SetTick(current_tick); }(sets), ...);
+			}, component_sets);
+		return current_tick;
+	}
+
+	template <typename EntityID, typename... Ts> template <auto member>
+	inline auto ECSManager<EntityID, Ts...>::ComponentField()
+	{
+		using T = typename internal_ecs::MemberPointerTraits<decltype(member)>::Class;
+		static_assert(T::component_type == ComponentType::SoA, "Only SoA components expose per-field arrays");
+		return getContainer<T>().template Field<member>();
+	}
+
+	template <typename EntityID, typename... Ts> template <auto member>
+	inline auto ECSManager<EntityID, Ts...>::ReadComponentField()
+	{
+		using T = typename internal_ecs::MemberPointerTraits<decltype(member)>::Class;
+		static_assert(T::component_type == ComponentType::SoA, "Only SoA components expose per-field arrays");
+		return getContainer<T>().template ReadField<member>();
 	}
 
 	template <typename EntityID, typename... Ts> template <typename T>
-	inline ComponentView<EntityID, T> ECSManager<EntityID, Ts...>::CView()
+	inline std::span<const EntityID> ECSManager<EntityID, Ts...>::ComponentOwners()
 	{
-		using SetType = typename internal_ecs::GetComponentContainer<EntityID, T, T::component_type>::Container;
-		SetType& set = std::get<SetType>(component_sets);
-		return ComponentView<EntityID, T>(set);
+		static_assert(T::component_type == ComponentType::Component || T::component_type == ComponentType::SoA, "Only densely stored components have an owner array");
+		return getContainer<T>().DenseOwners();
+	}
+
+	template <typename EntityID, typename... Ts> template <typename T>
+	inline bool ECSManager<EntityID, Ts...>::SortByEntity()
+	{
+		static_assert(T::component_type == ComponentType::Component, "Only SparseSet components can be sorted");
+		return getContainer<T>().SortByEntity();
+	}
+
+	template <typename EntityID, typename... Ts> template <typename T>
+	inline bool ECSManager<EntityID, Ts...>::SortByEntityIncremental(size_t max_steps)
+	{
+		static_assert(T::component_type == ComponentType::Component, "Only SparseSet components can be sorted");
+		return getContainer<T>().SortByEntityIncremental(max_steps);
 	}
 
 	template <typename EntityID, typename... Ts> template <typename T>
 	bool ECSManager<EntityID, Ts...>::HasTag(EntityID id)
 	{
-		SparseTagSetT<EntityID, T>& set = std::get<SparseTagSetT<EntityID, T>>(component_sets);
-		return set.Has(id);
+		static_assert(internal_ecs::is_tag<T>);
+		return getSignature(id).IsBitSet(typename Signature::index_t(signature_bit<T>));
 	}
 
 	template <typename EntityID, typename... Ts> template <typename T>
 	void ECSManager<EntityID, Ts...>::AddTag(EntityID id)
 	{
-		SparseTagSetT<EntityID, T>& set = std::get<SparseTagSetT<EntityID, T>>(component_sets);
-		return set.Add(id);
+		static_assert(internal_ecs::is_tag<T>);
+		getContainer<T>().Add(id);
+		writeSignature(id).SetBit(typename Signature::index_t(signature_bit<T>));
 	}
 
 	template <typename EntityID, typename... Ts> template <typename T>
 	void ECSManager<EntityID, Ts...>::RemoveTag(EntityID id)
 	{
-		SparseTagSetT<EntityID, T>& set = std::get<SparseTagSetT<EntityID, T>>(component_sets);
-		return set.Remove(id);
+		static_assert(internal_ecs::is_tag<T>);
+		getContainer<T>().Remove(id);
+		writeSignature(id).ClearBit(typename Signature::index_t(signature_bit<T>));
+	}
+
+	template <typename EntityID, typename... Ts> template <typename T>
+	void ECSManager<EntityID, Ts...>::RemoveTags(std::span<const EntityID> ids)
+	{
+		static_assert(internal_ecs::is_tag<T>);
+		removeMany<T>(ids);
 	}
 
 	template <typename EntityID, typename... Ts> template <typename T>
-	inline TagView<EntityID, T> ECSManager<EntityID, Ts...>::TView()
+	inline internal_ecs::GetTagView<EntityID, T> ECSManager<EntityID, Ts...>::TView()
+	{
+		static_assert(internal_ecs::is_tag<T>);
+		if constexpr (T::component_type == ComponentType::TagBitset) return QueryTags<T>();
+		else return TagView<EntityID, T>(getContainer<T>());
+	}
+
+	template <typename EntityID, typename... Ts> template <typename... Us, typename... Vs>
+	inline TagQuery<EntityID, sizeof...(Us), sizeof...(Vs)> ECSManager<EntityID, Ts...>::QueryTags(Exclude<Vs...>) const
 	{
-		SparseTagSetT<EntityID, T>& set = std::get<SparseTagSetT<EntityID, T>>(component_sets);
-		return TagView<EntityID, T>(set);
+		static_assert(((Us::component_type == ComponentType::TagBitset) && ...) && ((Vs::component_type == ComponentType::TagBitset) && ...), "Only TagBitset tags can be queried");
+		return TagQuery<EntityID, sizeof...(Us), sizeof...(Vs)>(entity_id_generator,
+			{ static_cast<const TagBitset<EntityID>*>(&std::get<TagBitsetT<EntityID, Us>>(component_sets))... },
+			{ static_cast<const TagBitset<EntityID>*>(&std::get<TagBitsetT<EntityID, Vs>>(component_sets))... });
+	}
+
+	template <typename EntityID, typename... Ts> template <typename... Us, typename... Ws, typename... Vs>
+	inline TagQuery<EntityID, sizeof...(Us), sizeof...(Vs), sizeof...(Ws)> ECSManager<EntityID, Ts...>::QueryTags(AnyOf<Ws...>, Exclude<Vs...>) const
+	{
+		static_assert(sizeof...(Ws) > 0, "AnyOf needs at least one tag");
+		static_assert(((Us::component_type == ComponentType::TagBitset) && ...) && ((Ws::component_type == ComponentType::TagBitset) && ...)
+			&& ((Vs::component_type == ComponentType::TagBitset) && ...), "Only TagBitset tags can be queried");
+		return TagQuery<EntityID, sizeof...(Us), sizeof...(Vs), sizeof...(Ws)>(entity_id_generator,
+			{ static_cast<const TagBitset<EntityID>*>(&std::get<TagBitsetT<EntityID, Us>>(component_sets))... },
+			{ static_cast<const TagBitset<EntityID>*>(&std::get<TagBitsetT<EntityID, Vs>>(component_sets))... },
+			{ static_cast<const TagBitset<EntityID>*>(&std::get<TagBitsetT<EntityID, Ws>>(component_sets))... });
 	}
 
 	/*template <typename... Ts, typename T>
@@ -165,25 +625,296 @@ namespace lcs
 	template <typename EntityID, typename... Ts>
 	void ECSManager<EntityID, Ts...>::Clear()
 	{
-		(std::get<typename internal_ecs::GetComponentContainer<EntityID, Ts, Ts::component_type>::Container>(component_sets).Clear(), ...);
+		std::apply([](auto&... sets) { (sets.Clear(), ...); }, component_sets);
+		archetypes.Clear();
 		entity_id_generator.Clear();
+		signatures.clear();
+		signature_dirty.MarkCleared();
 
 		reserved_component_count = 8;
 		reserveComponentStorage(reserved_component_count);
 	}
 
+	template <typename EntityID, typename... Ts> template <typename T>
+	inline ContainerStats ECSManager<EntityID, Ts...>::Stats()
+	{
+		return getContainer<T>().Stats();
+	}
+
+	template <typename EntityID, typename... Ts>
+	inline ECSManager<EntityID, Ts...>::MemoryStats ECSManager<EntityID, Ts...>::MemoryReport()
+	{
+		MemoryStats report{ entity_id_generator.Stats(), { Stats<Ts>()... }, archetypes.Stats(), 0 };
+		report.entities.bytes_allocated += internal_ecs::CapacityBytes(signatures) + signature_dirty.MemoryUsage();
+
+		report.total_bytes = report.entities.bytes_allocated + report.archetypes.bytes_allocated;
+		for (size_t i = 0; i < sizeof...(Ts); i++)
+		{
+			if (!archetypeSignature().IsBitSet(typename Signature::index_t(i))) report.total_bytes += report.components[i].bytes_allocated;
+		}
+		return report;
+	}
+
+	template <typename EntityID, typename... Ts>
+	inline bool ECSManager<EntityID, Ts...>::SaveSnapshot(const char* path)
+	{
+		SnapshotWriter writer(path);
+		SaveSnapshot(writer);
+		return writer.Close();
+	}
+
+	template <typename EntityID, typename... Ts>
+	inline void ECSManager<EntityID, Ts...>::SaveSnapshot(SnapshotWriter& writer)
+	{
+		std::random_device random{};
+		snapshot_origin = { (uint64_t(random()) << 32) | random(), 0 };
+		resetDirty();
+
+		writer.Write(SnapshotHeader{});
+		writer.WriteArray(std::span<const SnapshotTypeInfo>(snapshot_types));
+		writer.Write(snapshot_origin);
+		writer.Write(current_tick);
+		writer.Write(reserved_component_count);
+
+		entity_id_generator.Save(writer);
+		writer.WriteArray(std::span<const Signature>(signatures));
+		std::apply([&](const auto&... sets) { (sets.Save(writer), ...); }, component_sets);
+		archetypes.Save(writer);
+	}
+
+	template <typename EntityID, typename... Ts>
+	inline bool ECSManager<EntityID, Ts...>::LoadSnapshot(SnapshotReader& reader)
+	{
+		if (!groups.empty()) return false; /* Groups are not stored, create them after loading */
+
+		const bool same_layout = reader.Read<SnapshotHeader>() == SnapshotHeader{} && std::ranges::equal(reader.ReadArray<SnapshotTypeInfo>(), snapshot_types);
+		const SnapshotOrigin origin = reader.Read<SnapshotOrigin>();
+		if (same_layout && origin.sequence == 0)
+		{
+			current_tick = reader.Read<uint32_t>();
+			reserved_component_count = reader.Read<typename EntityID::data_t>();
+
+			entity_id_generator.Load(reader);
+			reader.ReadArray(signatures);
+			std::apply([&](auto&... sets) { (sets.Load(reader), ...); }, component_sets);
+			archetypes.Load(reader);
+		}
+
+		if (!same_layout || origin.sequence != 0 || reader.Failed() || !reader.AtEnd() || !hasValidIndices())
+		{
+			Clear();
+			snapshot_origin = {};
+			return false;
+		}
+		snapshot_origin = origin;
+		resetDirty();
+		return true;
+	}
+
+	template <typename EntityID, typename... Ts>
+	inline bool ECSManager<EntityID, Ts...>::SaveDeltaSnapshot(const char* path)
+	{
+		SnapshotWriter writer(path);
+		SaveDeltaSnapshot(writer);
+		return writer.Close();
+	}
+
+	template <typename EntityID, typename... Ts>
+	inline void ECSManager<EntityID, Ts...>::SaveDeltaSnapshot(SnapshotWriter& writer)
+	{
+		assert(snapshot_origin.base_id != 0); /* Deltas need a full snapshot saved or loaded first */
+		snapshot_origin.sequence++;
+
+		writer.Write(SnapshotHeader{});
+		writer.WriteArray(std::span<const SnapshotTypeInfo>(snapshot_types));
+		writer.Write(snapshot_origin);
+		writer.Write(current_tick);
+		writer.Write(reserved_component_count);
+
+		entity_id_generator.SaveDelta(writer);
+		writer.WriteDirty(std::span<const Signature>(signatures), signature_dirty);
+		signature_dirty.Reset();
+		std::apply([&](auto&... sets) { (sets.SaveDelta(writer), ...); }, component_sets);
+		archetypes.SaveDelta(writer);
+	}
+
+	template <typename EntityID, typename... Ts>
+	inline bool ECSManager<EntityID, Ts...>::ApplyDeltaSnapshot(SnapshotReader& reader)
+	{
+		if (!groups.empty()) return false; /* Groups are not stored, create them after loading */
+
+		/* Deltas of other worlds or out of order are rejected before anything is touched */
+		const bool same_layout = reader.Read<SnapshotHeader>() == SnapshotHeader{} && std::ranges::equal(reader.ReadArray<SnapshotTypeInfo>(), snapshot_types);
+		const SnapshotOrigin origin = reader.Read<SnapshotOrigin>();
+		if (!same_layout || reader.Failed() || snapshot_origin.base_id == 0 || origin.base_id != snapshot_origin.base_id || origin.sequence != snapshot_origin.sequence + 1) return false;
+
+		current_tick = reader.Read<uint32_t>();
+		reserved_component_count = reader.Read<typename EntityID::data_t>();
+
+		entity_id_generator.LoadDelta(reader);
+		reader.ReadDirty(signatures, internal_ecs::max_snapshot_entries<EntityID>);
+		std::apply([&](auto&... sets) { (sets.LoadDelta(reader), ...); }, component_sets);
+		archetypes.LoadDelta(reader);
+
+		if (reader.Failed() || !reader.AtEnd() || !hasValidIndices())
+		{
+			Clear();
+			snapshot_origin = {};
+			return false;
+		}
+		snapshot_origin = origin;
+		resetDirty();
+		return true;
+	}
+
+	template <typename EntityID, typename... Ts> template <typename T>
+	inline decltype(auto) ECSManager<EntityID, Ts...>::getContainer()
+	{
+		if constexpr (T::component_type == ComponentType::Archetype)
+		{
+			return ArchetypeColumnRef<ArchetypeStorageType, std::remove_const_t<T>>(archetypes);
+		}
+		else
+		{
+			return (std::get<internal_ecs::ComponentContainer<EntityID, T>>(component_sets));
+		}
+	}
+
+	template <typename EntityID, typename... Ts> template <typename T>
+	inline void ECSManager<EntityID, Ts...>::removeMany(std::span<const EntityID> ids)
+	{
+		constexpr auto bit = typename Signature::index_t(signature_bit<T>);
+		auto&& container = getContainer<T>();
+		if constexpr (requires { container.RemoveMany(ids); })
+		{
+			container.RemoveMany(ids);
+		}
+		else
+		{
+			for (const EntityID id : ids) container.Remove(id);
+		}
+		for (const EntityID id : ids)
+		{
+			Signature& signature = writeSignature(id);
+			assert(signature.IsBitSet(bit));
+			signature.ClearBit(bit);
+		}
+	}
+
+	template <typename EntityID, typename... Ts> template <typename... Us>
+	inline void ECSManager<EntityID, Ts...>::recreateGroup(ECSManager& ecs)
+	{
+		(ecs.getContainer<Us>().SetHook({}), ...);
+		ecs.Group<Us...>();
+	}
+
+	template <typename EntityID, typename... Ts>
+	inline void ECSManager<EntityID, Ts...>::recreateGroups(const std::vector<GroupEntry>& source_groups)
+	{
+		for (const GroupEntry& entry : source_groups)
+		{
+			entry.recreate(*this);
+		}
+	}
+
+	template <typename EntityID, typename... Ts>
+	inline void ECSManager<EntityID, Ts...>::resetDirty()
+	{
+		entity_id_generator.ResetDirty();
+		signature_dirty.Reset();
+		std::apply([](auto&... sets) { (sets.ResetDirty(), ...); }, component_sets);
+		archetypes.ResetDirty();
+	}
+
+	template <typename EntityID, typename... Ts>
+	inline bool ECSManager<EntityID, Ts...>::hasValidIndices()
+	{
+		/* Every index handed out has a signature and a sparse entry in every container */
+		const auto max_index = entity_id_generator.MaxIndex();
+		if (max_index > reserved_component_count || signatures.size() != reserved_component_count) return false;
+		if (!((Stats<Ts>().sparse_capacity >= reserved_component_count) && ...)) return false;
+		if (!(ownersAreCurrent<Ts>() && ...)) return false;
+		for (typename EntityID::data_t table_index = 0; table_index < archetypes.TableCount(); table_index++)
+		{
+			if (!std::ranges::all_of(archetypes.GetTable(table_index).owners, [&](EntityID owner) { return entity_id_generator.IsCurrent(owner); })) return false;
+		}
+
+		/* Only live entities have components, and every container holds exactly the entities whose signature has its bit.
+		 * Has checks for stale handles, which can't fire once every owner is current */
+		std::array<uint64_t, sizeof...(Ts)> bit_counts{};
+		for (typename EntityID::data_t index = 0; index < reserved_component_count; index++)
+		{
+			const Signature& signature = signatures[index];
+			if (signature.IsZero()) continue;
+			if (index >= max_index || !entity_id_generator.IsOccupied(index)) return false;
+
+			const EntityID id = entity_id_generator.GetHandle(index);
+			if (!((!signature.IsBitSet(typename Signature::index_t(signature_bit<Ts>)) || getContainer<Ts>().Has(id)) && ...)) return false;
+			((bit_counts[signature_bit<Ts>] += uint64_t(signature.IsBitSet(typename Signature::index_t(signature_bit<Ts>)))), ...);
+		}
+		return ((Stats<Ts>().dense_count == bit_counts[signature_bit<Ts>]) && ...);
+	}
+
+	template <typename EntityID, typename... Ts> template <typename T>
+	inline bool ECSManager<EntityID, Ts...>::ownersAreCurrent()
+	{
+		const auto is_current = [&](EntityID owner) { return entity_id_generator.IsCurrent(owner); };
+		auto&& container = getContainer<T>();
+		if constexpr (T::component_type == ComponentType::ComponentChunked)
+		{
+			using mask_t = typename std::remove_cvref_t<decltype(container)>::mask_t;
+			for (typename EntityID::data_t chunk_index = 0; chunk_index < container.ChunkCount(); chunk_index++)
+			{
+				const auto& owners = container.GetInverseHandleChunk(chunk_index);
+				for (auto occ_it = mask_t::Iterator::Create(container.GetOccupancyMask(chunk_index)); !occ_it.IsZero(); ++occ_it)
+				{
+					if (!is_current(owners[*occ_it])) return false;
+				}
+			}
+			return true;
+		}
+		else if constexpr (T::component_type == ComponentType::Archetype || T::component_type == ComponentType::TagBitset)
+		{
+			return true; /* Bitsets store no handles, archetype tables are checked once for all of their components */
+		}
+		else
+		{
+			return std::ranges::all_of(container.DenseOwners(), is_current);
+		}
+	}
+
+	template <typename EntityID, typename... Ts>
+	inline ECSManager<EntityID, Ts...>::Signature ECSManager<EntityID, Ts...>::archetypeSignature()
+	{
+		Signature signature{};
+		((Ts::component_type == ComponentType::Archetype ? signature.SetBit(typename Signature::index_t(signature_bit<Ts>)) : void()), ...);
+		return signature;
+	}
+
+	template <typename EntityID, typename... Ts>
+	inline const ECSManager<EntityID, Ts...>::Signature& ECSManager<EntityID, Ts...>::getSignature(EntityID id) const
+	{
+		const Signature& signature = signatures[id.GetIndex()];
+		assert(signature.IsZero() || entity_id_generator.IsCurrent(id)); /* Check for stale handle */
+		return signature;
+	}
+
 	template <typename EntityID, typename... Ts>
 	void ECSManager<EntityID, Ts...>::reserveComponentStorage(EntityID::data_t new_size)
 	{
-		(std::get<typename internal_ecs::GetComponentContainer<EntityID, Ts, Ts::component_type>::Container>(component_sets).ReserveSparseSize(new_size), ...);
+		std::apply([=](auto&... sets) { (sets.ReserveSparseSize(new_size), ...); }, component_sets);
+		archetypes.ReserveSparseSize(new_size);
+		signatures.resize(new_size);
 	}
 
 	template <typename EntityID, typename... Ts>
-	void ECSManager<EntityID, Ts...>::growComponentStorageIfNecessary()
+	void ECSManager<EntityID, Ts...>::growComponentStorageIfNecessary(EntityID::data_t new_entity_count)
 	{
-		if (reserved_component_count == entity_id_generator.UsedIndexCount())
+		/* New entities reuse freed indices before appending new ones, so covering the used count covers every index handed out */
+		const auto required_count = entity_id_generator.UsedIndexCount() + new_entity_count;
+		if (required_count > reserved_component_count)
 		{
-			reserved_component_count *= component_grow_factor;
+			while (reserved_component_count < required_count) reserved_component_count *= component_grow_factor;
 			reserveComponentStorage(reserved_component_count);
 		}
 	}
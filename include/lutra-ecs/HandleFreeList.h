@@ -1,6 +1,12 @@
 #pragma once
+#include <lutra-ecs/ContainerStats.h>
 #include <lutra-ecs/Handle.h>
+#include <lutra-ecs/Snapshot.h>
 
+#include <bit>
+#include <iterator>
+#include <memory_resource>
+#include <span>
 #include <vector>
 #include <assert.h>
 
@@ -11,9 +17,10 @@ namespace lcs
 	{
 	public:
 		using data_t = handle_t::data_t;
-		using handle_container_t = std::vector<handle_t>;
+		using handle_container_t = std::pmr::vector<handle_t>;
 
 		inline HandleFreeList() {};
+		explicit HandleFreeList(std::pmr::memory_resource* resource) : handles(resource), occupancy(resource), dirty(resource) {};
 		inline handle_t GetNextHandle()
 		{
 			used_index_count++;
@@ -23,37 +30,138 @@ namespace lcs
 			{
 				next_free_index++;
 				handles.push_back(handle_t::CreateNew(is_occupied_index));
+				if (handle_index % 64 == 0) occupancy.push_back(0);
+				setOccupied(handle_index);
+				dirty.Mark(handle_index);
 				return handle_t::CreateNew(handle_index);
 			}
 
 			const data_t old_handle_validation_id = handles[handle_index].GetValidationID();
 			next_free_index = handles[handle_index].GetIndex();
-			handles[handle_index] = handle_t::CreateNext(old_handle_validation_id, handle_index);
+			handles[handle_index] = handle_t::CreateNext(old_handle_validation_id, is_occupied_index);
+			setOccupied(handle_index);
+			dirty.Mark(handle_index);
 			return handle_t::CreateNext(old_handle_validation_id, handle_index);
 
 		}
+		/* Fills out with new handles, reusing freed indices first and appending the rest in one go */
+		inline void GetNextHandles(std::span<handle_t> out)
+		{
+			size_t out_index = 0;
+			for (; out_index < out.size() && next_free_index != data_t(handles.size()); out_index++)
+			{
+				const data_t handle_index = next_free_index;
+				const data_t old_handle_validation_id = handles[handle_index].GetValidationID();
+				next_free_index = handles[handle_index].GetIndex();
+				handles[handle_index] = handle_t::CreateNext(old_handle_validation_id, is_occupied_index);
+				setOccupied(handle_index);
+				dirty.Mark(handle_index);
+				out[out_index] = handle_t::CreateNext(old_handle_validation_id, handle_index);
+			}
+
+			const data_t first_new_index = data_t(handles.size());
+			const data_t new_index_count = data_t(out.size() - out_index);
+			handles.resize(handles.size() + new_index_count, handle_t::CreateNew(is_occupied_index));
+			occupancy.resize((handles.size() + 63) / 64, 0);
+			for (data_t i = 0; i < new_index_count; i++)
+			{
+				out[out_index + i] = handle_t::CreateNew(first_new_index + i);
+				setOccupied(first_new_index + i);
+			}
+			dirty.MarkRange(first_new_index, handles.size());
+			if (new_index_count > 0) next_free_index = data_t(handles.size()); /* Otherwise the rest of the free chain stays */
+			used_index_count += data_t(out.size());
+		}
 		inline void FreeHandle(handle_t handle)
 		{
 			const data_t handle_index = handle.GetIndex();
 			assert(IsOccupied(handle_index));
 			assert(handles[handle_index].GetValidationID() == handle.GetValidationID());
 			handles[handle_index] = handle_t::Create(handle.GetValidationID(), next_free_index);
+			setFree(handle_index);
+			dirty.Mark(handle_index);
 			next_free_index = handle_index;
 			used_index_count--;
 		}
+		/* Frees every handle, the last one is handed out again first */
+		inline void FreeHandles(std::span<const handle_t> freed)
+		{
+			for (const handle_t handle : freed)
+			{
+				const data_t handle_index = handle.GetIndex();
+				assert(IsOccupied(handle_index));
+				assert(handles[handle_index].GetValidationID() == handle.GetValidationID());
+				handles[handle_index] = handle_t::Create(handle.GetValidationID(), next_free_index);
+				setFree(handle_index);
+				dirty.Mark(handle_index);
+				next_free_index = handle_index;
+			}
+			used_index_count -= data_t(freed.size());
+		}
 		inline void Clear()
 		{
 			handles.clear();
+			occupancy.clear();
+			dirty.MarkCleared();
 			next_free_index = 0;
 			used_index_count = 0;
 		}
 
+		/* Stores the handle array with its validation ids and free chain as is */
+		inline void Save(SnapshotWriter& writer) const
+		{
+			writer.Write(next_free_index);
+			writer.Write(used_index_count);
+			writer.WriteArray(std::span<const handle_t>(handles));
+			writer.WriteArray(std::span<const uint64_t>(occupancy));
+		}
+		inline void Load(SnapshotReader& reader)
+		{
+			next_free_index = reader.Read<data_t>();
+			used_index_count = reader.Read<data_t>();
+			reader.ReadArray(handles);
+			reader.ReadArray(occupancy);
+			if (occupancy.size() != (handles.size() + 63) / 64 || next_free_index > MaxIndex() || used_index_count > MaxIndex() || !hasValidIndices()) reader.Fail();
+		}
+		/* Stores the handles created or freed since the last snapshot, a block of 64 handles shares one occupancy word */
+		inline void SaveDelta(SnapshotWriter& writer)
+		{
+			writer.Write(next_free_index);
+			writer.Write(used_index_count);
+			writer.WriteDirty(std::span<const handle_t>(handles), dirty);
+			writer.WriteDirty(std::span<const uint64_t>(occupancy), dirty, 1);
+			dirty.Reset();
+		}
+		inline void LoadDelta(SnapshotReader& reader)
+		{
+			next_free_index = reader.Read<data_t>();
+			used_index_count = reader.Read<data_t>();
+			reader.ReadDirty(handles, internal_ecs::max_snapshot_entries<handle_t>);
+			reader.ReadDirty(occupancy, internal_ecs::max_snapshot_entries<handle_t>);
+			if (occupancy.size() != (handles.size() + 63) / 64 || next_free_index > MaxIndex() || used_index_count > MaxIndex() || !hasValidIndices()) reader.Fail();
+		}
+		inline void ResetDirty() { dirty.Reset(); }
+
 		inline bool IsOccupied(data_t handle_index) const
 		{
 			assert(handle_index < MaxIndex());
 			return handles[handle_index].GetIndex() == is_occupied_index;
 		}
 
+		/* Live handle of an occupied index */
+		inline handle_t GetHandle(data_t handle_index) const
+		{
+			assert(IsOccupied(handle_index));
+			return handle_t::Create(handles[handle_index].GetValidationID(), handle_index);
+		}
+
+		/* Whether handle is the live handle of its index, false for handles of destroyed entities */
+		inline bool IsCurrent(handle_t handle) const
+		{
+			const data_t handle_index = handle.GetIndex();
+			return handle_index < MaxIndex() && IsOccupied(handle_index) && handles[handle_index].GetValidationID() == handle.GetValidationID();
+		}
+
 		inline data_t MaxIndex() const
 		{
 			return data_t(handles.size());
@@ -62,7 +170,14 @@ namespace lcs
 		{
 			return used_index_count;
 		}
+		/* Entities in use over indices handed out so far, freed indices form the free list */
+		inline ContainerStats Stats() const
+		{
+			const size_t bytes = internal_ecs::CapacityBytes(handles) + internal_ecs::CapacityBytes(occupancy) + dirty.MemoryUsage();
+			return { used_index_count, MaxIndex(), bytes, internal_ecs::FillRatio(used_index_count, MaxIndex()), uint64_t(MaxIndex() - used_index_count) };
+		}
 
+		/* Walks occupied indices through the occupancy bitset, skipping 64 free indices per word */
 		class Iterator
 		{
 		public:
@@ -72,71 +187,126 @@ namespace lcs
 			using pointer = handle_t*;
 			using reference = handle_t&;
 
-			Iterator(const HandleFreeList& owner, handle_container_t::const_iterator it)
-				: owner(owner), base_iterator(it)
-			{
-				if ((base_iterator != std::end(owner.handles)) && (it->GetIndex() != is_occupied_index)) ++(*this);
-			};
+			Iterator() {};
+			Iterator(const HandleFreeList& owner, data_t index) : owner(&owner) { seek(owner.nextOccupied(index)); };
 
-			inline handle_t operator*() const {
-				const data_t handle_index = data_t(std::distance(std::begin(owner.handles), base_iterator));
-				return handle_t::Create(base_iterator->GetValidationID(), handle_index);
-			}
+			inline handle_t operator*() const { return handle_t::Create(owner->handles[index].GetValidationID(), index); }
 
 			inline Iterator& operator++()
 			{
-				++base_iterator;
-				while ((base_iterator != std::end(owner.handles)) && (base_iterator->GetIndex() != is_occupied_index))
-				{
-					++base_iterator;
-				}
-				return *this;
-			}
-
-			inline Iterator& operator--()
-			{
-				--base_iterator;
-				while ((base_iterator != std::begin(owner.handles)) && (base_iterator->GetIndex() != is_occupied_index))
-				{
-					--base_iterator;
-				}
+				remaining &= remaining - 1;
+				if (remaining != 0) index = data_t((index & ~data_t(63)) + std::countr_zero(remaining));
+				else seek(owner->nextOccupied((index | data_t(63)) + 1));
 				return *this;
 			}
+			inline Iterator& operator--() { seek(owner->previousOccupied(index)); return *this; }
 
 			inline Iterator operator++(int) { Iterator tmp = *this; ++(*this); return tmp; }
 			inline Iterator operator--(int) { Iterator tmp = *this; --(*this); return tmp; }
 
-			friend bool operator== (const Iterator& a, const Iterator& b) { return a.base_iterator == b.base_iterator; };
-			friend bool operator!= (const Iterator& a, const Iterator& b) { return a.base_iterator != b.base_iterator; };
+			friend bool operator== (const Iterator& a, const Iterator& b) { return a.index == b.index; };
+			friend bool operator!= (const Iterator& a, const Iterator& b) { return a.index != b.index; };
 
 		private:
-			handle_container_t::const_iterator base_iterator{};
-			const HandleFreeList& owner;
+			/* Occupied bits of the current word from index on, so most increments stay within one word */
+			inline void seek(data_t new_index)
+			{
+				index = new_index;
+				remaining = index < owner->MaxIndex() ? owner->occupancy[index / 64] & (~uint64_t(0) << (index % 64)) : 0;
+			}
+
+			const HandleFreeList* owner{ nullptr };
+			data_t index{ 0 };
+			uint64_t remaining{ 0 };
 		};
 
 		using RIterator = std::reverse_iterator<Iterator>;
 
-		Iterator begin()
+		inline Iterator begin() const { return Iterator(*this, 0); }
+		inline Iterator end() const { return Iterator(*this, MaxIndex()); }
+		inline RIterator rbegin() const { return RIterator(end()); }
+		inline RIterator rend() const { return RIterator(begin()); }
+
+	private:
+		inline void setOccupied(data_t handle_index) { occupancy[handle_index / 64] |= uint64_t(1) << (handle_index % 64); };
+		inline void setFree(data_t handle_index) { occupancy[handle_index / 64] &= ~(uint64_t(1) << (handle_index % 64)); };
+
+		/* First occupied index at or after from, MaxIndex() if there is none */
+		inline data_t nextOccupied(data_t from) const;
+
+		/* Last occupied index before from, which must exist */
+		inline data_t previousOccupied(data_t from) const;
+
+		/* Whether the occupancy bits and used_index_count match the handles and the free chain visits every free index once,
+		 * checked on load before a damaged snapshot can hand out occupied or out of range indices */
+		inline bool hasValidIndices() const;
+
+		static constexpr data_t is_occupied_index = handle_t().GetIndex();
+		data_t next_free_index{ 0 };
+		data_t used_index_count{ 0 };
+		handle_container_t handles{};
+
+		/* Bit per index, set while the index is occupied. Bits past MaxIndex() stay clear */
+		std::pmr::vector<uint64_t> occupancy{};
+		DirtyBlocks<64> dirty{}; /* Over handles */
+	};
+
+	template <typename handle_t>
+	HandleFreeList<handle_t>::data_t HandleFreeList<handle_t>::nextOccupied(data_t from) const
+	{
+		const data_t max_index = MaxIndex();
+		if (from >= max_index) return max_index;
+
+		size_t word_index = from / 64;
+		uint64_t word = occupancy[word_index] & (~uint64_t(0) << (from % 64));
+		while (word == 0)
 		{
-			return Iterator(*this, std::begin(handles));
+			if (++word_index == occupancy.size()) return max_index;
+			word = occupancy[word_index];
 		}
-		Iterator end()
+		return data_t(word_index * 64 + std::countr_zero(word));
+	}
+
+	template <typename handle_t>
+	bool HandleFreeList<handle_t>::hasValidIndices() const
+	{
+		const data_t max_index = MaxIndex();
+		data_t occupied_count = 0;
+		for (size_t word_index = 0; word_index < occupancy.size(); word_index++)
 		{
-			return Iterator(*this, std::end(handles));
+			uint64_t word = 0;
+			for (data_t handle_index = data_t(word_index * 64); handle_index < max_index && handle_index < (word_index + 1) * 64; handle_index++)
+			{
+				word |= uint64_t(handles[handle_index].GetIndex() == is_occupied_index) << (handle_index % 64);
+			}
+			if (word != occupancy[word_index]) return false;
+			occupied_count += data_t(std::popcount(word));
 		}
-		RIterator rbegin()
+		if (occupied_count != used_index_count) return false;
+
+		/* Bounded by the free count, so a cycle fails instead of looping */
+		const data_t free_count = max_index - used_index_count;
+		data_t chain_length = 0;
+		for (data_t handle_index = next_free_index; handle_index != max_index; handle_index = handles[handle_index].GetIndex())
 		{
-			return RIterator(Iterator(*this, std::end(handles)));
+			if (handle_index > max_index || chain_length == free_count || handles[handle_index].GetIndex() == is_occupied_index) return false;
+			chain_length++;
 		}
-		RIterator rend()
+		return chain_length == free_count;
+	}
+
+	template <typename handle_t>
+	HandleFreeList<handle_t>::data_t HandleFreeList<handle_t>::previousOccupied(data_t from) const
+	{
+		assert(from > 0);
+		size_t word_index = (from - 1) / 64;
+		const uint32_t bit = (from - 1) % 64;
+		uint64_t word = occupancy[word_index] & (~uint64_t(0) >> (63 - bit));
+		while (word == 0)
 		{
-			return RIterator(Iterator(*this, std::begin(handles)));
+			assert(word_index > 0); /* Decremented past the first occupied index */
+			word = occupancy[--word_index];
 		}
-
-	private:
-		static constexpr data_t is_occupied_index = handle_t().GetIndex();
-		data_t next_free_index{ 0 };
-		data_t used_index_count{ 0 };
-		std::vector<handle_t> handles{};
-	};
-}
\ No newline at end of file
+		return data_t(word_index * 64 + 63 - std::countl_zero(word));
+	}
+}
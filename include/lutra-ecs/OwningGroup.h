@@ -0,0 +1,173 @@
+#pragma once
+#include <lutra-ecs/SparseSet.h>
+#include <lutra-ecs/ThreadPool.h>
+#include <algorithm>
+#include <cassert>
+#include <span>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace lcs
+{
+	/* Owning group over a set of SparseSets.
+	 * The group keeps every entity that has all of Ts in the prefix [0, Size()) of each owned set, in the same order,
+	 * so iterating the group walks plain arrays in lockstep. A SparseSet can be owned by a single group. */
+	template <typename handle_t, typename... Ts>
+	class OwningGroup
+	{
+		static_assert(sizeof...(Ts) > 1);
+
+		using Indices = std::index_sequence_for<Ts...>;
+
+	public:
+		using data_t = handle_t::data_t;
+
+		/* The sets must not be owned by another group yet, see CanOwn */
+		inline OwningGroup(SparseSet<handle_t, Ts>&... owned_sets);
+		inline ~OwningGroup();
+
+		OwningGroup(const OwningGroup&) = delete;
+		OwningGroup& operator=(const OwningGroup&) = delete;
+
+		inline data_t Size() const { return group_size; };
+		inline bool Contains(handle_t handle) const;
+
+		class Iterator
+		{
+		public:
+			/* Accessors */
+			inline std::tuple<handle_t, Ts&...> operator*() const { return std::tuple<handle_t, Ts&...>(owners[index], std::get<Ts*>(data)[index]...); }
+
+			inline handle_t GetOwner() const { return owners[index]; }
+
+			/* Prefix increment */
+			inline Iterator& operator++() { index++; return *this; }
+
+			/* Postfix increment */
+			inline Iterator operator++(int) { Iterator tmp = *this; ++(*this); return tmp; }
+
+			friend bool operator== (const Iterator& a, const Iterator& b) { return a.index == b.index; };
+			friend bool operator!= (const Iterator& a, const Iterator& b) { return a.index != b.index; };
+
+		private:
+			inline Iterator(const handle_t* owners, std::tuple<Ts*...> data, size_t index) : owners(owners), data(data), index(index) {};
+
+			const handle_t* owners;
+			std::tuple<Ts*...> data;
+			size_t index;
+
+			friend class OwningGroup;
+		};
+
+		/* begin and ParallelForEach mark the group prefix of every owned set as changed for delta snapshots */
+		inline Iterator begin() { markChanged(); return Iterator(std::get<0>(sets)->DenseOwners().data(), { std::get<SparseSet<handle_t, Ts>*>(sets)->DenseData().data()... }, 0); };
+		inline Iterator end() { return Iterator(nullptr, {}, group_size); };
+
+		/* Calls fn(handle_t, Ts&...) for every entity in the group, splitting the prefix into tasks on the pool */
+		template <typename F>
+		inline void ParallelForEach(F&& fn, uint32_t grain_size, ThreadPool& pool);
+
+		/* Whether none of the sets has a hook installed, so a group may own them */
+		inline static bool CanOwn(const SparseSet<handle_t, Ts>&... owned_sets) { return ((owned_sets.GetHook().key == nullptr) && ...); };
+
+		/* Identifies the group type in the hooks of the owned sets */
+		inline static const void* Key() { static const char key{}; return &key; };
+
+	private:
+		inline static void onAdd(void* context, handle_t handle);
+		inline static void onRemove(void* context, handle_t handle);
+		inline static void onClear(void* context);
+
+		inline void markChanged() { std::apply([this](auto*... set) { (set->MarkRangeChanged(0, group_size), ...); }, sets); };
+
+		template <size_t... I>
+		inline bool hasAll(handle_t handle, std::index_sequence<I...>) const { return (std::get<I>(sets)->Has(handle) && ...); };
+
+		template <size_t... I>
+		inline void swapAll(handle_t handle, data_t dense_index, std::index_sequence<I...>)
+		{
+			(std::get<I>(sets)->SwapDense(std::get<I>(sets)->DenseIndex(handle), dense_index), ...);
+		}
+
+		std::tuple<SparseSet<handle_t, Ts>*...> sets;
+		data_t group_size{ 0 };
+	};
+
+	template <typename handle_t, typename... Ts>
+	OwningGroup<handle_t, Ts...>::OwningGroup(SparseSet<handle_t, Ts>&... owned_sets) : sets(&owned_sets...)
+	{
+		assert(CanOwn(owned_sets...)); /* Set is already owned by another group */
+		(owned_sets.SetHook({ this, Key(), &onAdd, &onRemove, &onClear }), ...);
+
+		/* Pull entities already having all components into the group */
+		size_t smallest_size = size_t(-1);
+		std::span<const handle_t> smallest_owners{};
+		((owned_sets.DenseSize() < smallest_size ? (smallest_size = owned_sets.DenseSize(), smallest_owners = owned_sets.DenseOwners(), 0) : 0), ...);
+
+		const std::vector<handle_t> candidates(smallest_owners.begin(), smallest_owners.end());
+		for (const handle_t handle : candidates)
+		{
+			onAdd(this, handle);
+		}
+	}
+
+	template <typename handle_t, typename... Ts>
+	OwningGroup<handle_t, Ts...>::~OwningGroup()
+	{
+		std::apply([](auto*... set) { (set->SetHook({}), ...); }, sets);
+	}
+
+	template <typename handle_t, typename... Ts>
+	bool OwningGroup<handle_t, Ts...>::Contains(handle_t handle) const
+	{
+		auto& first_set = *std::get<0>(sets);
+		return first_set.Has(handle) && first_set.DenseIndex(handle) < group_size;
+	}
+
+	template <typename handle_t, typename... Ts> template <typename F>
+	void OwningGroup<handle_t, Ts...>::ParallelForEach(F&& fn, uint32_t grain_size, ThreadPool& pool)
+	{
+		assert(grain_size > 0);
+		markChanged();
+		const handle_t* owners = std::get<0>(sets)->DenseOwners().data();
+		const std::tuple<Ts*...> data{ std::get<SparseSet<handle_t, Ts>*>(sets)->DenseData().data()... };
+		const uint32_t entry_count = uint32_t(group_size);
+		const uint32_t task_count = entry_count / grain_size + (entry_count % grain_size != 0);
+		pool.ParallelFor(task_count, [&](uint32_t task_index)
+			{
+				const uint32_t first_entry = task_index * grain_size;
+				const uint32_t last_entry = first_entry + std::min(grain_size, entry_count - first_entry);
+				for (uint32_t i = first_entry; i < last_entry; i++)
+				{
+					fn(owners[i], std::get<Ts*>(data)[i]...);
+				}
+			});
+	}
+
+	template <typename handle_t, typename... Ts>
+	void OwningGroup<handle_t, Ts...>::onAdd(void* context, handle_t handle)
+	{
+		OwningGroup& group = *static_cast<OwningGroup*>(context);
+		if (!group.hasAll(handle, Indices{}) || group.Contains(handle)) return;
+
+		group.swapAll(handle, group.group_size, Indices{});
+		group.group_size++;
+	}
+
+	template <typename handle_t, typename... Ts>
+	void OwningGroup<handle_t, Ts...>::onRemove(void* context, handle_t handle)
+	{
+		OwningGroup& group = *static_cast<OwningGroup*>(context);
+		if (!group.Contains(handle)) return;
+
+		group.group_size--;
+		group.swapAll(handle, group.group_size, Indices{});
+	}
+
+	template <typename handle_t, typename... Ts>
+	void OwningGroup<handle_t, Ts...>::onClear(void* context)
+	{
+		static_cast<OwningGroup*>(context)->group_size = 0;
+	}
+}
@@ -0,0 +1,257 @@
+#pragma once
+#include <lutra-ecs/Snapshot.h>
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cinttypes>
+#include <cstddef>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+namespace lcs
+{
+	/* Index array that only allocates fixed-size pages on first write.
+	 * Unallocated pages point to a shared page filled with invalid_value, so reads stay branch free
+	 * and sparse arrays sized to the entity capacity cost a pointer per page until they get an entry.
+	 * Pages and the page table come from the memory resource given on construction. */
+	template <typename data_t, uint32_t page_bits = 12>
+	class PagedIndexArray
+	{
+	public:
+		static constexpr data_t invalid_value{ data_t(-1) };
+		static constexpr size_t page_size{ size_t(1) << page_bits };
+		static constexpr size_t dirty_block_size{ 64 };
+
+		PagedIndexArray() {};
+		explicit PagedIndexArray(std::pmr::memory_resource* resource) : pages(resource), dirty(resource) {};
+		inline PagedIndexArray(const PagedIndexArray& other);
+		inline PagedIndexArray(PagedIndexArray&& other) noexcept : pages(std::move(other.pages)), element_count(other.element_count), dirty(GetResource()) { other.pages.clear(); other.element_count = 0; markAllocated(); };
+		inline PagedIndexArray& operator=(const PagedIndexArray& other);
+		inline PagedIndexArray& operator=(PagedIndexArray&& other) noexcept;
+		inline ~PagedIndexArray() { clear(); };
+
+		/* Read access, never allocates */
+		inline data_t operator[](size_t index) const;
+
+		/* Write access for structural changes, allocates the page holding index if necessary and marks its block dirty */
+		inline data_t& At(size_t index);
+
+		inline size_t size() const { return element_count; };
+		inline void resize(size_t new_size);
+		inline void clear();
+
+		/* Stores the allocated pages only */
+		inline void Save(SnapshotWriter& writer) const;
+		inline void Load(SnapshotReader& reader);
+		/* Stores the blocks written through At since the last snapshot */
+		inline void SaveDelta(SnapshotWriter& writer);
+		inline void LoadDelta(SnapshotReader& reader);
+		inline void ResetDirty() { dirty.Reset(); };
+
+		/* Whether every entry is invalid_value or the position of an owner with that index, and every owner is reached this way.
+		 * Sparse sets check this after loading a snapshot, before a damaged one can send lookups out of range */
+		template <typename handle_t>
+		inline bool MatchesOwners(std::span<const handle_t> owners) const;
+
+		inline size_t AllocatedPageCount() const;
+		inline size_t MemoryUsage() const { return pages.capacity() * sizeof(data_t*) + AllocatedPageCount() * page_size * sizeof(data_t) + dirty.MemoryUsage(); };
+		inline std::pmr::memory_resource* GetResource() const { return pages.get_allocator().resource(); };
+
+	private:
+		static constexpr size_t page_mask{ page_size - 1 };
+
+		inline static bool isAllocated(const data_t* page) { return page != invalid_page.data(); };
+		inline static data_t* emptyPage() { return const_cast<data_t*>(invalid_page.data()); };
+		inline void markAllocated();
+		inline data_t* allocatePage() { return static_cast<data_t*>(GetResource()->allocate(page_size * sizeof(data_t), alignof(data_t))); };
+		inline void deallocatePage(data_t* page) { GetResource()->deallocate(page, page_size * sizeof(data_t), alignof(data_t)); };
+
+		/* Shared by all unallocated pages, never written to */
+		alignas(64) inline static const std::array<data_t, page_size> invalid_page = []() { std::array<data_t, page_size> page; page.fill(invalid_value); return page; }();
+
+		std::pmr::vector<data_t*> pages;
+		size_t element_count{ 0 };
+		DirtyBlocks<dirty_block_size> dirty;
+	};
+
+	template <typename data_t, uint32_t page_bits>
+	PagedIndexArray<data_t, page_bits>::PagedIndexArray(const PagedIndexArray& other)
+	{
+		*this = other;
+	}
+
+	template <typename data_t, uint32_t page_bits>
+	PagedIndexArray<data_t, page_bits>& PagedIndexArray<data_t, page_bits>::operator=(const PagedIndexArray& other)
+	{
+		if (this == &other) return *this;
+
+		clear();
+		pages.resize(other.pages.size(), emptyPage());
+		for (size_t page_index = 0; page_index < pages.size(); page_index++)
+		{
+			if (!isAllocated(other.pages[page_index])) continue;
+			pages[page_index] = allocatePage();
+			std::copy(other.pages[page_index], other.pages[page_index] + page_size, pages[page_index]);
+		}
+		element_count = other.element_count;
+		markAllocated();
+		return *this;
+	}
+
+	template <typename data_t, uint32_t page_bits>
+	PagedIndexArray<data_t, page_bits>& PagedIndexArray<data_t, page_bits>::operator=(PagedIndexArray&& other) noexcept
+	{
+		if (this == &other) return *this;
+		if (GetResource() != other.GetResource()) return *this = other; /* Pages can't change resource, copy them instead */
+
+		clear();
+		pages = std::move(other.pages);
+		element_count = other.element_count;
+		other.pages.clear();
+		other.element_count = 0;
+		markAllocated();
+		return *this;
+	}
+
+	template <typename data_t, uint32_t page_bits>
+	data_t PagedIndexArray<data_t, page_bits>::operator[](size_t index) const
+	{
+		assert(index < element_count);
+		return pages[index >> page_bits][index & page_mask];
+	}
+
+	template <typename data_t, uint32_t page_bits>
+	data_t& PagedIndexArray<data_t, page_bits>::At(size_t index)
+	{
+		assert(index < element_count);
+		data_t*& page = pages[index >> page_bits];
+		if (!isAllocated(page))
+		{
+			page = allocatePage();
+			std::fill(page, page + page_size, invalid_value);
+		}
+		dirty.Mark(index);
+		return page[index & page_mask];
+	}
+
+	template <typename data_t, uint32_t page_bits>
+	void PagedIndexArray<data_t, page_bits>::resize(size_t new_size)
+	{
+		assert(new_size >= element_count); /* Only growing is supported, use clear to shrink */
+		pages.resize((new_size + page_mask) >> page_bits, emptyPage());
+		element_count = new_size;
+		dirty.Reserve(new_size); /* At never grows the dirty bits */
+	}
+
+	template <typename data_t, uint32_t page_bits>
+	void PagedIndexArray<data_t, page_bits>::clear()
+	{
+		for (data_t* page : pages)
+		{
+			if (isAllocated(page)) deallocatePage(page);
+		}
+		pages.clear();
+		element_count = 0;
+		dirty.MarkCleared();
+	}
+
+	template <typename data_t, uint32_t page_bits>
+	void PagedIndexArray<data_t, page_bits>::markAllocated()
+	{
+		dirty.MarkCleared();
+		for (size_t page_index = 0; page_index < pages.size(); page_index++)
+		{
+			if (isAllocated(pages[page_index])) dirty.MarkRange(page_index * page_size, (page_index + 1) * page_size);
+		}
+	}
+
+	template <typename data_t, uint32_t page_bits>
+	size_t PagedIndexArray<data_t, page_bits>::AllocatedPageCount() const
+	{
+		size_t count = 0;
+		for (const data_t* page : pages)
+		{
+			count += isAllocated(page) ? 1 : 0;
+		}
+		return count;
+	}
+
+	template <typename data_t, uint32_t page_bits>
+	void PagedIndexArray<data_t, page_bits>::Save(SnapshotWriter& writer) const
+	{
+		std::vector<uint64_t> page_indices{};
+		for (size_t page_index = 0; page_index < pages.size(); page_index++)
+		{
+			if (isAllocated(pages[page_index])) page_indices.push_back(page_index);
+		}
+
+		writer.Write(uint64_t(element_count));
+		writer.WriteArray(std::span<const uint64_t>(page_indices));
+		for (const uint64_t page_index : page_indices)
+		{
+			writer.WriteArray(std::span<const data_t>(pages[page_index], page_size));
+		}
+	}
+
+	template <typename data_t, uint32_t page_bits>
+	void PagedIndexArray<data_t, page_bits>::Load(SnapshotReader& reader)
+	{
+		clear();
+		const uint64_t size = reader.Read<uint64_t>();
+		if (size > uint64_t(invalid_value)) { reader.Fail(); return; } /* Indices of data_t, a damaged size must not reach the page table */
+		resize(size_t(size));
+		const auto page_indices = reader.ReadArray<uint64_t>();
+		for (const uint64_t page_index : page_indices)
+		{
+			const auto page = reader.ReadArray<data_t>();
+			if (page.size() != page_size || page_index >= pages.size() || isAllocated(pages[page_index])) { reader.Fail(); return; }
+			pages[page_index] = allocatePage();
+			std::copy(page.begin(), page.end(), pages[page_index]);
+		}
+	}
+
+	template <typename data_t, uint32_t page_bits> template <typename handle_t>
+	bool PagedIndexArray<data_t, page_bits>::MatchesOwners(std::span<const handle_t> owners) const
+	{
+		/* Unallocated pages hold nothing but invalid_value */
+		size_t used_count = 0;
+		for (size_t page_index = 0; page_index < pages.size(); page_index++)
+		{
+			if (!isAllocated(pages[page_index])) continue;
+			const size_t first = page_index << page_bits;
+			for (size_t index = first; index < first + page_size && index < element_count; index++)
+			{
+				const data_t dense_index = pages[page_index][index & page_mask];
+				if (dense_index == invalid_value) continue;
+				if (dense_index >= owners.size() || owners[dense_index].GetIndex() != index) return false;
+				used_count++;
+			}
+		}
+		return used_count == owners.size();
+	}
+
+	template <typename data_t, uint32_t page_bits>
+	void PagedIndexArray<data_t, page_bits>::SaveDelta(SnapshotWriter& writer)
+	{
+		/* Written blocks always lie in allocated pages, runs are cut at page ends */
+		writer.WriteDirty<data_t>(element_count, dirty, dirty_block_size, page_size, [&](size_t first) { return pages[first >> page_bits] + (first & page_mask); });
+		dirty.Reset();
+	}
+
+	template <typename data_t, uint32_t page_bits>
+	void PagedIndexArray<data_t, page_bits>::LoadDelta(SnapshotReader& reader)
+	{
+		reader.ReadDirty<data_t>(size_t(invalid_value), [&](bool cleared, size_t size)
+			{
+				if (cleared) clear();
+				if (size < element_count) reader.Fail(); /* Only clearing shrinks */
+				else resize(size);
+			},
+			[&](size_t first, std::span<const data_t> values)
+			{
+				if ((first & page_mask) + values.size() > page_size) { reader.Fail(); return; }
+				std::copy(values.begin(), values.end(), &At(first));
+			});
+	}
+}
@@ -0,0 +1,335 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <cassert>
+#include <cinttypes>
+#include <cstddef>
+#include <cstdio>
+#include <cstring>
+#include <limits>
+#include <memory_resource>
+#include <span>
+#include <type_traits>
+#include <vector>
+
+namespace lcs
+{
+	/* Binary snapshot layout: plain values are stored as raw bytes, arrays as a 64 bit element count followed by the
+	 * elements at the next 64 byte aligned offset. Mapped files start page aligned, so arrays can be used in place.
+	 * Only trivially copyable types are stored, snapshots are meant to be loaded by the same build that saved them. */
+	namespace internal_ecs
+	{
+		constexpr size_t snapshot_alignment = 64;
+
+		/* Most elements an array of a container indexed by handle_t can hold, arrays of damaged deltas claiming more are refused */
+		template <typename handle_t>
+		constexpr size_t max_snapshot_entries = size_t(handle_t::max_index) + 1;
+
+		/* Elements [first, first + count) of an array stored by a delta snapshot */
+		struct SnapshotRun
+		{
+			uint64_t first;
+			uint64_t count;
+		};
+	}
+
+	/* Blocks of block_size elements of an array that were written since the last snapshot, delta snapshots only store these.
+	 * Clearing the array is recorded too, so a delta can start the array over.
+	 * Structural changes mark through Mark and MarkRange, which grow the bits to cover the array. Writes to existing elements
+	 * mark through MarkConcurrent and MarkRangeConcurrent, which never allocate and may run on several threads at once. */
+	template <size_t block_size = 64>
+	class DirtyBlocks
+	{
+	public:
+		DirtyBlocks() {};
+		explicit DirtyBlocks(std::pmr::memory_resource* resource) : bits(resource) {};
+
+		inline void Mark(size_t index)
+		{
+			const size_t block = index / block_size;
+			if (block / 64 >= bits.size()) bits.resize(block / 64 + 1, 0);
+			bits[block / 64] |= uint64_t(1) << (block % 64);
+		};
+		/* Marks the elements [first, last) */
+		inline void MarkRange(size_t first, size_t last);
+		/* Index has to be covered already, by a structural mark, Reserve or Reset */
+		inline void MarkConcurrent(size_t index) { markWord((index / block_size) / 64, uint64_t(1) << ((index / block_size) % 64)); };
+		inline void MarkRangeConcurrent(size_t first, size_t last);
+		/* Same as MarkConcurrent for a single thread. Marked blocks are not stored again, so runs of marks in one block don't wait on each other */
+		inline void MarkCovered(size_t index)
+		{
+			const size_t block = index / block_size;
+			assert(block / 64 < bits.size()); /* Not covered by a structural mark, Reserve or Reset */
+			uint64_t& word = bits[block / 64];
+			const uint64_t mask = uint64_t(1) << (block % 64);
+			if ((word & mask) == 0) word |= mask;
+		};
+		inline void MarkCleared() { bits.clear(); cleared = true; };
+		/* Forgets the marks and keeps the bits for at least element_count elements */
+		inline void Reset(size_t element_count = 0) { std::fill(bits.begin(), bits.end(), 0); Reserve(element_count); cleared = false; };
+		inline void Reserve(size_t element_count) { const size_t word_count = (element_count + block_size * 64 - 1) / (block_size * 64); if (word_count > bits.size()) bits.resize(word_count, 0); };
+
+		inline bool IsCleared() const { return cleared; };
+		inline size_t MemoryUsage() const { return bits.capacity() * sizeof(uint64_t); };
+
+		/* Calls fn(size_t first_block, size_t block_count) for every run of marked blocks */
+		template <typename F>
+		inline void ForEachRun(F&& fn) const;
+
+	private:
+		inline void markWord(size_t word_index, uint64_t mask)
+		{
+			assert(word_index < bits.size()); /* Not covered by a structural mark, Reserve or Reset */
+			std::atomic_ref<uint64_t> word(bits[word_index]);
+			if ((word.load(std::memory_order_relaxed) & mask) != mask) word.fetch_or(mask, std::memory_order_relaxed);
+		};
+
+		std::pmr::vector<uint64_t> bits{};
+		bool cleared{ false };
+	};
+
+	/* Streams a snapshot to a file */
+	class SnapshotWriter
+	{
+	public:
+		explicit SnapshotWriter(const char* path) : file(std::fopen(path, "wb")) { failed = file == nullptr; };
+		SnapshotWriter(const SnapshotWriter&) = delete;
+		SnapshotWriter& operator=(const SnapshotWriter&) = delete;
+		inline ~SnapshotWriter() { Close(); };
+
+		template <typename T>
+		inline void Write(const T& value);
+
+		template <typename T>
+		inline void WriteArray(std::span<const T> values);
+
+		/* Stores the size of values and the elements of the marked blocks, elements_per_block elements per block.
+		 * Arrays indexed by block, such as occupancy words of 64 entities, pass 1 with the dirty blocks of the entities */
+		template <typename T, size_t block_size>
+		inline void WriteDirty(std::span<const T> values, const DirtyBlocks<block_size>& dirty, size_t elements_per_block = block_size)
+		{
+			WriteDirty<T>(values.size(), dirty, elements_per_block, std::numeric_limits<size_t>::max(), [&](size_t first) { return values.data() + first; });
+		};
+
+		/* Same for arrays that are only contiguous in pieces of piece_size elements, data(first) points to element first */
+		template <typename T, size_t block_size, typename F>
+		inline void WriteDirty(size_t size, const DirtyBlocks<block_size>& dirty, size_t elements_per_block, size_t piece_size, F&& data);
+
+		/* Flushes and closes the file, returns false if any write failed */
+		inline bool Close();
+		inline bool Failed() const { return failed; };
+
+	private:
+		inline void writeBytes(const void* bytes, size_t size);
+
+		std::FILE* file{ nullptr };
+		size_t offset{ 0 };
+		bool failed{ false };
+	};
+
+	/* Reads a snapshot from memory, usually a MappedFile from SnapshotFile.h. Reads past the end return nothing and mark the reader as failed */
+	class SnapshotReader
+	{
+	public:
+		explicit SnapshotReader(std::span<const std::byte> data) : data(data) {};
+
+		template <typename T>
+		inline T Read();
+
+		/* Elements in place, valid as long as the underlying memory is */
+		template <typename T>
+		inline std::span<const T> ReadArray();
+
+		/* Replaces the contents of out with the next array in one bulk copy */
+		template <typename T, typename Allocator>
+		inline void ReadArray(std::vector<T, Allocator>& out) { const auto values = ReadArray<T>(); out.assign(values.begin(), values.end()); };
+
+		/* Reads the output of SnapshotWriter::WriteDirty. Calls resize(bool cleared, size_t size) once,
+		 * then write(size_t first, std::span<const T> values) for every stored run.
+		 * A size above max_size fails the reader before resize is called */
+		template <typename T, typename Resize, typename Write>
+		inline void ReadDirty(size_t max_size, Resize&& resize, Write&& write);
+
+		/* Applies the output of SnapshotWriter::WriteDirty to out, which holds at most max_size elements */
+		template <typename T, typename Allocator>
+		inline void ReadDirty(std::vector<T, Allocator>& out, size_t max_size)
+		{
+			ReadDirty<T>(max_size, [&](bool cleared, size_t size) { if (cleared) out.clear(); out.resize(size); },
+				[&](size_t first, std::span<const T> values) { std::copy(values.begin(), values.end(), out.begin() + first); });
+		};
+
+		/* Marks the snapshot as damaged, for containers finding inconsistent arrays */
+		inline void Fail() { failed = true; };
+		inline bool Failed() const { return failed; };
+		inline bool AtEnd() const { return offset == data.size(); };
+
+	private:
+		inline const std::byte* readBytes(size_t size);
+
+		std::span<const std::byte> data;
+		size_t offset{ 0 };
+		bool failed{ false };
+	};
+
+	template <size_t block_size>
+	void DirtyBlocks<block_size>::MarkRange(size_t first, size_t last)
+	{
+		if (first >= last) return;
+		const size_t first_block = first / block_size;
+		const size_t last_block = (last - 1) / block_size;
+		if (last_block / 64 >= bits.size()) bits.resize(last_block / 64 + 1, 0);
+		for (size_t block = first_block; block <= last_block; block++)
+		{
+			bits[block / 64] |= uint64_t(1) << (block % 64);
+		}
+	}
+
+	template <size_t block_size>
+	void DirtyBlocks<block_size>::MarkRangeConcurrent(size_t first, size_t last)
+	{
+		if (first >= last) return;
+		const size_t first_block = first / block_size;
+		const size_t last_block = (last - 1) / block_size;
+		for (size_t word_index = first_block / 64; word_index <= last_block / 64; word_index++)
+		{
+			/* Bits of [first_block, last_block] within this word */
+			const size_t low = word_index == first_block / 64 ? first_block % 64 : 0;
+			const size_t high = word_index == last_block / 64 ? last_block % 64 : 63;
+			markWord(word_index, (~uint64_t(0) >> (63 - high)) & (~uint64_t(0) << low));
+		}
+	}
+
+	template <size_t block_size> template <typename F>
+	void DirtyBlocks<block_size>::ForEachRun(F&& fn) const
+	{
+		size_t run_first = 0;
+		size_t run_count = 0;
+		for (size_t word_index = 0; word_index < bits.size(); word_index++)
+		{
+			uint64_t word = bits[word_index];
+			while (word != 0)
+			{
+				const size_t block = word_index * 64 + std::countr_zero(word);
+				word &= word - 1;
+				if (run_count > 0 && run_first + run_count == block)
+				{
+					run_count++;
+					continue;
+				}
+				if (run_count > 0) fn(run_first, run_count);
+				run_first = block;
+				run_count = 1;
+			}
+		}
+		if (run_count > 0) fn(run_first, run_count);
+	}
+
+	template <typename T>
+	void SnapshotWriter::Write(const T& value)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Snapshots only store trivially copyable types");
+		writeBytes(&value, sizeof(T));
+	}
+
+	template <typename T>
+	void SnapshotWriter::WriteArray(std::span<const T> values)
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Snapshots only store trivially copyable types");
+		Write(uint64_t(values.size()));
+
+		static constexpr std::byte padding[internal_ecs::snapshot_alignment]{};
+		writeBytes(padding, (internal_ecs::snapshot_alignment - offset % internal_ecs::snapshot_alignment) % internal_ecs::snapshot_alignment);
+		writeBytes(values.data(), values.size_bytes());
+	}
+
+	template <typename T, size_t block_size, typename F>
+	void SnapshotWriter::WriteDirty(size_t size, const DirtyBlocks<block_size>& dirty, size_t elements_per_block, size_t piece_size, F&& data)
+	{
+		/* Runs of marked blocks, cut at the end of the array and at piece boundaries */
+		std::vector<internal_ecs::SnapshotRun> runs{};
+		dirty.ForEachRun([&](size_t first_block, size_t block_count)
+			{
+				size_t first = first_block * elements_per_block;
+				const size_t last = std::min(size, (first_block + block_count) * elements_per_block);
+				while (first < last)
+				{
+					const size_t piece_end = first + std::min(last - first, piece_size - first % piece_size);
+					runs.push_back({ first, piece_end - first });
+					first = piece_end;
+				}
+			});
+
+		Write(uint8_t(dirty.IsCleared()));
+		Write(uint64_t(size));
+		WriteArray(std::span<const internal_ecs::SnapshotRun>(runs));
+		for (const internal_ecs::SnapshotRun& run : runs)
+		{
+			WriteArray(std::span<const T>(data(size_t(run.first)), size_t(run.count)));
+		}
+	}
+
+	bool SnapshotWriter::Close()
+	{
+		if (file)
+		{
+			failed |= std::fclose(file) != 0;
+			file = nullptr;
+		}
+		return !failed;
+	}
+
+	void SnapshotWriter::writeBytes(const void* bytes, size_t size)
+	{
+		if (failed || size == 0) return;
+		failed = std::fwrite(bytes, 1, size, file) != size;
+		offset += size;
+	}
+
+	template <typename T>
+	T SnapshotReader::Read()
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Snapshots only store trivially copyable types");
+		T value{};
+		if (const std::byte* bytes = readBytes(sizeof(T))) std::memcpy(&value, bytes, sizeof(T));
+		return value;
+	}
+
+	template <typename T>
+	std::span<const T> SnapshotReader::ReadArray()
+	{
+		static_assert(std::is_trivially_copyable_v<T>, "Snapshots only store trivially copyable types");
+		const uint64_t count = Read<uint64_t>();
+		readBytes((internal_ecs::snapshot_alignment - offset % internal_ecs::snapshot_alignment) % internal_ecs::snapshot_alignment);
+		if (failed || count > (data.size() - offset) / sizeof(T)) { failed = true; return {}; }
+
+		const std::byte* bytes = readBytes(size_t(count) * sizeof(T));
+		assert(reinterpret_cast<uintptr_t>(bytes) % alignof(T) == 0); /* Snapshot memory must be aligned like a mapping */
+		return { reinterpret_cast<const T*>(bytes), size_t(count) };
+	}
+
+	template <typename T, typename Resize, typename Write>
+	void SnapshotReader::ReadDirty(size_t max_size, Resize&& resize, Write&& write)
+	{
+		const bool cleared = Read<uint8_t>() != 0;
+		const uint64_t size = Read<uint64_t>();
+		const auto runs = ReadArray<internal_ecs::SnapshotRun>();
+		if (failed || size > max_size) { failed = true; return; }
+
+		resize(cleared, size_t(size));
+		for (const internal_ecs::SnapshotRun& run : runs)
+		{
+			const auto values = ReadArray<T>();
+			if (failed || values.size() != run.count || run.first > size || run.count > size - run.first) { failed = true; return; }
+			write(size_t(run.first), values);
+		}
+	}
+
+	const std::byte* SnapshotReader::readBytes(size_t size)
+	{
+		if (failed || size > data.size() - offset) { failed = true; return nullptr; }
+		const std::byte* bytes = data.data() + offset;
+		offset += size;
+		return bytes;
+	}
+}
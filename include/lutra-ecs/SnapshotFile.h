@@ -0,0 +1,112 @@
+#pragma once
+#include <lutra-ecs/ECSManager.h>
+#include <lutra-ecs/Snapshot.h>
+#include <cstddef>
+#include <span>
+
+#if defined(_WIN32)
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace lcs
+{
+	/* Loading snapshots from files. The file is mapped and read in place, which needs the platform headers,
+	 * so it lives apart from Snapshot.h and ECSManager.h and only code loading from a path includes it */
+
+	/* Read only memory mapping of a whole file */
+	class MappedFile
+	{
+	public:
+		explicit inline MappedFile(const char* path);
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+		inline ~MappedFile();
+
+		inline bool IsOpen() const { return mapping != nullptr; };
+		inline std::span<const std::byte> Data() const { return { static_cast<const std::byte*>(mapping), size }; };
+
+	private:
+		const void* mapping{ nullptr };
+		size_t size{ 0 };
+#if defined(_WIN32)
+		HANDLE file_handle{ INVALID_HANDLE_VALUE };
+		HANDLE mapping_handle{ nullptr };
+#endif
+	};
+
+	/* ECSManager::LoadSnapshot from the file at path, false if it can't be opened */
+	template <typename handle_t, typename... Ts>
+	inline bool LoadSnapshot(ECSManager<handle_t, Ts...>& ecs, const char* path)
+	{
+		const MappedFile file(path);
+		if (!file.IsOpen()) return false;
+		SnapshotReader reader(file.Data());
+		return ecs.LoadSnapshot(reader);
+	}
+
+	/* ECSManager::ApplyDeltaSnapshot from the file at path, false if it can't be opened */
+	template <typename handle_t, typename... Ts>
+	inline bool ApplyDeltaSnapshot(ECSManager<handle_t, Ts...>& ecs, const char* path)
+	{
+		const MappedFile file(path);
+		if (!file.IsOpen()) return false;
+		SnapshotReader reader(file.Data());
+		return ecs.ApplyDeltaSnapshot(reader);
+	}
+
+#if defined(_WIN32)
+	MappedFile::MappedFile(const char* path)
+	{
+		file_handle = CreateFileA(path, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (file_handle == INVALID_HANDLE_VALUE) return;
+
+		LARGE_INTEGER file_size{};
+		if (!GetFileSizeEx(file_handle, &file_size) || file_size.QuadPart == 0) return;
+		mapping_handle = CreateFileMappingA(file_handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		if (!mapping_handle) return;
+
+		mapping = MapViewOfFile(mapping_handle, FILE_MAP_READ, 0, 0, 0);
+		if (mapping) size = size_t(file_size.QuadPart);
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (mapping) UnmapViewOfFile(mapping);
+		if (mapping_handle) CloseHandle(mapping_handle);
+		if (file_handle != INVALID_HANDLE_VALUE) CloseHandle(file_handle);
+	}
+#else
+	MappedFile::MappedFile(const char* path)
+	{
+		const int descriptor = open(path, O_RDONLY);
+		if (descriptor < 0) return;
+
+		struct stat file_stat {};
+		if (fstat(descriptor, &file_stat) == 0 && file_stat.st_size > 0)
+		{
+			void* result = mmap(nullptr, size_t(file_stat.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+			if (result != MAP_FAILED)
+			{
+				/* Loads read the whole file front to back */
+				madvise(result, size_t(file_stat.st_size), MADV_SEQUENTIAL);
+				mapping = result;
+				size = size_t(file_stat.st_size);
+			}
+		}
+		close(descriptor); /* The mapping stays valid without the descriptor */
+	}
+
+	MappedFile::~MappedFile()
+	{
+		if (mapping) munmap(const_cast<void*>(mapping), size);
+	}
+#endif
+}
@@ -1,12 +1,30 @@
 #pragma once
+#include <lutra-ecs/ChangeEvents.h>
+#include <lutra-ecs/ContainerStats.h>
 #include <lutra-ecs/Handle.h>
+#include <lutra-ecs/PagedIndexArray.h>
+#include <lutra-ecs/Snapshot.h>
 #include <algorithm>
 #include <cassert>
+#include <memory_resource>
+#include <numeric>
+#include <span>
 #include <utility>
 #include <vector>
 
 namespace lcs
 {
+	/* Hook a single owner (such as an owning group) can install to be told about structural changes */
+	template <typename handle_t>
+	struct SparseSetHook
+	{
+		void* context{ nullptr };
+		const void* key{ nullptr };
+		void (*on_add)(void* context, handle_t handle) { nullptr };
+		void (*on_remove)(void* context, handle_t handle) { nullptr };
+		void (*on_clear)(void* context) { nullptr };
+	};
+
 	template <typename handle_t, typename T>
 	class SparseSet
 	{
@@ -14,20 +32,73 @@ namespace lcs
 		using data_t = handle_t::data_t;
 
 		SparseSet() {};
+		explicit SparseSet(std::pmr::memory_resource* resource) : sparse_indices(resource), inverse_list(resource), dense_data(resource), dense_dirty(resource), events(resource) {};
 
 		inline void Add(handle_t handle, T&& data);
+		inline void AddMany(std::span<const handle_t> handles, std::span<const T> data);
+		/* Reads, Get and TryGet have no side effects and are safe to call from several threads */
 		inline T& Get(handle_t handle);
-		inline const T& Get(handle_t handle) const { return Get(handle); };
+		inline const T& Get(handle_t handle) const { assertValidInputHandle(handle); return dense_data[sparse_indices[handle.GetIndex()]]; };
+		inline T* TryGet(handle_t handle);
+		/* Get for writing, marks the entry for delta snapshots */
+		inline T& Write(handle_t handle);
 		inline void Remove(handle_t handle);
+		/* Removes every handle, which must all be present and unique.
+		 * Large batches mark their entries and close the holes in one pass that keeps the order of the remaining entries. */
+		inline void RemoveMany(std::span<const handle_t> handles);
 		inline void RemoveIfPresent(handle_t handle);
 		inline bool Has(handle_t handle) const;
+		/* Record writes for delta snapshots. Write, views and iteration over the set or its group mark what they hand out,
+		 * writes through Get, TryGet or DenseData have to be reported here. Marking never allocates, several threads may mark at once */
+		inline void MarkChanged(handle_t handle) { assertValidInputHandle(handle); dense_dirty.MarkConcurrent(sparse_indices[handle.GetIndex()]); };
+		inline void MarkRangeChanged(data_t first, data_t last) { assert(last <= DenseSize()); dense_dirty.MarkRangeConcurrent(first, last); };
+		inline void MarkAllChanged() { dense_dirty.MarkRangeConcurrent(0, DenseSize()); };
+		/* MarkChanged for an entry handed out by Get, TryGet or the iterator, without looking its handle up again.
+		 * MarkEntryChanged is for a single thread, views running on several threads use MarkEntryChangedConcurrent */
+		inline void MarkEntryChanged(const T* entry) { dense_dirty.MarkCovered(denseIndexOf(entry)); };
+		inline void MarkEntryChangedConcurrent(const T* entry) { dense_dirty.MarkConcurrent(denseIndexOf(entry)); };
 
 		inline data_t SparseSize() const { return data_t(sparse_indices.size()); };
+		inline size_t SparseMemoryUsage() const { return sparse_indices.MemoryUsage(); };
 		inline data_t DenseSize() const { return data_t(dense_data.size()); };
+		inline ContainerStats Stats() const;
+
+		inline std::span<T> DenseData() { return dense_data; };
+		inline std::span<const handle_t> DenseOwners() const { return inverse_list; };
+		inline data_t DenseIndex(handle_t handle) const { assertValidInputHandle(handle); return sparse_indices[handle.GetIndex()]; };
+		inline void SwapDense(data_t dense_index1, data_t dense_index2);
+
+		/* Reorders the dense arrays by entity index, so sets sorted this way are walked in the same order.
+		 * Sets owned by a group keep the order of the group, the sorts leave them alone and SortByEntity and Sort return false */
+		inline bool SortByEntity();
+		/* Reorders the dense arrays by component, less(const T&, const T&) */
+		template <typename Compare>
+		inline bool Sort(Compare less);
+		/* Continues an insertion sort by entity index for at most max_steps steps, returns true once the set is sorted.
+		 * The sorted prefix survives adds, and removes only shorten it, so sets that stay nearly sorted are cheap to maintain.
+		 * Returns true right away for owned sets, there is nothing left it may do */
+		inline bool SortByEntityIncremental(size_t max_steps);
+
+		inline void SetHook(SparseSetHook<handle_t> new_hook) { hook = new_hook; };
+		inline const SparseSetHook<handle_t>& GetHook() const { return hook; };
 
 		inline void ReserveSparseSize(data_t new_size);
 		inline void Clear();
 
+		/* Bulk copies of the sparse and dense arrays, T has to be trivially copyable. The hook is not stored */
+		inline void Save(SnapshotWriter& writer) const;
+		inline void Load(SnapshotReader& reader);
+		/* Stores the dense ranges written since the last snapshot */
+		inline void SaveDelta(SnapshotWriter& writer);
+		inline void LoadDelta(SnapshotReader& reader);
+		inline void ResetDirty() { sparse_indices.ResetDirty(); dense_dirty.Reset(DenseSize()); };
+
+		/* Bumped whenever entries are added, removed or reordered, cached queries compare it to find out if they are stale */
+		inline uint64_t Version() const { return version; };
+
+		/* Added and removed entities for reactive consumers, off until enabled */
+		inline ChangeEvents<handle_t>& Events() { return events; };
+
 		class Iterator
 		{
 		public:
@@ -77,11 +148,24 @@ namespace lcs
 	private:
 		constexpr static data_t invalid_index{ data_t(-1) };
 
+		/* RemoveMany compacts when removing at least 1 / compaction_ratio of the entries, smaller batches swap and pop */
+		constexpr static size_t compaction_ratio{ 32 };
+
 		inline void assertValidInputHandle(handle_t handle) const;
+		inline data_t denseIndexOf(const T* entry) const { assert(entry >= dense_data.data() && entry < dense_data.data() + DenseSize()); return data_t(entry - dense_data.data()); };
+		inline void swapEntries(data_t dense_index1, data_t dense_index2);
+		inline void applyOrder(std::vector<data_t>& order);
 
-		std::vector<data_t> sparse_indices;
-		std::vector<handle_t> inverse_list;
-		std::vector<T> dense_data;
+		inline static bool lessByIndex(handle_t a, handle_t b) { return a.GetIndex() < b.GetIndex(); };
+
+		PagedIndexArray<data_t> sparse_indices;
+		std::pmr::vector<handle_t> inverse_list;
+		std::pmr::vector<T> dense_data;
+		SparseSetHook<handle_t> hook{};
+		data_t entity_sorted_count{ 0 }; /* Dense prefix known to be sorted by entity index */
+		DirtyBlocks<> dense_dirty; /* Covers dense_data and inverse_list */
+		uint64_t version{ 0 };
+		ChangeEvents<handle_t> events;
 	};
 
 	template <typename handle_t, typename T>
@@ -93,7 +177,38 @@ namespace lcs
 
 		dense_data.emplace_back(data);
 		inverse_list.push_back(handle);
-		sparse_indices[handle_index] = DenseSize() - 1;
+		sparse_indices.At(handle_index) = DenseSize() - 1;
+		dense_dirty.Mark(DenseSize() - 1);
+		version++;
+		events.RecordAdd(handle);
+
+		if (hook.on_add) hook.on_add(hook.context, handle);
+	}
+
+	template <typename handle_t, typename T>
+	void SparseSet<handle_t, T>::AddMany(std::span<const handle_t> handles, std::span<const T> data)
+	{
+		assert(handles.size() == data.size());
+		const data_t first_dense_index = DenseSize();
+
+		/* Appending from raw pointers is a single memmove for trivially copyable T */
+		dense_data.insert(dense_data.end(), data.data(), data.data() + data.size());
+		inverse_list.insert(inverse_list.end(), handles.data(), handles.data() + handles.size());
+		for (size_t i = 0; i < handles.size(); i++)
+		{
+			const auto handle_index = handles[i].GetIndex();
+			assert(handle_index < SparseSize()); /* Invalid index or missing reservation */
+			assert(sparse_indices[handle_index] == invalid_index);
+			sparse_indices.At(handle_index) = first_dense_index + data_t(i);
+		}
+		dense_dirty.MarkRange(first_dense_index, DenseSize());
+		version++;
+		events.RecordAdds(handles);
+
+		if (hook.on_add)
+		{
+			for (const handle_t handle : handles) hook.on_add(hook.context, handle);
+		}
 	}
 
 	template <typename handle_t, typename T>
@@ -103,10 +218,32 @@ namespace lcs
 		return dense_data[sparse_indices[handle.GetIndex()]];
 	}
 
+	template <typename handle_t, typename T>
+	T& SparseSet<handle_t, T>::Write(handle_t handle)
+	{
+		assertValidInputHandle(handle);
+		const data_t dense_index = sparse_indices[handle.GetIndex()];
+		dense_dirty.MarkConcurrent(dense_index);
+		return dense_data[dense_index];
+	}
+
+	template <typename handle_t, typename T>
+	T* SparseSet<handle_t, T>::TryGet(handle_t handle)
+	{
+		const auto handle_index = handle.GetIndex();
+		assert(handle_index < SparseSize());
+		const auto dense_index = sparse_indices[handle_index];
+		if (dense_index == invalid_index) return nullptr;
+		assert(inverse_list[dense_index].GetValidationID() == handle.GetValidationID()); /* Check for stale handle */
+		return &dense_data[dense_index];
+	}
+
 	template <typename handle_t, typename T>
 	void SparseSet<handle_t, T>::Remove(handle_t handle)
 	{
 		assertValidInputHandle(handle);
+		if (hook.on_remove) hook.on_remove(hook.context, handle);
+
 		const auto handle_index = handle.GetIndex();
 		const auto back_index = inverse_list.back().GetIndex();
 		const auto dense_index = sparse_indices[handle_index];
@@ -119,9 +256,204 @@ namespace lcs
 		}
 		dense_data.pop_back();
 		inverse_list.pop_back();
+		dense_dirty.Mark(dense_index);
+		version++;
+		events.RecordRemove(handle);
+
+		sparse_indices.At(back_index) = dense_index;
+		sparse_indices.At(handle_index) = invalid_index;
+		entity_sorted_count = std::min(entity_sorted_count, dense_index);
+	}
+
+	template <typename handle_t, typename T>
+	void SparseSet<handle_t, T>::RemoveMany(std::span<const handle_t> handles)
+	{
+		if (handles.size() * compaction_ratio < DenseSize())
+		{
+			for (const handle_t handle : handles) Remove(handle);
+			return;
+		}
+
+		/* A group moves the entries out of its prefix, which the compaction below keeps in place */
+		if (hook.on_remove)
+		{
+			for (const handle_t handle : handles) hook.on_remove(hook.context, handle);
+		}
+
+		/* Mark the removed entries with an invalid owner */
+		const data_t dense_size = DenseSize();
+		data_t first_hole = dense_size;
+		data_t sorted_holes = 0;
+		for (const handle_t handle : handles)
+		{
+			assertValidInputHandle(handle);
+			const auto handle_index = handle.GetIndex();
+			const data_t dense_index = sparse_indices[handle_index];
+			inverse_list[dense_index] = handle_t{};
+			sparse_indices.At(handle_index) = invalid_index;
+			first_hole = std::min(first_hole, dense_index);
+			sorted_holes += dense_index < entity_sorted_count ? 1 : 0;
+		}
+
+		data_t write_index = first_hole;
+		for (data_t read_index = first_hole; read_index < dense_size; read_index++)
+		{
+			const handle_t owner = inverse_list[read_index];
+			if (!owner.IsValid()) continue;
 
-		sparse_indices[back_index] = dense_index;
-		sparse_indices[handle_index] = invalid_index;
+			if (write_index != read_index)
+			{
+				dense_data[write_index] = std::move(dense_data[read_index]);
+				inverse_list[write_index] = owner;
+				sparse_indices.At(owner.GetIndex()) = write_index;
+			}
+			write_index++;
+		}
+		dense_data.erase(dense_data.begin() + write_index, dense_data.end());
+		inverse_list.erase(inverse_list.begin() + write_index, inverse_list.end());
+		dense_dirty.MarkRange(first_hole, write_index);
+		version++;
+		events.RecordRemoves(handles);
+		entity_sorted_count -= sorted_holes;
+	}
+
+	template <typename handle_t, typename T>
+	void SparseSet<handle_t, T>::SwapDense(data_t dense_index1, data_t dense_index2)
+	{
+		assert(dense_index1 < DenseSize() && dense_index2 < DenseSize());
+		if (dense_index1 == dense_index2) return;
+
+		swapEntries(dense_index1, dense_index2);
+		entity_sorted_count = std::min(entity_sorted_count, std::min(dense_index1, dense_index2));
+	}
+
+	template <typename handle_t, typename T>
+	bool SparseSet<handle_t, T>::SortByEntity()
+	{
+		if (hook.key != nullptr) return false; /* Owned sets are ordered by their group */
+		const data_t dense_size = DenseSize();
+		const data_t check_from = entity_sorted_count > 0 ? entity_sorted_count - 1 : 0;
+		if (std::is_sorted(inverse_list.begin() + check_from, inverse_list.end(), lessByIndex))
+		{
+			entity_sorted_count = dense_size;
+			return true;
+		}
+
+		/* Split off the entries breaking the order, keeping one sorted run.
+		 * A short streak of entries larger than what follows (such as back entries moved into removed slots) is split off
+		 * instead of the entries after it. After swap and pop removals and appends only a few entries are displaced,
+		 * so the cost stays close to a linear pass. */
+		constexpr size_t max_streak = 16;
+		const auto less = [this](data_t a, data_t b) { return lessByIndex(inverse_list[a], inverse_list[b]); };
+		std::vector<data_t> order;
+		std::vector<data_t> displaced;
+		order.reserve(dense_size);
+		for (data_t i = 0; i < dense_size; i++)
+		{
+			if (order.empty() || !less(i, order.back()))
+			{
+				order.push_back(i);
+				continue;
+			}
+
+			size_t streak = 1;
+			while (streak < order.size() && streak <= max_streak && less(i, order[order.size() - 1 - streak])) streak++;
+
+			if (streak <= max_streak && streak < order.size())
+			{
+				displaced.insert(displaced.end(), order.end() - streak, order.end());
+				order.resize(order.size() - streak);
+				order.push_back(i);
+			}
+			else displaced.push_back(i);
+		}
+
+		const size_t run_size = order.size();
+		std::sort(displaced.begin(), displaced.end(), less);
+		order.insert(order.end(), displaced.begin(), displaced.end());
+		std::inplace_merge(order.begin(), order.begin() + run_size, order.end(), less);
+		applyOrder(order);
+		entity_sorted_count = dense_size;
+		return true;
+	}
+
+	template <typename handle_t, typename T> template <typename Compare>
+	bool SparseSet<handle_t, T>::Sort(Compare less)
+	{
+		if (hook.key != nullptr) return false; /* Owned sets are ordered by their group */
+		std::vector<data_t> order(DenseSize());
+		std::iota(order.begin(), order.end(), data_t(0));
+		std::sort(order.begin(), order.end(), [&](data_t a, data_t b) { return less(std::as_const(dense_data[a]), std::as_const(dense_data[b])); });
+		applyOrder(order);
+		entity_sorted_count = 0;
+		return true;
+	}
+
+	template <typename handle_t, typename T>
+	bool SparseSet<handle_t, T>::SortByEntityIncremental(size_t max_steps)
+	{
+		if (hook.key != nullptr) return true; /* Owned sets are ordered by their group */
+		const data_t dense_size = DenseSize();
+		size_t steps = 0;
+		while (entity_sorted_count < dense_size && steps < max_steps)
+		{
+			/* Sift the first unsorted entry down into the sorted prefix */
+			data_t i = entity_sorted_count;
+			for (; i > 0 && lessByIndex(inverse_list[i], inverse_list[i - 1]); i--)
+			{
+				if (++steps > max_steps)
+				{
+					/* Out of budget mid-sift: only the entries in front of the moving one are still known to be sorted */
+					entity_sorted_count = i;
+					return false;
+				}
+				swapEntries(i - 1, i);
+			}
+			entity_sorted_count++;
+			steps++;
+		}
+		return entity_sorted_count == dense_size;
+	}
+
+	template <typename handle_t, typename T>
+	void SparseSet<handle_t, T>::swapEntries(data_t dense_index1, data_t dense_index2)
+	{
+		std::iter_swap(dense_data.begin() + dense_index1, dense_data.begin() + dense_index2);
+		std::iter_swap(inverse_list.begin() + dense_index1, inverse_list.begin() + dense_index2);
+		sparse_indices.At(inverse_list[dense_index1].GetIndex()) = dense_index1;
+		sparse_indices.At(inverse_list[dense_index2].GetIndex()) = dense_index2;
+		dense_dirty.Mark(dense_index1);
+		dense_dirty.Mark(dense_index2);
+		version++;
+	}
+
+	template <typename handle_t, typename T>
+	void SparseSet<handle_t, T>::applyOrder(std::vector<data_t>& order)
+	{
+		/* Moves the entry at order[i] to i by walking the cycles of the permutation, each entry is moved once */
+		dense_dirty.MarkRange(0, order.size());
+		version++;
+		for (data_t start = 0; start < data_t(order.size()); start++)
+		{
+			if (order[start] == start) continue;
+
+			T data = std::move(dense_data[start]);
+			const handle_t owner = inverse_list[start];
+			data_t current = start;
+			while (order[current] != start)
+			{
+				const data_t next = order[current];
+				dense_data[current] = std::move(dense_data[next]);
+				inverse_list[current] = inverse_list[next];
+				sparse_indices.At(inverse_list[current].GetIndex()) = current;
+				order[current] = current;
+				current = next;
+			}
+			dense_data[current] = std::move(data);
+			inverse_list[current] = owner;
+			sparse_indices.At(owner.GetIndex()) = current;
+			order[current] = current;
+		}
 	}
 
 	template <typename handle_t, typename T>
@@ -144,7 +476,7 @@ namespace lcs
 	inline void SparseSet<handle_t, T>::ReserveSparseSize(handle_t::data_t new_size)
 	{
 		assert(new_size > SparseSize());
-		sparse_indices.resize(size_t(new_size), invalid_index);
+		sparse_indices.resize(size_t(new_size));
 	}
 
 	template <typename handle_t, typename T>
@@ -153,6 +485,12 @@ namespace lcs
 		sparse_indices.clear();
 		inverse_list.clear();
 		dense_data.clear();
+		entity_sorted_count = 0;
+		dense_dirty.MarkCleared();
+		version++;
+		events.RecordReset();
+
+		if (hook.on_clear) hook.on_clear(hook.context);
 	}
 
 	template <typename handle_t, typename T>
@@ -164,4 +502,59 @@ namespace lcs
 		assert(sparse_indices[handle_index] < DenseSize());
 		assert(inverse_list[sparse_indices[handle_index]].GetValidationID() == handle.GetValidationID()); /* Check for stale handle */
 	}
-}
\ No newline at end of file
+
+	template <typename handle_t, typename T>
+	ContainerStats SparseSet<handle_t, T>::Stats() const
+	{
+		const size_t bytes = sparse_indices.MemoryUsage() + internal_ecs::CapacityBytes(inverse_list) + internal_ecs::CapacityBytes(dense_data)
+			+ dense_dirty.MemoryUsage() + events.MemoryUsage();
+		return { DenseSize(), SparseSize(), bytes, internal_ecs::FillRatio(DenseSize(), dense_data.capacity()), 0 };
+	}
+
+	template <typename handle_t, typename T>
+	void SparseSet<handle_t, T>::Save(SnapshotWriter& writer) const
+	{
+		sparse_indices.Save(writer);
+		writer.WriteArray(std::span<const handle_t>(inverse_list));
+		writer.WriteArray(std::span<const T>(dense_data));
+		writer.Write(entity_sorted_count);
+	}
+
+	template <typename handle_t, typename T>
+	void SparseSet<handle_t, T>::Load(SnapshotReader& reader)
+	{
+		assert(!hook.context); /* Owning groups can't follow a load */
+		sparse_indices.Load(reader);
+		reader.ReadArray(inverse_list);
+		reader.ReadArray(dense_data);
+		entity_sorted_count = reader.Read<data_t>();
+		if (inverse_list.size() != dense_data.size() || entity_sorted_count > DenseSize() || !sparse_indices.MatchesOwners(DenseOwners())) reader.Fail();
+		dense_dirty.Reset(DenseSize());
+		version++;
+		events.RecordReset();
+	}
+
+	template <typename handle_t, typename T>
+	void SparseSet<handle_t, T>::SaveDelta(SnapshotWriter& writer)
+	{
+		sparse_indices.SaveDelta(writer);
+		writer.WriteDirty(std::span<const handle_t>(inverse_list), dense_dirty);
+		writer.WriteDirty(std::span<const T>(dense_data), dense_dirty);
+		writer.Write(entity_sorted_count);
+		dense_dirty.Reset(DenseSize());
+	}
+
+	template <typename handle_t, typename T>
+	void SparseSet<handle_t, T>::LoadDelta(SnapshotReader& reader)
+	{
+		assert(!hook.context); /* Owning groups can't follow a load */
+		sparse_indices.LoadDelta(reader);
+		reader.ReadDirty(inverse_list, internal_ecs::max_snapshot_entries<handle_t>);
+		reader.ReadDirty(dense_data, internal_ecs::max_snapshot_entries<handle_t>);
+		entity_sorted_count = reader.Read<data_t>();
+		if (inverse_list.size() != dense_data.size() || entity_sorted_count > DenseSize() || !sparse_indices.MatchesOwners(DenseOwners())) reader.Fail();
+		dense_dirty.Reset(DenseSize());
+		version++;
+		events.RecordReset();
+	}
+}
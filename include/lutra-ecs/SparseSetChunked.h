@@ -1,40 +1,138 @@
 #pragma once
 #include <lutra-ecs/Handle.h>
 #include <lutra-ecs/BitMask.h>
+#include <lutra-ecs/ChangeEvents.h>
+#include <lutra-ecs/ContainerStats.h>
+#include <lutra-ecs/Snapshot.h>
 #include <algorithm>
+#include <atomic>
 #include <cassert>
+#include <cstddef>
+#include <memory_resource>
+#include <span>
+#include <type_traits>
 #include <utility>
 #include <array>
 #include <vector>
 
 namespace lcs
 {
-	template <typename handle_t, typename T>
+	/* Change stamps kept by chunked storage, components opt in through static constexpr ChangeTracking change_tracking */
+	enum class ChangeTracking
+	{
+		None, PerChunk, PerSlot
+	};
+
+	namespace internal_ecs
+	{
+		template <typename T>
+		constexpr ChangeTracking GetChangeTracking()
+		{
+			if constexpr (requires { T::change_tracking; }) return T::change_tracking;
+			else return ChangeTracking::None;
+		}
+
+		/* Entries per chunk, components opt in to wider chunks through static constexpr uint32_t chunk_width */
+		template <typename T>
+		constexpr uint32_t GetChunkWidth()
+		{
+			if constexpr (requires { T::chunk_width; }) return T::chunk_width;
+			else return 64;
+		}
+	}
+
+	/* Wider chunks need fewer chunk_indices entries and mask steps for dense components, narrow chunks waste less on sparse ones */
+	template <typename handle_t, typename T, uint32_t chunk_width = internal_ecs::GetChunkWidth<T>()>
 	class SparseSetChunked
 	{
+		static_assert(chunk_width % 64 == 0 && chunk_width <= 512, "Chunk width must be 64, 128, 256 or 512 entries");
+
 	public:
-		using bit_t = uint64_t;
+		using mask_t = internal_ecs::ChunkMask<chunk_width>;
 		using data_t = handle_t::data_t;
+		using tick_t = uint32_t;
+		static constexpr ChangeTracking change_tracking = internal_ecs::GetChangeTracking<T>();
 
-		static constexpr data_t entries_per_chunk = sizeof(bit_t) * 8;
+		static constexpr data_t entries_per_chunk = chunk_width;
 		using InverseHandlesChunk = std::array<handle_t, entries_per_chunk>;
 		using Chunk = std::array<T, entries_per_chunk>;
 
 		SparseSetChunked() {};
+		explicit SparseSetChunked(std::pmr::memory_resource* resource)
+			: chunk_indices(resource), chunk_ranges(resource), occupancy_masks(resource), inverse_handle_chunks(resource), chunks(resource), chunk_ticks(resource), slot_ticks(resource), sparse_dirty(resource), chunk_dirty(resource), events(resource) {};
 
 		inline void Add(handle_t handle, T&& data);
+		/* Get and TryGet neither stamp nor mark, writes through them are reported with MarkChanged */
 		inline T& Get(handle_t handle);
-		inline const T& Get(handle_t handle) const { return Get(handle); };
+		inline const T& Get(handle_t handle) const { assert(Has(handle)); return chunks[chunk_indices[handle.GetIndex() / entries_per_chunk]][handle.GetIndex() % entries_per_chunk]; };
+		inline T* TryGet(handle_t handle);
+		/* Same as Get, stamping and marking the entry as written */
+		inline T& Write(handle_t handle) { MarkChanged(handle); return Get(handle); };
 		inline void Remove(handle_t handle);
+		/* Removes every handle, which must all be present and unique.
+		 * Slots are freed first, then the chunks left empty are dropped in one pass that keeps the order of the other chunks. */
+		inline void RemoveMany(std::span<const handle_t> handles);
 		inline void RemoveIfPresent(handle_t handle);
 		inline bool Has(handle_t handle) const;
 
 		inline data_t SparseSize() const { return data_t(chunk_indices.size() * entries_per_chunk); };
 		inline data_t DenseSize() const { return data_t(chunks.size()) * entries_per_chunk; };
+		/* Counts the occupied slots, fill_ratio is their share of the slots of all chunks */
+		inline ContainerStats Stats() const;
 
 		inline void ReserveSparseSize(data_t new_size);
 		inline void Clear();
 
+		/* Bulk copies of the chunk arrays and change ticks, T has to be trivially copyable */
+		inline void Save(SnapshotWriter& writer) const;
+		inline void Load(SnapshotReader& reader);
+		/* Stores the chunks written since the last snapshot. Structural changes, Write, MarkChanged, ForEachChunk and mutable views
+		 * mark their chunk, writes through Get, TryGet or GetChunk have to be reported with MarkChanged or MarkChunkChanged */
+		inline void SaveDelta(SnapshotWriter& writer);
+		inline void LoadDelta(SnapshotReader& reader);
+		inline void ResetDirty() { sparse_dirty.Reset(); chunk_dirty.Reset(ChunkCount()); };
+
+		/* Bumped whenever entries are added or removed, cached queries compare it to find out if they are stale */
+		inline uint64_t Version() const { return version; };
+
+		/* Added and removed entities for reactive consumers, off until enabled */
+		inline ChangeEvents<handle_t>& Events() { return events; };
+
+		/* Chunk level access, chunks are identified by their index in the dense chunk list */
+		constexpr static data_t invalid_index{ data_t(-1) };
+
+		inline data_t ChunkCount() const { return data_t(chunks.size()); };
+		inline data_t FindChunk(data_t chunk_range) const { return chunk_range < chunk_indices.size() ? chunk_indices[chunk_range] : invalid_index; };
+		inline data_t GetChunkRange(data_t chunk_index) const { return chunk_ranges[chunk_index]; };
+		inline mask_t GetOccupancyMask(data_t chunk_index) const { return occupancy_masks[chunk_index]; };
+		inline Chunk& GetChunk(data_t chunk_index) { return chunks[chunk_index]; };
+		inline const InverseHandlesChunk& GetInverseHandleChunk(data_t chunk_index) const { return inverse_handle_chunks[chunk_index]; };
+
+		/* Change tracking. Add, Write, MarkChanged, ForEachChunk and views handing out mutable entries stamp the current tick,
+		 * Get, TryGet, GetChunk and the set's own iterator do not */
+		inline tick_t CurrentTick() const { return current_tick; };
+		inline void SetTick(tick_t tick) { current_tick = tick; };
+		/* Stamps the entry and marks its chunk dirty. Safe to call from several threads on the same tick */
+		inline void MarkChanged(handle_t handle);
+		/* Stamps the slots of a chunk and marks it dirty, views call these for the entries they hand out mutably.
+		 * Safe to call from several threads on the same tick */
+		inline void MarkChunkChanged(data_t chunk_index, const mask_t& slots) { assert(chunk_index < ChunkCount()); stampSlots(chunk_index, slots); chunk_dirty.MarkConcurrent(chunk_index); };
+		inline void MarkAllChanged();
+		/* MarkChanged for an entry handed out by Get, TryGet or the iterator, without looking its handle up again.
+		 * MarkEntryChanged is for a single thread, views running on several threads use MarkEntryChangedConcurrent */
+		inline void MarkEntryChanged(const T* entry);
+		inline void MarkEntryChangedConcurrent(const T* entry);
+		inline tick_t GetChunkTick(data_t chunk_index) const;
+		/* Occupied slots of a chunk stamped at since_tick or later, whole chunks when only chunks are stamped */
+		inline mask_t GetChangedMask(data_t chunk_index, tick_t since_tick) const;
+
+		/* Calls fn(T* data, const handle_t* owners, mask_t occupancy, bool is_full) once per chunk, for kernels working on
+		 * entries_per_chunk slots at a time. is_full is passed as std::true_type for fully occupied chunks and std::false_type
+		 * otherwise, so a generic callback can branch on it at compile time and run an unmasked loop.
+		 * Free slots hold valid T objects that are not part of the set, kernels may write them to stay branch free. */
+		template <typename F>
+		inline void ForEachChunk(F&& fn);
+
 		class Iterator
 		{
 		public:
@@ -51,7 +149,7 @@ namespace lcs
 					chunk_index++;
 					if (chunk_index < owner.chunks.size())
 					{
-						occ_it = BitMask<bit_t>::Iterator::Create(owner.occupancy_masks[chunk_index]);
+						occ_it = mask_t::Iterator::Create(owner.occupancy_masks[chunk_index]);
 					}
 				}
 				return *this;
@@ -76,11 +174,11 @@ namespace lcs
 			{
 				if (owner.occupancy_masks.size() > 0 && chunk_index < owner.occupancy_masks.size())
 				{
-					occ_it = BitMask<bit_t>::Iterator::Create(owner.occupancy_masks[chunk_index]);
+					occ_it = mask_t::Iterator::Create(owner.occupancy_masks[chunk_index]);
 				}
 			}
 			data_t chunk_index{};
-			BitMask<bit_t>::Iterator occ_it{};
+			typename mask_t::Iterator occ_it{};
 			SparseSetChunked& owner;
 
 			friend class SparseSetChunked;
@@ -90,16 +188,34 @@ namespace lcs
 
 
 	private:
-		constexpr static data_t invalid_index{ data_t(-1) };
-
-		std::vector<data_t> chunk_indices{};
-		std::vector<BitMask<bit_t>> occupancy_masks{};
-		std::vector<InverseHandlesChunk> inverse_handle_chunks{};
-		std::vector<Chunk> chunks{};
+		std::pmr::vector<data_t> chunk_indices{};
+		std::pmr::vector<data_t> chunk_ranges{};
+		std::pmr::vector<mask_t> occupancy_masks{};
+		std::pmr::vector<InverseHandlesChunk> inverse_handle_chunks{};
+		std::pmr::vector<Chunk> chunks{};
+
+		using SlotTicks = std::array<tick_t, entries_per_chunk>;
+		inline void stamp(data_t chunk_index, data_t data_index);
+		inline void stampConcurrent(data_t chunk_index, data_t data_index);
+		/* Chunk index and slot of an entry, from its offset in the dense chunk array */
+		inline std::pair<data_t, data_t> locate(const T* entry) const;
+		inline void stampSlots(data_t chunk_index, const mask_t& slots);
+		/* Whether chunk_indices and chunk_ranges point at each other and every occupied slot holds the handle of its index,
+		 * checked on load after the array sizes */
+		inline bool hasValidIndices() const;
+
+		tick_t current_tick{ 1 };
+		std::pmr::vector<tick_t> chunk_ticks{};
+		std::pmr::vector<SlotTicks> slot_ticks{};
+
+		DirtyBlocks<> sparse_dirty{}; /* Over chunk_indices */
+		DirtyBlocks<1> chunk_dirty{}; /* Over the dense chunk arrays */
+		uint64_t version{ 0 };
+		ChangeEvents<handle_t> events{};
 	};
 
-	template <typename handle_t, typename T>
-	void SparseSetChunked<handle_t, T>::Add(handle_t handle, T&& data)
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	void SparseSetChunked<handle_t, T, chunk_width>::Add(handle_t handle, T&& data)
 	{
 		assert(!Has(handle));
 		const auto handle_index = handle.GetIndex();
@@ -110,9 +226,13 @@ namespace lcs
 			/* Add new chunk */
 			chunk_index = chunks.size();
 			chunk_indices[handle_index / entries_per_chunk] = chunk_index;
-			occupancy_masks.push_back({ 0 });
+			sparse_dirty.Mark(handle_index / entries_per_chunk);
+			chunk_ranges.push_back(handle_index / entries_per_chunk);
+			occupancy_masks.push_back({});
 			inverse_handle_chunks.push_back({});
 			chunks.push_back({});
+			if constexpr (change_tracking != ChangeTracking::None) chunk_ticks.push_back(current_tick);
+			if constexpr (change_tracking == ChangeTracking::PerSlot) slot_ticks.push_back({});
 		}
 
 		auto& occupancy_mask = occupancy_masks[chunk_index];
@@ -120,24 +240,188 @@ namespace lcs
 		Chunk& chunk = chunks[chunk_index];
 
 		const auto data_index = handle.GetIndex() % entries_per_chunk;
-		occupancy_mask.SetBit(uint8_t(data_index));
+		occupancy_mask.SetBit(typename mask_t::index_t(data_index));
 		inverse_handle_chunk[data_index] = handle;
 		chunk[data_index] = data;
+		stamp(chunk_index, data_index);
+		chunk_dirty.Mark(chunk_index);
+		version++;
+		events.RecordAdd(handle);
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	T& SparseSetChunked<handle_t, T, chunk_width>::Get(handle_t handle)
+	{
+		assert(Has(handle));
+
+		const auto handle_index = handle.GetIndex();
+		const auto chunk_index = chunk_indices[handle_index / entries_per_chunk];
+		return chunks[chunk_index][handle_index % entries_per_chunk];
 	}
 
-	template <typename handle_t, typename T>
-	T& SparseSetChunked<handle_t, T>::Get(handle_t handle)
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	void SparseSetChunked<handle_t, T, chunk_width>::MarkChanged(handle_t handle)
 	{
 		assert(Has(handle));
+		const auto handle_index = handle.GetIndex();
+		const auto chunk_index = chunk_indices[handle_index / entries_per_chunk];
+		stampConcurrent(chunk_index, handle_index % entries_per_chunk);
+		chunk_dirty.MarkConcurrent(chunk_index);
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	void SparseSetChunked<handle_t, T, chunk_width>::MarkEntryChanged(const T* entry)
+	{
+		const auto [chunk_index, data_index] = locate(entry);
+		stamp(chunk_index, data_index);
+		chunk_dirty.MarkCovered(chunk_index);
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	void SparseSetChunked<handle_t, T, chunk_width>::MarkEntryChangedConcurrent(const T* entry)
+	{
+		const auto [chunk_index, data_index] = locate(entry);
+		stampConcurrent(chunk_index, data_index);
+		chunk_dirty.MarkConcurrent(chunk_index);
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	void SparseSetChunked<handle_t, T, chunk_width>::MarkAllChanged()
+	{
+		const data_t chunk_count = ChunkCount();
+		for (data_t chunk_index = 0; chunk_index < chunk_count; chunk_index++) stampSlots(chunk_index, occupancy_masks[chunk_index]);
+		chunk_dirty.MarkRangeConcurrent(0, chunk_count);
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	SparseSetChunked<handle_t, T, chunk_width>::tick_t SparseSetChunked<handle_t, T, chunk_width>::GetChunkTick(data_t chunk_index) const
+	{
+		static_assert(change_tracking != ChangeTracking::None, "Component does not track changes");
+		return chunk_ticks[chunk_index];
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	typename SparseSetChunked<handle_t, T, chunk_width>::mask_t SparseSetChunked<handle_t, T, chunk_width>::GetChangedMask(data_t chunk_index, tick_t since_tick) const
+	{
+		static_assert(change_tracking != ChangeTracking::None, "Component does not track changes");
+		if (chunk_ticks[chunk_index] < since_tick) return {};
+		if constexpr (change_tracking == ChangeTracking::PerChunk) return occupancy_masks[chunk_index];
+
+		/* Branch free over all slots so the compare vectorizes, free slots are masked out afterwards */
+		mask_t changed{};
+		const SlotTicks& ticks = slot_ticks[chunk_index];
+		for (size_t word_index = 0; word_index < mask_t::word_count; word_index++)
+		{
+			uint64_t changed_bits = 0;
+			for (data_t bit = 0; bit < 64; bit++)
+			{
+				changed_bits |= uint64_t(ticks[word_index * 64 + bit] >= since_tick) << bit;
+			}
+			changed.Word(word_index) = changed_bits;
+		}
+		return changed & occupancy_masks[chunk_index];
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width> template <typename F>
+	void SparseSetChunked<handle_t, T, chunk_width>::ForEachChunk(F&& fn)
+	{
+		const data_t chunk_count = ChunkCount();
+		for (data_t chunk_index = 0; chunk_index < chunk_count; chunk_index++)
+		{
+			const mask_t& occupancy = occupancy_masks[chunk_index];
+			T* data = chunks[chunk_index].data();
+			const handle_t* owners = inverse_handle_chunks[chunk_index].data();
+			MarkChunkChanged(chunk_index, occupancy);
+			if (occupancy.PopCount() == entries_per_chunk) fn(data, owners, occupancy, std::true_type{});
+			else fn(data, owners, occupancy, std::false_type{});
+		}
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	void SparseSetChunked<handle_t, T, chunk_width>::stamp(data_t chunk_index, data_t data_index)
+	{
+		if constexpr (change_tracking != ChangeTracking::None) chunk_ticks[chunk_index] = current_tick;
+		if constexpr (change_tracking == ChangeTracking::PerSlot) slot_ticks[chunk_index][data_index] = current_tick;
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	void SparseSetChunked<handle_t, T, chunk_width>::stampConcurrent(data_t chunk_index, data_t data_index)
+	{
+		/* Concurrent writers of one chunk all store the same tick */
+		if constexpr (change_tracking != ChangeTracking::None) std::atomic_ref<tick_t>(chunk_ticks[chunk_index]).store(current_tick, std::memory_order_relaxed);
+		if constexpr (change_tracking == ChangeTracking::PerSlot) slot_ticks[chunk_index][data_index] = current_tick;
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	std::pair<typename SparseSetChunked<handle_t, T, chunk_width>::data_t, typename SparseSetChunked<handle_t, T, chunk_width>::data_t> SparseSetChunked<handle_t, T, chunk_width>::locate(const T* entry) const
+	{
+		const size_t offset = size_t(reinterpret_cast<const std::byte*>(entry) - reinterpret_cast<const std::byte*>(chunks.data()));
+		assert(offset < chunks.size() * sizeof(Chunk));
+		return { data_t(offset / sizeof(Chunk)), data_t(offset % sizeof(Chunk) / sizeof(T)) };
+	}
 
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	void SparseSetChunked<handle_t, T, chunk_width>::stampSlots(data_t chunk_index, const mask_t& slots)
+	{
+		if constexpr (change_tracking != ChangeTracking::None) std::atomic_ref<tick_t>(chunk_ticks[chunk_index]).store(current_tick, std::memory_order_relaxed);
+		if constexpr (change_tracking == ChangeTracking::PerSlot)
+		{
+			/* Branch free over all slots like GetChangedMask, unstamped slots keep their tick */
+			SlotTicks& ticks = slot_ticks[chunk_index];
+			for (size_t word_index = 0; word_index < mask_t::word_count; word_index++)
+			{
+				const uint64_t bits = slots.Word(word_index);
+				for (data_t bit = 0; bit < 64; bit++)
+				{
+					tick_t& tick = ticks[word_index * 64 + bit];
+					tick = ((bits >> bit) & 1) ? current_tick : tick;
+				}
+			}
+		}
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	bool SparseSetChunked<handle_t, T, chunk_width>::hasValidIndices() const
+	{
+		size_t used_count = 0;
+		for (size_t chunk_range = 0; chunk_range < chunk_indices.size(); chunk_range++)
+		{
+			const data_t chunk_index = chunk_indices[chunk_range];
+			if (chunk_index == invalid_index) continue;
+			if (chunk_index >= chunks.size() || chunk_ranges[chunk_index] != chunk_range) return false;
+			used_count++;
+		}
+		if (used_count != chunks.size()) return false;
+
+		for (data_t chunk_index = 0; chunk_index < ChunkCount(); chunk_index++)
+		{
+			const data_t first_index = chunk_ranges[chunk_index] * entries_per_chunk;
+			for (auto occ_it = mask_t::Iterator::Create(occupancy_masks[chunk_index]); !occ_it.IsZero(); ++occ_it)
+			{
+				if (inverse_handle_chunks[chunk_index][*occ_it].GetIndex() != first_index + *occ_it) return false;
+			}
+		}
+		return true;
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	T* SparseSetChunked<handle_t, T, chunk_width>::TryGet(handle_t handle)
+	{
 		const auto handle_index = handle.GetIndex();
+		assert(handle_index / entries_per_chunk < chunk_indices.size());
+
 		const auto chunk_index = chunk_indices[handle_index / entries_per_chunk];
+		if (chunk_index == invalid_index) return nullptr;
+
 		const auto data_index = handle_index % entries_per_chunk;
-		return chunks[chunk_index][data_index];
+		if (!occupancy_masks[chunk_index].IsBitSet(typename mask_t::index_t(data_index))) return nullptr;
+
+		assert(inverse_handle_chunks[chunk_index][data_index].GetValidationID() == handle.GetValidationID()); /* Check for stale handle */
+		return &chunks[chunk_index][data_index];
 	}
 
-	template <typename handle_t, typename T>
-	void SparseSetChunked<handle_t, T>::Remove(handle_t handle)
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	void SparseSetChunked<handle_t, T, chunk_width>::Remove(handle_t handle)
 	{
 		assert(Has(handle));
 
@@ -147,38 +431,99 @@ namespace lcs
 
 
 		auto& occupancy_mask = occupancy_masks[chunk_index];
-		occupancy_mask.ClearBit(uint8_t(data_index));
+		occupancy_mask.ClearBit(typename mask_t::index_t(data_index));
+		chunk_dirty.Mark(chunk_index);
+		version++;
+		events.RecordRemove(handle);
 
 		if (occupancy_mask.IsZero())
 		{
 			/* Remove the chunk */
 			assert(chunks.size() > 0);
 			const auto back_chunk_index = typename handle_t::data_t(chunks.size()) - 1;
-			const auto back_index = inverse_handle_chunks[back_chunk_index][data_index].GetIndex();
 
 			if (back_chunk_index != chunk_index)
 			{
+				std::iter_swap(chunk_ranges.begin() + chunk_index, chunk_ranges.begin() + back_chunk_index);
 				std::iter_swap(occupancy_masks.begin() + chunk_index, occupancy_masks.begin() + back_chunk_index);
 				std::iter_swap(inverse_handle_chunks.begin() + chunk_index, inverse_handle_chunks.begin() + back_chunk_index);
 				std::iter_swap(chunks.begin() + chunk_index, chunks.begin() + back_chunk_index);
+				if constexpr (change_tracking != ChangeTracking::None) std::iter_swap(chunk_ticks.begin() + chunk_index, chunk_ticks.begin() + back_chunk_index);
+				if constexpr (change_tracking == ChangeTracking::PerSlot) std::iter_swap(slot_ticks.begin() + chunk_index, slot_ticks.begin() + back_chunk_index);
+				chunk_indices[chunk_ranges[chunk_index]] = chunk_index;
+				sparse_dirty.Mark(chunk_ranges[chunk_index]);
 			}
+			chunk_ranges.pop_back();
 			occupancy_masks.pop_back();
 			inverse_handle_chunks.pop_back();
 			chunks.pop_back();
+			if constexpr (change_tracking != ChangeTracking::None) chunk_ticks.pop_back();
+			if constexpr (change_tracking == ChangeTracking::PerSlot) slot_ticks.pop_back();
 
-			chunk_indices[back_index] = chunk_index;
-			chunk_indices[handle_index] = invalid_index;
+			chunk_indices[handle_index / entries_per_chunk] = invalid_index;
+			sparse_dirty.Mark(handle_index / entries_per_chunk);
 		}
 	}
 
-	template <typename handle_t, typename T>
-	void SparseSetChunked<handle_t, T>::RemoveIfPresent(handle_t handle)
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	void SparseSetChunked<handle_t, T, chunk_width>::RemoveMany(std::span<const handle_t> handles)
+	{
+		events.RecordRemoves(handles);
+		bool emptied_chunk = false;
+		for (const handle_t handle : handles)
+		{
+			assert(Has(handle));
+			const auto handle_index = handle.GetIndex();
+			const data_t chunk_index = chunk_indices[handle_index / entries_per_chunk];
+			auto& occupancy_mask = occupancy_masks[chunk_index];
+			occupancy_mask.ClearBit(typename mask_t::index_t(handle_index % entries_per_chunk));
+			chunk_dirty.Mark(chunk_index);
+			version++;
+			emptied_chunk |= occupancy_mask.IsZero();
+		}
+		if (!emptied_chunk) return;
+
+		const data_t chunk_count = ChunkCount();
+		data_t write_index = 0;
+		for (data_t read_index = 0; read_index < chunk_count; read_index++)
+		{
+			if (occupancy_masks[read_index].IsZero())
+			{
+				chunk_indices[chunk_ranges[read_index]] = invalid_index;
+				sparse_dirty.Mark(chunk_ranges[read_index]);
+				continue;
+			}
+
+			if (write_index != read_index)
+			{
+				chunk_ranges[write_index] = chunk_ranges[read_index];
+				occupancy_masks[write_index] = occupancy_masks[read_index];
+				inverse_handle_chunks[write_index] = inverse_handle_chunks[read_index];
+				chunks[write_index] = std::move(chunks[read_index]);
+				if constexpr (change_tracking != ChangeTracking::None) chunk_ticks[write_index] = chunk_ticks[read_index];
+				if constexpr (change_tracking == ChangeTracking::PerSlot) slot_ticks[write_index] = slot_ticks[read_index];
+				chunk_indices[chunk_ranges[write_index]] = write_index;
+				sparse_dirty.Mark(chunk_ranges[write_index]);
+				chunk_dirty.Mark(write_index);
+			}
+			write_index++;
+		}
+		chunk_ranges.erase(chunk_ranges.begin() + write_index, chunk_ranges.end());
+		occupancy_masks.erase(occupancy_masks.begin() + write_index, occupancy_masks.end());
+		inverse_handle_chunks.erase(inverse_handle_chunks.begin() + write_index, inverse_handle_chunks.end());
+		chunks.erase(chunks.begin() + write_index, chunks.end());
+		if constexpr (change_tracking != ChangeTracking::None) chunk_ticks.erase(chunk_ticks.begin() + write_index, chunk_ticks.end());
+		if constexpr (change_tracking == ChangeTracking::PerSlot) slot_ticks.erase(slot_ticks.begin() + write_index, slot_ticks.end());
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	void SparseSetChunked<handle_t, T, chunk_width>::RemoveIfPresent(handle_t handle)
 	{
 		if (Has(handle)) Remove(handle);
 	}
 
-	template <typename handle_t, typename T>
-	bool SparseSetChunked<handle_t, T>::Has(handle_t handle) const
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	bool SparseSetChunked<handle_t, T, chunk_width>::Has(handle_t handle) const
 	{
 		const auto handle_index = handle.GetIndex();
 		assert(handle_index / entries_per_chunk < chunk_indices.size());
@@ -188,29 +533,119 @@ namespace lcs
 
 		const auto data_index = handle_index % entries_per_chunk;
 		const auto occupancy_mask = occupancy_masks[chunk_index];
-		if (!occupancy_mask.IsBitSet(uint8_t(data_index))) return false;
+		if (!occupancy_mask.IsBitSet(typename mask_t::index_t(data_index))) return false;
 
 		const InverseHandlesChunk& inverse_handle_chunk = inverse_handle_chunks[chunk_index];
 		assert(inverse_handle_chunk[data_index].GetValidationID() == handle.GetValidationID()); /* Check for stale handle */
 		return true;
 	}
 
-	template <typename handle_t, typename T>
-	inline void SparseSetChunked<handle_t, T>::ReserveSparseSize(handle_t::data_t new_size)
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	inline void SparseSetChunked<handle_t, T, chunk_width>::ReserveSparseSize(handle_t::data_t new_size)
 	{
 		if (new_size > SparseSize())
 		{
 			const auto new_size_aligned = (new_size / entries_per_chunk) + 1;
+			sparse_dirty.MarkRange(chunk_indices.size(), size_t(new_size_aligned));
 			chunk_indices.resize(size_t(new_size_aligned), invalid_index);
 		}
 	}
 
-	template <typename handle_t, typename T>
-	inline void SparseSetChunked<handle_t, T>::Clear()
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	inline void SparseSetChunked<handle_t, T, chunk_width>::Clear()
 	{
 		chunk_indices.clear();
+		chunk_ranges.clear();
 		occupancy_masks.clear();
 		inverse_handle_chunks.clear();
 		chunks.clear();
+		chunk_ticks.clear();
+		slot_ticks.clear();
+		sparse_dirty.MarkCleared();
+		chunk_dirty.MarkCleared();
+		version++;
+		events.RecordReset();
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	inline ContainerStats SparseSetChunked<handle_t, T, chunk_width>::Stats() const
+	{
+		uint64_t occupied = 0;
+		for (const mask_t& occupancy_mask : occupancy_masks) occupied += occupancy_mask.PopCount();
+		const size_t bytes = internal_ecs::CapacityBytes(chunk_indices) + internal_ecs::CapacityBytes(chunk_ranges) + internal_ecs::CapacityBytes(occupancy_masks)
+			+ internal_ecs::CapacityBytes(inverse_handle_chunks) + internal_ecs::CapacityBytes(chunks) + internal_ecs::CapacityBytes(chunk_ticks)
+			+ internal_ecs::CapacityBytes(slot_ticks) + sparse_dirty.MemoryUsage() + chunk_dirty.MemoryUsage() + events.MemoryUsage();
+		return { occupied, SparseSize(), bytes, internal_ecs::FillRatio(occupied, uint64_t(chunks.size()) * entries_per_chunk), 0 };
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	inline void SparseSetChunked<handle_t, T, chunk_width>::Save(SnapshotWriter& writer) const
+	{
+		writer.WriteArray(std::span<const data_t>(chunk_indices));
+		writer.WriteArray(std::span<const data_t>(chunk_ranges));
+		writer.WriteArray(std::span<const mask_t>(occupancy_masks));
+		writer.WriteArray(std::span<const InverseHandlesChunk>(inverse_handle_chunks));
+		writer.WriteArray(std::span<const Chunk>(chunks));
+		writer.Write(current_tick);
+		writer.WriteArray(std::span<const tick_t>(chunk_ticks));
+		writer.WriteArray(std::span<const SlotTicks>(slot_ticks));
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	inline void SparseSetChunked<handle_t, T, chunk_width>::Load(SnapshotReader& reader)
+	{
+		reader.ReadArray(chunk_indices);
+		reader.ReadArray(chunk_ranges);
+		reader.ReadArray(occupancy_masks);
+		reader.ReadArray(inverse_handle_chunks);
+		reader.ReadArray(chunks);
+		current_tick = reader.Read<tick_t>();
+		reader.ReadArray(chunk_ticks);
+		reader.ReadArray(slot_ticks);
+
+		const size_t chunk_count = chunks.size();
+		const bool consistent = chunk_ranges.size() == chunk_count && occupancy_masks.size() == chunk_count && inverse_handle_chunks.size() == chunk_count
+			&& chunk_ticks.size() == (change_tracking != ChangeTracking::None ? chunk_count : 0)
+			&& slot_ticks.size() == (change_tracking == ChangeTracking::PerSlot ? chunk_count : 0);
+		if (!consistent || !hasValidIndices()) reader.Fail();
+		ResetDirty();
+		version++;
+		events.RecordReset();
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	inline void SparseSetChunked<handle_t, T, chunk_width>::SaveDelta(SnapshotWriter& writer)
+	{
+		writer.WriteDirty(std::span<const data_t>(chunk_indices), sparse_dirty);
+		writer.WriteDirty(std::span<const data_t>(chunk_ranges), chunk_dirty);
+		writer.WriteDirty(std::span<const mask_t>(occupancy_masks), chunk_dirty);
+		writer.WriteDirty(std::span<const InverseHandlesChunk>(inverse_handle_chunks), chunk_dirty);
+		writer.WriteDirty(std::span<const Chunk>(chunks), chunk_dirty);
+		writer.Write(current_tick);
+		writer.WriteDirty(std::span<const tick_t>(chunk_ticks), chunk_dirty);
+		writer.WriteDirty(std::span<const SlotTicks>(slot_ticks), chunk_dirty);
+		ResetDirty();
+	}
+
+	template <typename handle_t, typename T, uint32_t chunk_width>
+	inline void SparseSetChunked<handle_t, T, chunk_width>::LoadDelta(SnapshotReader& reader)
+	{
+		reader.ReadDirty(chunk_indices, internal_ecs::max_snapshot_entries<handle_t>);
+		reader.ReadDirty(chunk_ranges, internal_ecs::max_snapshot_entries<handle_t>);
+		reader.ReadDirty(occupancy_masks, internal_ecs::max_snapshot_entries<handle_t>);
+		reader.ReadDirty(inverse_handle_chunks, internal_ecs::max_snapshot_entries<handle_t>);
+		reader.ReadDirty(chunks, internal_ecs::max_snapshot_entries<handle_t>);
+		current_tick = reader.Read<tick_t>();
+		reader.ReadDirty(chunk_ticks, internal_ecs::max_snapshot_entries<handle_t>);
+		reader.ReadDirty(slot_ticks, internal_ecs::max_snapshot_entries<handle_t>);
+
+		const size_t chunk_count = chunks.size();
+		const bool consistent = chunk_ranges.size() == chunk_count && occupancy_masks.size() == chunk_count && inverse_handle_chunks.size() == chunk_count
+			&& chunk_ticks.size() == (change_tracking != ChangeTracking::None ? chunk_count : 0)
+			&& slot_ticks.size() == (change_tracking == ChangeTracking::PerSlot ? chunk_count : 0);
+		if (!consistent || !hasValidIndices()) reader.Fail();
+		ResetDirty();
+		version++;
+		events.RecordReset();
 	}
-}
\ No newline at end of file
+}
@@ -0,0 +1,506 @@
+#pragma once
+#include <lutra-ecs/ContainerStats.h>
+#include <lutra-ecs/Handle.h>
+#include <lutra-ecs/PagedIndexArray.h>
+#include <lutra-ecs/Snapshot.h>
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <span>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace lcs
+{
+	namespace internal_ecs
+	{
+		template <typename M>
+		struct MemberPointerTraits;
+
+		template <typename C, typename F>
+		struct MemberPointerTraits<F C::*>
+		{
+			using Class = C;
+			using Field = F;
+		};
+
+		/* Field layout of a struct-of-arrays component, declared by the component as
+		 * static constexpr std::tuple soa_fields{ &T::a, &T::b, ... }; */
+		template <typename T, typename Members = std::remove_const_t<decltype(T::soa_fields)>>
+		struct SoALayout;
+
+		template <typename T, typename... Ms>
+		struct SoALayout<T, std::tuple<Ms...>>
+		{
+			static_assert(((std::is_same_v<typename MemberPointerTraits<Ms>::Class, T>) && ...), "soa_fields must point to members of the component");
+
+			using FieldPointers = std::tuple<typename MemberPointerTraits<Ms>::Field*...>;
+			using ConstFieldPointers = std::tuple<const typename MemberPointerTraits<Ms>::Field*...>;
+			using Columns = std::tuple<std::pmr::vector<typename MemberPointerTraits<Ms>::Field>...>;
+			static constexpr size_t field_count = sizeof...(Ms);
+
+			/* Index of member in soa_fields */
+			template <auto member>
+			static constexpr size_t FieldIndex()
+			{
+				size_t result = field_count;
+				[&]<size_t... I>(std::index_sequence<I...>)
+				{
+					([&]()
+						{
+							if constexpr (std::is_same_v<decltype(member), std::tuple_element_t<I, std::tuple<Ms...>>>)
+							{
+								if (std::get<I>(T::soa_fields) == member) result = I;
+							}
+						}(), ...);
+				}(std::index_sequence_for<Ms...>{});
+				return result;
+			}
+		};
+	}
+
+	/* Proxy reference to a component stored as struct-of-arrays.
+	 * Fields are accessed in place through Get<&T::field>(), the whole component can be loaded or stored at once.
+	 * SoARef<const T> is the read-only proxy, a SoARef<T> converts to it */
+	template <typename T>
+	class SoARef
+	{
+		using Value = std::remove_const_t<T>;
+		using Layout = internal_ecs::SoALayout<Value>;
+		using FieldPointers = std::conditional_t<std::is_const_v<T>, typename Layout::ConstFieldPointers, typename Layout::FieldPointers>;
+
+	public:
+		inline explicit SoARef(FieldPointers fields) : fields(fields) {};
+		SoARef(const SoARef&) = default;
+		inline SoARef(const SoARef<Value>& other) requires std::is_const_v<T> : fields(other.fields) {};
+
+		template <auto member>
+		inline auto& Get() const
+		{
+			constexpr size_t index = Layout::template FieldIndex<member>();
+			static_assert(index < Layout::field_count, "Member is not listed in soa_fields");
+			return *std::get<index>(fields);
+		}
+
+		inline Value Load() const;
+		inline operator Value() const { return Load(); };
+
+		inline const SoARef& operator=(const Value& value) const requires (!std::is_const_v<T>);
+		inline const SoARef& operator=(const SoARef& other) const requires (!std::is_const_v<T>) { return *this = other.Load(); };
+
+	private:
+		FieldPointers fields;
+
+		template <typename U> friend class SoARef;
+		template <typename U> friend class SoAPtr;
+	};
+
+	/* Proxy pointer to a component stored as struct-of-arrays, null when default constructed */
+	template <typename T>
+	class SoAPtr
+	{
+		using Value = std::remove_const_t<T>;
+		using Layout = internal_ecs::SoALayout<Value>;
+		using FieldPointers = std::conditional_t<std::is_const_v<T>, typename Layout::ConstFieldPointers, typename Layout::FieldPointers>;
+
+	public:
+		SoAPtr() {};
+		inline explicit SoAPtr(FieldPointers fields) : fields(fields) {};
+		SoAPtr(const SoAPtr&) = default;
+		SoAPtr& operator=(const SoAPtr&) = default;
+		inline SoAPtr(const SoAPtr<Value>& other) requires std::is_const_v<T> : fields(other.fields) {};
+
+		inline SoARef<T> operator*() const { return SoARef<T>(fields); };
+		inline explicit operator bool() const { return std::get<0>(fields) != nullptr; };
+
+		friend bool operator== (const SoAPtr& a, std::nullptr_t) { return std::get<0>(a.fields) == nullptr; };
+
+	private:
+		FieldPointers fields{};
+
+		template <typename U> friend class SoAPtr;
+		template <typename H, typename U> friend class SparseSetSoA;
+	};
+
+	template <typename T>
+	SoARef<T>::Value SoARef<T>::Load() const
+	{
+		Value value{};
+		[&]<size_t... I>(std::index_sequence<I...>) { ((value.*std::get<I>(T::soa_fields) = *std::get<I>(fields)), ...); }(std::make_index_sequence<Layout::field_count>{});
+		return value;
+	}
+
+	template <typename T>
+	const SoARef<T>& SoARef<T>::operator=(const Value& value) const requires (!std::is_const_v<T>)
+	{
+		[&]<size_t... I>(std::index_sequence<I...>) { ((*std::get<I>(fields) = value.*std::get<I>(T::soa_fields)), ...); }(std::make_index_sequence<Layout::field_count>{});
+		return *this;
+	}
+
+	/* Sparse set storing every field of T listed in T::soa_fields in its own dense array.
+	 * Passes touching a few fields stream only those arrays, which lets the compiler vectorize them. */
+	template <typename handle_t, typename T>
+	class SparseSetSoA
+	{
+		using Layout = internal_ecs::SoALayout<T>;
+		using FieldIndices = std::make_index_sequence<Layout::field_count>;
+
+	public:
+		using data_t = handle_t::data_t;
+
+		SparseSetSoA() {};
+		explicit SparseSetSoA(std::pmr::memory_resource* resource) : sparse_indices(resource), inverse_list(resource), columns(makeColumns(resource, FieldIndices{})), dense_dirty(resource) {};
+
+		inline void Add(handle_t handle, const T& data);
+		inline void AddMany(std::span<const handle_t> handles, std::span<const T> data);
+		/* Get and TryGet don't mark the entry, writes through them are reported with MarkChanged */
+		inline SoARef<T> Get(handle_t handle);
+		inline SoAPtr<T> TryGet(handle_t handle);
+		/* Same as Get, marking the entry as written for delta snapshots */
+		inline SoARef<T> Write(handle_t handle);
+		inline void Remove(handle_t handle);
+		/* Removes every handle, which must all be present and unique. Large batches are compacted in one pass per column */
+		inline void RemoveMany(std::span<const handle_t> handles);
+		inline void RemoveIfPresent(handle_t handle);
+		inline bool Has(handle_t handle) const;
+		/* Record writes for delta snapshots, Write and Field record themselves. Safe to call from several threads */
+		inline void MarkChanged(handle_t handle) { assertValidInputHandle(handle); dense_dirty.MarkConcurrent(sparse_indices[handle.GetIndex()]); };
+		inline void MarkRangeChanged(data_t first_dense_index, data_t last_dense_index) { assert(last_dense_index <= DenseSize()); dense_dirty.MarkRangeConcurrent(first_dense_index, last_dense_index); };
+		inline void MarkAllChanged() { dense_dirty.MarkRangeConcurrent(0, DenseSize()); };
+		/* MarkChanged for an entry handed out by TryGet or the iterator without a second lookup, the Concurrent one for several threads */
+		inline void MarkEntryChanged(const SoAPtr<T>& entry) { dense_dirty.MarkCovered(denseIndexOf(entry)); };
+		inline void MarkEntryChangedConcurrent(const SoAPtr<T>& entry) { dense_dirty.MarkConcurrent(denseIndexOf(entry)); };
+
+		inline data_t SparseSize() const { return data_t(sparse_indices.size()); };
+		inline size_t SparseMemoryUsage() const { return sparse_indices.MemoryUsage(); };
+		inline data_t DenseSize() const { return data_t(inverse_list.size()); };
+		inline ContainerStats Stats() const;
+
+		/* Dense array of a single field, in the same order as DenseOwners(). Field marks every entry as written, ReadField marks nothing */
+		template <auto member>
+		inline auto Field();
+		template <auto member>
+		inline auto ReadField() const;
+		inline std::span<const handle_t> DenseOwners() const { return inverse_list; };
+		inline SoAPtr<T> DenseEntry(data_t dense_index) { assert(dense_index < DenseSize()); return SoAPtr<T>(fieldPointers(dense_index, FieldIndices{})); };
+
+		inline void ReserveSparseSize(data_t new_size);
+		inline void Clear();
+
+		/* Bulk copies of the sparse array and of every column */
+		inline void Save(SnapshotWriter& writer) const;
+		inline void Load(SnapshotReader& reader);
+		/* Stores the dense ranges written since the last snapshot, of every column */
+		inline void SaveDelta(SnapshotWriter& writer);
+		inline void LoadDelta(SnapshotReader& reader);
+		inline void ResetDirty() { sparse_indices.ResetDirty(); dense_dirty.Reset(DenseSize()); };
+
+		/* Bumped whenever entries are added or removed, cached queries compare it to find out if they are stale */
+		inline uint64_t Version() const { return version; };
+
+		class Iterator
+		{
+		public:
+			inline SoARef<T> operator*() const { return SoARef<T>(owner.fieldPointers(dense_index, FieldIndices{})); }
+			inline SoAPtr<T> operator->() const { return SoAPtr<T>(owner.fieldPointers(dense_index, FieldIndices{})); }
+
+			inline handle_t GetOwner() const { return owner.inverse_list[dense_index]; };
+
+			inline Iterator& operator++() { dense_index++; return *this; }
+			inline Iterator& operator--() { dense_index--; return *this; }
+
+			inline Iterator operator++(int)
+			{
+				Iterator tmp = *this; ++(*this); return tmp;
+			}
+			inline Iterator operator--(int)
+			{
+				Iterator tmp = *this; --(*this); return tmp;
+			}
+
+			friend bool operator== (const Iterator& a, const Iterator& b) { return a.dense_index == b.dense_index; };
+			friend bool operator!= (const Iterator& a, const Iterator& b) { return a.dense_index != b.dense_index; };
+		private:
+			inline Iterator(SparseSetSoA& owner, data_t dense_index) : dense_index(dense_index), owner(owner) {}
+			data_t dense_index;
+			SparseSetSoA& owner;
+
+			friend class SparseSetSoA;
+		};
+
+		inline Iterator begin() { return Iterator(*this, 0); };
+		inline Iterator end() { return Iterator(*this, DenseSize()); };
+
+	private:
+		constexpr static data_t invalid_index{ data_t(-1) };
+
+		/* RemoveMany compacts when removing at least 1 / compaction_ratio of the entries, smaller batches swap and pop */
+		constexpr static size_t compaction_ratio{ 32 };
+
+		template <size_t... I>
+		inline Layout::FieldPointers fieldPointers(data_t dense_index, std::index_sequence<I...>) { return { &std::get<I>(columns)[dense_index]... }; };
+
+		template <size_t... I>
+		inline static Layout::Columns makeColumns(std::pmr::memory_resource* resource, std::index_sequence<I...>) { return { std::tuple_element_t<I, typename Layout::Columns>(resource)... }; };
+
+		inline void assertValidInputHandle(handle_t handle) const;
+		/* Every field pointer of an entry sits at the same index of its column */
+		inline data_t denseIndexOf(const SoAPtr<T>& entry) const { assert(entry); return data_t(std::get<0>(entry.fields) - std::get<0>(columns).data()); };
+
+		PagedIndexArray<data_t> sparse_indices;
+		std::pmr::vector<handle_t> inverse_list;
+		Layout::Columns columns;
+		DirtyBlocks<> dense_dirty; /* Covers inverse_list and every column */
+		uint64_t version{ 0 };
+	};
+
+	template <typename handle_t, typename T>
+	void SparseSetSoA<handle_t, T>::Add(handle_t handle, const T& data)
+	{
+		const auto handle_index = handle.GetIndex();
+		assert(handle_index < SparseSize()); /* Invalid index or missing reservation */
+		assert(sparse_indices[handle_index] == invalid_index);
+
+		[&]<size_t... I>(std::index_sequence<I...>) { (std::get<I>(columns).push_back(data.*std::get<I>(T::soa_fields)), ...); }(FieldIndices{});
+		inverse_list.push_back(handle);
+		sparse_indices.At(handle_index) = DenseSize() - 1;
+		dense_dirty.Mark(DenseSize() - 1);
+		version++;
+	}
+
+	template <typename handle_t, typename T>
+	void SparseSetSoA<handle_t, T>::AddMany(std::span<const handle_t> handles, std::span<const T> data)
+	{
+		assert(handles.size() == data.size());
+		const data_t first_dense_index = DenseSize();
+
+		/* Scatter one field at a time so every column is written sequentially */
+		[&]<size_t... I>(std::index_sequence<I...>)
+		{
+			([&]()
+				{
+					auto& column = std::get<I>(columns);
+					column.resize(column.size() + data.size());
+					for (size_t i = 0; i < data.size(); i++)
+					{
+						column[first_dense_index + i] = data[i].*std::get<I>(T::soa_fields);
+					}
+				}(), ...);
+		}(FieldIndices{});
+
+		inverse_list.insert(inverse_list.end(), handles.data(), handles.data() + handles.size());
+		for (size_t i = 0; i < handles.size(); i++)
+		{
+			const auto handle_index = handles[i].GetIndex();
+			assert(handle_index < SparseSize()); /* Invalid index or missing reservation */
+			assert(sparse_indices[handle_index] == invalid_index);
+			sparse_indices.At(handle_index) = first_dense_index + data_t(i);
+		}
+		dense_dirty.MarkRange(first_dense_index, DenseSize());
+		version++;
+	}
+
+	template <typename handle_t, typename T>
+	SoARef<T> SparseSetSoA<handle_t, T>::Get(handle_t handle)
+	{
+		assertValidInputHandle(handle);
+		return SoARef<T>(fieldPointers(sparse_indices[handle.GetIndex()], FieldIndices{}));
+	}
+
+	template <typename handle_t, typename T>
+	SoARef<T> SparseSetSoA<handle_t, T>::Write(handle_t handle)
+	{
+		MarkChanged(handle);
+		return Get(handle);
+	}
+
+	template <typename handle_t, typename T>
+	SoAPtr<T> SparseSetSoA<handle_t, T>::TryGet(handle_t handle)
+	{
+		const auto handle_index = handle.GetIndex();
+		assert(handle_index < SparseSize());
+		const auto dense_index = sparse_indices[handle_index];
+		if (dense_index == invalid_index) return SoAPtr<T>();
+		assert(inverse_list[dense_index].GetValidationID() == handle.GetValidationID()); /* Check for stale handle */
+		return SoAPtr<T>(fieldPointers(dense_index, FieldIndices{}));
+	}
+
+	template <typename handle_t, typename T>
+	void SparseSetSoA<handle_t, T>::Remove(handle_t handle)
+	{
+		assertValidInputHandle(handle);
+
+		const auto handle_index = handle.GetIndex();
+		const auto back_index = inverse_list.back().GetIndex();
+		const auto dense_index = sparse_indices[handle_index];
+
+		/* Move the back entry of every column into the hole */
+		std::apply([=](auto&... column) { ((column[dense_index] = column.back(), column.pop_back()), ...); }, columns);
+		inverse_list[dense_index] = inverse_list.back();
+		inverse_list.pop_back();
+		dense_dirty.Mark(dense_index);
+		version++;
+
+		sparse_indices.At(back_index) = dense_index;
+		sparse_indices.At(handle_index) = invalid_index;
+	}
+
+	template <typename handle_t, typename T>
+	void SparseSetSoA<handle_t, T>::RemoveMany(std::span<const handle_t> handles)
+	{
+		if (handles.size() * compaction_ratio < DenseSize())
+		{
+			for (const handle_t handle : handles) Remove(handle);
+			return;
+		}
+
+		/* Mark the removed entries with an invalid owner */
+		const data_t dense_size = DenseSize();
+		data_t first_hole = dense_size;
+		for (const handle_t handle : handles)
+		{
+			assertValidInputHandle(handle);
+			const auto handle_index = handle.GetIndex();
+			const data_t dense_index = sparse_indices[handle_index];
+			inverse_list[dense_index] = handle_t{};
+			sparse_indices.At(handle_index) = invalid_index;
+			first_hole = std::min(first_hole, dense_index);
+		}
+
+		/* Every column is compacted on its own so each pass streams a single array */
+		const auto compact = [&](auto& column)
+			{
+				data_t write_index = first_hole;
+				for (data_t read_index = first_hole; read_index < dense_size; read_index++)
+				{
+					if (!inverse_list[read_index].IsValid()) continue;
+					column[write_index++] = column[read_index];
+				}
+				column.erase(column.begin() + write_index, column.end());
+			};
+		std::apply([&](auto&... column) { (compact(column), ...); }, columns);
+
+		data_t write_index = first_hole;
+		for (data_t read_index = first_hole; read_index < dense_size; read_index++)
+		{
+			const handle_t owner = inverse_list[read_index];
+			if (!owner.IsValid()) continue;
+			inverse_list[write_index] = owner;
+			sparse_indices.At(owner.GetIndex()) = write_index;
+			write_index++;
+		}
+		inverse_list.erase(inverse_list.begin() + write_index, inverse_list.end());
+		dense_dirty.MarkRange(first_hole, write_index);
+		version++;
+	}
+
+	template <typename handle_t, typename T>
+	void SparseSetSoA<handle_t, T>::RemoveIfPresent(handle_t handle)
+	{
+		if (Has(handle)) Remove(handle);
+	}
+
+	template <typename handle_t, typename T>
+	bool SparseSetSoA<handle_t, T>::Has(handle_t handle) const
+	{
+		const auto handle_index = handle.GetIndex();
+		assert(handle_index < SparseSize());
+		if (sparse_indices[handle_index] == invalid_index) return false;
+		assert(inverse_list[sparse_indices[handle_index]].GetValidationID() == handle.GetValidationID()); /* Check for stale handle */
+		return true;
+	}
+
+	template <typename handle_t, typename T> template <auto member>
+	auto SparseSetSoA<handle_t, T>::Field()
+	{
+		constexpr size_t index = Layout::template FieldIndex<member>();
+		static_assert(index < Layout::field_count, "Member is not listed in soa_fields");
+		MarkAllChanged(); /* Field passes usually write every entry */
+		return std::span(std::get<index>(columns));
+	}
+
+	template <typename handle_t, typename T> template <auto member>
+	auto SparseSetSoA<handle_t, T>::ReadField() const
+	{
+		constexpr size_t index = Layout::template FieldIndex<member>();
+		static_assert(index < Layout::field_count, "Member is not listed in soa_fields");
+		return std::span(std::as_const(std::get<index>(columns)));
+	}
+
+	template <typename handle_t, typename T>
+	inline void SparseSetSoA<handle_t, T>::ReserveSparseSize(handle_t::data_t new_size)
+	{
+		assert(new_size > SparseSize());
+		sparse_indices.resize(size_t(new_size));
+	}
+
+	template <typename handle_t, typename T>
+	inline void SparseSetSoA<handle_t, T>::Clear()
+	{
+		sparse_indices.clear();
+		inverse_list.clear();
+		std::apply([](auto&... column) { (column.clear(), ...); }, columns);
+		dense_dirty.MarkCleared();
+		version++;
+	}
+
+	template <typename handle_t, typename T>
+	inline void SparseSetSoA<handle_t, T>::assertValidInputHandle(handle_t handle) const
+	{
+		[[maybe_unused]] const auto handle_index = handle.GetIndex();
+		assert(handle_index < SparseSize());
+		assert(sparse_indices[handle_index] != invalid_index);
+		assert(sparse_indices[handle_index] < DenseSize());
+		assert(inverse_list[sparse_indices[handle_index]].GetValidationID() == handle.GetValidationID()); /* Check for stale handle */
+	}
+
+	template <typename handle_t, typename T>
+	ContainerStats SparseSetSoA<handle_t, T>::Stats() const
+	{
+		size_t bytes = sparse_indices.MemoryUsage() + internal_ecs::CapacityBytes(inverse_list) + dense_dirty.MemoryUsage();
+		std::apply([&](const auto&... column) { ((bytes += internal_ecs::CapacityBytes(column)), ...); }, columns);
+		return { DenseSize(), SparseSize(), bytes, internal_ecs::FillRatio(DenseSize(), inverse_list.capacity()), 0 };
+	}
+
+	template <typename handle_t, typename T>
+	void SparseSetSoA<handle_t, T>::Save(SnapshotWriter& writer) const
+	{
+		sparse_indices.Save(writer);
+		writer.WriteArray(std::span<const handle_t>(inverse_list));
+		std::apply([&](const auto&... column) { (writer.WriteArray(std::span(column.data(), column.size())), ...); }, columns);
+	}
+
+	template <typename handle_t, typename T>
+	void SparseSetSoA<handle_t, T>::Load(SnapshotReader& reader)
+	{
+		sparse_indices.Load(reader);
+		reader.ReadArray(inverse_list);
+		std::apply([&](auto&... column) { (reader.ReadArray(column), ...); }, columns);
+		std::apply([&](const auto&... column) { if (((column.size() != inverse_list.size()) || ...)) reader.Fail(); }, columns);
+		if (!sparse_indices.MatchesOwners(DenseOwners())) reader.Fail();
+		dense_dirty.Reset(DenseSize());
+		version++;
+	}
+
+	template <typename handle_t, typename T>
+	void SparseSetSoA<handle_t, T>::SaveDelta(SnapshotWriter& writer)
+	{
+		sparse_indices.SaveDelta(writer);
+		writer.WriteDirty(std::span<const handle_t>(inverse_list), dense_dirty);
+		std::apply([&](const auto&... column) { (writer.WriteDirty(std::span(column.data(), column.size()), dense_dirty), ...); }, columns);
+		dense_dirty.Reset(DenseSize());
+	}
+
+	template <typename handle_t, typename T>
+	void SparseSetSoA<handle_t, T>::LoadDelta(SnapshotReader& reader)
+	{
+		sparse_indices.LoadDelta(reader);
+		reader.ReadDirty(inverse_list, internal_ecs::max_snapshot_entries<handle_t>);
+		std::apply([&](auto&... column) { (reader.ReadDirty(column, internal_ecs::max_snapshot_entries<handle_t>), ...); }, columns);
+		std::apply([&](const auto&... column) { if (((column.size() != inverse_list.size()) || ...)) reader.Fail(); }, columns);
+		if (!sparse_indices.MatchesOwners(DenseOwners())) reader.Fail();
+		dense_dirty.Reset(DenseSize());
+		version++;
+	}
+}
@@ -1,5 +1,11 @@
 #pragma once
+#include <lutra-ecs/ChangeEvents.h>
+#include <lutra-ecs/ContainerStats.h>
 #include <lutra-ecs/Handle.h>
+#include <lutra-ecs/PagedIndexArray.h>
+#include <lutra-ecs/Snapshot.h>
+#include <memory_resource>
+#include <span>
 #include <vector>
 #include <algorithm>
 #include <assert.h>
@@ -13,20 +19,35 @@ namespace lcs
 		using data_t = handle_t::data_t;
 
 		inline SparseTagSet() {};
+		explicit SparseTagSet(std::pmr::memory_resource* resource) : sparse_indices(resource), inverse_list(resource), dense_dirty(resource), events(resource) {};
 
 		inline void Add(handle_t handle);
 
 		inline void Remove(handle_t handle);
+		/* Removes every handle, which must all be present and unique. Large batches are compacted in one pass */
+		inline void RemoveMany(std::span<const handle_t> handles);
 		inline void RemoveIfPresent(handle_t handle);
 		inline bool Has(handle_t handle) const;
 
 		inline data_t SparseSize() const { return data_t(sparse_indices.size()); };
+		inline size_t SparseMemoryUsage() const { return sparse_indices.MemoryUsage(); };
 		inline data_t DenseSize() const { return data_t(inverse_list.size()); };
+		inline std::span<const handle_t> DenseOwners() const { return inverse_list; };
+		inline ContainerStats Stats() const;
 
 		inline void ReserveSparseSize(data_t new_size);
 		inline void Clear();
 
-		using Iterator = std::vector<handle_t>::iterator;
+		inline void Save(SnapshotWriter& writer) const;
+		inline void Load(SnapshotReader& reader);
+		inline void SaveDelta(SnapshotWriter& writer);
+		inline void LoadDelta(SnapshotReader& reader);
+		inline void ResetDirty() { sparse_indices.ResetDirty(); dense_dirty.Reset(); };
+
+		/* Added and removed entities for reactive consumers, off until enabled */
+		inline ChangeEvents<handle_t>& Events() { return events; };
+
+		using Iterator = std::pmr::vector<handle_t>::iterator;
 		
 		inline Iterator begin() { return inverse_list.begin(); };
 
@@ -35,16 +56,23 @@ namespace lcs
 	private:
 		constexpr static data_t invalid_index{ data_t(-1) };
 
+		/* RemoveMany compacts when removing at least 1 / compaction_ratio of the entries, smaller batches swap and pop */
+		constexpr static size_t compaction_ratio{ 32 };
+
 		inline void assertValidInputHandle(handle_t handle) const;
 
-		std::vector<data_t> sparse_indices;
-		std::vector<handle_t> inverse_list;
+		PagedIndexArray<data_t> sparse_indices;
+		std::pmr::vector<handle_t> inverse_list;
+		DirtyBlocks<> dense_dirty;
+		ChangeEvents<handle_t> events;
 	};
 
 	/* Templated version for specific tags */
 	template <typename handle_t, typename T>
 	class SparseTagSetT : public SparseTagSet<handle_t>
 	{
+	public:
+		using SparseTagSet<handle_t>::SparseTagSet;
 
 	};
 
@@ -56,7 +84,9 @@ namespace lcs
 		assert(sparse_indices[handle_index] == invalid_index);
 
 		inverse_list.push_back(handle);
-		sparse_indices[handle_index] = DenseSize() - 1;
+		sparse_indices.At(handle_index) = DenseSize() - 1;
+		dense_dirty.Mark(DenseSize() - 1);
+		events.RecordAdd(handle);
 	}
 
 	template <typename handle_t>
@@ -73,9 +103,46 @@ namespace lcs
 			std::iter_swap(inverse_list.begin() + dense_index, inverse_list.begin() + dense_back_index);
 		}
 		inverse_list.pop_back();
+		dense_dirty.Mark(dense_index);
+		events.RecordRemove(handle);
+
+		sparse_indices.At(back_index) = dense_index;
+		sparse_indices.At(handle_index) = invalid_index;
+	}
+
+	template <typename handle_t>
+	void SparseTagSet<handle_t>::RemoveMany(std::span<const handle_t> handles)
+	{
+		if (handles.size() * compaction_ratio < DenseSize())
+		{
+			for (const handle_t handle : handles) Remove(handle);
+			return;
+		}
+
+		const data_t dense_size = DenseSize();
+		data_t first_hole = dense_size;
+		for (const handle_t handle : handles)
+		{
+			assertValidInputHandle(handle);
+			const auto handle_index = handle.GetIndex();
+			const data_t dense_index = sparse_indices[handle_index];
+			inverse_list[dense_index] = handle_t{};
+			sparse_indices.At(handle_index) = invalid_index;
+			first_hole = std::min(first_hole, dense_index);
+		}
 
-		sparse_indices[back_index] = dense_index;
-		sparse_indices[handle_index] = invalid_index;
+		data_t write_index = first_hole;
+		for (data_t read_index = first_hole; read_index < dense_size; read_index++)
+		{
+			const handle_t owner = inverse_list[read_index];
+			if (!owner.IsValid()) continue;
+			inverse_list[write_index] = owner;
+			sparse_indices.At(owner.GetIndex()) = write_index;
+			write_index++;
+		}
+		inverse_list.erase(inverse_list.begin() + write_index, inverse_list.end());
+		dense_dirty.MarkRange(first_hole, write_index);
+		events.RecordRemoves(handles);
 	}
 
 	template <typename handle_t>
@@ -98,7 +165,7 @@ namespace lcs
 	inline void SparseTagSet<handle_t>::ReserveSparseSize(handle_t::data_t new_size)
 	{
 		assert(new_size > SparseSize());
-		sparse_indices.resize(size_t(new_size), invalid_index);
+		sparse_indices.resize(size_t(new_size));
 	}
 
 	template <typename handle_t>
@@ -106,6 +173,8 @@ namespace lcs
 	{
 		sparse_indices.clear();
 		inverse_list.clear();
+		dense_dirty.MarkCleared();
+		events.RecordReset();
 	}
 
 	template <typename handle_t>
@@ -117,4 +186,44 @@ namespace lcs
 		assert(sparse_indices[handle_index] < DenseSize());
 		assert(inverse_list[sparse_indices[handle_index]].GetValidationID() == handle.GetValidationID()); /* Check for stale handle */
 	}
-}
\ No newline at end of file
+
+	template <typename handle_t>
+	ContainerStats SparseTagSet<handle_t>::Stats() const
+	{
+		const size_t bytes = sparse_indices.MemoryUsage() + internal_ecs::CapacityBytes(inverse_list) + dense_dirty.MemoryUsage() + events.MemoryUsage();
+		return { DenseSize(), SparseSize(), bytes, internal_ecs::FillRatio(DenseSize(), inverse_list.capacity()), 0 };
+	}
+
+	template <typename handle_t>
+	void SparseTagSet<handle_t>::Save(SnapshotWriter& writer) const
+	{
+		sparse_indices.Save(writer);
+		writer.WriteArray(std::span<const handle_t>(inverse_list));
+	}
+
+	template <typename handle_t>
+	void SparseTagSet<handle_t>::Load(SnapshotReader& reader)
+	{
+		sparse_indices.Load(reader);
+		reader.ReadArray(inverse_list);
+		if (!sparse_indices.MatchesOwners(DenseOwners())) reader.Fail();
+		events.RecordReset();
+	}
+
+	template <typename handle_t>
+	void SparseTagSet<handle_t>::SaveDelta(SnapshotWriter& writer)
+	{
+		sparse_indices.SaveDelta(writer);
+		writer.WriteDirty(std::span<const handle_t>(inverse_list), dense_dirty);
+		dense_dirty.Reset();
+	}
+
+	template <typename handle_t>
+	void SparseTagSet<handle_t>::LoadDelta(SnapshotReader& reader)
+	{
+		sparse_indices.LoadDelta(reader);
+		reader.ReadDirty(inverse_list, internal_ecs::max_snapshot_entries<handle_t>);
+		if (!sparse_indices.MatchesOwners(DenseOwners())) reader.Fail();
+		events.RecordReset();
+	}
+}
@@ -0,0 +1,202 @@
+#pragma once
+#include <lutra-ecs/ECSManager.h>
+#include <lutra-ecs/ThreadPool.h>
+#include <algorithm>
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <functional>
+#include <span>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace lcs
+{
+	/* Component and tag types a system reads or writes, Reads<Position>{}, Writes<Velocity, IsWet>{} */
+	template <typename... Ts> struct Reads {};
+	template <typename... Ts> struct Writes {};
+
+	template <typename ECS>
+	class SystemScheduler;
+
+	/* Runs systems declaring the components they access, systems without a conflict run at the same time on a thread pool.
+	 * Two systems conflict if one writes a type the other reads or writes, conflicting systems run in the order they were added.
+	 * Systems are grouped into waves, every system runs in the first wave after all of its earlier conflicting systems.
+	 *
+	 * Readers may use GetComponent, TryGet, DenseData, ReadComponentField, HasComponent, HasTag and views listing the components
+	 * they read as const, View<Velocity, const Position>, which hand them out read-only and leave them out of delta snapshots.
+	 * Views mark the non-const components they hand out without allocating, WriteComponent and MarkChanged count as writes.
+	 * Structural changes go through a ParallelCommandBuffer flushed after Run. */
+	template <typename handle_t, typename... Ts>
+	class SystemScheduler<ECSManager<handle_t, Ts...>>
+	{
+	public:
+		using ECS = ECSManager<handle_t, Ts...>;
+		using SystemID = uint32_t;
+
+		/* Measurements of the last Run, in microseconds since the start of the frame */
+		struct SystemTiming
+		{
+			SystemID system;
+			uint32_t wave;
+			double start_us;
+			double duration_us;
+			bool on_critical_path;
+		};
+
+		SystemScheduler() {};
+
+		/* fn(ECS&) runs once per Run */
+		template <typename... Rs, typename... Ws, typename F>
+		inline SystemID AddSystem(std::string name, Reads<Rs...>, Writes<Ws...>, F&& fn);
+
+		inline void Run(ECS& ecs, ThreadPool& pool = ThreadPool::Default());
+
+		inline const std::string& Name(SystemID system) const { return systems[system].name; };
+		inline uint32_t WaveCount();
+		/* Systems that have to finish before system runs */
+		inline std::span<const SystemID> Dependencies(SystemID system) const { return systems[system].dependencies; };
+		inline std::span<const SystemTiming> Timings() const { return timings; };
+		/* Sum of the durations along the longest chain of dependent systems in the last Run */
+		inline double CriticalPathMicroseconds() const { return critical_path_us; };
+		inline double FrameMicroseconds() const { return frame_us; };
+
+		/* Table of the last Run, critical path systems are marked with * */
+		inline void PrintTimings(std::FILE* out = stdout) const;
+
+	private:
+		using Access = internal_ecs::SignatureMask<sizeof...(Ts)>;
+		using Clock = std::chrono::steady_clock;
+
+		struct System
+		{
+			std::string name;
+			std::function<void(ECS&)> fn;
+			Access accessed;
+			Access written;
+			std::vector<SystemID> dependencies;
+			uint32_t wave;
+		};
+
+		template <typename... Us>
+		inline static Access makeAccess() { Access access{}; (access.SetBit(typename Access::index_t(internal_ecs::index_of<Us, Ts...>)), ...); return access; };
+		inline static bool conflicts(const System& a, const System& b) { return !(a.written & b.accessed).IsZero() || !(b.written & a.accessed).IsZero(); };
+
+		inline void buildWaves();
+		inline void findCriticalPath();
+
+		std::vector<System> systems{};
+		std::vector<std::vector<SystemID>> waves{};
+		bool waves_dirty{ false };
+
+		std::vector<SystemTiming> timings{};
+		double critical_path_us{ 0.0 };
+		double frame_us{ 0.0 };
+	};
+
+	template <typename handle_t, typename... Ts> template <typename... Rs, typename... Ws, typename F>
+	SystemScheduler<ECSManager<handle_t, Ts...>>::SystemID SystemScheduler<ECSManager<handle_t, Ts...>>::AddSystem(std::string name, Reads<Rs...>, Writes<Ws...>, F&& fn)
+	{
+		System system{ std::move(name), std::function<void(ECS&)>(std::forward<F>(fn)), makeAccess<Rs..., Ws...>(), makeAccess<Ws...>(), {}, 0 };
+
+		/* Edges only point from earlier to later systems, so the graph can't have cycles */
+		for (SystemID other = 0; other < systems.size(); other++)
+		{
+			if (!conflicts(systems[other], system)) continue;
+			system.dependencies.push_back(other);
+			system.wave = std::max(system.wave, systems[other].wave + 1);
+		}
+
+		systems.push_back(std::move(system));
+		waves_dirty = true;
+		return SystemID(systems.size() - 1);
+	}
+
+	template <typename handle_t, typename... Ts>
+	void SystemScheduler<ECSManager<handle_t, Ts...>>::Run(ECS& ecs, ThreadPool& pool)
+	{
+		if (waves_dirty) buildWaves();
+
+		timings.resize(systems.size());
+		const Clock::time_point frame_start = Clock::now();
+		const auto since_start = [&](Clock::time_point time) { return std::chrono::duration<double, std::micro>(time - frame_start).count(); };
+
+		for (const std::vector<SystemID>& wave : waves)
+		{
+			pool.ParallelFor(uint32_t(wave.size()), [&](uint32_t task_index)
+				{
+					const SystemID id = wave[task_index];
+					const Clock::time_point start = Clock::now();
+					systems[id].fn(ecs);
+					const Clock::time_point end = Clock::now();
+					timings[id] = { id, systems[id].wave, since_start(start), since_start(end) - since_start(start), false };
+				});
+		}
+
+		frame_us = since_start(Clock::now());
+		findCriticalPath();
+	}
+
+	template <typename handle_t, typename... Ts>
+	uint32_t SystemScheduler<ECSManager<handle_t, Ts...>>::WaveCount()
+	{
+		if (waves_dirty) buildWaves();
+		return uint32_t(waves.size());
+	}
+
+	template <typename handle_t, typename... Ts>
+	void SystemScheduler<ECSManager<handle_t, Ts...>>::PrintTimings(std::FILE* out) const
+	{
+		std::fprintf(out, "%-32s %6s %12s %12s\n", "System", "Wave", "Start us", "Duration us");
+		for (const SystemTiming& timing : timings)
+		{
+			std::fprintf(out, "%-32s %6" PRIu32 " %12.1f %12.1f %s\n", Name(timing.system).c_str(), timing.wave, timing.start_us, timing.duration_us, timing.on_critical_path ? "*" : "");
+		}
+		std::fprintf(out, "Frame %.1f us, critical path %.1f us\n", frame_us, critical_path_us);
+	}
+
+	template <typename handle_t, typename... Ts>
+	void SystemScheduler<ECSManager<handle_t, Ts...>>::buildWaves()
+	{
+		waves.clear();
+		for (SystemID id = 0; id < systems.size(); id++)
+		{
+			if (systems[id].wave >= waves.size()) waves.resize(systems[id].wave + 1);
+			waves[systems[id].wave].push_back(id);
+		}
+		waves_dirty = false;
+	}
+
+	/* Longest chain of dependencies weighted by the measured durations, walked back from its last system */
+	template <typename handle_t, typename... Ts>
+	void SystemScheduler<ECSManager<handle_t, Ts...>>::findCriticalPath()
+	{
+		critical_path_us = 0.0;
+		if (systems.empty()) return;
+
+		std::vector<double> path_us(systems.size());
+		std::vector<SystemID> previous(systems.size());
+		SystemID last = 0;
+		for (SystemID id = 0; id < systems.size(); id++)
+		{
+			double longest_dependency = 0.0;
+			previous[id] = id;
+			for (const SystemID dependency : systems[id].dependencies)
+			{
+				if (path_us[dependency] <= longest_dependency) continue;
+				longest_dependency = path_us[dependency];
+				previous[id] = dependency;
+			}
+			path_us[id] = longest_dependency + timings[id].duration_us;
+			if (path_us[id] > path_us[last]) last = id;
+		}
+
+		critical_path_us = path_us[last];
+		for (SystemID id = last; ; id = previous[id])
+		{
+			timings[id].on_critical_path = true;
+			if (previous[id] == id) break;
+		}
+	}
+}
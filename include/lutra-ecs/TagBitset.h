@@ -0,0 +1,361 @@
+#pragma once
+#include <lutra-ecs/ContainerStats.h>
+#include <lutra-ecs/Handle.h>
+#include <lutra-ecs/HandleFreeList.h>
+#include <lutra-ecs/Snapshot.h>
+#include <array>
+#include <bit>
+#include <cassert>
+#include <cinttypes>
+#include <iterator>
+#include <memory_resource>
+#include <span>
+#include <vector>
+
+namespace lcs
+{
+	/* Tag storage with one bit per entity index, plus a summary bit per 64 bit word that is set while the word is not empty.
+	 * Costs an eighth of a byte per entity index instead of an index and a handle per tagged entity,
+	 * and lets queries over several tags combine whole words and skip 4096 empty entity indices per summary word.
+	 * Only indices are stored, handles are restored from the HandleFreeList of the manager. */
+	template <typename handle_t>
+	class TagBitset
+	{
+	public:
+		using data_t = handle_t::data_t;
+		using word_t = uint64_t;
+		static constexpr data_t word_bits = 64;
+
+		TagBitset() {};
+		explicit TagBitset(std::pmr::memory_resource* resource) : words(resource), summary(resource), dirty(resource) {};
+
+		inline void Add(handle_t handle);
+		inline void Remove(handle_t handle);
+		inline void RemoveMany(std::span<const handle_t> handles);
+		inline void RemoveIfPresent(handle_t handle) { if (Has(handle)) Remove(handle); };
+		inline bool Has(handle_t handle) const;
+
+		inline data_t SparseSize() const { return data_t(words.size()) * word_bits; };
+		inline size_t SparseMemoryUsage() const { return (words.capacity() + summary.capacity()) * sizeof(word_t); };
+		inline data_t Size() const { return tag_count; };
+		inline ContainerStats Stats() const;
+
+		/* Word level access for queries, word i holds entity indices [64 * i, 64 * i + 64) */
+		inline std::span<const word_t> Words() const { return words; };
+		inline std::span<const word_t> SummaryWords() const { return summary; };
+
+		inline void ReserveSparseSize(data_t new_size);
+		inline void Clear();
+
+		inline void Save(SnapshotWriter& writer) const;
+		inline void Load(SnapshotReader& reader);
+		/* Stores the words written since the last snapshot, a block of 64 words shares one summary word */
+		inline void SaveDelta(SnapshotWriter& writer);
+		inline void LoadDelta(SnapshotReader& reader);
+		inline void ResetDirty() { dirty.Reset(); };
+
+	private:
+		/* Whether the summary bits are exactly the non-empty words and tag_count counts the bits, checked on load */
+		inline bool hasValidIndices() const;
+
+		std::pmr::vector<word_t> words;
+		std::pmr::vector<word_t> summary;
+		data_t tag_count{ 0 };
+		DirtyBlocks<word_bits> dirty; /* Over words */
+	};
+
+	/* Templated version for specific tags */
+	template <typename handle_t, typename T>
+	class TagBitsetT : public TagBitset<handle_t>
+	{
+	public:
+		using TagBitset<handle_t>::TagBitset;
+	};
+
+	template <typename handle_t>
+	void TagBitset<handle_t>::Add(handle_t handle)
+	{
+		const auto handle_index = handle.GetIndex();
+		assert(handle_index < SparseSize()); /* Invalid index or missing reservation */
+		assert(!Has(handle));
+
+		const data_t word_index = handle_index / word_bits;
+		words[word_index] |= word_t(1) << (handle_index % word_bits);
+		summary[word_index / word_bits] |= word_t(1) << (word_index % word_bits);
+		dirty.Mark(word_index);
+		tag_count++;
+	}
+
+	template <typename handle_t>
+	void TagBitset<handle_t>::Remove(handle_t handle)
+	{
+		assert(Has(handle));
+		const auto handle_index = handle.GetIndex();
+		const data_t word_index = handle_index / word_bits;
+		word_t& word = words[word_index];
+		word &= ~(word_t(1) << (handle_index % word_bits));
+		if (word == 0) summary[word_index / word_bits] &= ~(word_t(1) << (word_index % word_bits));
+		dirty.Mark(word_index);
+		tag_count--;
+	}
+
+	template <typename handle_t>
+	void TagBitset<handle_t>::RemoveMany(std::span<const handle_t> handles)
+	{
+		for (const handle_t handle : handles) Remove(handle);
+	}
+
+	template <typename handle_t>
+	bool TagBitset<handle_t>::Has(handle_t handle) const
+	{
+		const auto handle_index = handle.GetIndex();
+		assert(handle_index < SparseSize());
+		return (words[handle_index / word_bits] >> (handle_index % word_bits)) & 1;
+	}
+
+	template <typename handle_t>
+	void TagBitset<handle_t>::ReserveSparseSize(data_t new_size)
+	{
+		const size_t word_count = (size_t(new_size) + word_bits - 1) / word_bits;
+		if (word_count <= words.size()) return;
+		words.resize(word_count, 0);
+		summary.resize((word_count + word_bits - 1) / word_bits, 0);
+	}
+
+	template <typename handle_t>
+	void TagBitset<handle_t>::Clear()
+	{
+		words.clear();
+		summary.clear();
+		tag_count = 0;
+		dirty.MarkCleared();
+	}
+
+	template <typename handle_t>
+	ContainerStats TagBitset<handle_t>::Stats() const
+	{
+		const size_t bytes = internal_ecs::CapacityBytes(words) + internal_ecs::CapacityBytes(summary) + dirty.MemoryUsage();
+		return { tag_count, SparseSize(), bytes, internal_ecs::FillRatio(tag_count, SparseSize()), 0 };
+	}
+
+	template <typename handle_t>
+	bool TagBitset<handle_t>::hasValidIndices() const
+	{
+		size_t bit_count = 0;
+		for (size_t summary_index = 0; summary_index < summary.size(); summary_index++)
+		{
+			word_t non_empty = 0;
+			for (size_t word_index = summary_index * word_bits; word_index < words.size() && word_index < (summary_index + 1) * word_bits; word_index++)
+			{
+				non_empty |= word_t(words[word_index] != 0) << (word_index % word_bits);
+				bit_count += size_t(std::popcount(words[word_index]));
+			}
+			if (non_empty != summary[summary_index]) return false;
+		}
+		return bit_count == tag_count;
+	}
+
+	template <typename handle_t>
+	void TagBitset<handle_t>::Save(SnapshotWriter& writer) const
+	{
+		writer.WriteArray(std::span<const word_t>(words));
+		writer.WriteArray(std::span<const word_t>(summary));
+		writer.Write(tag_count);
+	}
+
+	template <typename handle_t>
+	void TagBitset<handle_t>::Load(SnapshotReader& reader)
+	{
+		reader.ReadArray(words);
+		reader.ReadArray(summary);
+		tag_count = reader.Read<data_t>();
+		if (summary.size() != (words.size() + word_bits - 1) / word_bits || !hasValidIndices()) reader.Fail();
+	}
+
+	template <typename handle_t>
+	void TagBitset<handle_t>::SaveDelta(SnapshotWriter& writer)
+	{
+		writer.WriteDirty(std::span<const word_t>(words), dirty);
+		writer.WriteDirty(std::span<const word_t>(summary), dirty, 1);
+		writer.Write(tag_count);
+		dirty.Reset();
+	}
+
+	template <typename handle_t>
+	void TagBitset<handle_t>::LoadDelta(SnapshotReader& reader)
+	{
+		reader.ReadDirty(words, internal_ecs::max_snapshot_entries<handle_t>);
+		reader.ReadDirty(summary, internal_ecs::max_snapshot_entries<handle_t>);
+		tag_count = reader.Read<data_t>();
+		if (summary.size() != (words.size() + word_bits - 1) / word_bits || !hasValidIndices()) reader.Fail();
+	}
+
+	/* Entities having every tag of the all sets, at least one tag of the any sets if there are any, and none of the tags of the none sets.
+	 * Each step combines a word of every set with AND, OR and ANDNOT, the summaries of the all and any sets skip runs of empty words. */
+	template <typename handle_t, size_t all_count, size_t none_count, size_t any_count = 0>
+	class TagQuery
+	{
+		static_assert(all_count + any_count > 0, "A query needs at least one required tag");
+
+		using data_t = handle_t::data_t;
+		using word_t = TagBitset<handle_t>::word_t;
+		static constexpr data_t word_bits = TagBitset<handle_t>::word_bits;
+
+	public:
+		TagQuery(const HandleFreeList<handle_t>& entities, std::array<const TagBitset<handle_t>*, all_count> all_sets, std::array<const TagBitset<handle_t>*, none_count> none_sets,
+			std::array<const TagBitset<handle_t>*, any_count> any_sets = {})
+			: entities(&entities), all_sets(all_sets), none_sets(none_sets), any_sets(any_sets)
+		{
+#ifndef NDEBUG
+			/* Sets must cover the same entity indices */
+			for (const auto* set : none_sets) assert(set->Words().size() == wordCount());
+			for (const auto* set : all_sets) assert(set->Words().size() == wordCount());
+			for (const auto* set : any_sets) assert(set->Words().size() == wordCount());
+#endif
+		};
+
+		/* Matching entity indices of word word_index */
+		inline word_t Word(size_t word_index) const;
+
+		/* Calls fn(size_t word_index, word_t bits) for every word with at least one match */
+		template <typename F>
+		inline void ForEachWord(F&& fn) const;
+
+		inline data_t Count() const;
+
+		class Iterator
+		{
+		public:
+			using iterator_category = std::forward_iterator_tag;
+			using value_type = handle_t;
+			using difference_type = std::ptrdiff_t;
+			using pointer = handle_t*;
+			using reference = handle_t&;
+
+			inline handle_t operator*() const { return query->entities->GetHandle(data_t(word_index * word_bits + std::countr_zero(current))); }
+
+			inline Iterator& operator++();
+			inline Iterator operator++(int) { Iterator tmp = *this; ++(*this); return tmp; }
+
+			friend bool operator== (const Iterator& a, const Iterator& b) { return a.word_index == b.word_index && a.current == b.current; };
+			friend bool operator!= (const Iterator& a, const Iterator& b) { return !(a == b); };
+
+		private:
+			inline Iterator(const TagQuery* query, size_t word_index) : query(query), word_index(word_index) {};
+
+			/* Moves to the first word at or after word_index with a match */
+			inline void seek();
+
+			const TagQuery* query;
+			size_t word_index;
+			word_t current{ 0 };
+
+			friend class TagQuery;
+		};
+
+		inline Iterator begin() const { Iterator it(this, 0); it.seek(); return it; };
+		inline Iterator end() const { return Iterator(this, wordCount()); };
+
+	private:
+		inline const TagBitset<handle_t>* firstSet() const { if constexpr (all_count > 0) return all_sets[0]; else return any_sets[0]; };
+		inline size_t wordCount() const { return firstSet()->Words().size(); };
+
+		/* Words that may hold a match, from the summaries of the all and any sets */
+		inline word_t summaryWord(size_t summary_index) const;
+
+		/* First word at or after word_index that may hold a match, wordCount() if there is none */
+		inline size_t nextCandidate(size_t word_index) const;
+
+		const HandleFreeList<handle_t>* entities;
+		std::array<const TagBitset<handle_t>*, all_count> all_sets;
+		std::array<const TagBitset<handle_t>*, none_count> none_sets;
+		std::array<const TagBitset<handle_t>*, any_count> any_sets;
+	};
+
+	template <typename handle_t, size_t all_count, size_t none_count, size_t any_count>
+	TagQuery<handle_t, all_count, none_count, any_count>::word_t TagQuery<handle_t, all_count, none_count, any_count>::Word(size_t word_index) const
+	{
+		word_t bits = ~word_t(0);
+		for (size_t i = 0; i < all_count; i++) bits &= all_sets[i]->Words()[word_index];
+		if constexpr (any_count > 0)
+		{
+			word_t any_bits = 0;
+			for (size_t i = 0; i < any_count; i++) any_bits |= any_sets[i]->Words()[word_index];
+			bits &= any_bits;
+		}
+		for (size_t i = 0; i < none_count; i++) bits &= ~none_sets[i]->Words()[word_index];
+		return bits;
+	}
+
+	template <typename handle_t, size_t all_count, size_t none_count, size_t any_count>
+	TagQuery<handle_t, all_count, none_count, any_count>::word_t TagQuery<handle_t, all_count, none_count, any_count>::summaryWord(size_t summary_index) const
+	{
+		word_t bits = ~word_t(0);
+		for (size_t i = 0; i < all_count; i++) bits &= all_sets[i]->SummaryWords()[summary_index];
+		if constexpr (any_count > 0)
+		{
+			word_t any_bits = 0;
+			for (size_t i = 0; i < any_count; i++) any_bits |= any_sets[i]->SummaryWords()[summary_index];
+			bits &= any_bits;
+		}
+		return bits;
+	}
+
+	template <typename handle_t, size_t all_count, size_t none_count, size_t any_count>
+	size_t TagQuery<handle_t, all_count, none_count, any_count>::nextCandidate(size_t word_index) const
+	{
+		const size_t word_count = wordCount();
+		if (word_index >= word_count) return word_count;
+
+		size_t summary_index = word_index / word_bits;
+		word_t candidates = summaryWord(summary_index) & (~word_t(0) << (word_index % word_bits));
+		const size_t summary_count = firstSet()->SummaryWords().size();
+		while (candidates == 0)
+		{
+			if (++summary_index == summary_count) return word_count;
+			candidates = summaryWord(summary_index);
+		}
+		return summary_index * word_bits + std::countr_zero(candidates);
+	}
+
+	template <typename handle_t, size_t all_count, size_t none_count, size_t any_count> template <typename F>
+	void TagQuery<handle_t, all_count, none_count, any_count>::ForEachWord(F&& fn) const
+	{
+		for (size_t word_index = nextCandidate(0); word_index < wordCount(); word_index = nextCandidate(word_index + 1))
+		{
+			const word_t bits = Word(word_index);
+			if (bits != 0) fn(word_index, bits);
+		}
+	}
+
+	template <typename handle_t, size_t all_count, size_t none_count, size_t any_count>
+	TagQuery<handle_t, all_count, none_count, any_count>::data_t TagQuery<handle_t, all_count, none_count, any_count>::Count() const
+	{
+		data_t count = 0;
+		ForEachWord([&](size_t, word_t bits) { count += data_t(std::popcount(bits)); });
+		return count;
+	}
+
+	template <typename handle_t, size_t all_count, size_t none_count, size_t any_count>
+	TagQuery<handle_t, all_count, none_count, any_count>::Iterator& TagQuery<handle_t, all_count, none_count, any_count>::Iterator::operator++()
+	{
+		current &= current - 1;
+		if (current == 0)
+		{
+			word_index++;
+			seek();
+		}
+		return *this;
+	}
+
+	template <typename handle_t, size_t all_count, size_t none_count, size_t any_count>
+	void TagQuery<handle_t, all_count, none_count, any_count>::Iterator::seek()
+	{
+		for (word_index = query->nextCandidate(word_index); word_index < query->wordCount(); word_index = query->nextCandidate(word_index + 1))
+		{
+			current = query->Word(word_index);
+			if (current != 0) return;
+		}
+		current = 0;
+	}
+}
@@ -0,0 +1,226 @@
+#pragma once
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cinttypes>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace lcs
+{
+	/* Work-stealing thread pool.
+	 * Every worker owns a task queue, pops work from its back and steals from the front of the other queues.
+	 * The thread calling ParallelFor takes part in the work until all of its tasks are done. */
+	class ThreadPool
+	{
+	public:
+		inline explicit ThreadPool(uint32_t worker_count = DefaultWorkerCount());
+		inline ~ThreadPool();
+
+		ThreadPool(const ThreadPool&) = delete;
+		ThreadPool& operator=(const ThreadPool&) = delete;
+
+		/* Runs fn(task_index) for every task_index in [0, task_count) and returns when all have finished.
+		 * A task that throws does not stop the others; the first exception is rethrown on the calling thread once they are done. */
+		template <typename F>
+		inline void ParallelFor(uint32_t task_count, F&& fn);
+
+		inline uint32_t WorkerCount() const { return uint32_t(workers.size()); };
+
+		inline static uint32_t DefaultWorkerCount() { return std::max(std::thread::hardware_concurrency(), 1u) - 1; };
+		inline static ThreadPool& Default() { static ThreadPool pool{}; return pool; };
+
+	private:
+		struct Job
+		{
+			void (*invoke)(void* context, uint32_t task_index);
+			void* context;
+			std::atomic<uint32_t> remaining_tasks;
+			std::atomic_flag failed{};
+			std::exception_ptr error{};
+		};
+
+		struct Task
+		{
+			Job* job;
+			uint32_t task_index;
+		};
+
+		struct WorkQueue
+		{
+			std::mutex mutex{};
+			std::deque<Task> tasks{};
+		};
+
+		inline void workerLoop(uint32_t queue_index);
+		inline bool tryRunTask(uint32_t queue_index);
+		inline bool tryPop(uint32_t queue_index, Task& task);
+		inline bool trySteal(uint32_t queue_index, Task& task);
+		inline uint32_t currentQueueIndex() const;
+
+		/* One queue per worker plus a shared one for threads outside the pool */
+		std::vector<std::unique_ptr<WorkQueue>> queues{};
+		std::vector<std::thread> workers{};
+
+		std::mutex sleep_mutex{};
+		std::condition_variable wake_condition{};
+		std::atomic<uint32_t> queued_task_count{ 0 };
+		bool stopping{ false };
+
+		inline static thread_local const ThreadPool* current_pool{ nullptr };
+		inline static thread_local uint32_t current_queue_index{ 0 };
+	};
+
+	ThreadPool::ThreadPool(uint32_t worker_count)
+	{
+		for (uint32_t i = 0; i < worker_count + 1; i++)
+		{
+			queues.push_back(std::make_unique<WorkQueue>());
+		}
+		for (uint32_t i = 0; i < worker_count; i++)
+		{
+			workers.emplace_back([this, i]() { workerLoop(i); });
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex);
+			stopping = true;
+		}
+		wake_condition.notify_all();
+		for (std::thread& worker : workers)
+		{
+			worker.join();
+		}
+	}
+
+	template <typename F>
+	void ThreadPool::ParallelFor(uint32_t task_count, F&& fn)
+	{
+		if (task_count == 0) return;
+		if (task_count == 1 || workers.empty())
+		{
+			std::exception_ptr error{};
+			for (uint32_t i = 0; i < task_count; i++)
+			{
+				try
+				{
+					fn(i);
+				}
+				catch (...)
+				{
+					if (!error) error = std::current_exception();
+				}
+			}
+			if (error) std::rethrow_exception(error);
+			return;
+		}
+
+		using Fn = std::remove_reference_t<F>;
+		Job job{ [](void* context, uint32_t task_index) { (*static_cast<Fn*>(context))(task_index); }, (void*)&fn, task_count };
+
+		{
+			std::lock_guard<std::mutex> lock(sleep_mutex);
+			queued_task_count += task_count;
+		}
+
+		/* Hand out contiguous blocks of tasks so neighbouring tasks start on the same thread */
+		const uint32_t queue_count = uint32_t(queues.size());
+		const uint32_t tasks_per_queue = (task_count + queue_count - 1) / queue_count;
+		for (uint32_t queue_index = 0; queue_index < queue_count; queue_index++)
+		{
+			const uint32_t first_task = queue_index * tasks_per_queue;
+			const uint32_t last_task = std::min(first_task + tasks_per_queue, task_count);
+			if (first_task >= last_task) break;
+
+			WorkQueue& queue = *queues[queue_index];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			for (uint32_t task_index = last_task; task_index > first_task; task_index--)
+			{
+				queue.tasks.push_back({ &job, task_index - 1 });
+			}
+		}
+		wake_condition.notify_all();
+
+		const uint32_t queue_index = currentQueueIndex();
+		while (job.remaining_tasks.load(std::memory_order_acquire) > 0)
+		{
+			if (!tryRunTask(queue_index)) std::this_thread::yield();
+		}
+		if (job.error) std::rethrow_exception(job.error);
+	}
+
+	void ThreadPool::workerLoop(uint32_t queue_index)
+	{
+		current_pool = this;
+		current_queue_index = queue_index;
+
+		while (true)
+		{
+			if (tryRunTask(queue_index)) continue;
+
+			std::unique_lock<std::mutex> lock(sleep_mutex);
+			wake_condition.wait(lock, [this]() { return stopping || queued_task_count.load() > 0; });
+			if (stopping) return;
+		}
+	}
+
+	bool ThreadPool::tryRunTask(uint32_t queue_index)
+	{
+		Task task{};
+		if (!tryPop(queue_index, task) && !trySteal(queue_index, task)) return false;
+
+		queued_task_count--;
+		try
+		{
+			task.job->invoke(task.job->context, task.task_index);
+		}
+		catch (...)
+		{
+			/* The job lives on its caller's stack, so the exception has to wait there until every task is done */
+			if (!task.job->failed.test_and_set(std::memory_order_relaxed)) task.job->error = std::current_exception();
+		}
+		task.job->remaining_tasks.fetch_sub(1, std::memory_order_release);
+		return true;
+	}
+
+	bool ThreadPool::tryPop(uint32_t queue_index, Task& task)
+	{
+		WorkQueue& queue = *queues[queue_index];
+		std::lock_guard<std::mutex> lock(queue.mutex);
+		if (queue.tasks.empty()) return false;
+		task = queue.tasks.back();
+		queue.tasks.pop_back();
+		return true;
+	}
+
+	bool ThreadPool::trySteal(uint32_t queue_index, Task& task)
+	{
+		const uint32_t queue_count = uint32_t(queues.size());
+		for (uint32_t offset = 1; offset < queue_count; offset++)
+		{
+			WorkQueue& queue = *queues[(queue_index + offset) % queue_count];
+			std::lock_guard<std::mutex> lock(queue.mutex);
+			if (queue.tasks.empty()) continue;
+			task = queue.tasks.front();
+			queue.tasks.pop_front();
+			return true;
+		}
+		return false;
+	}
+
+	uint32_t ThreadPool::currentQueueIndex() const
+	{
+		if (current_pool == this) return current_queue_index;
+		return uint32_t(queues.size()) - 1;
+	}
+}
@@ -0,0 +1,26 @@
+#pragma once
+#include <cstddef>
+#include <tuple>
+#include <type_traits>
+
+namespace lcs
+{
+	namespace internal_ecs
+	{
+		/* Index of T in Ts */
+		template <typename T, typename... Ts>
+		struct IndexOf;
+
+		template <typename T, typename... Ts>
+		struct IndexOf<T, T, Ts...> : std::integral_constant<size_t, 0> {};
+
+		template <typename T, typename U, typename... Ts>
+		struct IndexOf<T, U, Ts...> : std::integral_constant<size_t, 1 + IndexOf<T, Ts...>::value> {};
+
+		template <typename T, typename... Ts>
+		constexpr size_t index_of = IndexOf<T, Ts...>::value;
+
+		template <typename T, typename... Ts>
+		constexpr bool contains = (std::is_same_v<T, Ts> || ...);
+	}
+}
@@ -1,16 +1,35 @@
 #pragma once
+#include <lutra-ecs/ArchetypeStorage.h>
 #include <lutra-ecs/SparseSet.h>
+#include <lutra-ecs/SparseSetChunked.h>
+#include <lutra-ecs/SparseSetSoA.h>
 #include <lutra-ecs/SparseTagSet.h>
+#include <lutra-ecs/TagBitset.h>
+#include <lutra-ecs/ThreadPool.h>
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <span>
+#include <tuple>
+#include <type_traits>
 #include <utility>
 
 namespace lcs
 {
 	enum class ComponentType
 	{
-		Component, ComponentChunked, Tag
+		Component, ComponentChunked, Tag, Archetype, SoA, TagBitset
 	};
 
+	/* Excluded tags of ECSManager::QueryTags */
+	template <typename... Ts>
+	struct Exclude {};
+
+	/* Tags of ECSManager::QueryTags of which an entity needs at least one */
+	template <typename... Ts>
+	struct AnyOf {};
+
 	namespace internal_ecs
 	{
 		template <typename EntityID, typename T, ComponentType type>
@@ -33,12 +52,94 @@ namespace lcs
 		{
 			using Container = SparseTagSetT<EntityID, T>;
 		};
+
+		template <typename EntityID, typename T>
+		struct GetComponentContainer<EntityID, T, ComponentType::SoA>
+		{
+			using Container = SparseSetSoA<EntityID, T>;
+		};
+
+		template <typename EntityID, typename T>
+		struct GetComponentContainer<EntityID, T, ComponentType::TagBitset>
+		{
+			using Container = TagBitsetT<EntityID, T>;
+		};
+
+		template <typename T>
+		constexpr bool is_tag = T::component_type == ComponentType::Tag || T::component_type == ComponentType::TagBitset;
+
+		/* Container of T, views over const T use the container of T */
+		template <typename EntityID, typename T>
+		using ComponentContainer = typename GetComponentContainer<EntityID, std::remove_const_t<T>, T::component_type>::Container;
+
+		template <typename P>
+		struct ConstPointer;
+
+		template <typename T>
+		struct ConstPointer<T*>
+		{
+			using Pointer = const T*;
+		};
+
+		template <typename T>
+		struct ConstPointer<SoAPtr<T>>
+		{
+			using Pointer = SoAPtr<const T>;
+		};
+
+		/* What the container of T hands out for a component: T* and T&, or proxies for SoA storage. Read-only ones for const T */
+		template <typename EntityID, typename T, typename Pointer = decltype(std::declval<ComponentContainer<EntityID, T>&>().TryGet(std::declval<EntityID>()))>
+		using ComponentPointer = std::conditional_t<std::is_const_v<T>, typename ConstPointer<Pointer>::Pointer, Pointer>;
+
+		template <typename EntityID, typename T>
+		using ComponentReference = decltype(*std::declval<ComponentPointer<EntityID, T>>());
+
+		/* Archetype components share a single ArchetypeStorage, all others get a container each */
+		template <typename EntityID, typename T, bool is_archetype = (T::component_type == ComponentType::Archetype)>
+		struct GetContainerTuple
+		{
+			using Tuple = std::tuple<typename GetComponentContainer<EntityID, T, T::component_type>::Container>;
+		};
+
+		template <typename EntityID, typename T>
+		struct GetContainerTuple<EntityID, T, true>
+		{
+			using Tuple = std::tuple<>;
+		};
+
+		template <typename EntityID, typename... Ts>
+		struct GetComponentSets
+		{
+			using Sets = decltype(std::tuple_cat(std::declval<typename GetContainerTuple<EntityID, Ts>::Tuple>()...));
+		};
+
+		template <typename S, typename... Ts>
+		struct GetArchetypeStorageImpl
+		{
+			using Storage = S;
+		};
+
+		template <typename EntityID, typename... As, typename T, typename... Ts>
+		struct GetArchetypeStorageImpl<ArchetypeStorage<EntityID, As...>, T, Ts...>
+		{
+			using Next = std::conditional_t<T::component_type == ComponentType::Archetype, ArchetypeStorage<EntityID, As..., T>, ArchetypeStorage<EntityID, As...>>;
+			using Storage = GetArchetypeStorageImpl<Next, Ts...>::Storage;
+		};
+
+		template <typename EntityID, typename... Ts>
+		struct GetArchetypeStorage
+		{
+			using Storage = GetArchetypeStorageImpl<ArchetypeStorage<EntityID>, Ts...>::Storage;
+		};
 	}
 
+	/* View over every entity having T, which is marked and stamped as written. Views over const T hand out read-only components
+	 * and mark nothing */
 	template <typename EntityID, typename T>
 	class ComponentView
 	{
-		using SetType = typename internal_ecs::GetComponentContainer<EntityID, T, T::component_type>::Container;
+		using SetType = internal_ecs::ComponentContainer<EntityID, T>;
+		using Reference = internal_ecs::ComponentReference<EntityID, T>;
 
 	public:
 		ComponentView(SetType& set) : set(set) {};
@@ -53,14 +154,14 @@ namespace lcs
 			class ArrowHelper
 			{
 			public:
-				inline ArrowHelper(EntityID id, T& c) : p(std::pair<EntityID, T&>(id, c)) {};
-				inline std::pair<EntityID, T&>* operator->() { return &p; };
+				inline ArrowHelper(EntityID id, Reference c) : p(std::pair<EntityID, Reference>(id, c)) {};
+				inline std::pair<EntityID, Reference>* operator->() { return &p; };
 			private:
-				std::pair<EntityID, T&> p;
+				std::pair<EntityID, Reference> p;
 			};
 
 			/* Accessors */
-			inline std::pair<EntityID, T&> operator*(){ return std::pair<EntityID, T&>(set_iterator.GetOwner(), *set_iterator); }
+			inline std::pair<EntityID, Reference> operator*(){ return std::pair<EntityID, Reference>(set_iterator.GetOwner(), *set_iterator); }
 			inline ArrowHelper operator->() { return ArrowHelper(set_iterator.GetOwner(), *set_iterator); }
 
 			/* Prefix increment */
@@ -84,7 +185,11 @@ namespace lcs
 	};
 
 	template <typename EntityID, typename T>
-	inline ComponentView<EntityID, T>::Iterator ComponentView<EntityID, T>::begin() { return ComponentView<EntityID, T>::Iterator(set.begin()); };
+	inline ComponentView<EntityID, T>::Iterator ComponentView<EntityID, T>::begin()
+	{
+		if constexpr (!std::is_const_v<T>) set.MarkAllChanged(); /* Every entry is handed out mutably */
+		return ComponentView<EntityID, T>::Iterator(set.begin());
+	};
 
 	template <typename EntityID, typename T>
 	inline ComponentView<EntityID, T>::Iterator ComponentView<EntityID, T>::end() { return ComponentView<EntityID, T>::Iterator(set.end()); };
@@ -140,4 +245,627 @@ namespace lcs
 
 	template <typename EntityID, typename T>
 	inline TagView<EntityID, T>::Iterator TagView<EntityID, T>::end() { return TagView<EntityID, T>::Iterator(set.end()); };
+
+	namespace internal_ecs
+	{
+		/* Bitset tags are walked as a query over a single tag */
+		template <typename EntityID, typename T>
+		using GetTagView = std::conditional_t<T::component_type == ComponentType::TagBitset, TagQuery<EntityID, 1, 0>, TagView<EntityID, T>>;
+	}
+}
+
+namespace lcs
+{
+	namespace internal_ecs
+	{
+		/* Calls f.template operator()<I>() for the I in [0, N) equal to index */
+		template <size_t N, typename F>
+		inline void VisitIndex(size_t index, F&& f)
+		{
+			[&]<size_t... I>(std::index_sequence<I...>) { ((index == I ? (f.template operator()<I>(), true) : false) || ...); }(std::make_index_sequence<N>{});
+		}
+
+		/* Splits the dense range of a set into tasks of grain_size entries and calls f(owner, component pointer) for every entry */
+		template <typename handle_t, typename T, typename F>
+		inline void ParallelForEachEntry(SparseSet<handle_t, T>& set, uint32_t grain_size, ThreadPool& pool, F&& f)
+		{
+			assert(grain_size > 0);
+			const uint32_t entry_count = uint32_t(set.DenseSize());
+			const uint32_t task_count = entry_count / grain_size + (entry_count % grain_size != 0);
+			pool.ParallelFor(task_count, [&](uint32_t task_index)
+				{
+					const std::span<T> data = set.DenseData();
+					const std::span<const handle_t> owners = set.DenseOwners();
+					const uint32_t first_entry = task_index * grain_size;
+					const uint32_t last_entry = first_entry + std::min(grain_size, entry_count - first_entry);
+					for (uint32_t i = first_entry; i < last_entry; i++)
+					{
+						f(owners[i], &data[i]);
+					}
+				});
+		}
+
+		template <typename handle_t, typename T, typename F>
+		inline void ParallelForEachEntry(SparseSetSoA<handle_t, T>& set, uint32_t grain_size, ThreadPool& pool, F&& f)
+		{
+			assert(grain_size > 0);
+			const uint32_t entry_count = uint32_t(set.DenseSize());
+			const uint32_t task_count = entry_count / grain_size + (entry_count % grain_size != 0);
+			pool.ParallelFor(task_count, [&](uint32_t task_index)
+				{
+					const std::span<const handle_t> owners = set.DenseOwners();
+					const uint32_t first_entry = task_index * grain_size;
+					const uint32_t last_entry = first_entry + std::min(grain_size, entry_count - first_entry);
+					for (uint32_t i = first_entry; i < last_entry; i++)
+					{
+						f(owners[i], set.DenseEntry(i));
+					}
+				});
+		}
+
+		/* Splits the chunk list of a set into tasks covering roughly grain_size entries */
+		template <typename handle_t, typename T, uint32_t chunk_width, typename F>
+		inline void ParallelForEachEntry(SparseSetChunked<handle_t, T, chunk_width>& set, uint32_t grain_size, ThreadPool& pool, F&& f)
+		{
+			using SetType = SparseSetChunked<handle_t, T, chunk_width>;
+			const uint32_t chunks_per_task = std::max(grain_size / uint32_t(SetType::entries_per_chunk), 1u);
+			const uint32_t chunk_count = uint32_t(set.ChunkCount());
+			const uint32_t task_count = chunk_count / chunks_per_task + (chunk_count % chunks_per_task != 0);
+			pool.ParallelFor(task_count, [&](uint32_t task_index)
+				{
+					const uint32_t first_chunk = task_index * chunks_per_task;
+					const uint32_t last_chunk = first_chunk + std::min(chunks_per_task, chunk_count - first_chunk);
+					for (uint32_t chunk_index = first_chunk; chunk_index < last_chunk; chunk_index++)
+					{
+						auto& chunk = set.GetChunk(chunk_index);
+						const auto& owners = set.GetInverseHandleChunk(chunk_index);
+						for (const auto data_index : set.GetOccupancyMask(chunk_index))
+						{
+							f(owners[data_index], &chunk[data_index]);
+						}
+					}
+				});
+		}
+	}
+
+	/* View over all entities having every component in Ts.
+	 * The smallest container drives the iteration, the others are probed once per candidate.
+	 * Every match marks and stamps its components as written, except those listed as const which are handed out read-only. */
+	template <typename EntityID, typename... Ts>
+	class JoinedView
+	{
+		static_assert(sizeof...(Ts) > 0);
+		static_assert(((!internal_ecs::is_tag<Ts>) && ...), "Use TView or QueryTags for tags");
+		static_assert(((Ts::component_type != ComponentType::Archetype) && ...), "Archetype components can only be joined with other archetype components");
+
+		template <typename T>
+		using SetType = internal_ecs::ComponentContainer<EntityID, T>;
+		template <typename T>
+		using Pointer = internal_ecs::ComponentPointer<EntityID, T>;
+		template <typename T>
+		using Reference = internal_ecs::ComponentReference<EntityID, T>;
+		using Indices = std::index_sequence_for<Ts...>;
+
+	public:
+		JoinedView(SetType<Ts>&... sets) : sets(&sets...)
+		{
+			selectDriver(Indices{});
+		};
+
+		class Iterator
+		{
+		public:
+			/* Accessors */
+			inline std::tuple<EntityID, Reference<Ts>...> operator*() const { return dereference(Indices{}); }
+
+			inline EntityID GetOwner() const { return owner; }
+
+			/* Prefix increment */
+			inline Iterator& operator++() { internal_ecs::VisitIndex<sizeof...(Ts)>(driver, [this]<size_t D>() { ++std::get<D>(cursors); skipToMatch<D>(); }); return *this; }
+
+			/* Postfix increment */
+			inline Iterator operator++(int) { Iterator tmp = *this; ++(*this); return tmp; }
+
+			friend bool operator== (const Iterator& a, const Iterator& b) { return a.equals(b); };
+			friend bool operator!= (const Iterator& a, const Iterator& b) { return !a.equals(b); };
+
+		private:
+			using CursorTuple = std::tuple<typename SetType<Ts>::Iterator...>;
+
+			inline Iterator(const JoinedView& view, CursorTuple cursors, CursorTuple ends)
+				: view(view), driver(view.driver), cursors(cursors), ends(ends)
+			{
+				internal_ecs::VisitIndex<sizeof...(Ts)>(driver, [this]<size_t D>() { skipToMatch<D>(); });
+			}
+
+			/* Advances the driver cursor until all other sets contain its owner */
+			template <size_t D>
+			inline void skipToMatch()
+			{
+				auto& cursor = std::get<D>(cursors);
+				while (cursor != std::get<D>(ends))
+				{
+					owner = cursor.GetOwner();
+					std::get<D>(components) = cursor.operator->();
+					if (view.template probeOthers<D>(owner, components, Indices{})) { view.template markMatch<false>(components, Indices{}); return; }
+					++cursor;
+				}
+			}
+
+			template <size_t... I>
+			inline std::tuple<EntityID, Reference<Ts>...> dereference(std::index_sequence<I...>) const
+			{
+				return std::tuple<EntityID, Reference<Ts>...>(owner, *std::get<I>(components)...);
+			}
+
+			inline bool equals(const Iterator& other) const
+			{
+				bool result = false;
+				internal_ecs::VisitIndex<sizeof...(Ts)>(driver, [&]<size_t D>() { result = std::get<D>(cursors) == std::get<D>(other.cursors); });
+				return result;
+			}
+
+			const JoinedView& view;
+			size_t driver;
+			CursorTuple cursors;
+			CursorTuple ends;
+			EntityID owner{};
+			std::tuple<Pointer<Ts>...> components{};
+
+			friend class JoinedView;
+		};
+
+		inline Iterator begin() { return Iterator(*this, beginCursors(Indices{}), endCursors(Indices{})); };
+		inline Iterator end() { const auto ends = endCursors(Indices{}); return Iterator(*this, ends, ends); };
+
+		/* Calls fn(EntityID, Reference<Ts>...) for every match, splitting the driver's storage into tasks on the pool */
+		template <typename F>
+		inline void ParallelForEach(F&& fn, uint32_t grain_size, ThreadPool& pool);
+
+	private:
+		/* Looks up the driver owner in all other sets, returns false as soon as one is missing */
+		template <size_t D, size_t... I>
+		inline bool probeOthers(EntityID owner, std::tuple<Pointer<Ts>...>& components, std::index_sequence<I...>) const
+		{
+			return ((I == D || (std::get<I>(components) = std::get<I>(sets)->TryGet(owner)) != nullptr) && ...);
+		}
+
+		template <size_t... I>
+		inline void selectDriver(std::index_sequence<I...>)
+		{
+			size_t smallest_size = size_t(-1);
+			((std::get<I>(sets)->DenseSize() < smallest_size ? (smallest_size = std::get<I>(sets)->DenseSize(), driver = I) : 0), ...);
+		}
+
+		/* Marks the mutable components of a match by the entries already found, concurrent when running on several threads */
+		template <bool concurrent, size_t... I>
+		inline void markMatch(const std::tuple<Pointer<Ts>...>& components, std::index_sequence<I...>) const
+		{
+			([&]()
+				{
+					if constexpr (std::is_const_v<Ts>) return;
+					else if constexpr (concurrent) std::get<I>(sets)->MarkEntryChangedConcurrent(std::get<I>(components));
+					else std::get<I>(sets)->MarkEntryChanged(std::get<I>(components));
+				}(), ...);
+		}
+
+		template <size_t... I>
+		inline Iterator::CursorTuple beginCursors(std::index_sequence<I...>) const { return { std::get<I>(sets)->begin()... }; }
+
+		template <size_t... I>
+		inline Iterator::CursorTuple endCursors(std::index_sequence<I...>) const { return { std::get<I>(sets)->end()... }; }
+
+		std::tuple<SetType<Ts>*...> sets;
+		size_t driver{ 0 };
+	};
+
+	template <typename EntityID, typename... Ts> template <typename F>
+	inline void JoinedView<EntityID, Ts...>::ParallelForEach(F&& fn, uint32_t grain_size, ThreadPool& pool)
+	{
+		internal_ecs::VisitIndex<sizeof...(Ts)>(driver, [&]<size_t D>()
+			{
+				internal_ecs::ParallelForEachEntry(*std::get<D>(sets), grain_size, pool, [&](EntityID owner, auto component)
+					{
+						std::tuple<Pointer<Ts>...> components{};
+						std::get<D>(components) = component;
+						if (probeOthers<D>(owner, components, Indices{}))
+						{
+							markMatch<true>(components, Indices{});
+							std::apply([&](Pointer<Ts>... c) { fn(owner, *c...); }, components);
+						}
+					});
+			});
+	}
+}
+
+namespace lcs
+{
+	/* View over all entities having every component in Ts, when all of them are stored chunked with the same chunk width.
+	 * Chunks covering the same entity range are intersected through their occupancy masks.
+	 * Chunks with a non-empty intersection are marked and their matches stamped as written, except for components listed as const. */
+	template <typename EntityID, typename... Ts>
+	class ChunkedJoinView
+	{
+		static_assert(sizeof...(Ts) > 0);
+		static_assert(((Ts::component_type == ComponentType::ComponentChunked) && ...));
+
+		template <typename T>
+		using SetType = internal_ecs::ComponentContainer<EntityID, T>;
+		using Indices = std::index_sequence_for<Ts...>;
+		using data_t = EntityID::data_t;
+		using FirstSetType = SetType<std::tuple_element_t<0, std::tuple<Ts...>>>;
+		using mask_t = FirstSetType::mask_t;
+		using InverseHandlesChunk = FirstSetType::InverseHandlesChunk;
+		static_assert(((SetType<Ts>::entries_per_chunk == FirstSetType::entries_per_chunk) && ...), "Chunked components joined chunk by chunk need the same chunk width");
+
+	public:
+		ChunkedJoinView(SetType<Ts>&... sets) : sets(&sets...)
+		{
+			selectDriver(Indices{});
+		};
+
+		class Iterator
+		{
+		public:
+			/* Accessors */
+			inline std::tuple<EntityID, Ts&...> operator*() const { return dereference(Indices{}); }
+
+			inline EntityID GetOwner() const { return (*owners)[*occ_it]; }
+
+			/* Prefix increment */
+			inline Iterator& operator++()
+			{
+				++occ_it;
+				if (occ_it.IsZero())
+				{
+					chunk_index++;
+					skipToMatchingChunk();
+				}
+				return *this;
+			}
+
+			/* Postfix increment */
+			inline Iterator operator++(int) { Iterator tmp = *this; ++(*this); return tmp; }
+
+			friend bool operator== (const Iterator& a, const Iterator& b)
+			{
+				return (a.chunk_index == b.chunk_index) && (a.occ_it == b.occ_it);
+			};
+			friend bool operator!= (const Iterator& a, const Iterator& b)
+			{
+				return (a.chunk_index != b.chunk_index) || (a.occ_it != b.occ_it);
+			};
+
+		private:
+			inline Iterator(const ChunkedJoinView& view, data_t chunk_index)
+				: view(view), chunk_index(chunk_index)
+			{
+				skipToMatchingChunk();
+			}
+
+			/* Advances to the first driver chunk whose intersected occupancy mask is non-zero */
+			inline void skipToMatchingChunk()
+			{
+				const data_t chunk_count = view.driverChunkCount();
+				for (; chunk_index < chunk_count; chunk_index++)
+				{
+					mask_t mask = mask_t::Full();
+					if (view.loadChunk(view.driverChunkRange(chunk_index), mask, chunk_data, owners, Indices{}))
+					{
+						occ_it = mask_t::Iterator::Create(mask);
+						return;
+					}
+				}
+				occ_it = {};
+			}
+
+			template <size_t... I>
+			inline std::tuple<EntityID, Ts&...> dereference(std::index_sequence<I...>) const
+			{
+				const auto data_index = *occ_it;
+				return std::tuple<EntityID, Ts&...>((*owners)[data_index], std::get<I>(chunk_data)[data_index]...);
+			}
+
+			const ChunkedJoinView& view;
+			data_t chunk_index{};
+			typename mask_t::Iterator occ_it{};
+			const InverseHandlesChunk* owners{};
+			std::tuple<Ts*...> chunk_data{};
+
+			friend class ChunkedJoinView;
+		};
+
+		inline Iterator begin() { return Iterator(*this, 0); };
+		inline Iterator end() { return Iterator(*this, driverChunkCount()); };
+
+		/* Calls fn(EntityID, Ts&...) for every match, splitting the driver's chunk list into tasks on the pool */
+		template <typename F>
+		inline void ParallelForEach(F&& fn, uint32_t grain_size, ThreadPool& pool);
+
+	private:
+		/* Intersects the occupancy masks of the chunks covering chunk_range, returns false if none remain.
+		 * The chunks of mutable components are marked once the intersection is known, may run on several threads */
+		template <size_t... I>
+		inline bool loadChunk(data_t chunk_range, mask_t& mask, std::tuple<Ts*...>& chunk_data, const InverseHandlesChunk*& owners, std::index_sequence<I...>) const
+		{
+			std::array<data_t, sizeof...(Ts)> set_chunk_indices{};
+			if (!(loadSetChunk<I>(chunk_range, mask, chunk_data, owners, set_chunk_indices[I]) && ...) || mask.IsZero()) return false;
+			((std::is_const_v<Ts> ? void() : std::get<I>(sets)->MarkChunkChanged(set_chunk_indices[I], mask)), ...);
+			return true;
+		}
+
+		template <size_t I>
+		inline bool loadSetChunk(data_t chunk_range, mask_t& mask, std::tuple<Ts*...>& chunk_data, const InverseHandlesChunk*& owners, data_t& set_chunk_index) const
+		{
+			auto& set = *std::get<I>(sets);
+			set_chunk_index = set.FindChunk(chunk_range);
+			if (set_chunk_index == set.invalid_index) return false;
+
+			mask &= set.GetOccupancyMask(set_chunk_index);
+			std::get<I>(chunk_data) = set.GetChunk(set_chunk_index).data();
+			if constexpr (I == 0) owners = &set.GetInverseHandleChunk(set_chunk_index);
+			return true;
+		}
+
+		template <size_t... I>
+		inline void selectDriver(std::index_sequence<I...>)
+		{
+			data_t smallest_count = data_t(-1);
+			((std::get<I>(sets)->ChunkCount() < smallest_count ? (smallest_count = std::get<I>(sets)->ChunkCount(), driver = I) : 0), ...);
+		}
+
+		inline data_t driverChunkCount() const { return visitDriver([](const auto& set) { return set.ChunkCount(); }, Indices{}); }
+		inline data_t driverChunkRange(data_t chunk_index) const { return visitDriver([=](const auto& set) { return set.GetChunkRange(chunk_index); }, Indices{}); }
+
+		template <typename F, size_t... I>
+		inline data_t visitDriver(F&& f, std::index_sequence<I...>) const
+		{
+			data_t result{};
+			((driver == I ? (result = f(*std::get<I>(sets)), true) : false) || ...);
+			return result;
+		}
+
+		std::tuple<SetType<Ts>*...> sets;
+		size_t driver{ 0 };
+	};
+
+	template <typename EntityID, typename... Ts> template <typename F>
+	inline void ChunkedJoinView<EntityID, Ts...>::ParallelForEach(F&& fn, uint32_t grain_size, ThreadPool& pool)
+	{
+		const uint32_t chunks_per_task = std::max(grain_size / uint32_t(FirstSetType::entries_per_chunk), 1u);
+		const uint32_t chunk_count = uint32_t(driverChunkCount());
+		const uint32_t task_count = chunk_count / chunks_per_task + (chunk_count % chunks_per_task != 0);
+		pool.ParallelFor(task_count, [&](uint32_t task_index)
+			{
+				const uint32_t first_chunk = task_index * chunks_per_task;
+				const uint32_t last_chunk = first_chunk + std::min(chunks_per_task, chunk_count - first_chunk);
+				for (uint32_t chunk_index = first_chunk; chunk_index < last_chunk; chunk_index++)
+				{
+					mask_t mask = mask_t::Full();
+					std::tuple<Ts*...> chunk_data{};
+					const InverseHandlesChunk* owners{};
+					if (!loadChunk(driverChunkRange(chunk_index), mask, chunk_data, owners, Indices{})) continue;
+
+					for (const auto data_index : mask)
+					{
+						std::apply([&](Ts*... c) { fn((*owners)[data_index], c[data_index]...); }, chunk_data);
+					}
+				}
+			});
+	}
+
+	/* View over the entities whose chunked component T was stamped at since_tick or later.
+	 * Chunks with an older stamp are skipped without touching their data. Unless T is const the entries handed out are stamped again
+	 * and their chunks marked as written, so a pass over Changed<T> sees the entries of a mutable pass over it once more */
+	template <typename EntityID, typename T>
+	class ChangedView
+	{
+		static_assert(T::component_type == ComponentType::ComponentChunked, "Change tracking is only available for chunked components");
+
+		using SetType = internal_ecs::ComponentContainer<EntityID, T>;
+		using data_t = EntityID::data_t;
+		using mask_t = SetType::mask_t;
+		using tick_t = SetType::tick_t;
+
+	public:
+		ChangedView(SetType& set, tick_t since_tick) : set(set), since_tick(since_tick) {};
+
+		class Iterator
+		{
+		public:
+			/* Accessors */
+			inline std::pair<EntityID, T&> operator*() const { return std::pair<EntityID, T&>(view.set.GetInverseHandleChunk(chunk_index)[*occ_it], view.set.GetChunk(chunk_index)[*occ_it]); }
+
+			inline EntityID GetOwner() const { return view.set.GetInverseHandleChunk(chunk_index)[*occ_it]; }
+
+			/* Prefix increment */
+			inline Iterator& operator++()
+			{
+				++occ_it;
+				if (occ_it.IsZero())
+				{
+					chunk_index++;
+					skipToChangedChunk();
+				}
+				return *this;
+			}
+
+			/* Postfix increment */
+			inline Iterator operator++(int) { Iterator tmp = *this; ++(*this); return tmp; }
+
+			friend bool operator== (const Iterator& a, const Iterator& b) { return (a.chunk_index == b.chunk_index) && (a.occ_it == b.occ_it); };
+			friend bool operator!= (const Iterator& a, const Iterator& b) { return (a.chunk_index != b.chunk_index) || (a.occ_it != b.occ_it); };
+
+		private:
+			inline Iterator(const ChangedView& view, data_t chunk_index) : view(view), chunk_index(chunk_index)
+			{
+				skipToChangedChunk();
+			}
+
+			inline void skipToChangedChunk()
+			{
+				for (; chunk_index < view.set.ChunkCount(); chunk_index++)
+				{
+					const mask_t mask = view.set.GetChangedMask(chunk_index, view.since_tick);
+					if (!mask.IsZero())
+					{
+						if constexpr (!std::is_const_v<T>) view.set.MarkChunkChanged(chunk_index, mask);
+						occ_it = mask_t::Iterator::Create(mask);
+						return;
+					}
+				}
+				occ_it = {};
+			}
+
+			const ChangedView& view;
+			data_t chunk_index{};
+			typename mask_t::Iterator occ_it{};
+
+			friend class ChangedView;
+		};
+
+		inline Iterator begin() { return Iterator(*this, 0); };
+		inline Iterator end() { return Iterator(*this, set.ChunkCount()); };
+
+	private:
+		SetType& set;
+		tick_t since_tick;
+	};
+
+	/* View over all entities having every component in Ts, when all of them are archetype components.
+	 * Iterates the rows of every table whose signature contains Ts, without any sparse lookups.
+	 * Tables are marked as written when they are entered, unless every component is listed as const. */
+	template <typename EntityID, typename Storage, typename... Ts>
+	class ArchetypeView
+	{
+		static_assert(sizeof...(Ts) > 0);
+		static_assert(((Ts::component_type == ComponentType::Archetype) && ...));
+
+		using data_t = EntityID::data_t;
+		using signature_t = Storage::signature_t;
+		using Table = Storage::Table;
+		static constexpr signature_t required_signature = (Storage::template component_bit<std::remove_const_t<Ts>> | ...);
+		static constexpr bool writes = ((!std::is_const_v<Ts>) || ...);
+
+	public:
+		ArchetypeView(Storage& storage) : storage(storage) {};
+
+		class Iterator
+		{
+		public:
+			/* Accessors */
+			inline std::tuple<EntityID, Ts&...> operator*() const { return std::tuple<EntityID, Ts&...>(owners[row], std::get<Ts*>(columns)[row]...); }
+
+			inline EntityID GetOwner() const { return owners[row]; }
+
+			/* Prefix increment */
+			inline Iterator& operator++()
+			{
+				row++;
+				if (row == row_count)
+				{
+					table_index++;
+					skipToMatchingTable();
+				}
+				return *this;
+			}
+
+			/* Postfix increment */
+			inline Iterator operator++(int) { Iterator tmp = *this; ++(*this); return tmp; }
+
+			friend bool operator== (const Iterator& a, const Iterator& b) { return (a.table_index == b.table_index) && (a.row == b.row); };
+			friend bool operator!= (const Iterator& a, const Iterator& b) { return (a.table_index != b.table_index) || (a.row != b.row); };
+
+		private:
+			inline Iterator(Storage& storage, data_t table_index) : storage(storage), table_index(table_index)
+			{
+				skipToMatchingTable();
+			}
+
+			inline void skipToMatchingTable()
+			{
+				row = 0;
+				for (; table_index < storage.TableCount(); table_index++)
+				{
+					Table& table = storage.GetTable(table_index);
+					if ((table.signature & required_signature) == required_signature && table.RowCount() > 0)
+					{
+						if constexpr (writes) storage.MarkTableChanged(table_index);
+						owners = table.owners.data();
+						columns = { table.template Column<std::remove_const_t<Ts>>().data()... };
+						row_count = table.RowCount();
+						return;
+					}
+				}
+			}
+
+			Storage& storage;
+			data_t table_index{};
+			size_t row{};
+			size_t row_count{};
+			const EntityID* owners{};
+			std::tuple<Ts*...> columns{};
+
+			friend class ArchetypeView;
+		};
+
+		inline Iterator begin() { return Iterator(storage, 0); };
+		inline Iterator end() { return Iterator(storage, storage.TableCount()); };
+
+		/* Calls fn(EntityID, Ts&...) for every match, splitting the rows of each matching table into tasks on the pool */
+		template <typename F>
+		inline void ParallelForEach(F&& fn, uint32_t grain_size, ThreadPool& pool);
+
+	private:
+		Storage& storage;
+	};
+
+	template <typename EntityID, typename Storage, typename... Ts> template <typename F>
+	inline void ArchetypeView<EntityID, Storage, Ts...>::ParallelForEach(F&& fn, uint32_t grain_size, ThreadPool& pool)
+	{
+		assert(grain_size > 0);
+		for (data_t table_index = 0; table_index < storage.TableCount(); table_index++)
+		{
+			Table& table = storage.GetTable(table_index);
+			if ((table.signature & required_signature) != required_signature) continue;
+
+			if constexpr (writes) storage.MarkTableChanged(table_index);
+			const uint32_t row_count = uint32_t(table.RowCount());
+			const uint32_t task_count = row_count / grain_size + (row_count % grain_size != 0);
+			pool.ParallelFor(task_count, [&](uint32_t task_index)
+				{
+					const uint32_t first_row = task_index * grain_size;
+					const uint32_t last_row = first_row + std::min(grain_size, row_count - first_row);
+					for (uint32_t row = first_row; row < last_row; row++)
+					{
+						fn(table.owners[row], table.template Column<std::remove_const_t<Ts>>()[row]...);
+					}
+				});
+		}
+	}
+
+	namespace internal_ecs
+	{
+		template <typename EntityID, typename Storage, typename... Ts>
+		struct GetJoinedView
+		{
+			static constexpr bool all_archetype = ((Ts::component_type == ComponentType::Archetype) && ...);
+			static constexpr bool all_chunked = ((Ts::component_type == ComponentType::ComponentChunked) && ...)
+				&& ((GetChunkWidth<Ts>() == GetChunkWidth<std::tuple_element_t<0, std::tuple<Ts...>>>()) && ...);
+
+			using View = std::conditional_t<all_archetype,
+				ArchetypeView<EntityID, Storage, Ts...>,
+				std::conditional_t<all_chunked,
+					ChunkedJoinView<EntityID, Ts...>,
+					JoinedView<EntityID, Ts...>>>;
+		};
+
+		template <typename EntityID, typename Storage, typename T>
+		struct GetComponentView
+		{
+			using View = std::conditional_t<T::component_type == ComponentType::Archetype,
+				ArchetypeView<EntityID, Storage, T>,
+				ComponentView<EntityID, T>>;
+		};
+	}
 }
\ No newline at end of file
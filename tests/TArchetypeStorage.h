@@ -0,0 +1,104 @@
+#pragma once
+#include <gtest/gtest.h>
+#include <lutra-ecs/ArchetypeStorage.h>
+
+namespace TArchetype
+{
+	using Handle = lcs::Handle<uint32_t, 16>;
+
+	struct A { int value; };
+	struct B { int value; };
+	struct C { int value; };
+
+	using Storage = lcs::ArchetypeStorage<Handle, A, B, C>;
+
+	inline Handle cnh(uint32_t value) { return Handle::CreateNew(value); }
+}
+
+TEST(ArchetypeStorage, AddHasGet)
+{
+	TArchetype::Storage storage{};
+	storage.ReserveSparseSize(16);
+
+	storage.Add<TArchetype::A>(TArchetype::cnh(3), { 3 });
+	storage.Add<TArchetype::B>(TArchetype::cnh(3), { 30 });
+	storage.Add<TArchetype::A>(TArchetype::cnh(5), { 5 });
+
+	ASSERT_TRUE(storage.Has<TArchetype::A>(TArchetype::cnh(3)));
+	ASSERT_TRUE(storage.Has<TArchetype::B>(TArchetype::cnh(3)));
+	ASSERT_TRUE(!storage.Has<TArchetype::C>(TArchetype::cnh(3)));
+	ASSERT_TRUE(storage.Has<TArchetype::A>(TArchetype::cnh(5)));
+	ASSERT_TRUE(!storage.Has<TArchetype::B>(TArchetype::cnh(5)));
+	ASSERT_TRUE(!storage.Has<TArchetype::A>(TArchetype::cnh(4)));
+
+	ASSERT_EQ(storage.Get<TArchetype::A>(TArchetype::cnh(3)).value, 3);
+	ASSERT_EQ(storage.Get<TArchetype::B>(TArchetype::cnh(3)).value, 30);
+	ASSERT_EQ(storage.Get<TArchetype::A>(TArchetype::cnh(5)).value, 5);
+	ASSERT_EQ(storage.TryGet<TArchetype::B>(TArchetype::cnh(5)), nullptr);
+
+	ASSERT_EQ(storage.Size<TArchetype::A>(), 2u);
+	ASSERT_EQ(storage.Size<TArchetype::B>(), 1u);
+	ASSERT_EQ(storage.Size<TArchetype::C>(), 0u);
+}
+
+TEST(ArchetypeStorage, MoveBetweenTables)
+{
+	TArchetype::Storage storage{};
+	storage.ReserveSparseSize(16);
+
+	for (uint32_t i = 0; i < 10; i++)
+	{
+		storage.Add<TArchetype::A>(TArchetype::cnh(i), { int(i) });
+		storage.Add<TArchetype::B>(TArchetype::cnh(i), { int(i) * 10 });
+	}
+	for (uint32_t i = 0; i < 10; i += 2)
+	{
+		storage.Remove<TArchetype::A>(TArchetype::cnh(i));
+		storage.Add<TArchetype::C>(TArchetype::cnh(i), { int(i) * 100 });
+	}
+	storage.Remove<TArchetype::B>(TArchetype::cnh(9));
+	storage.Remove<TArchetype::A>(TArchetype::cnh(9));
+
+	for (uint32_t i = 0; i < 9; i++)
+	{
+		const bool even = i % 2 == 0;
+		ASSERT_EQ(storage.Has<TArchetype::A>(TArchetype::cnh(i)), !even);
+		ASSERT_EQ(storage.Has<TArchetype::C>(TArchetype::cnh(i)), even);
+		ASSERT_EQ(storage.Get<TArchetype::B>(TArchetype::cnh(i)).value, int(i) * 10);
+		if (even) { ASSERT_EQ(storage.Get<TArchetype::C>(TArchetype::cnh(i)).value, int(i) * 100); }
+		else ASSERT_EQ(storage.Get<TArchetype::A>(TArchetype::cnh(i)).value, int(i));
+	}
+	ASSERT_TRUE(!storage.Has<TArchetype::A>(TArchetype::cnh(9)));
+	ASSERT_TRUE(!storage.Has<TArchetype::B>(TArchetype::cnh(9)));
+
+	/* Tables: A, AB, B, BC */
+	ASSERT_EQ(storage.TableCount(), 4u);
+	uint32_t row_count = 0;
+	for (uint32_t i = 0; i < storage.TableCount(); i++)
+	{
+		row_count += storage.GetTable(i).RowCount();
+	}
+	ASSERT_EQ(row_count, 9u);
+}
+
+TEST(ArchetypeStorage, RemoveIfPresent)
+{
+	TArchetype::Storage storage{};
+	storage.ReserveSparseSize(16);
+
+	storage.Add<TArchetype::A>(TArchetype::cnh(1), { 1 });
+	storage.Add<TArchetype::C>(TArchetype::cnh(1), { 1 });
+	storage.Add<TArchetype::A>(TArchetype::cnh(2), { 2 });
+
+	storage.RemoveIfPresent(TArchetype::cnh(1));
+	storage.RemoveIfPresent(TArchetype::cnh(3));
+
+	ASSERT_TRUE(!storage.Has<TArchetype::A>(TArchetype::cnh(1)));
+	ASSERT_TRUE(!storage.Has<TArchetype::C>(TArchetype::cnh(1)));
+	ASSERT_EQ(storage.Get<TArchetype::A>(TArchetype::cnh(2)).value, 2);
+	ASSERT_EQ(storage.Size<TArchetype::A>(), 1u);
+	ASSERT_EQ(storage.Size<TArchetype::C>(), 0u);
+
+	storage.Clear();
+	ASSERT_EQ(storage.TableCount(), 0u);
+}
@@ -48,6 +48,18 @@ TEST(BitMask, ClearBit)
 	ASSERT_EQ(mask.mask, 0x0000000000000000);
 }
 
+TEST(BitMask, And)
+{
+	lcs::BitMask<uint64_t> a{ 0x8000000080008083 };
+	const lcs::BitMask<uint64_t> b{ 0x0000000180000081 };
+
+	ASSERT_EQ((a & b).mask, 0x0000000080000081);
+	a &= b;
+	ASSERT_EQ(a.mask, 0x0000000080000081);
+	a &= { 0 };
+	ASSERT_TRUE(a.IsZero());
+}
+
 TEST(BitMask, Iterate)
 {
 	auto extract_bits = [](lcs::BitMask<uint64_t> mask) -> std::vector<uint8_t> {
@@ -110,4 +122,108 @@ TEST(BitMask, IterateReverse)
 	ASSERT_EQ(bits3[3], 7);
 	ASSERT_EQ(bits3[4], 1);
 	ASSERT_EQ(bits3[5], 0);
-}
\ No newline at end of file
+}
+
+TEST(WideBitMask, SetClearBit)
+{
+	lcs::WideBitMask<256> mask{};
+
+	mask.SetBit(0);
+	mask.SetBit(64);
+	mask.SetBit(255);
+	ASSERT_EQ(mask.words[0], 0x0000000000000001);
+	ASSERT_EQ(mask.words[1], 0x0000000000000001);
+	ASSERT_EQ(mask.words[2], 0x0000000000000000);
+	ASSERT_EQ(mask.words[3], 0x8000000000000000);
+	ASSERT_TRUE(mask.IsBitSet(64));
+	ASSERT_FALSE(mask.IsBitSet(65));
+
+	mask.ClearBit(64);
+	ASSERT_FALSE(mask.IsBitSet(64));
+	ASSERT_EQ(mask.words[1], 0x0000000000000000);
+	mask.ClearBit(0);
+	mask.ClearBit(255);
+	ASSERT_TRUE(mask.IsZero());
+}
+
+TEST(WideBitMask, AndAndNot)
+{
+	lcs::WideBitMask<128> a{ { 0x8000000080008083, 0x00000000000000FF } };
+	const lcs::WideBitMask<128> b{ { 0x0000000180000081, 0x0000000000000F0F } };
+
+	const auto c = a & b;
+	ASSERT_EQ(c.words[0], 0x0000000080000081);
+	ASSERT_EQ(c.words[1], 0x000000000000000F);
+
+	a.AndNot(b);
+	ASSERT_EQ(a.words[0], 0x8000000000008002);
+	ASSERT_EQ(a.words[1], 0x00000000000000F0);
+
+	a &= lcs::WideBitMask<128>{};
+	ASSERT_TRUE(a.IsZero());
+	ASSERT_EQ(lcs::WideBitMask<128>::Full().PopCount(), 128u);
+}
+
+TEST(WideBitMask, PopCountFirstSet)
+{
+	lcs::WideBitMask<512> mask{};
+	ASSERT_EQ(mask.PopCount(), 0u);
+	ASSERT_EQ(mask.FirstSet(), 512u);
+
+	mask.SetBit(300);
+	mask.SetBit(301);
+	mask.SetBit(511);
+	ASSERT_EQ(mask.PopCount(), 3u);
+	ASSERT_EQ(mask.FirstSet(), 300u);
+
+	const lcs::BitMask<uint64_t> narrow{ 0x0000000080008080 };
+	ASSERT_EQ(narrow.PopCount(), 3u);
+	ASSERT_EQ(narrow.FirstSet(), 7u);
+}
+
+TEST(WideBitMask, Iterate)
+{
+	lcs::WideBitMask<256> mask{};
+	ASSERT_TRUE(mask.begin() == mask.end());
+
+	const std::vector<uint16_t> expected{ 0, 1, 63, 64, 130, 200, 255 };
+	for (const uint16_t bit : expected) mask.SetBit(bit);
+
+	std::vector<uint16_t> bits{};
+	for (const uint16_t bit : mask)
+	{
+		bits.push_back(bit);
+	}
+	ASSERT_EQ(bits, expected);
+}
+
+TEST(WideBitMask, OddWordCount)
+{
+	/* Three words, the last one is left over after the word pairs */
+	lcs::WideBitMask<192> a{ { 0x00000000000000FF, 0x0000000000000000, 0x8000000000000F0F } };
+	const lcs::WideBitMask<192> b{ { 0x000000000000000F, 0x0000000000000001, 0x8000000000000F00 } };
+	ASSERT_EQ(a.FirstSet(), 0u);
+
+	const auto c = a & b;
+	ASSERT_EQ(c.words[0], 0x000000000000000F);
+	ASSERT_EQ(c.words[1], 0x0000000000000000);
+	ASSERT_EQ(c.words[2], 0x8000000000000F00);
+
+	a.AndNot(b);
+	ASSERT_EQ(a.words[0], 0x00000000000000F0);
+	ASSERT_EQ(a.words[1], 0x0000000000000000);
+	ASSERT_EQ(a.words[2], 0x000000000000000F);
+	ASSERT_EQ(a.PopCount(), 8u);
+
+	a.words[0] = 0;
+	ASSERT_FALSE(a.IsZero());
+	ASSERT_EQ(a.FirstSet(), 128u);
+
+	lcs::WideBitMask<192> second_word{};
+	second_word.SetBit(70);
+	ASSERT_EQ(second_word.FirstSet(), 70u);
+
+	a &= second_word;
+	ASSERT_TRUE(a.IsZero());
+	ASSERT_EQ(a.FirstSet(), 192u);
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <gtest/gtest.h>
+#include <lutra-ecs/ECSManager.h>
+#include <algorithm>
+#include <vector>
+
+namespace TCachedQuery
+{
+	using EntityID = lcs::Handle<uint32_t, 16>;
+
+	struct Position
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Component;
+		int x, y;
+	};
+	struct Velocity
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Component;
+		int x, y;
+	};
+	struct Heat
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::ComponentChunked;
+		int kelvin;
+	};
+	struct Spin
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::SoA;
+		int x, y;
+		static constexpr std::tuple soa_fields{ &Spin::x, &Spin::y };
+	};
+
+	using ECS = lcs::ECSManager<EntityID, Position, Velocity, Heat, Spin>;
+
+	template <typename... Us>
+	inline std::vector<EntityID> ViewOwners(ECS& ecs)
+	{
+		std::vector<EntityID> owners{};
+		for (auto row : ecs.View<Us...>()) owners.push_back(std::get<0>(row));
+		std::sort(owners.begin(), owners.end(), [](EntityID a, EntityID b) { return a.GetIndex() < b.GetIndex(); });
+		return owners;
+	}
+
+	template <typename Query>
+	inline std::vector<EntityID> QueryOwners(Query& query)
+	{
+		std::vector<EntityID> owners{};
+		for (auto row : query) owners.push_back(std::get<0>(row));
+		std::sort(owners.begin(), owners.end(), [](EntityID a, EntityID b) { return a.GetIndex() < b.GetIndex(); });
+		return owners;
+	}
+}
+
+TEST(CachedQuery, MatchesViewAcrossStructuralChanges)
+{
+	using namespace TCachedQuery;
+	ECS ecs{};
+	std::vector<EntityID> entities(1000);
+	ecs.CreateEntities(1000, entities);
+	for (uint32_t i = 0; i < 1000; i++)
+	{
+		if (i % 2 == 0) ecs.AddComponent<Position>(entities[i], { int(i), 0 });
+		if (i % 3 == 0) ecs.AddComponent<Velocity>(entities[i], { 1, 1 });
+		if (i % 5 != 0) ecs.AddComponent<Heat>(entities[i], { int(i) });
+		if (i % 4 == 0) ecs.AddComponent<Spin>(entities[i], { 0, int(i) });
+	}
+
+	auto query = ecs.Query<Position, Velocity, Heat>();
+	ASSERT_EQ(QueryOwners(query), (ViewOwners<Position, Velocity, Heat>(ecs)));
+	ASSERT_EQ(query.Size(), 133u);
+
+	/* Writes through the query reach the containers, steady state iteration doesn't rebuild */
+	for (auto [e, p, v, h] : query) p.x += v.x + h.kelvin;
+	for (int frame = 0; frame < 5; frame++) query.ForEach([](EntityID, Position& p, Velocity&, Heat&) { p.y++; });
+	ASSERT_EQ(query.BuildCount(), 1u);
+	ASSERT_EQ(ecs.GetComponent<Position>(entities[6]).x, 6 + 1 + 6);
+	ASSERT_EQ(ecs.GetComponent<Position>(entities[6]).y, 5);
+
+	/* Value writes don't change the structure */
+	ecs.WriteComponent<Velocity>(entities[6]).x = 2;
+	ASSERT_TRUE(!query.IsStale());
+
+	/* Each container invalidates the query */
+	ecs.RemoveComponent<Velocity>(entities[6]);
+	ASSERT_TRUE(query.IsStale());
+	ASSERT_EQ(QueryOwners(query), (ViewOwners<Position, Velocity, Heat>(ecs)));
+	ecs.RemoveComponent<Heat>(entities[12]);
+	ASSERT_EQ(QueryOwners(query), (ViewOwners<Position, Velocity, Heat>(ecs)));
+	ecs.AddComponent<Velocity>(entities[2], { 1, 1 });
+	ASSERT_EQ(QueryOwners(query), (ViewOwners<Position, Velocity, Heat>(ecs)));
+	ASSERT_EQ(query.BuildCount(), 4u);
+
+	/* Destroying entities and sorting reorder the dense arrays */
+	std::vector<EntityID> destroyed{};
+	for (uint32_t i = 0; i < 1000; i += 7) destroyed.push_back(entities[i]);
+	ecs.DestroyEntities(destroyed);
+	ASSERT_EQ(QueryOwners(query), (ViewOwners<Position, Velocity, Heat>(ecs)));
+	ecs.SortByEntity<Position>();
+	for (auto [e, p, v, h] : query) ASSERT_EQ(&p, &ecs.GetComponent<Position>(e));
+
+	/* SoA components hand out proxies */
+	auto spin_query = ecs.Query<Spin, Position>();
+	for (auto [e, s, p] : spin_query) s.Get<&Spin::x>() = p.x;
+	ASSERT_EQ(QueryOwners(spin_query), (ViewOwners<Spin, Position>(ecs)));
+	for (auto [e, s, p] : spin_query) ASSERT_EQ(s.Get<&Spin::x>(), p.x);
+
+	ecs.Clear();
+	ASSERT_EQ(query.Size(), 0u);
+	ASSERT_EQ(spin_query.Size(), 0u);
+}
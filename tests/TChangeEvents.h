@@ -0,0 +1,160 @@
+#pragma once
+#include <gtest/gtest.h>
+#include <lutra-ecs/ECSManager.h>
+#include <vector>
+
+namespace TChangeEvents
+{
+	using EntityID = lcs::Handle<uint32_t, 16>;
+
+	struct Position
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Component;
+		int x, y;
+	};
+	struct Heat
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::ComponentChunked;
+		int kelvin;
+	};
+	struct IsHot
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Tag;
+	};
+
+	using ECS = lcs::ECSManager<EntityID, Position, Heat, IsHot>;
+
+	/* What a reactive consumer such as a spatial index keeps, one flag per entity index */
+	template <typename T>
+	struct Mirror
+	{
+		std::vector<bool> present = std::vector<bool>(EntityID::max_index + 1, false);
+
+		void Rebuild(ECS& ecs)
+		{
+			present.assign(present.size(), false);
+			for (const EntityID e : ecs.Entities()) present[e.GetIndex()] = ecs.HasComponent<T>(e);
+		}
+
+		void Apply(ECS& ecs)
+		{
+			ecs.Events<T>().Drain([&](std::span<const EntityID> added, std::span<const EntityID> removed, bool was_reset)
+				{
+					if (was_reset) { Rebuild(ecs); return; }
+					for (const EntityID e : removed) present[e.GetIndex()] = false;
+					for (const EntityID e : added)
+					{
+						if (ecs.Entities().IsCurrent(e) && ecs.HasComponent<T>(e)) present[e.GetIndex()] = true;
+					}
+				});
+		}
+
+		bool Matches(ECS& ecs) const
+		{
+			for (uint32_t index = 0; index < present.size(); index++)
+			{
+				const bool expected = index < ecs.Entities().MaxIndex() && ecs.Entities().IsOccupied(index) && ecs.HasComponent<T>(ecs.Entities().GetHandle(index));
+				if (present[index] != expected) return false;
+			}
+			return true;
+		}
+	};
+}
+
+TEST(ChangeEvents, RecordsBatches)
+{
+	using namespace TChangeEvents;
+	ECS ecs{};
+	std::vector<EntityID> entities(100);
+	ecs.CreateEntities(100, entities);
+
+	/* Nothing is recorded until enabled */
+	ecs.AddComponent<Position>(entities[0], { 0, 0 });
+	ASSERT_TRUE(ecs.Events<Position>().IsEmpty());
+
+	ecs.Events<Position>().Enable();
+	std::vector<Position> positions(10, Position{ 1, 2 });
+	ecs.AddComponents<Position>(std::span(entities).subspan(1, 10), positions);
+	ecs.RemoveComponent<Position>(entities[0]);
+	ecs.DestroyEntity(entities[5]);
+	ASSERT_TRUE(std::ranges::equal(ecs.Events<Position>().Added(), std::span(entities).subspan(1, 10)));
+	ASSERT_TRUE(std::ranges::equal(ecs.Events<Position>().Removed(), std::vector<EntityID>{ entities[0], entities[5] }));
+
+	size_t drained = 0;
+	ecs.Events<Position>().Drain([&](std::span<const EntityID> added, std::span<const EntityID> removed, bool was_reset)
+		{
+			drained = added.size() + removed.size();
+			ASSERT_FALSE(was_reset);
+		});
+	ASSERT_EQ(drained, 12u);
+	ASSERT_TRUE(ecs.Events<Position>().IsEmpty());
+
+	/* Clear drops the buffers and asks for a rebuild */
+	ecs.AddComponent<Position>(entities[20], { 0, 0 });
+	ecs.Clear();
+	ASSERT_TRUE(ecs.Events<Position>().Added().empty());
+	ASSERT_TRUE(ecs.Events<Position>().WasReset());
+
+	ecs.Events<Position>().Disable();
+	ASSERT_TRUE(ecs.Events<Position>().IsEmpty());
+}
+
+TEST(ChangeEvents, ConsumerFollowsStructuralChanges)
+{
+	using namespace TChangeEvents;
+	ECS ecs{};
+	std::vector<EntityID> entities(2000);
+	ecs.CreateEntities(2000, entities);
+	for (uint32_t i = 0; i < 2000; i++)
+	{
+		if (i % 2 == 0) ecs.AddComponent<Position>(entities[i], { int(i), 0 });
+		if (i % 3 == 0) ecs.AddComponent<Heat>(entities[i], { int(i) });
+	}
+
+	Mirror<Position> positions{};
+	Mirror<Heat> heats{};
+	Mirror<IsHot> hot{};
+	positions.Rebuild(ecs);
+	heats.Rebuild(ecs);
+	hot.Rebuild(ecs);
+	ecs.Events<Position>().Enable();
+	ecs.Events<Heat>().Enable();
+	ecs.Events<IsHot>().Enable();
+
+	for (uint32_t frame = 0; frame < 8; frame++)
+	{
+		for (uint32_t i = frame; i < 2000; i += 7)
+		{
+			const EntityID e = entities[i];
+			if (ecs.HasComponent<Position>(e)) ecs.RemoveComponent<Position>(e);
+			else ecs.AddComponent<Position>(e, { 0, 0 });
+			if (!ecs.HasComponent<Heat>(e)) ecs.AddComponent<Heat>(e, { 1 });
+			if (ecs.HasComponent<IsHot>(e)) ecs.RemoveTag<IsHot>(e);
+			else ecs.AddTag<IsHot>(e);
+		}
+
+		/* Removed and added again, added and removed again within the same frame */
+		const EntityID flip = entities[(frame * 31) % 2000];
+		if (ecs.HasComponent<Position>(flip)) { ecs.RemoveComponent<Position>(flip); ecs.AddComponent<Position>(flip, { 1, 1 }); }
+		else { ecs.AddComponent<Position>(flip, { 1, 1 }); ecs.RemoveComponent<Position>(flip); }
+
+		/* Large batches take the compacting paths, the freed indices are reused by new entities */
+		std::vector<EntityID> destroyed{};
+		for (uint32_t i = frame * 3; i < 2000; i += 5) destroyed.push_back(entities[i]);
+		ecs.DestroyEntities(destroyed);
+		ecs.CreateEntities(EntityID::data_t(destroyed.size()), destroyed);
+		for (size_t i = 0; i < destroyed.size(); i++)
+		{
+			entities[frame * 3 + i * 5] = destroyed[i];
+			if (i % 2 == 0) ecs.AddComponent<Position>(destroyed[i], { 2, 2 });
+			if (i % 4 == 0) ecs.AddTag<IsHot>(destroyed[i]);
+		}
+
+		positions.Apply(ecs);
+		heats.Apply(ecs);
+		hot.Apply(ecs);
+		ASSERT_TRUE(positions.Matches(ecs));
+		ASSERT_TRUE(heats.Matches(ecs));
+		ASSERT_TRUE(hot.Matches(ecs));
+	}
+}
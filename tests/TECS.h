@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <lutra-ecs/CommandBuffer.h>
 #include <lutra-ecs/ECSManager.h>
 
 namespace TECS
@@ -33,12 +34,74 @@ namespace TECS
 		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Component;
 		int length;
 	};
+	struct Mass
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::ComponentChunked;
+		int kg;
+	};
+	struct Charge
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::ComponentChunked;
+		int coulomb;
+	};
+	struct Fuel
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::ComponentChunked;
+		static constexpr lcs::ChangeTracking change_tracking = lcs::ChangeTracking::PerChunk;
+		int liters;
+	};
+	struct Temperature
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::ComponentChunked;
+		static constexpr lcs::ChangeTracking change_tracking = lcs::ChangeTracking::PerSlot;
+		int kelvin;
+	};
+	struct Acceleration
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::SoA;
+		int x, y;
+		static constexpr std::tuple soa_fields{ &Acceleration::x, &Acceleration::y };
+	};
 	struct IsWet
 	{
 		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Tag;
 	};
 
-	using ECS = lcs::ECSManager<EntityID, Position, Velocity, Player, Enemy, Weapon, IsWet>;
+	using ECS = lcs::ECSManager<EntityID, Position, Velocity, Player, Enemy, Weapon, Mass, Charge, Fuel, Temperature, Acceleration, IsWet>;
+
+	struct Body
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Archetype;
+		int x, y;
+	};
+	struct Motion
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Archetype;
+		int x, y;
+	};
+	struct Team
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Archetype;
+		int id;
+	};
+
+	using ArchetypeECS = lcs::ECSManager<EntityID, Body, Motion, Position, Team, IsWet>;
+
+	struct Density
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::ComponentChunked;
+		static constexpr uint32_t chunk_width = 256;
+		int value;
+	};
+	struct Pressure
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::ComponentChunked;
+		static constexpr uint32_t chunk_width = 256;
+		static constexpr lcs::ChangeTracking change_tracking = lcs::ChangeTracking::PerSlot;
+		int value;
+	};
+
+	using WideChunkECS = lcs::ECSManager<EntityID, Mass, Density, Pressure>;
 
 	inline EntityID CreatePlayer(ECS& ecs, int x, int y)
 	{
@@ -314,4 +377,971 @@ TEST(ECS, TestUseAfterClear)
 	ASSERT_TRUE(ecs.GetComponent<TECS::Position>(e).x == player_pos_x);
 	ASSERT_TRUE(ecs.GetComponent<TECS::Position>(e).y == player_pos_y);
 
-}
\ No newline at end of file
+}
+
+TEST(ECS, TestJoinedView)
+{
+	TECS::ECS ecs{ };
+
+	std::vector<TECS::EntityID> entities;
+	for (int i = 0; i < 100; i++)
+	{
+		entities.push_back(TECS::CreatePlayer(ecs, i, 0));
+	}
+	for (int i = 0; i < 100; i += 3)
+	{
+		ecs.RemoveComponent<TECS::Velocity>(entities[i]);
+	}
+
+	int visit_count = 0;
+	for (auto [e, p, v] : ecs.View<TECS::Position, TECS::Velocity>())
+	{
+		ASSERT_TRUE(e.GetIndex() % 3 != 0);
+		p.y += v.y;
+		visit_count++;
+	}
+	ASSERT_EQ(visit_count, 66);
+
+	for (int i = 0; i < 100; i++)
+	{
+		ASSERT_EQ(ecs.GetComponent<TECS::Position>(entities[i]).y, (i % 3 == 0) ? 0 : 1);
+	}
+	ecs.Clear();
+}
+
+TEST(ECS, TestJoinedViewMixedContainers)
+{
+	TECS::ECS ecs{ };
+
+	std::vector<TECS::EntityID> entities;
+	for (int i = 0; i < 200; i++)
+	{
+		entities.push_back(ecs.CreateEntity());
+		ecs.AddComponent<TECS::Position>(entities[i], { i, 0 });
+	}
+	for (int i = 0; i < 200; i += 10)
+	{
+		ecs.AddComponent<TECS::Mass>(entities[i], { i });
+	}
+
+	int visit_count = 0;
+	for (auto [e, m, p] : ecs.View<TECS::Mass, TECS::Position>())
+	{
+		ASSERT_EQ(m.kg, p.x);
+		visit_count++;
+	}
+	ASSERT_EQ(visit_count, 20);
+
+	int empty_count = 0;
+	for (auto&& entry : ecs.View<TECS::Position, TECS::Weapon>())
+	{
+		(void)entry;
+		empty_count++;
+	}
+	ASSERT_EQ(empty_count, 0);
+	ecs.Clear();
+}
+
+TEST(ECS, TestChunkedJoinView)
+{
+	TECS::ECS ecs{ };
+
+	std::vector<TECS::EntityID> entities;
+	for (int i = 0; i < 500; i++)
+	{
+		entities.push_back(ecs.CreateEntity());
+		if (i % 2 == 0) ecs.AddComponent<TECS::Mass>(entities[i], { i });
+		if (i % 3 == 0) ecs.AddComponent<TECS::Charge>(entities[i], { -i });
+	}
+	for (int i = 128; i < 192; i++)
+	{
+		if (ecs.HasComponent<TECS::Charge>(entities[i])) ecs.RemoveComponent<TECS::Charge>(entities[i]);
+	}
+
+	int visit_count = 0;
+	for (auto [e, m, c] : ecs.View<TECS::Mass, TECS::Charge>())
+	{
+		const int index = int(e.GetIndex());
+		ASSERT_TRUE(index % 6 == 0);
+		ASSERT_TRUE(index < 128 || index >= 192);
+		ASSERT_EQ(m.kg, index);
+		ASSERT_EQ(c.coulomb, -index);
+		m.kg++;
+		visit_count++;
+	}
+	ASSERT_EQ(visit_count, 84 - 10);
+	ASSERT_EQ(ecs.GetComponent<TECS::Mass>(entities[6]).kg, 7);
+	ASSERT_EQ(ecs.GetComponent<TECS::Mass>(entities[2]).kg, 2);
+	ecs.Clear();
+}
+
+TEST(ECS, TestWideChunks)
+{
+	TECS::WideChunkECS ecs{ };
+
+	std::vector<TECS::EntityID> entities(1000);
+	ecs.CreateEntities(1000, entities);
+	for (int i = 0; i < 1000; i++)
+	{
+		if (i % 2 == 0) ecs.AddComponent<TECS::Density>(entities[i], { i });
+		if (i % 3 == 0) ecs.AddComponent<TECS::Pressure>(entities[i], { -i });
+		if (i % 5 == 0) ecs.AddComponent<TECS::Mass>(entities[i], { i });
+	}
+	for (int i = 256; i < 512; i++)
+	{
+		if (ecs.HasComponent<TECS::Pressure>(entities[i])) ecs.RemoveComponent<TECS::Pressure>(entities[i]);
+	}
+
+	/* Same width, joined chunk by chunk */
+	int visit_count = 0;
+	for (auto [e, d, p] : ecs.View<TECS::Density, TECS::Pressure>())
+	{
+		const int index = int(e.GetIndex());
+		ASSERT_TRUE(index % 6 == 0);
+		ASSERT_TRUE(index < 256 || index >= 512);
+		ASSERT_EQ(d.value, index);
+		ASSERT_EQ(p.value, -index);
+		visit_count++;
+	}
+	ASSERT_EQ(visit_count, 167 - 43);
+
+	/* Mixed widths fall back to probing */
+	visit_count = 0;
+	for (auto [e, m, d] : ecs.View<TECS::Mass, TECS::Density>())
+	{
+		ASSERT_EQ(int(e.GetIndex()) % 10, 0);
+		ASSERT_EQ(m.kg, d.value);
+		visit_count++;
+	}
+	ASSERT_EQ(visit_count, 100);
+
+	std::atomic<int> parallel_count{ 0 };
+	ecs.ParallelForEach<TECS::Density, TECS::Pressure>([&](TECS::EntityID, TECS::Density&, TECS::Pressure&) { parallel_count++; }, 256);
+	ASSERT_EQ(parallel_count.load(), 167 - 43);
+
+	/* Per slot stamps across the words of a wide chunk */
+	const uint32_t last_sync = ecs.AdvanceTick();
+	ecs.WriteComponent<TECS::Pressure>(entities[3]).value = 1;
+	ecs.MarkChanged<TECS::Pressure>(entities[201]);
+	ecs.MarkChanged<TECS::Pressure>(entities[999]);
+	std::vector<uint32_t> changed{};
+	for (auto [id, p] : ecs.Changed<TECS::Pressure>(last_sync)) changed.push_back(id.GetIndex());
+	std::sort(changed.begin(), changed.end());
+	ASSERT_EQ(changed, (std::vector<uint32_t>{ 3, 201, 999 }));
+}
+
+TEST(ECS, TestParallelForEach)
+{
+	TECS::ECS ecs{ };
+
+	std::vector<TECS::EntityID> entities;
+	for (int i = 0; i < 5000; i++)
+	{
+		entities.push_back(ecs.CreateEntity());
+		ecs.AddComponent<TECS::Position>(entities[i], { i, 0 });
+		if (i % 2 == 0) ecs.AddComponent<TECS::Velocity>(entities[i], { 0, 1 });
+		if (i % 5 == 0) ecs.AddComponent<TECS::Mass>(entities[i], { i });
+		if (i % 7 == 0) ecs.AddComponent<TECS::Charge>(entities[i], { i });
+	}
+
+	ecs.ParallelForEach<TECS::Position, TECS::Velocity>([](TECS::EntityID, TECS::Position& p, TECS::Velocity& v) { p.y += v.y; }, 64);
+	ecs.ParallelForEach<TECS::Mass, TECS::Position>([](TECS::EntityID, TECS::Mass&, TECS::Position& p) { p.y += 10; }, 100);
+	ecs.ParallelForEach<TECS::Mass, TECS::Charge>([](TECS::EntityID, TECS::Mass& m, TECS::Charge& c) { m.kg = -c.coulomb; }, 128);
+
+	for (int i = 0; i < 5000; i++)
+	{
+		const int expected_y = ((i % 2 == 0) ? 1 : 0) + ((i % 5 == 0) ? 10 : 0);
+		ASSERT_EQ(ecs.GetComponent<TECS::Position>(entities[i]).y, expected_y);
+		if (i % 5 == 0) { ASSERT_EQ(ecs.GetComponent<TECS::Mass>(entities[i]).kg, (i % 7 == 0) ? -i : i); }
+	}
+	ecs.Clear();
+}
+
+TEST(ECS, TestArchetypeComponents)
+{
+	TECS::ArchetypeECS ecs{ };
+
+	std::vector<TECS::EntityID> entities;
+	for (int i = 0; i < 300; i++)
+	{
+		entities.push_back(ecs.CreateEntity());
+		ecs.AddComponent<TECS::Body>(entities[i], { i, 0 });
+		if (i % 2 == 0) ecs.AddComponent<TECS::Motion>(entities[i], { 0, 1 });
+		if (i % 3 == 0) ecs.AddComponent<TECS::Team>(entities[i], { i % 4 });
+		if (i % 5 == 0) ecs.AddComponent<TECS::Position>(entities[i], { i, i });
+	}
+	ecs.RemoveComponent<TECS::Motion>(entities[10]);
+	ecs.DestroyEntity(entities[12]);
+
+	ASSERT_EQ(ecs.GetComponentCount<TECS::Body>(), 299u);
+	ASSERT_EQ(ecs.GetComponentCount<TECS::Motion>(), 148u);
+
+	int visit_count = 0;
+	for (auto [e, b, m] : ecs.View<TECS::Body, TECS::Motion>())
+	{
+		ASSERT_EQ(b.x % 2, 0);
+		b.y += m.y;
+		visit_count++;
+	}
+	ASSERT_EQ(visit_count, 148);
+
+	ecs.ParallelForEach<TECS::Motion, TECS::Team>([](TECS::EntityID, TECS::Motion& m, TECS::Team&) { m.y += 10; }, 8);
+
+	int body_count = 0;
+	for (auto&& entry : ecs.CView<TECS::Body>())
+	{
+		(void)entry;
+		body_count++;
+	}
+	ASSERT_EQ(body_count, 299);
+
+	for (int i = 0; i < 300; i++)
+	{
+		if (i == 12) continue;
+		const bool has_motion = (i % 2 == 0) && (i != 10);
+		ASSERT_EQ(ecs.HasComponent<TECS::Motion>(entities[i]), has_motion);
+		ASSERT_EQ(ecs.HasComponent<TECS::Team>(entities[i]), i % 3 == 0);
+		ASSERT_EQ(ecs.HasComponent<TECS::Position>(entities[i]), i % 5 == 0);
+		ASSERT_EQ(ecs.GetComponent<TECS::Body>(entities[i]).x, i);
+		ASSERT_EQ(ecs.GetComponent<TECS::Body>(entities[i]).y, has_motion ? 1 : 0);
+		if (has_motion) { ASSERT_EQ(ecs.GetComponent<TECS::Motion>(entities[i]).y, (i % 3 == 0) ? 11 : 1); }
+	}
+
+	/* Archetype columns have no batch removal, RemoveComponents moves the entities one at a time */
+	const std::vector<TECS::EntityID> teamed{ entities[0], entities[3], entities[6] };
+	ecs.RemoveComponents<TECS::Team>(teamed);
+	for (const TECS::EntityID id : teamed)
+	{
+		ASSERT_FALSE(ecs.HasComponent<TECS::Team>(id));
+		ASSERT_TRUE(ecs.HasComponent<TECS::Body>(id));
+	}
+	ASSERT_EQ(ecs.GetComponentCount<TECS::Team>(), 96u);
+	ecs.Clear();
+}
+
+TEST(ECS, TestOwningGroup)
+{
+	TECS::ECS ecs{ };
+
+	std::vector<TECS::EntityID> entities;
+	for (int i = 0; i < 100; i++)
+	{
+		entities.push_back(ecs.CreateEntity());
+		ecs.AddComponent<TECS::Position>(entities[i], { i, 0 });
+		if (i % 2 == 0) ecs.AddComponent<TECS::Velocity>(entities[i], { 0, i });
+	}
+
+	auto& group = *ecs.Group<TECS::Position, TECS::Velocity>();
+	ASSERT_EQ(group.Size(), 50u);
+	ASSERT_EQ(&group, (ecs.Group<TECS::Position, TECS::Velocity>()));
+
+	/* A set is owned by a single group, other groups over it are refused and leave the first one working */
+	ASSERT_EQ((ecs.Group<TECS::Velocity, TECS::Position>()), nullptr);
+	ASSERT_EQ((ecs.Group<TECS::Position, TECS::Player>()), nullptr);
+	ASSERT_EQ((ecs.Group<TECS::Player, TECS::Enemy>()->Size()), 0u);
+	ASSERT_EQ((ecs.Group<TECS::Enemy, TECS::Player>()), nullptr);
+
+	/* Owned sets keep the order of the group */
+	const TECS::EntityID first_owner = ecs.ComponentOwners<TECS::Position>()[0];
+	ASSERT_FALSE(ecs.SortByEntity<TECS::Position>());
+	ASSERT_TRUE(ecs.SortByEntityIncremental<TECS::Velocity>(100));
+	ASSERT_EQ(ecs.ComponentOwners<TECS::Position>()[0], first_owner);
+
+	/* Structural changes after creation keep the group up to date */
+	ecs.AddComponent<TECS::Velocity>(entities[1], { 0, 1 });
+	ecs.RemoveComponent<TECS::Velocity>(entities[10]);
+	ecs.RemoveComponent<TECS::Position>(entities[20]);
+	ecs.DestroyEntity(entities[30]);
+	auto e = ecs.CreateEntity();
+	ecs.AddComponent<TECS::Velocity>(e, { 0, 1000 });
+	ecs.AddComponent<TECS::Position>(e, { 1000, 0 });
+	ASSERT_EQ(group.Size(), 49u);
+
+	int visit_count = 0;
+	for (auto [id, p, v] : group)
+	{
+		ASSERT_EQ(p.x, v.y);
+		ASSERT_TRUE(group.Contains(id));
+		p.y = 1;
+		visit_count++;
+	}
+	ASSERT_EQ(visit_count, 49);
+
+	group.ParallelForEach([](TECS::EntityID, TECS::Position& p, TECS::Velocity&) { p.y++; }, 8, lcs::ThreadPool::Default());
+
+	for (int i = 0; i < 100; i++)
+	{
+		if (i == 20 || i == 30) continue;
+		const bool grouped = (i % 2 == 0 && i != 10) || i == 1;
+		ASSERT_EQ(group.Contains(entities[i]), grouped);
+		ASSERT_EQ(ecs.GetComponent<TECS::Position>(entities[i]).y, grouped ? 2 : 0);
+	}
+
+	ecs.Clear();
+	ASSERT_EQ(group.Size(), 0u);
+}
+
+TEST(ECS, TestCopyAndMove)
+{
+	TECS::ECS ecs{ };
+
+	std::vector<TECS::EntityID> entities;
+	for (int i = 0; i < 100; i++)
+	{
+		entities.push_back(ecs.CreateEntity());
+		ecs.AddComponent<TECS::Position>(entities[i], { i, 0 });
+		if (i % 2 == 0) ecs.AddComponent<TECS::Velocity>(entities[i], { 0, i });
+	}
+
+	/* Managers without groups copy and move like values */
+	TECS::ECS copy = ecs;
+	copy.AddComponent<TECS::Velocity>(entities[1], { 0, 1 });
+	ASSERT_FALSE(ecs.HasComponent<TECS::Velocity>(entities[1]));
+
+	TECS::ECS moved = std::move(copy);
+	ASSERT_EQ(moved.GetEntityCount(), 100u);
+	ASSERT_TRUE(moved.HasComponent<TECS::Velocity>(entities[1]));
+	ASSERT_EQ(moved.GetComponent<TECS::Position>(entities[42]).x, 42);
+
+	/* Groups are created again on the new manager and follow its sets */
+	auto& group = *ecs.Group<TECS::Position, TECS::Velocity>();
+	TECS::ECS grouped_copy{ };
+	grouped_copy = ecs;
+	auto& copied_group = *grouped_copy.Group<TECS::Position, TECS::Velocity>();
+	ASSERT_NE(&copied_group, &group);
+	ASSERT_EQ(copied_group.Size(), 50u);
+	ASSERT_EQ((grouped_copy.Group<TECS::Velocity, TECS::Position>()), nullptr);
+
+	grouped_copy.RemoveComponent<TECS::Velocity>(entities[0]);
+	ASSERT_EQ(copied_group.Size(), 49u);
+	ASSERT_EQ(group.Size(), 50u);
+
+	TECS::ECS grouped_moved = std::move(grouped_copy);
+	auto& moved_group = *grouped_moved.Group<TECS::Position, TECS::Velocity>();
+	grouped_moved.AddComponent<TECS::Velocity>(entities[3], { 0, 3 });
+	ASSERT_EQ(moved_group.Size(), 50u);
+	ASSERT_TRUE(moved_group.Contains(entities[3]));
+	ASSERT_FALSE(moved_group.Contains(entities[0]));
+	for (auto&& entry : moved_group)
+	{
+		ASSERT_TRUE((grouped_moved.HasAll<TECS::Position, TECS::Velocity>(std::get<0>(entry))));
+	}
+}
+
+
+TEST(ECS, TestSoAComponents)
+{
+	TECS::ECS ecs{ };
+
+	std::vector<TECS::EntityID> entities;
+	for (int i = 0; i < 100; i++)
+	{
+		entities.push_back(ecs.CreateEntity());
+		ecs.AddComponent<TECS::Acceleration>(entities[i], { i, 2 * i });
+		if (i % 4 == 0) ecs.AddComponent<TECS::Position>(entities[i], { 0, 0 });
+	}
+	ecs.DestroyEntity(entities[8]);
+	ecs.RemoveComponent<TECS::Acceleration>(entities[12]);
+
+	ASSERT_TRUE(ecs.HasComponent<TECS::Acceleration>(entities[1]));
+	ASSERT_FALSE(ecs.HasComponent<TECS::Acceleration>(entities[12]));
+	ASSERT_EQ(ecs.GetComponent<TECS::Acceleration>(entities[7]).Get<&TECS::Acceleration::y>(), 14);
+
+	int visit_count = 0;
+	for (auto [id, a] : ecs.CView<TECS::Acceleration>())
+	{
+		ASSERT_EQ(a.Get<&TECS::Acceleration::x>() * 2, a.Get<&TECS::Acceleration::y>());
+		visit_count++;
+	}
+	ASSERT_EQ(visit_count, 98);
+
+	visit_count = 0;
+	for (auto [id, p, a] : ecs.View<TECS::Position, TECS::Acceleration>())
+	{
+		p.x += a.Get<&TECS::Acceleration::x>();
+		visit_count++;
+	}
+	ASSERT_EQ(visit_count, 23);
+
+	ecs.ParallelForEach<TECS::Position, TECS::Acceleration>([](TECS::EntityID, TECS::Position& p, lcs::SoARef<TECS::Acceleration> a) { p.y += a.Load().y; }, 4);
+
+	/* Bulk pass over a single field */
+	std::span<int> xs = ecs.ComponentField<&TECS::Acceleration::x>();
+	std::span<const TECS::EntityID> owners = ecs.ComponentOwners<TECS::Acceleration>();
+	ASSERT_EQ(xs.size(), owners.size());
+	for (size_t i = 0; i < xs.size(); i++)
+	{
+		xs[i] = -xs[i];
+	}
+
+	for (int i = 0; i < 100; i += 4)
+	{
+		if (i == 8) continue;
+		const TECS::Position& p = ecs.GetComponent<TECS::Position>(entities[i]);
+		ASSERT_EQ(p.x, i == 12 ? 0 : i);
+		ASSERT_EQ(p.y, i == 12 ? 0 : 2 * i);
+	}
+	const TECS::Acceleration a = ecs.GetComponent<TECS::Acceleration>(entities[5]);
+	ASSERT_EQ(a.x, -5);
+	ASSERT_EQ(a.y, 10);
+}
+
+
+TEST(ECS, TestBulkCreateAndAdd)
+{
+	TECS::ECS ecs{ };
+	auto& group = *ecs.Group<TECS::Position, TECS::Velocity>();
+
+	std::vector<TECS::EntityID> first(10);
+	ecs.CreateEntities(10, first);
+	ecs.DestroyEntity(first[4]);
+
+	std::vector<TECS::EntityID> entities(1000);
+	ecs.CreateEntities(1000, entities);
+	ASSERT_EQ(entities[0].GetIndex(), 4u);
+
+	std::vector<TECS::Position> positions;
+	std::vector<TECS::Velocity> velocities;
+	std::vector<TECS::Mass> masses;
+	std::vector<TECS::Acceleration> accelerations;
+	for (int i = 0; i < 1000; i++)
+	{
+		positions.push_back({ i, 0 });
+		velocities.push_back({ 0, i });
+		masses.push_back({ i });
+		accelerations.push_back({ i, -i });
+	}
+
+	ecs.AddComponents<TECS::Position>(entities, positions);
+	ecs.AddComponents<TECS::Velocity>(std::span(entities).first(500), std::span(velocities).first(500));
+	ecs.AddComponents<TECS::Mass>(entities, masses);
+	ecs.AddComponents<TECS::Acceleration>(entities, accelerations);
+	ASSERT_EQ(group.Size(), 500u);
+
+	for (int i = 0; i < 1000; i++)
+	{
+		ASSERT_EQ(ecs.GetComponent<TECS::Position>(entities[i]).x, i);
+		ASSERT_EQ(ecs.HasComponent<TECS::Velocity>(entities[i]), i < 500);
+		ASSERT_EQ(ecs.GetComponent<TECS::Mass>(entities[i]).kg, i);
+		ASSERT_EQ(ecs.GetComponent<TECS::Acceleration>(entities[i]).Load().y, -i);
+		ASSERT_EQ(group.Contains(entities[i]), i < 500);
+	}
+
+	/* Single creation keeps working after a bulk reservation */
+	const auto e = ecs.CreateEntity();
+	ecs.AddComponent<TECS::Position>(e, { 1, 1 });
+	ASSERT_EQ(ecs.GetComponent<TECS::Position>(e).x, 1);
+}
+
+TEST(ECS, TestBulkCreateReusesRestOfFreeChain)
+{
+	TECS::ECS ecs{ };
+	std::vector<TECS::EntityID> entities(8);
+	ecs.CreateEntities(8, entities);
+	for (const auto e : entities) ecs.AddComponent<TECS::Position>(e, { 0, 0 });
+	ecs.DestroyEntities(entities);
+
+	/* Indices left in the free chain after a smaller bulk request are handed out before new ones */
+	std::vector<TECS::EntityID> one(1);
+	ecs.CreateEntities(1, one);
+	const auto e = ecs.CreateEntity();
+	ASSERT_LT(e.GetIndex(), 8u);
+	ecs.AddComponent<TECS::Position>(e, { 1, 2 });
+	ASSERT_EQ(ecs.GetComponent<TECS::Position>(e).y, 2);
+	ASSERT_EQ(ecs.Entities().MaxIndex(), 8u);
+}
+
+
+TEST(ECS, TestCommandBuffer)
+{
+	using CommandBuffer = lcs::CommandBuffer<TECS::EntityID, TECS::Position, TECS::Velocity, TECS::Player, TECS::Enemy, TECS::Weapon, TECS::Mass, TECS::Charge, TECS::Fuel, TECS::Temperature, TECS::Acceleration, TECS::IsWet>;
+
+	TECS::ECS ecs{ };
+	CommandBuffer commands{};
+
+	std::vector<TECS::EntityID> entities;
+	for (int i = 0; i < 100; i++)
+	{
+		entities.push_back(ecs.CreateEntity());
+		ecs.AddComponent<TECS::Position>(entities[i], { i, 0 });
+		ecs.AddComponent<TECS::Mass>(entities[i], { i });
+	}
+
+	/* Structural changes while iterating are recorded instead of applied */
+	for (auto [id, p] : ecs.CView<TECS::Position>())
+	{
+		if (p.x % 2 == 0) commands.RemoveComponent<TECS::Position>(id);
+		if (p.x % 3 == 0) commands.AddComponent(id, TECS::Velocity{ 0, p.x });
+		if (p.x % 5 == 0) commands.AddTag<TECS::IsWet>(id);
+		if (p.x == 99) commands.DestroyEntity(id);
+	}
+	commands.RemoveComponent<TECS::Position>(entities[0]);
+	commands.DestroyEntity(entities[99]);
+
+	const auto pending = commands.CreateEntity();
+	commands.AddComponent(pending, TECS::Position{ 1000, 0 });
+	commands.AddComponent(pending, TECS::Acceleration{ 1, 2 });
+	ASSERT_FALSE(commands.Empty());
+	ASSERT_TRUE(ecs.HasComponent<TECS::Position>(entities[0]));
+
+	commands.Flush(ecs);
+	ASSERT_TRUE(commands.Empty());
+
+	for (int i = 0; i < 99; i++)
+	{
+		ASSERT_EQ(ecs.HasComponent<TECS::Position>(entities[i]), i % 2 != 0);
+		ASSERT_EQ(ecs.HasComponent<TECS::Velocity>(entities[i]), i % 3 == 0);
+		ASSERT_EQ(ecs.HasTag<TECS::IsWet>(entities[i]), i % 5 == 0);
+	}
+	ASSERT_EQ(ecs.GetEntityCount(), 100u);
+
+	int created_count = 0;
+	for (auto [id, p, a] : ecs.View<TECS::Position, TECS::Acceleration>())
+	{
+		ASSERT_EQ(p.x, 1000);
+		ASSERT_EQ(a.Load().y, 2);
+		created_count++;
+	}
+	ASSERT_EQ(created_count, 1);
+
+	/* Removals of one type are applied in one batch, repeated removals and missing components are skipped */
+	for (int i = 0; i < 99; i++)
+	{
+		if (i % 4 == 0) commands.RemoveComponent<TECS::Mass>(entities[i]);
+		if (i % 8 == 0) commands.RemoveComponent<TECS::Mass>(entities[i]);
+		commands.RemoveComponent<TECS::Velocity>(entities[i]);
+		commands.RemoveTag<TECS::IsWet>(entities[i]);
+	}
+	commands.Flush(ecs);
+
+	for (int i = 0; i < 99; i++)
+	{
+		ASSERT_EQ(ecs.HasComponent<TECS::Mass>(entities[i]), i % 4 != 0);
+		ASSERT_FALSE(ecs.HasComponent<TECS::Velocity>(entities[i]));
+		ASSERT_FALSE(ecs.HasTag<TECS::IsWet>(entities[i]));
+	}
+	ASSERT_EQ(ecs.Stats<TECS::Mass>().dense_count, 74u);
+	ASSERT_EQ(ecs.Stats<TECS::Velocity>().dense_count, 0u);
+}
+
+TEST(ECS, TestCommandBufferDuplicateAdds)
+{
+	using CommandBuffer = lcs::CommandBuffer<TECS::EntityID, TECS::Position, TECS::Velocity, TECS::Player, TECS::Enemy, TECS::Weapon, TECS::Mass, TECS::Charge, TECS::Fuel, TECS::Temperature, TECS::Acceleration, TECS::IsWet>;
+	using ParallelCommandBuffer = lcs::ParallelCommandBuffer<TECS::EntityID, TECS::Position, TECS::Velocity, TECS::Player, TECS::Enemy, TECS::Weapon, TECS::Mass, TECS::Charge, TECS::Fuel, TECS::Temperature, TECS::Acceleration, TECS::IsWet>;
+
+	TECS::ECS ecs{ };
+	std::vector<TECS::EntityID> entities(1000);
+	ecs.CreateEntities(1000, entities);
+	for (int i = 0; i < 1000; i++)
+	{
+		ecs.AddComponent<TECS::Position>(entities[i], { i, 0 });
+		if (i % 10 == 0) ecs.AddComponent<TECS::Velocity>(entities[i], { -1, -1 });
+		if (i % 10 == 0) ecs.AddTag<TECS::IsWet>(entities[i]);
+	}
+
+	/* The last add recorded wins, across appended buffers too, and existing components are overwritten */
+	CommandBuffer first{};
+	CommandBuffer second{};
+	for (int i = 0; i < 1000; i++)
+	{
+		first.AddComponent(entities[i], TECS::Velocity{ 1, 0 });
+		first.AddTag<TECS::IsWet>(entities[i]);
+		if (i % 2 == 0) second.AddComponent(entities[i], TECS::Velocity{ 2, 0 });
+		if (i % 3 == 0) second.AddComponent(entities[i], TECS::Velocity{ 3, 0 });
+		second.AddTag<TECS::IsWet>(entities[i]);
+	}
+	first.Append(second);
+	first.Flush(ecs);
+	for (int i = 0; i < 1000; i++)
+	{
+		ASSERT_EQ(ecs.GetComponent<TECS::Velocity>(entities[i]).x, i % 3 == 0 ? 3 : (i % 2 == 0 ? 2 : 1));
+		ASSERT_TRUE(ecs.HasTag<TECS::IsWet>(entities[i]));
+	}
+	ASSERT_EQ(ecs.Stats<TECS::Velocity>().dense_count, 1000u);
+
+	/* Threads adding the same component to one entity */
+	ParallelCommandBuffer commands{};
+	lcs::ThreadPool pool{ 3 };
+	ecs.View<const TECS::Position>().ParallelForEach([&](TECS::EntityID id, const TECS::Position& p)
+		{
+			auto& local = commands.Local();
+			local.AddComponent(entities[0], TECS::Mass{ 7 });
+			if (p.x % 2 == 0) local.AddComponent(id, TECS::Mass{ p.x });
+		}, 16, pool);
+	commands.Flush(ecs);
+	ASSERT_EQ(ecs.Stats<TECS::Mass>().dense_count, 500u);
+	ASSERT_EQ(ecs.GetComponent<TECS::Mass>(entities[2]).kg, 2);
+	const int first_mass = ecs.GetComponent<TECS::Mass>(entities[0]).kg;
+	ASSERT_TRUE(first_mass == 0 || first_mass == 7);
+}
+
+TEST(ECS, TestParallelCommandBuffer)
+{
+	using ParallelCommandBuffer = lcs::ParallelCommandBuffer<TECS::EntityID, TECS::Position, TECS::Velocity, TECS::Player, TECS::Enemy, TECS::Weapon, TECS::Mass, TECS::Charge, TECS::Fuel, TECS::Temperature, TECS::Acceleration, TECS::IsWet>;
+
+	TECS::ECS ecs{ };
+	ParallelCommandBuffer commands{};
+	lcs::ThreadPool pool{ 3 };
+
+	std::vector<TECS::EntityID> entities(1000);
+	ecs.CreateEntities(1000, entities);
+	for (int i = 0; i < 1000; i++)
+	{
+		ecs.AddComponent<TECS::Position>(entities[i], { i, 0 });
+	}
+
+	for (int frame = 0; frame < 2; frame++)
+	{
+		ecs.View<TECS::Position>().ParallelForEach([&](TECS::EntityID id, TECS::Position& p)
+			{
+				auto& local = commands.Local();
+				if (p.x % 4 == frame) local.DestroyEntity(id);
+				if (p.x % 4 == 3 && frame == 0)
+				{
+					const auto child = local.CreateEntity();
+					local.AddComponent(child, TECS::Velocity{ p.x, 0 });
+				}
+			}, 16, pool);
+		commands.Flush(ecs);
+	}
+
+	ASSERT_EQ(ecs.GetEntityCount(), 750u);
+	int child_count = 0;
+	for (auto [id, v] : ecs.CView<TECS::Velocity>())
+	{
+		ASSERT_EQ(v.x % 4, 3);
+		child_count++;
+	}
+	ASSERT_EQ(child_count, 250);
+	for (int i = 0; i < 1000; i++)
+	{
+		ASSERT_EQ(ecs.Entities().IsOccupied(entities[i].GetIndex()) && ecs.HasComponent<TECS::Position>(entities[i]), i % 4 >= 2);
+	}
+}
+
+
+TEST(ECS, TestChangedView)
+{
+	TECS::ECS ecs{ };
+
+	std::vector<TECS::EntityID> entities(1000);
+	ecs.CreateEntities(1000, entities);
+	for (int i = 0; i < 1000; i++)
+	{
+		ecs.AddComponent<TECS::Fuel>(entities[i], { i });
+		ecs.AddComponent<TECS::Temperature>(entities[i], { i });
+	}
+
+	/* Everything added before the first sync counts as changed */
+	uint32_t last_sync = 0;
+	int changed_count = 0;
+	for (auto&& entry : ecs.Changed<const TECS::Temperature>(last_sync)) { (void)entry; changed_count++; }
+	ASSERT_EQ(changed_count, 1000);
+	last_sync = ecs.AdvanceTick();
+
+	changed_count = 0;
+	for (auto&& entry : ecs.Changed<const TECS::Temperature>(last_sync)) { (void)entry; changed_count++; }
+	ASSERT_EQ(changed_count, 0);
+
+	/* Per slot stamps report exactly the written entities */
+	ecs.WriteComponent<TECS::Temperature>(entities[3]).kelvin = 10;
+	ecs.MarkChanged<TECS::Temperature>(entities[700]);
+	std::vector<int> changed{};
+	for (auto [id, t] : ecs.Changed<const TECS::Temperature>(last_sync)) changed.push_back(t.kelvin);
+	std::sort(changed.begin(), changed.end());
+	ASSERT_EQ(changed, (std::vector<int>{ 10, 700 }));
+
+	/* Per chunk stamps report the whole chunk of a written entity */
+	ecs.WriteComponent<TECS::Fuel>(entities[130]).liters = -1;
+	changed_count = 0;
+	for (auto [id, f] : ecs.Changed<TECS::Fuel>(last_sync))
+	{
+		ASSERT_EQ(id.GetIndex() / 64, 130u / 64);
+		changed_count++;
+	}
+	ASSERT_EQ(changed_count, 64);
+
+	/* Changes after the sync but within its tick are reported next time */
+	last_sync = ecs.AdvanceTick();
+	ecs.MarkChanged<TECS::Fuel>(entities[999]);
+	ecs.DestroyEntity(entities[0]);
+	changed_count = 0;
+	for (auto [id, f] : ecs.Changed<TECS::Fuel>(last_sync))
+	{
+		ASSERT_EQ(id.GetIndex() / 64, 999u / 64);
+		changed_count++;
+	}
+	ASSERT_EQ(changed_count, 1000 - 960);
+}
+
+TEST(ECS, TestChangedViewSeesViewWrites)
+{
+	TECS::ECS ecs{ };
+
+	std::vector<TECS::EntityID> entities(1000);
+	ecs.CreateEntities(1000, entities);
+	for (int i = 0; i < 1000; i++)
+	{
+		ecs.AddComponent<TECS::Temperature>(entities[i], { i });
+		if (i % 2 == 0) ecs.AddComponent<TECS::Fuel>(entities[i], { i });
+		if (i < 100) ecs.AddComponent<TECS::Position>(entities[i], { i, 0 });
+	}
+	const auto count_changed = [&](uint32_t since_tick) { int count = 0; for ([[maybe_unused]] auto [id, t] : ecs.Changed<const TECS::Temperature>(since_tick)) count++; return count; };
+
+	/* Read-only passes stamp nothing */
+	uint32_t last_sync = ecs.AdvanceTick();
+	int sum = 0;
+	for (auto [id, t] : ecs.CView<const TECS::Temperature>()) sum += t.kelvin;
+	for (auto [id, f, t] : ecs.View<const TECS::Fuel, const TECS::Temperature>()) sum += f.liters + t.kelvin;
+	ASSERT_EQ(sum, 999 * 1000 / 2 + 998 * 500);
+	ASSERT_EQ(count_changed(last_sync), 0);
+
+	/* Every kind of view stamps the entries it hands out mutably */
+	for (auto [id, t] : ecs.CView<TECS::Temperature>()) t.kelvin++;
+	ASSERT_EQ(count_changed(last_sync), 1000);
+
+	last_sync = ecs.AdvanceTick();
+	for (auto [id, f, t] : ecs.View<const TECS::Fuel, TECS::Temperature>()) t.kelvin++;
+	ASSERT_EQ(count_changed(last_sync), 500);
+
+	last_sync = ecs.AdvanceTick();
+	for (auto [id, p, t] : ecs.View<const TECS::Position, TECS::Temperature>()) t.kelvin++;
+	ASSERT_EQ(count_changed(last_sync), 100);
+
+	last_sync = ecs.AdvanceTick();
+	ecs.ParallelForEach<TECS::Position, TECS::Temperature>([](TECS::EntityID, TECS::Position&, TECS::Temperature& t) { t.kelvin++; });
+	ASSERT_EQ(count_changed(last_sync), 100);
+
+	last_sync = ecs.AdvanceTick();
+	ecs.ForEachChunk<TECS::Temperature>([](TECS::Temperature* data, const TECS::EntityID*, auto, auto) { data[0].kelvin++; });
+	ASSERT_EQ(count_changed(last_sync), 1000);
+
+	/* A mutable pass over the changes stamps them again, a read-only one does not */
+	last_sync = ecs.AdvanceTick();
+	ecs.WriteComponent<TECS::Temperature>(entities[7]).kelvin = 0;
+	uint32_t pass_sync = ecs.AdvanceTick();
+	for (auto [id, t] : ecs.Changed<TECS::Temperature>(last_sync)) t.kelvin++;
+	ASSERT_EQ(count_changed(pass_sync), 1);
+	last_sync = pass_sync;
+	pass_sync = ecs.AdvanceTick();
+	for (auto [id, t] : ecs.Changed<const TECS::Temperature>(last_sync)) sum += t.kelvin;
+	ASSERT_EQ(count_changed(pass_sync), 0);
+	ASSERT_EQ(ecs.GetComponent<TECS::Temperature>(entities[7]).kelvin, 1);
+}
+
+TEST(ECS, TestEntitySignature)
+{
+	TECS::ECS ecs{ };
+	const TECS::EntityID e1 = TECS::CreatePlayer(ecs, 1, 2);
+	ecs.AddComponent<TECS::Mass>(e1, { 3 });
+	ecs.AddComponent<TECS::Acceleration>(e1, { 1, 2 });
+	ecs.AddTag<TECS::IsWet>(e1);
+	const TECS::EntityID e2 = TECS::CreateEnemy(ecs, 3, 4);
+
+	ASSERT_TRUE((ecs.HasAll<TECS::Position, TECS::Velocity, TECS::Player, TECS::Mass, TECS::Acceleration, TECS::IsWet>(e1)));
+	ASSERT_TRUE(!(ecs.HasAll<TECS::Position, TECS::Enemy>(e1)));
+	ASSERT_TRUE((ecs.HasAll<TECS::Position, TECS::Enemy>(e2)));
+	ASSERT_TRUE(ecs.HasAll<>(e2));
+
+	ecs.RemoveComponent<TECS::Mass>(e1);
+	ecs.RemoveTag<TECS::IsWet>(e1);
+	ASSERT_TRUE(!ecs.HasComponent<TECS::Mass>(e1));
+	ASSERT_TRUE(!ecs.HasTag<TECS::IsWet>(e1));
+	ASSERT_TRUE((ecs.HasAll<TECS::Position, TECS::Acceleration>(e1)));
+
+	/* Destroying visits the containers named by the signature and leaves the reused index empty */
+	ecs.DestroyEntity(e1);
+	ASSERT_TRUE(!ecs.HasComponent<TECS::Position>(e1));
+	ASSERT_EQ(ecs.ComponentOwners<TECS::Position>().size(), 1u);
+	ASSERT_EQ(ecs.ComponentOwners<TECS::Acceleration>().size(), 0u);
+
+	const TECS::EntityID e3 = ecs.CreateEntity();
+	ASSERT_EQ(e3.GetIndex(), e1.GetIndex());
+	ASSERT_TRUE(!ecs.HasComponent<TECS::Position>(e3));
+	ASSERT_TRUE(!ecs.HasComponent<TECS::Player>(e3));
+	ecs.DestroyEntity(e3);
+
+	/* Archetype components leave the archetype storage in one step */
+	TECS::ArchetypeECS archetype_ecs{ };
+	const TECS::EntityID a1 = archetype_ecs.CreateEntity();
+	archetype_ecs.AddComponent<TECS::Body>(a1, { 1, 2 });
+	archetype_ecs.AddComponent<TECS::Team>(a1, { 3 });
+	archetype_ecs.AddComponent<TECS::Position>(a1, { 4, 5 });
+	ASSERT_TRUE((archetype_ecs.HasAll<TECS::Body, TECS::Team, TECS::Position>(a1)));
+	archetype_ecs.DestroyEntity(a1);
+
+	const TECS::EntityID a2 = archetype_ecs.CreateEntity();
+	ASSERT_TRUE(!archetype_ecs.HasComponent<TECS::Body>(a2));
+	archetype_ecs.AddComponent<TECS::Body>(a2, { 6, 7 });
+	ASSERT_EQ(archetype_ecs.GetComponentCount<TECS::Body>(), 1u);
+	ASSERT_EQ(archetype_ecs.GetComponentCount<TECS::Team>(), 0u);
+}
+
+TEST(ECS, TestDestroyEntities)
+{
+	TECS::ECS ecs{ };
+	std::vector<TECS::EntityID> entities(300);
+	ecs.CreateEntities(300, entities);
+	for (int i = 0; i < 300; i++)
+	{
+		ecs.AddComponent<TECS::Position>(entities[i], { i, 0 });
+		if (i % 2 == 0) ecs.AddComponent<TECS::Velocity>(entities[i], { 0, i });
+		if (i % 3 == 0) ecs.AddComponent<TECS::Mass>(entities[i], { i });
+		if (i % 5 == 0) ecs.AddComponent<TECS::Acceleration>(entities[i], { i, i });
+		if (i % 7 == 0) ecs.AddTag<TECS::IsWet>(entities[i]);
+	}
+	auto& group = *ecs.Group<TECS::Position, TECS::Velocity>();
+	ASSERT_EQ(group.Size(), 150u);
+
+	std::vector<TECS::EntityID> destroyed{};
+	for (int i = 0; i < 300; i++)
+	{
+		if (i % 4 == 0 || (i >= 100 && i < 200)) destroyed.push_back(entities[i]);
+	}
+	ecs.DestroyEntities(destroyed);
+	ASSERT_EQ(ecs.GetEntityCount(), 300u - uint32_t(destroyed.size()));
+
+	uint32_t position_count = 0, velocity_count = 0, acceleration_count = 0;
+	for (int i = 0; i < 300; i++)
+	{
+		if (i % 4 == 0 || (i >= 100 && i < 200)) continue;
+		position_count++;
+		velocity_count += i % 2 == 0 ? 1 : 0;
+		acceleration_count += i % 5 == 0 ? 1 : 0;
+		ASSERT_EQ(ecs.GetComponent<TECS::Position>(entities[i]).x, i);
+		ASSERT_EQ(ecs.HasComponent<TECS::Velocity>(entities[i]), i % 2 == 0);
+		ASSERT_EQ(ecs.HasComponent<TECS::Mass>(entities[i]), i % 3 == 0);
+		if (i % 3 == 0) { ASSERT_EQ(ecs.GetComponent<TECS::Mass>(entities[i]).kg, i); }
+		if (i % 5 == 0) { ASSERT_EQ(ecs.GetComponent<TECS::Acceleration>(entities[i]).Get<&TECS::Acceleration::y>(), i); }
+		ASSERT_EQ(ecs.HasTag<TECS::IsWet>(entities[i]), i % 7 == 0);
+		ASSERT_EQ(group.Contains(entities[i]), i % 2 == 0);
+	}
+	ASSERT_EQ(ecs.ComponentOwners<TECS::Position>().size(), position_count);
+	ASSERT_EQ(ecs.ComponentOwners<TECS::Acceleration>().size(), acceleration_count);
+	ASSERT_EQ(group.Size(), velocity_count);
+
+	int visit_count = 0;
+	for (auto [id, p, v] : group)
+	{
+		ASSERT_EQ(p.x, v.y);
+		visit_count++;
+	}
+	ASSERT_EQ(visit_count, int(velocity_count));
+
+	/* Freed indices are handed out again */
+	std::vector<TECS::EntityID> recreated(destroyed.size());
+	ecs.CreateEntities(uint32_t(recreated.size()), recreated);
+	for (const TECS::EntityID id : recreated)
+	{
+		ASSERT_TRUE(!ecs.HasComponent<TECS::Position>(id));
+	}
+	ASSERT_EQ(ecs.GetEntityCount(), 300u);
+}
+
+TEST(ECS, TestMemoryResource)
+{
+	struct CountingResource : std::pmr::memory_resource
+	{
+		size_t allocation_count{ 0 };
+		size_t bytes_in_use{ 0 };
+
+		void* do_allocate(size_t bytes, size_t alignment) override { allocation_count++; bytes_in_use += bytes; return std::pmr::new_delete_resource()->allocate(bytes, alignment); }
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override { bytes_in_use -= bytes; std::pmr::new_delete_resource()->deallocate(p, bytes, alignment); }
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+	};
+
+	CountingResource resource{};
+
+	/* Any allocation bypassing the resource would hit the null resource and throw */
+	std::pmr::memory_resource* previous_default = std::pmr::set_default_resource(std::pmr::null_memory_resource());
+	{
+		TECS::ECS ecs{ &resource };
+		TECS::ArchetypeECS archetype_ecs{ &resource };
+
+		std::vector<TECS::EntityID> entities(500);
+		ecs.CreateEntities(500, entities);
+		for (int i = 0; i < 500; i++)
+		{
+			ecs.AddComponent<TECS::Position>(entities[i], { i, i });
+			ecs.AddComponent<TECS::Mass>(entities[i], { i });
+			ecs.AddComponent<TECS::Temperature>(entities[i], { i });
+			ecs.AddComponent<TECS::Acceleration>(entities[i], { i, 0 });
+			if (i % 2 == 0) ecs.AddTag<TECS::IsWet>(entities[i]);
+
+			const TECS::EntityID e = archetype_ecs.CreateEntity();
+			archetype_ecs.AddComponent<TECS::Body>(e, { i, 0 });
+			if (i % 3 == 0) archetype_ecs.AddComponent<TECS::Team>(e, { i });
+		}
+		for (int i = 0; i < 500; i += 7)
+		{
+			ecs.DestroyEntity(entities[i]);
+		}
+		ASSERT_EQ(ecs.ComponentOwners<TECS::Position>().size(), 500u - 72u);
+		ASSERT_EQ(ecs.GetComponent<TECS::Mass>(entities[1]).kg, 1);
+		ASSERT_GT(resource.allocation_count, 0u);
+		ASSERT_GT(resource.bytes_in_use, 0u);
+
+		ecs.Clear();
+		archetype_ecs.Clear();
+	}
+	std::pmr::set_default_resource(previous_default);
+	ASSERT_EQ(resource.bytes_in_use, 0u);
+}
+
+TEST(ECS, TestMemoryReport)
+{
+	TECS::ECS ecs{};
+	std::vector<TECS::EntityID> entities(1000);
+	ecs.CreateEntities(1000, entities);
+	for (int i = 0; i < 1000; i++)
+	{
+		ecs.AddComponent<TECS::Position>(entities[i], { i, i });
+		if (i % 4 == 0) ecs.AddComponent<TECS::Mass>(entities[i], { i });
+		if (i % 2 == 0) ecs.AddTag<TECS::IsWet>(entities[i]);
+	}
+	for (int i = 0; i < 1000; i += 10)
+	{
+		ecs.DestroyEntity(entities[i]);
+	}
+
+	/* Every fourth slot of the 64 wide chunks covering 1000 entities holds a Mass, minus the destroyed ones */
+	const lcs::ContainerStats mass = ecs.Stats<TECS::Mass>();
+	ASSERT_EQ(mass.dense_count, 250u - 50u);
+	ASSERT_DOUBLE_EQ(mass.fill_ratio, 200.0 / (16.0 * 64.0));
+	ASSERT_GE(mass.sparse_capacity, 1000u);
+	ASSERT_GE(mass.bytes_allocated, 16u * 64u * sizeof(TECS::Mass));
+
+	const lcs::ContainerStats position = ecs.Stats<TECS::Position>();
+	ASSERT_EQ(position.dense_count, 900u);
+	ASSERT_GT(position.fill_ratio, 0.0);
+	ASSERT_LE(position.fill_ratio, 1.0);
+	ASSERT_GE(position.bytes_allocated, 900u * (sizeof(TECS::Position) + sizeof(TECS::EntityID)));
+
+	const auto report = ecs.MemoryReport();
+	ASSERT_EQ(report.entities.dense_count, 900u);
+	ASSERT_EQ(report.entities.free_list_length, 100u);
+	ASSERT_EQ(report.components[0].dense_count, 900u);
+	ASSERT_EQ(report.components[10].dense_count, 500u - 100u);
+	ASSERT_EQ(report.components[3].dense_count, 0u);
+	ASSERT_EQ(report.archetypes.dense_count, 0u);
+
+	uint64_t component_bytes = 0;
+	for (const lcs::ContainerStats& stats : report.components) component_bytes += stats.bytes_allocated;
+	ASSERT_EQ(report.total_bytes, report.entities.bytes_allocated + component_bytes + report.archetypes.bytes_allocated);
+
+	/* Archetype components report their columns, which are part of the archetype storage */
+	TECS::ArchetypeECS archetype_ecs{};
+	for (int i = 0; i < 100; i++)
+	{
+		const TECS::EntityID e = archetype_ecs.CreateEntity();
+		archetype_ecs.AddComponent<TECS::Body>(e, { i, 0 });
+		if (i % 2 == 0) archetype_ecs.AddComponent<TECS::Team>(e, { i });
+	}
+	const auto archetype_report = archetype_ecs.MemoryReport();
+	ASSERT_EQ(archetype_report.components[0].dense_count, 100u);
+	ASSERT_EQ(archetype_report.components[3].dense_count, 50u);
+	ASSERT_EQ(archetype_report.archetypes.dense_count, 100u);
+	ASSERT_GE(archetype_report.archetypes.bytes_allocated, archetype_report.components[0].bytes_allocated + archetype_report.components[3].bytes_allocated);
+	ASSERT_EQ(archetype_report.total_bytes, archetype_report.entities.bytes_allocated + archetype_report.components[2].bytes_allocated
+		+ archetype_report.components[4].bytes_allocated + archetype_report.archetypes.bytes_allocated);
+}
@@ -194,4 +194,102 @@ TEST(HandleFreeList, Empty)
 	lcs::HandleFreeList<TestHandle> list{};
 	ASSERT_TRUE(list.MaxIndex() == 0);
 	for (auto i : list) {}
-}
\ No newline at end of file
+}
+TEST(HandleFreeList, GetNextHandles)
+{
+	lcs::HandleFreeList<TestHandle> list{};
+	std::vector<TestHandle> first(4);
+	list.GetNextHandles(first);
+	list.FreeHandle(first[1]);
+	list.FreeHandle(first[3]);
+
+	std::vector<TestHandle> second(5);
+	list.GetNextHandles(second);
+	ASSERT_EQ(list.UsedIndexCount(), 7u);
+	ASSERT_EQ(list.MaxIndex(), 7u);
+
+	/* Freed indices come first, in free list order, with a new validation id */
+	ASSERT_EQ(second[0].GetIndex(), 3u);
+	ASSERT_EQ(second[1].GetIndex(), 1u);
+	ASSERT_NE(second[0].GetValidationID(), first[3].GetValidationID());
+	for (uint32_t i = 2; i < 5; i++)
+	{
+		ASSERT_EQ(second[i].GetIndex(), 2 + i);
+		ASSERT_TRUE(list.IsOccupied(second[i].GetIndex()));
+	}
+
+	ASSERT_EQ(list.GetNextHandle().GetIndex(), 7u);
+
+	/* A free chain longer than the request keeps its remaining indices */
+	std::vector<TestHandle> all(8);
+	list.GetNextHandles(all);
+	for (const TestHandle handle : all) list.FreeHandle(handle);
+	list.FreeHandle(first[0]);
+	std::vector<TestHandle> third(3);
+	list.GetNextHandles(third);
+	for (uint32_t i = 0; i < 6; i++) ASSERT_LT(list.GetNextHandle().GetIndex(), 16u);
+	ASSERT_EQ(list.MaxIndex(), 16u);
+	ASSERT_EQ(list.GetNextHandle().GetIndex(), 16u);
+}
+
+TEST(HandleFreeList, FragmentedIteration)
+{
+	lcs::HandleFreeList<TestHandle> list{};
+	std::vector<TestHandle> handles(300);
+	list.GetNextHandles(handles);
+
+	/* Leaves whole free words between the survivors, and frees the first and last index */
+	std::vector<TestHandle> expected{};
+	for (uint32_t i = 0; i < 300; i++)
+	{
+		if (i != 0 && i != 299 && (i < 64 || i >= 192) && i % 3 != 0) expected.push_back(handles[i]);
+		else list.FreeHandle(handles[i]);
+	}
+
+	const lcs::HandleFreeList<TestHandle>& const_list = list;
+	std::vector<TestHandle> forward(const_list.begin(), const_list.end());
+	ASSERT_EQ(forward, expected);
+
+	std::vector<TestHandle> backward(const_list.rbegin(), const_list.rend());
+	std::reverse(backward.begin(), backward.end());
+	ASSERT_EQ(backward, expected);
+
+	/* Reused indices show up again, freed ones at the end stay skipped */
+	const TestHandle reused = list.GetNextHandle();
+	ASSERT_EQ(reused.GetIndex(), 299u);
+	ASSERT_EQ(*std::prev(const_list.end()), reused);
+
+	list.Clear();
+	ASSERT_TRUE(const_list.begin() == const_list.end());
+}
+
+TEST(HandleFreeList, ReusedIndexIsOccupied)
+{
+	lcs::HandleFreeList<TestHandle> list{};
+	const TestHandle first = list.GetNextHandle();
+	list.FreeHandle(first);
+	ASSERT_TRUE(!list.IsCurrent(first));
+
+	const TestHandle reused = list.GetNextHandle();
+	ASSERT_EQ(reused.GetIndex(), first.GetIndex());
+	ASSERT_TRUE(list.IsOccupied(reused.GetIndex()));
+	ASSERT_TRUE(list.IsCurrent(reused));
+	ASSERT_TRUE(!list.IsCurrent(first));
+	list.FreeHandle(reused);
+}
+
+TEST(HandleFreeList, NarrowValidationBits)
+{
+	/* Validation ids must not overlap the 24 index bits */
+	using NarrowHandle = lcs::Handle<uint32_t, 8>;
+	lcs::HandleFreeList<NarrowHandle> list{};
+	std::vector<NarrowHandle> handles(1000);
+	list.GetNextHandles(handles);
+	list.FreeHandle(handles[700]);
+
+	const NarrowHandle reused = list.GetNextHandle();
+	ASSERT_EQ(reused.GetIndex(), 700u);
+	ASSERT_NE(reused.GetValidationID(), handles[700].GetValidationID());
+	ASSERT_TRUE(list.IsCurrent(reused));
+	ASSERT_TRUE(!list.IsCurrent(handles[700]));
+}
@@ -0,0 +1,39 @@
+#include <gtest/gtest.h>
+
+#include <lutra-ecs/PagedIndexArray.h>
+
+TEST(PagedIndexArray, AllocatesPagesOnWrite)
+{
+	using Array = lcs::PagedIndexArray<uint32_t, 4>;
+
+	Array array{};
+	array.resize(1000);
+	ASSERT_EQ(array.size(), 1000u);
+	ASSERT_EQ(array.AllocatedPageCount(), 0u);
+	ASSERT_EQ(array[0], Array::invalid_value);
+	ASSERT_EQ(array[999], Array::invalid_value);
+
+	array.At(17) = 5;
+	array.At(18) = 6;
+	array.At(999) = 7;
+	ASSERT_EQ(array.AllocatedPageCount(), 2u);
+	ASSERT_EQ(array[17], 5u);
+	ASSERT_EQ(array[18], 6u);
+	ASSERT_EQ(array[16], Array::invalid_value);
+	ASSERT_EQ(array[999], 7u);
+
+	/* Growing keeps existing entries */
+	array.resize(5000);
+	ASSERT_EQ(array[17], 5u);
+	ASSERT_EQ(array[4999], Array::invalid_value);
+
+	Array copy = array;
+	copy.At(17) = 100;
+	ASSERT_EQ(array[17], 5u);
+	ASSERT_EQ(copy[17], 100u);
+	ASSERT_EQ(copy[999], 7u);
+
+	array.clear();
+	ASSERT_EQ(array.size(), 0u);
+	ASSERT_EQ(array.AllocatedPageCount(), 0u);
+}
@@ -0,0 +1,561 @@
+#pragma once
+#include <gtest/gtest.h>
+#include <lutra-ecs/ECSManager.h>
+#include <lutra-ecs/SnapshotFile.h>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <string>
+#include <vector>
+
+namespace TSnapshot
+{
+	using EntityID = lcs::Handle<uint32_t, 16>;
+
+	struct Position
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Component;
+		int x, y;
+	};
+	struct Heat
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::ComponentChunked;
+		static constexpr lcs::ChangeTracking change_tracking = lcs::ChangeTracking::PerSlot;
+		int kelvin;
+	};
+	struct Spin
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::SoA;
+		int x, y;
+		static constexpr std::tuple soa_fields{ &Spin::x, &Spin::y };
+	};
+	struct Body
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Archetype;
+		int mass;
+	};
+	struct IsWet
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Tag;
+	};
+	struct IsHot
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::TagBitset;
+	};
+
+	using ECS = lcs::ECSManager<EntityID, Position, Heat, Spin, Body, IsWet, IsHot>;
+	using OtherECS = lcs::ECSManager<EntityID, Position, Heat>;
+
+	struct Velocity
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Component;
+		int x, y;
+	};
+	using GroupedECS = lcs::ECSManager<EntityID, Position, Velocity>;
+
+	inline std::string TempPath(const char* name)
+	{
+		return (std::filesystem::temp_directory_path() / name).string();
+	}
+
+	/* 1000 entities with every kind of container, and every third one destroyed again */
+	inline std::vector<EntityID> Populate(ECS& ecs)
+	{
+		std::vector<EntityID> entities(1000);
+		ecs.CreateEntities(1000, entities);
+		for (uint32_t i = 0; i < 1000; i++)
+		{
+			const EntityID e = entities[i];
+			ecs.AddComponent<Position>(e, { int(i), -int(i) });
+			if (i % 2 == 0) ecs.AddComponent<Heat>(e, { int(i) * 10 });
+			if (i % 5 == 0) ecs.AddComponent<Spin>(e, { 1, int(i) });
+			if (i % 7 == 0) ecs.AddComponent<Body>(e, { int(i) });
+			if (i % 4 == 0) ecs.AddTag<IsWet>(e);
+			if (i % 6 == 0) ecs.AddTag<IsHot>(e);
+		}
+		ecs.AdvanceTick();
+
+		std::vector<EntityID> alive{};
+		for (uint32_t i = 0; i < 1000; i++)
+		{
+			if (i % 3 == 0) ecs.DestroyEntity(entities[i]);
+			else alive.push_back(entities[i]);
+		}
+		return alive;
+	}
+
+	/* Compares every entity, component and tag of two managers */
+	inline void ExpectSameWorld(ECS& a, ECS& b)
+	{
+		ASSERT_EQ(a.GetEntityCount(), b.GetEntityCount());
+		ASSERT_TRUE(std::ranges::equal(a.Entities(), b.Entities()));
+		ASSERT_EQ(a.CurrentTick(), b.CurrentTick());
+		for (const EntityID e : a.Entities())
+		{
+			ASSERT_EQ(a.HasComponent<Position>(e), b.HasComponent<Position>(e));
+			if (a.HasComponent<Position>(e)) { ASSERT_EQ(a.GetComponent<Position>(e).x, b.GetComponent<Position>(e).x); }
+			ASSERT_EQ(a.HasComponent<Heat>(e), b.HasComponent<Heat>(e));
+			if (a.HasComponent<Heat>(e)) { ASSERT_EQ(a.GetComponent<Heat>(e).kelvin, b.GetComponent<Heat>(e).kelvin); }
+			ASSERT_EQ(a.HasComponent<Spin>(e), b.HasComponent<Spin>(e));
+			if (a.HasComponent<Spin>(e)) { ASSERT_EQ(a.GetComponent<Spin>(e).Get<&Spin::y>(), b.GetComponent<Spin>(e).Get<&Spin::y>()); }
+			ASSERT_EQ(a.HasComponent<Body>(e), b.HasComponent<Body>(e));
+			if (a.HasComponent<Body>(e)) { ASSERT_EQ(a.GetComponent<Body>(e).mass, b.GetComponent<Body>(e).mass); }
+			ASSERT_EQ(a.HasTag<IsWet>(e), b.HasTag<IsWet>(e));
+			ASSERT_EQ(a.HasTag<IsHot>(e), b.HasTag<IsHot>(e));
+		}
+		ASSERT_TRUE(std::ranges::equal(a.ComponentOwners<Position>(), b.ComponentOwners<Position>()));
+		ASSERT_TRUE(std::ranges::equal(a.ComponentOwners<Spin>(), b.ComponentOwners<Spin>()));
+		ASSERT_EQ(a.QueryTags<IsHot>().Count(), b.QueryTags<IsHot>().Count());
+	}
+}
+
+TEST(Snapshot, RoundTrip)
+{
+	using namespace TSnapshot;
+	const std::string path = TempPath("lcs_snapshot_round_trip.bin");
+
+	ECS saved{};
+	const std::vector<EntityID> alive = Populate(saved);
+	ASSERT_TRUE(saved.SaveSnapshot(path.c_str()));
+
+	ECS loaded{};
+	loaded.CreateEntity(); /* Replaced by the load */
+	ASSERT_TRUE(lcs::LoadSnapshot(loaded, path.c_str()));
+	std::filesystem::remove(path);
+
+	ASSERT_EQ(loaded.GetEntityCount(), saved.GetEntityCount());
+	ASSERT_TRUE(std::ranges::equal(loaded.Entities(), saved.Entities()));
+	ASSERT_EQ(loaded.CurrentTick(), saved.CurrentTick());
+	for (const EntityID e : alive)
+	{
+		const uint32_t i = e.GetIndex();
+		ASSERT_EQ(loaded.GetComponent<Position>(e).x, int(i));
+		ASSERT_EQ(loaded.HasComponent<Heat>(e), i % 2 == 0);
+		if (i % 2 == 0) { ASSERT_EQ(loaded.GetComponent<Heat>(e).kelvin, int(i) * 10); }
+		ASSERT_EQ(loaded.HasComponent<Spin>(e), i % 5 == 0);
+		if (i % 5 == 0) { ASSERT_EQ(loaded.GetComponent<Spin>(e).Get<&Spin::y>(), int(i)); }
+		ASSERT_EQ(loaded.HasComponent<Body>(e), i % 7 == 0);
+		if (i % 7 == 0) { ASSERT_EQ(loaded.GetComponent<Body>(e).mass, int(i)); }
+		ASSERT_EQ(loaded.HasTag<IsWet>(e), i % 4 == 0);
+		ASSERT_EQ(loaded.HasTag<IsHot>(e), i % 6 == 0);
+	}
+	ASSERT_TRUE(std::ranges::equal(loaded.ComponentOwners<Position>(), saved.ComponentOwners<Position>()));
+	ASSERT_EQ(loaded.QueryTags<IsHot>().Count(), saved.QueryTags<IsHot>().Count());
+
+	/* Change ticks survive, so systems keep seeing changes made before the save */
+	const auto count_changed = [](ECS& ecs) { uint32_t count = 0; for ([[maybe_unused]] auto [e, heat] : ecs.Changed<Heat>(1)) count++; return count; };
+	ASSERT_EQ(count_changed(loaded), count_changed(saved));
+	ASSERT_GT(count_changed(loaded), 0u);
+
+	/* The free chain and validation ids continue where the saved manager left off */
+	for (uint32_t i = 0; i < 400; i++)
+	{
+		const EntityID a = saved.CreateEntity();
+		const EntityID b = loaded.CreateEntity();
+		ASSERT_EQ(a, b);
+		saved.AddComponent<Heat>(a, { 1 });
+		loaded.AddComponent<Heat>(b, { 1 });
+		loaded.AddTag<IsHot>(b);
+	}
+	for (const EntityID e : alive) loaded.DestroyEntity(e);
+	ASSERT_EQ(loaded.GetEntityCount(), 400u);
+	ASSERT_EQ(loaded.QueryTags<IsHot>().Count(), 400u);
+}
+
+TEST(Snapshot, RejectsOtherLayouts)
+{
+	using namespace TSnapshot;
+	const std::string path = TempPath("lcs_snapshot_other_layout.bin");
+
+	ECS saved{};
+	Populate(saved);
+	ASSERT_TRUE(saved.SaveSnapshot(path.c_str()));
+
+	OtherECS other{};
+	other.CreateEntity();
+	ASSERT_TRUE(!lcs::LoadSnapshot(other, path.c_str()));
+	ASSERT_EQ(other.GetEntityCount(), 0u);
+
+	/* Truncated snapshots fail as a whole */
+	const auto size = std::filesystem::file_size(path);
+	std::filesystem::resize_file(path, size / 2);
+	ECS truncated{};
+	ASSERT_TRUE(!lcs::LoadSnapshot(truncated, path.c_str()));
+	ASSERT_EQ(truncated.GetEntityCount(), 0u);
+	std::filesystem::remove(path);
+
+	ECS missing{};
+	ASSERT_TRUE(!lcs::LoadSnapshot(missing, path.c_str()));
+}
+
+TEST(Snapshot, RejectsDamagedIndices)
+{
+	using namespace TSnapshot;
+	const std::string path = TempPath("lcs_snapshot_damaged.bin");
+
+	ECS saved{};
+	std::vector<EntityID> entities(200);
+	saved.CreateEntities(200, entities);
+	for (uint32_t i = 0; i < 200; i++)
+	{
+		const EntityID e = entities[i];
+		saved.AddComponent<Position>(e, { int(i), 0 });
+		if (i % 2 == 0) saved.AddComponent<Heat>(e, { int(i) });
+		if (i % 3 == 0) saved.AddComponent<Spin>(e, { 1, int(i) });
+		if (i % 5 == 0) saved.AddComponent<Body>(e, { int(i) });
+		if (i % 4 == 0) saved.AddTag<IsWet>(e);
+		if (i % 6 == 0) saved.AddTag<IsHot>(e);
+	}
+	for (uint32_t i = 0; i < 200; i += 7) saved.DestroyEntity(entities[i]);
+	ASSERT_TRUE(saved.SaveSnapshot(path.c_str()));
+
+	std::vector<std::byte> bytes(std::filesystem::file_size(path));
+	std::FILE* file = std::fopen(path.c_str(), "rb");
+	ASSERT_EQ(std::fread(bytes.data(), 1, bytes.size(), file), bytes.size());
+	std::fclose(file);
+	std::filesystem::remove(path);
+
+	/* Damage every 17th byte. Loads either fail or leave a world whose lookups, removals and adds stay in range,
+	 * which the asserts of the containers check. Only component values may still differ */
+	size_t rejected_count = 0;
+	for (size_t position = 0; position < bytes.size(); position += 17)
+	{
+		bytes[position] ^= std::byte{ 0x5A };
+		ECS loaded{};
+		lcs::SnapshotReader reader(bytes);
+		const bool accepted = loaded.LoadSnapshot(reader);
+		bytes[position] ^= std::byte{ 0x5A };
+		if (!accepted)
+		{
+			ASSERT_EQ(loaded.GetEntityCount(), 0u);
+			rejected_count++;
+			continue;
+		}
+		const std::vector<EntityID> alive(loaded.Entities().begin(), loaded.Entities().end());
+		for (const EntityID e : alive)
+		{
+			if (loaded.HasComponent<Heat>(e)) loaded.WriteComponent<Heat>(e).kelvin++;
+			if (loaded.HasComponent<Body>(e)) loaded.WriteComponent<Body>(e).mass++;
+			if (loaded.HasComponent<Position>(e)) loaded.RemoveComponent<Position>(e);
+		}
+		for (auto [e, s] : loaded.View<Spin>()) s.Get<&Spin::x>() = 0;
+		for (const EntityID e : alive) loaded.DestroyEntity(e);
+		const EntityID e = loaded.CreateEntity();
+		loaded.AddComponent<Heat>(e, { 1 });
+		loaded.AddTag<IsHot>(e);
+		ASSERT_EQ(loaded.GetEntityCount(), 1u);
+	}
+	ASSERT_GT(rejected_count, 0u);
+}
+
+TEST(Snapshot, DeltaRoundTrip)
+{
+	using namespace TSnapshot;
+	const std::string base_path = TempPath("lcs_snapshot_delta_base.bin");
+	const std::string delta_path = TempPath("lcs_snapshot_delta.bin");
+
+	ECS saved{};
+	std::vector<EntityID> alive = Populate(saved);
+	ASSERT_TRUE(saved.SaveSnapshot(base_path.c_str()));
+	ECS loaded{};
+	ASSERT_TRUE(lcs::LoadSnapshot(loaded, base_path.c_str()));
+
+	const auto apply_delta = [&]()
+		{
+			ASSERT_TRUE(saved.SaveDeltaSnapshot(delta_path.c_str()));
+			ASSERT_TRUE(lcs::ApplyDeltaSnapshot(loaded, delta_path.c_str()));
+			ExpectSameWorld(saved, loaded);
+		};
+
+	/* Writes through Get and tags */
+	for (uint32_t i = 0; i < alive.size(); i += 9)
+	{
+		const EntityID e = alive[i];
+		saved.WriteComponent<Position>(e).x += 1000;
+		if (saved.HasComponent<Heat>(e)) saved.WriteComponent<Heat>(e).kelvin = -1;
+		if (saved.HasComponent<Spin>(e)) saved.WriteComponent<Spin>(e).Get<&Spin::y>() = -2;
+		if (saved.HasComponent<Body>(e)) saved.WriteComponent<Body>(e).mass = -3;
+		if (saved.HasTag<IsHot>(e)) saved.RemoveTag<IsHot>(e);
+		else saved.AddTag<IsHot>(e);
+		if (!saved.HasTag<IsWet>(e)) saved.AddTag<IsWet>(e);
+	}
+	saved.AdvanceTick();
+	apply_delta();
+
+	/* Writes through views are marked by the view */
+	for (auto [e, p] : saved.CView<Position>())
+	{
+		if (e.GetIndex() % 11 != 0) continue;
+		p.y = 7;
+	}
+	apply_delta();
+	for (const EntityID e : loaded.Entities())
+	{
+		if (e.GetIndex() % 11 == 0) { ASSERT_EQ(loaded.GetComponent<Position>(e).y, 7); }
+	}
+
+	/* Destroys empty whole chunks, new entities reuse the freed indices and grow the storage */
+	std::vector<EntityID> destroyed(alive.begin(), alive.begin() + alive.size() / 2);
+	saved.DestroyEntities(destroyed);
+	for (uint32_t i = 0; i < 2000; i++)
+	{
+		const EntityID e = saved.CreateEntity();
+		saved.AddComponent<Heat>(e, { int(i) });
+		if (i % 3 == 0) saved.AddComponent<Position>(e, { int(i), 0 });
+		if (i % 8 == 0) saved.AddComponent<Spin>(e, { 0, int(i) });
+		if (i % 5 == 0) saved.AddTag<IsHot>(e);
+	}
+	apply_delta();
+
+	/* Deltas after a Clear replace the world */
+	saved.Clear();
+	alive = Populate(saved);
+	apply_delta();
+	apply_delta();
+
+	std::filesystem::remove(base_path);
+	std::filesystem::remove(delta_path);
+}
+
+TEST(Snapshot, DeltaStoresViewWrites)
+{
+	using namespace TSnapshot;
+	const std::string base_path = TempPath("lcs_snapshot_view_base.bin");
+	const std::string delta_path = TempPath("lcs_snapshot_view_delta.bin");
+
+	ECS saved{};
+	const std::vector<EntityID> alive = Populate(saved);
+	ASSERT_TRUE(saved.SaveSnapshot(base_path.c_str()));
+	ECS loaded{};
+	ASSERT_TRUE(lcs::LoadSnapshot(loaded, base_path.c_str()));
+
+	const auto apply_delta = [&]()
+		{
+			ASSERT_TRUE(saved.SaveDeltaSnapshot(delta_path.c_str()));
+			ASSERT_TRUE(lcs::ApplyDeltaSnapshot(loaded, delta_path.c_str()));
+			ExpectSameWorld(saved, loaded);
+		};
+
+	/* Plain writes through every kind of view, one delta each and nothing reported with MarkChanged */
+	for (auto [e, p] : saved.CView<Position>()) p.x = 42;
+	apply_delta();
+	saved.ParallelForEach<Heat>([](EntityID, Heat& h) { h.kelvin = 7; });
+	apply_delta();
+	saved.ParallelForEach<Position, Spin>([](EntityID, Position&, auto s) { s.template Get<&Spin::x>() = 9; });
+	apply_delta();
+	for (auto [e, p, s] : saved.View<Position, Spin>()) { p.y = 3; s.Get<&Spin::y>() = 4; }
+	apply_delta();
+	saved.ParallelForEach<Body>([](EntityID, Body& b) { b.mass = 5; });
+	apply_delta();
+	for (const EntityID e : alive)
+	{
+		ASSERT_EQ(loaded.GetComponent<Position>(e).x, 42);
+		if (loaded.HasComponent<Heat>(e)) { ASSERT_EQ(loaded.GetComponent<Heat>(e).kelvin, 7); }
+		if (loaded.HasComponent<Spin>(e))
+		{
+			ASSERT_EQ(loaded.GetComponent<Spin>(e).Get<&Spin::x>(), 9);
+			ASSERT_EQ(loaded.GetComponent<Spin>(e).Get<&Spin::y>(), 4);
+			ASSERT_EQ(loaded.GetComponent<Position>(e).y, 3);
+		}
+		if (loaded.HasComponent<Body>(e)) { ASSERT_EQ(loaded.GetComponent<Body>(e).mass, 5); }
+	}
+
+	std::filesystem::remove(base_path);
+	std::filesystem::remove(delta_path);
+}
+
+TEST(Snapshot, DeltaSkipsReadOnlyViews)
+{
+	using namespace TSnapshot;
+	const std::string base_path = TempPath("lcs_snapshot_read_base.bin");
+	const std::string delta_path = TempPath("lcs_snapshot_read_delta.bin");
+	const std::string empty_path = TempPath("lcs_snapshot_read_empty.bin");
+
+	ECS saved{};
+	std::vector<EntityID> entities(20000);
+	saved.CreateEntities(20000, entities);
+	for (uint32_t i = 0; i < 20000; i++)
+	{
+		saved.AddComponent<Position>(entities[i], { 1, 2 });
+		if (i < 100) saved.AddComponent<Heat>(entities[i], { 3 });
+		saved.AddComponent<Spin>(entities[i], { 4, 5 });
+		saved.AddComponent<Body>(entities[i], { 6 });
+	}
+	ASSERT_TRUE(saved.SaveSnapshot(base_path.c_str()));
+	ASSERT_TRUE(saved.SaveDeltaSnapshot(empty_path.c_str()));
+
+	/* Const components are handed out read-only and leave the delta as small as one without any pass */
+	int sum = 0;
+	for (auto [e, p] : saved.CView<const Position>()) sum += p.x;
+	for (auto [e, h] : saved.CView<const Heat>()) sum += h.kelvin;
+	for (auto [e, p, s] : saved.View<const Position, const Spin>()) sum += p.y + s.Get<&Spin::x>();
+	for (auto [e, p, h] : saved.View<const Position, const Heat>()) sum += p.x + h.kelvin;
+	for (auto [e, b] : saved.View<const Body>()) sum += b.mass;
+	saved.Query<const Position, const Heat>().ForEach([&](EntityID, const Position& p, const Heat& h) { sum += p.x + h.kelvin; });
+	for (const int x : saved.ReadComponentField<&Spin::x>()) sum += x;
+	ASSERT_EQ(sum, 20000 * (1 + 2 + 4 + 6 + 4) + 100 * (3 + 1 + 3 + 1 + 3));
+	ASSERT_TRUE(saved.SaveDeltaSnapshot(delta_path.c_str()));
+	ASSERT_EQ(std::filesystem::file_size(delta_path), std::filesystem::file_size(empty_path));
+
+	/* Joins only mark their matches, not every Position */
+	for (auto [e, p, h] : saved.View<Position, const Heat>()) p.x = h.kelvin;
+	ASSERT_TRUE(saved.SaveDeltaSnapshot(delta_path.c_str()));
+	const size_t join_size = std::filesystem::file_size(delta_path);
+	for (auto [e, p] : saved.CView<Position>()) p.y = 0;
+	ASSERT_TRUE(saved.SaveDeltaSnapshot(delta_path.c_str()));
+	ASSERT_LT(join_size * 10, std::filesystem::file_size(delta_path));
+
+	std::filesystem::remove(base_path);
+	std::filesystem::remove(delta_path);
+	std::filesystem::remove(empty_path);
+}
+
+TEST(Snapshot, DeltaRejectsOtherBase)
+{
+	using namespace TSnapshot;
+	const std::string base_path = TempPath("lcs_snapshot_delta_order_base.bin");
+	const std::string first_path = TempPath("lcs_snapshot_delta_order_1.bin");
+	const std::string second_path = TempPath("lcs_snapshot_delta_order_2.bin");
+
+	ECS saved{};
+	const std::vector<EntityID> alive = Populate(saved);
+	ASSERT_TRUE(saved.SaveSnapshot(base_path.c_str()));
+	saved.WriteComponent<Position>(alive[0]).x = 1;
+	ASSERT_TRUE(saved.SaveDeltaSnapshot(first_path.c_str()));
+	saved.WriteComponent<Position>(alive[1]).x = 2;
+	ASSERT_TRUE(saved.SaveDeltaSnapshot(second_path.c_str()));
+
+	/* Out of order deltas leave the world untouched */
+	ECS loaded{};
+	ASSERT_TRUE(lcs::LoadSnapshot(loaded, base_path.c_str()));
+	ASSERT_TRUE(!lcs::ApplyDeltaSnapshot(loaded, second_path.c_str()));
+	ASSERT_EQ(loaded.GetEntityCount(), saved.GetEntityCount());
+	ASSERT_TRUE(lcs::ApplyDeltaSnapshot(loaded, first_path.c_str()));
+	ASSERT_TRUE(!lcs::ApplyDeltaSnapshot(loaded, first_path.c_str()));
+	ASSERT_TRUE(lcs::ApplyDeltaSnapshot(loaded, second_path.c_str()));
+	ExpectSameWorld(saved, loaded);
+
+	/* Deltas only apply to their own base */
+	ECS other{};
+	Populate(other);
+	ASSERT_TRUE(other.SaveSnapshot(base_path.c_str()));
+	ASSERT_TRUE(!lcs::ApplyDeltaSnapshot(other, first_path.c_str()));
+	ASSERT_TRUE(!lcs::LoadSnapshot(other, first_path.c_str()));
+
+	std::filesystem::remove(base_path);
+	std::filesystem::remove(first_path);
+	std::filesystem::remove(second_path);
+}
+
+TEST(Snapshot, DeltaRejectsDamagedSizes)
+{
+	using namespace TSnapshot;
+	const std::string base_path = TempPath("lcs_snapshot_delta_size_base.bin");
+	const std::string delta_path = TempPath("lcs_snapshot_delta_size.bin");
+
+	ECS saved{};
+	std::vector<EntityID> entities(100);
+	saved.CreateEntities(100, entities);
+	for (uint32_t i = 0; i < 100; i++)
+	{
+		const EntityID e = entities[i];
+		saved.AddComponent<Position>(e, { int(i), 0 });
+		if (i % 2 == 0) saved.AddComponent<Heat>(e, { int(i) });
+		if (i % 3 == 0) saved.AddComponent<Spin>(e, { 1, int(i) });
+		if (i % 5 == 0) saved.AddComponent<Body>(e, { int(i) });
+		if (i % 4 == 0) saved.AddTag<IsWet>(e);
+		if (i % 6 == 0) saved.AddTag<IsHot>(e);
+	}
+	ASSERT_TRUE(saved.SaveSnapshot(base_path.c_str()));
+	ECS base{};
+	ASSERT_TRUE(lcs::LoadSnapshot(base, base_path.c_str()));
+	saved.WriteComponent<Position>(entities[0]).x = 1;
+	saved.AddComponent<Heat>(saved.CreateEntity(), { 1 });
+	ASSERT_TRUE(saved.SaveDeltaSnapshot(delta_path.c_str()));
+
+	std::vector<std::byte> bytes(std::filesystem::file_size(delta_path));
+	std::FILE* file = std::fopen(delta_path.c_str(), "rb");
+	ASSERT_EQ(std::fread(bytes.data(), 1, bytes.size(), file), bytes.size());
+	std::fclose(file);
+	std::filesystem::remove(base_path);
+	std::filesystem::remove(delta_path);
+
+	/* Overwrite eight bytes at every offset with a huge value. Where that hits an array size the delta is refused
+	 * and the world cleared, instead of the resize throwing out of ApplyDeltaSnapshot. Damaged headers leave it untouched */
+	const uint64_t huge_size = uint64_t(1) << 60;
+	size_t rejected_count = 0;
+	for (size_t position = 0; position + sizeof(huge_size) <= bytes.size(); position++)
+	{
+		std::vector<std::byte> damaged = bytes;
+		std::memcpy(damaged.data() + position, &huge_size, sizeof(huge_size));
+		ECS loaded = base;
+		lcs::SnapshotReader reader(damaged);
+		if (!loaded.ApplyDeltaSnapshot(reader))
+		{
+			ASSERT_TRUE(loaded.GetEntityCount() == 0u || loaded.GetEntityCount() == base.GetEntityCount());
+			rejected_count++;
+		}
+	}
+	ASSERT_GT(rejected_count, 0u);
+}
+
+TEST(Snapshot, GroupsBlockLoading)
+{
+	using namespace TSnapshot;
+	const std::string path = TempPath("lcs_snapshot_groups.bin");
+	const std::string delta_path = TempPath("lcs_snapshot_groups_delta.bin");
+
+	GroupedECS saved{};
+	for (int i = 0; i < 10; i++)
+	{
+		const EntityID e = saved.CreateEntity();
+		saved.AddComponent<Position>(e, { i, 0 });
+		saved.AddComponent<Velocity>(e, { 0, i });
+	}
+	ASSERT_TRUE(saved.SaveSnapshot(path.c_str()));
+	ASSERT_TRUE(saved.SaveDeltaSnapshot(delta_path.c_str()));
+
+	/* Groups are not stored, a manager that has them refuses to load and keeps its world */
+	GroupedECS grouped{};
+	const EntityID kept = grouped.CreateEntity();
+	grouped.AddComponent<Position>(kept, { 7, 7 });
+	grouped.AddComponent<Velocity>(kept, { 7, 7 });
+	auto& group = *grouped.Group<Position, Velocity>();
+	ASSERT_TRUE(!lcs::LoadSnapshot(grouped, path.c_str()));
+	ASSERT_TRUE(!lcs::ApplyDeltaSnapshot(grouped, delta_path.c_str()));
+	ASSERT_EQ(grouped.GetEntityCount(), 1u);
+	ASSERT_EQ(group.Size(), 1u);
+	ASSERT_EQ(grouped.GetComponent<Position>(kept).x, 7);
+
+	/* Groups created after loading pick up the loaded entities */
+	GroupedECS loaded{};
+	ASSERT_TRUE(lcs::LoadSnapshot(loaded, path.c_str()));
+	ASSERT_TRUE(lcs::ApplyDeltaSnapshot(loaded, delta_path.c_str()));
+	ASSERT_EQ((loaded.Group<Position, Velocity>()->Size()), 10u);
+	std::filesystem::remove(path);
+	std::filesystem::remove(delta_path);
+}
+
+TEST(Snapshot, DeltaSizeScalesWithChange)
+{
+	using namespace TSnapshot;
+	const std::string base_path = TempPath("lcs_snapshot_delta_size_base.bin");
+	const std::string delta_path = TempPath("lcs_snapshot_delta_size.bin");
+
+	ECS saved{};
+	std::vector<EntityID> entities(50000);
+	saved.CreateEntities(50000, entities);
+	for (const EntityID e : entities)
+	{
+		saved.AddComponent<Position>(e, { 0, 0 });
+		saved.AddComponent<Heat>(e, { 0 });
+	}
+	ASSERT_TRUE(saved.SaveSnapshot(base_path.c_str()));
+	saved.WriteComponent<Position>(entities[500]).x = 1;
+	saved.WriteComponent<Heat>(entities[40000]).kelvin = 1;
+	ASSERT_TRUE(saved.SaveDeltaSnapshot(delta_path.c_str()));
+
+	ASSERT_LT(std::filesystem::file_size(delta_path) * 100, std::filesystem::file_size(base_path));
+	std::filesystem::remove(base_path);
+	std::filesystem::remove(delta_path);
+}
@@ -39,7 +39,7 @@ void TestInsertHasGet()
 template <typename SetType>
 void TestRemove()
 {
-	lcs::SparseSet<TestHandle, u64> set{};
+	SetType set{};
 	set.ReserveSparseSize(56);
 
 	set.Add(cnh(33), 1);
@@ -62,7 +62,7 @@ void TestRemove()
 template <typename SetType>
 void TestInsertRemoveInsert()
 {
-	lcs::SparseSet<TestHandle, u64> set{};
+	SetType set{};
 	set.ReserveSparseSize(58);
 
 	set.Add(cnh(33), 1);
@@ -92,7 +92,7 @@ void TestInsertRemoveInsert()
 template <typename SetType>
 void TestInsertRemoveInsert2()
 {
-	lcs::SparseSet<TestHandle, u64> set{};
+	SetType set{};
 	set.ReserveSparseSize(3);
 
 	set.Add(cnh(0), 0);
@@ -109,10 +109,42 @@ void TestInsertRemoveInsert2()
 	ASSERT_TRUE(set.Get(cnh(2)) == 2);
 }
 
+template <typename SetType>
+void TestRemoveAcrossChunks()
+{
+	SetType set{};
+	set.ReserveSparseSize(256);
+
+	for (uint32_t i = 0; i < 256; i += 4)
+	{
+		set.Add(cnh(i), u64(i));
+	}
+	for (uint32_t i = 64; i < 128; i += 4)
+	{
+		set.Remove(cnh(i));
+	}
+	set.Remove(cnh(0));
+
+	for (uint32_t i = 0; i < 256; i += 4)
+	{
+		const bool expected = (i != 0) && (i < 64 || i >= 128);
+		ASSERT_EQ(set.Has(cnh(i)), expected);
+		if (expected) { ASSERT_EQ(set.Get(cnh(i)), u64(i)); }
+	}
+
+	u64 data_sum = 0;
+	for (auto it = set.begin(); it != set.end(); ++it)
+	{
+		ASSERT_EQ(u64(it.GetOwner().GetIndex()), *it);
+		data_sum += *it;
+	}
+	ASSERT_EQ(data_sum, u64(4 * (1 + 15) * 15 / 2 + 4 * (32 + 63) * 32 / 2));
+}
+
 template <typename SetType>
 void TestIteration()
 {
-	lcs::SparseSet<TestHandle, u64> set{};
+	SetType set{};
 	set.ReserveSparseSize(16);
 
 	set.Add(cnh(5), 1);
@@ -133,7 +165,7 @@ void TestIteration()
 template <typename SetType>
 void TestClearSparse()
 {
-	lcs::SparseSet<TestHandle, u64> set{};
+	SetType set{};
 	set.ReserveSparseSize(16);
 
 	set.Add(cnh(5), 1);
@@ -144,16 +176,227 @@ void TestClearSparse()
 	ASSERT_TRUE(set.DenseSize() == 0);
 }
 
+template <typename SetType>
+void AssertDenseConsistent(SetType& set)
+{
+	for (auto it = set.begin(); it != set.end(); ++it)
+	{
+		ASSERT_EQ(u64(it.GetOwner().GetIndex()), *it);
+		ASSERT_EQ(set.Get(it.GetOwner()), *it);
+	}
+}
+
+template <typename SetType>
+bool IsSortedByEntity(SetType& set)
+{
+	const auto owners = set.DenseOwners();
+	return std::is_sorted(owners.begin(), owners.end(), [](TestHandle a, TestHandle b) { return a.GetIndex() < b.GetIndex(); });
+}
+
+void TestSortByEntity()
+{
+	lcs::SparseSet<TestHandle, u64> set{};
+	set.ReserveSparseSize(1000);
+
+	for (uint32_t i = 0; i < 1000; i++)
+	{
+		const uint32_t index = (i * 337) % 1000;
+		set.Add(cnh(index), u64(index));
+	}
+	set.Remove(cnh(10));
+	set.Remove(cnh(5));
+	ASSERT_FALSE(IsSortedByEntity(set));
+
+	set.SortByEntity();
+	ASSERT_TRUE(IsSortedByEntity(set));
+	ASSERT_EQ(set.DenseSize(), 998u);
+	ASSERT_FALSE(set.Has(cnh(10)));
+	AssertDenseConsistent(set);
+
+	/* Removals and appends leave a few displaced entries to merge back */
+	set.Remove(cnh(500));
+	set.Add(cnh(10), 10);
+	set.Add(cnh(5), 5);
+	set.SortByEntity();
+	ASSERT_TRUE(IsSortedByEntity(set));
+	AssertDenseConsistent(set);
+}
+
+void TestSortComparator()
+{
+	lcs::SparseSet<TestHandle, u64> set{};
+	set.ReserveSparseSize(100);
+
+	for (uint32_t i = 0; i < 100; i++)
+	{
+		set.Add(cnh(i), u64(i));
+	}
+	set.Sort([](const u64& a, const u64& b) { return a > b; });
+
+	u64 previous = u64(-1);
+	for (auto it = set.begin(); it != set.end(); ++it)
+	{
+		ASSERT_LT(*it, previous);
+		previous = *it;
+	}
+	AssertDenseConsistent(set);
+}
+
+void TestSortByEntityIncremental()
+{
+	lcs::SparseSet<TestHandle, u64> set{};
+	set.ReserveSparseSize(200);
+
+	for (uint32_t i = 0; i < 200; i++)
+	{
+		const uint32_t index = (i * 73) % 200;
+		set.Add(cnh(index), u64(index));
+	}
+
+	uint32_t call_count = 0;
+	while (!set.SortByEntityIncremental(100))
+	{
+		AssertDenseConsistent(set);
+		call_count++;
+		ASSERT_LT(call_count, 1000u);
+	}
+	ASSERT_GT(call_count, 1u);
+	ASSERT_TRUE(IsSortedByEntity(set));
+	AssertDenseConsistent(set);
+
+	/* Removals move the back entry into the hole, which is sifted back to the end */
+	set.Remove(cnh(50));
+	set.Remove(cnh(120));
+	ASSERT_TRUE(set.SortByEntityIncremental(1000));
+	ASSERT_TRUE(IsSortedByEntity(set));
+	ASSERT_EQ(set.DenseSize(), 198u);
+	AssertDenseConsistent(set);
+	ASSERT_TRUE(set.SortByEntityIncremental(1));
+}
+
+template <typename SetType>
+void TestForEachChunk()
+{
+	constexpr uint32_t width = SetType::entries_per_chunk;
+	SetType set{};
+	set.ReserveSparseSize(3 * width);
+
+	/* Full first chunk, half full second chunk, third chunk only has its last slot */
+	for (uint32_t i = 0; i < width; i++) set.Add(cnh(i), u64(i));
+	for (uint32_t i = width; i < 2 * width; i += 2) set.Add(cnh(i), u64(i));
+	set.Add(cnh(3 * width - 1), u64(3 * width - 1));
+
+	uint32_t chunk_count = 0;
+	uint32_t full_count = 0;
+	u64 data_sum = 0;
+	set.ForEachChunk([&](u64* data, const TestHandle* owners, const typename SetType::mask_t& mask, auto is_full)
+		{
+			chunk_count++;
+			if constexpr (is_full)
+			{
+				full_count++;
+				for (uint32_t i = 0; i < width; i++) data[i] += 1;
+			}
+			else
+			{
+				for (auto it = mask.begin(); it != mask.end(); ++it)
+				{
+					ASSERT_EQ(u64(owners[*it].GetIndex()), data[*it]);
+					data[*it] += 1;
+				}
+			}
+		});
+	ASSERT_EQ(chunk_count, 3u);
+	ASSERT_EQ(full_count, 1u);
+
+	/* Every entry was visited exactly once */
+	for (auto it = set.begin(); it != set.end(); ++it)
+	{
+		ASSERT_EQ(u64(it.GetOwner().GetIndex()) + 1, *it);
+		data_sum += *it;
+	}
+	ASSERT_EQ(data_sum, u64(width) * (width - 1) / 2 + width + (width / 2) * (width + (2 * width - 2)) / 2 + width / 2 + 3 * width);
+}
+
+template <typename SetType>
+void TestRemoveMany(uint32_t removed_step, bool remove_range)
+{
+	SetType set{};
+	set.ReserveSparseSize(512);
+	for (uint32_t i = 0; i < 512; i++)
+	{
+		if (i % 3 != 2) set.Add(cnh(i), u64(i));
+	}
+
+	/* Every removed_step-th entry, plus the whole range [128, 192) if remove_range is set */
+	std::vector<TestHandle> removed{};
+	for (uint32_t i = 0; i < 512; i++)
+	{
+		if (i % 3 != 2 && (i % removed_step == 0 || (remove_range && i >= 128 && i < 192))) removed.push_back(cnh(i));
+	}
+	set.RemoveMany(removed);
+
+	u64 expected_sum = 0;
+	for (uint32_t i = 0; i < 512; i++)
+	{
+		const bool expected = i % 3 != 2 && !(i % removed_step == 0 || (remove_range && i >= 128 && i < 192));
+		ASSERT_EQ(set.Has(cnh(i)), expected);
+		if (expected) { ASSERT_EQ(set.Get(cnh(i)), u64(i)); }
+		expected_sum += expected ? i : 0;
+	}
+
+	u64 data_sum = 0;
+	for (auto it = set.begin(); it != set.end(); ++it)
+	{
+		ASSERT_EQ(u64(it.GetOwner().GetIndex()), *it);
+		data_sum += *it;
+	}
+	ASSERT_EQ(data_sum, expected_sum);
+}
+
+void TestRemoveManyKeepsOrder()
+{
+	lcs::SparseSet<TestHandle, u64> set{};
+	set.ReserveSparseSize(100);
+	for (uint32_t i = 0; i < 100; i++) set.Add(cnh(i), u64(i));
+	set.SortByEntity();
+
+	std::vector<TestHandle> removed{};
+	for (uint32_t i = 0; i < 100; i += 2) removed.push_back(cnh(i));
+	set.RemoveMany(removed);
+
+	ASSERT_EQ(set.DenseSize(), 50u);
+	ASSERT_TRUE(IsSortedByEntity(set));
+	AssertDenseConsistent(set);
+	ASSERT_TRUE(set.SortByEntityIncremental(1));
+}
+
 TEST(SparseSet, TestInsertHasGet) { TestInsertHasGet<lcs::SparseSet<TestHandle, u64>>(); }
 TEST(SparseSet, TestRemove) { TestRemove<lcs::SparseSet<TestHandle, u64>>(); }
 TEST(SparseSet, TestInsertRemoveInsert) { TestInsertRemoveInsert<lcs::SparseSet<TestHandle, u64>>(); }
 TEST(SparseSet, TestInsertRemoveInsert2) { TestInsertRemoveInsert2<lcs::SparseSet<TestHandle, u64>>(); }
+TEST(SparseSet, TestRemoveAcrossChunks) { TestRemoveAcrossChunks<lcs::SparseSet<TestHandle, u64>>(); }
 TEST(SparseSet, TestIteration) { TestIteration<lcs::SparseSet<TestHandle, u64>>(); }
 TEST(SparseSet, TestClearSparse) { TestClearSparse<lcs::SparseSet<TestHandle, u64>>(); }
+TEST(SparseSet, TestSortByEntity) { TestSortByEntity(); }
+TEST(SparseSet, TestSortComparator) { TestSortComparator(); }
+TEST(SparseSet, TestSortByEntityIncremental) { TestSortByEntityIncremental(); }
+TEST(SparseSet, TestRemoveMany) { TestRemoveMany<lcs::SparseSet<TestHandle, u64>>(4, true); TestRemoveMany<lcs::SparseSet<TestHandle, u64>>(100, false); }
+TEST(SparseSet, TestRemoveManyKeepsOrder) { TestRemoveManyKeepsOrder(); }
 
 TEST(SparseSetChunked, TestInsertHasGet) { TestInsertHasGet<lcs::SparseSetChunked<TestHandle, u64>>(); }
 TEST(SparseSetChunked, TestRemove) { TestRemove<lcs::SparseSetChunked<TestHandle, u64>>(); }
 TEST(SparseSetChunked, TestInsertRemoveInsert) { TestInsertRemoveInsert<lcs::SparseSetChunked<TestHandle, u64>>(); }
 TEST(SparseSetChunked, TestInsertRemoveInsert2) { TestInsertRemoveInsert2<lcs::SparseSetChunked<TestHandle, u64>>(); }
+TEST(SparseSetChunked, TestRemoveAcrossChunks) { TestRemoveAcrossChunks<lcs::SparseSetChunked<TestHandle, u64>>(); }
 TEST(SparseSetChunked, TestIteration) { TestIteration<lcs::SparseSetChunked<TestHandle, u64>>(); }
-TEST(SparseSetChunked, TestClearSparse) { TestClearSparse<lcs::SparseSetChunked<TestHandle, u64>>(); }
\ No newline at end of file
+TEST(SparseSetChunked, TestClearSparse) { TestClearSparse<lcs::SparseSetChunked<TestHandle, u64>>(); }
+TEST(SparseSetChunked, TestRemoveMany) { TestRemoveMany<lcs::SparseSetChunked<TestHandle, u64>>(4, true); }
+TEST(SparseSetChunked, TestForEachChunk) { TestForEachChunk<lcs::SparseSetChunked<TestHandle, u64>>(); }
+
+TEST(SparseSetChunkedWide, TestInsertHasGet) { TestInsertHasGet<lcs::SparseSetChunked<TestHandle, u64, 256>>(); }
+TEST(SparseSetChunkedWide, TestRemove) { TestRemove<lcs::SparseSetChunked<TestHandle, u64, 256>>(); }
+TEST(SparseSetChunkedWide, TestInsertRemoveInsert) { TestInsertRemoveInsert<lcs::SparseSetChunked<TestHandle, u64, 256>>(); }
+TEST(SparseSetChunkedWide, TestRemoveAcrossChunks) { TestRemoveAcrossChunks<lcs::SparseSetChunked<TestHandle, u64, 128>>(); }
+TEST(SparseSetChunkedWide, TestIteration) { TestIteration<lcs::SparseSetChunked<TestHandle, u64, 512>>(); }
+TEST(SparseSetChunkedWide, TestForEachChunk) { TestForEachChunk<lcs::SparseSetChunked<TestHandle, u64, 256>>(); }
@@ -0,0 +1,87 @@
+#include <gtest/gtest.h>
+
+#include <lutra-ecs/SparseSetSoA.h>
+
+namespace TSoA
+{
+	struct Particle
+	{
+		float x, y;
+		int id;
+		static constexpr std::tuple soa_fields{ &Particle::x, &Particle::y, &Particle::id };
+	};
+
+	using Handle = lcs::Handle<uint32_t, 16>;
+	using Set = lcs::SparseSetSoA<Handle, Particle>;
+
+	inline Handle h(uint32_t value) { return Handle::CreateNew(value); }
+}
+
+TEST(SparseSetSoA, AddGetRemove)
+{
+	TSoA::Set set{};
+	set.ReserveSparseSize(64);
+
+	for (uint32_t i = 0; i < 10; i++)
+	{
+		set.Add(TSoA::h(i * 5), { float(i), float(i) * 2.0f, int(i) });
+	}
+	ASSERT_EQ(set.DenseSize(), 10u);
+
+	set.Remove(TSoA::h(0));
+	set.Remove(TSoA::h(45));
+	set.Remove(TSoA::h(20));
+	ASSERT_EQ(set.DenseSize(), 7u);
+	ASSERT_FALSE(set.Has(TSoA::h(20)));
+	ASSERT_TRUE(set.TryGet(TSoA::h(20)) == nullptr);
+
+	/* Columns stay aligned with the owners after swap removal */
+	for (auto it = set.begin(); it != set.end(); ++it)
+	{
+		const TSoA::Particle p = *it;
+		ASSERT_EQ(it.GetOwner().GetIndex(), uint32_t(p.id * 5));
+		ASSERT_EQ(p.y, p.x * 2.0f);
+	}
+
+	const TSoA::Particle p = set.Get(TSoA::h(15));
+	ASSERT_EQ(p.id, 3);
+	ASSERT_EQ(p.x, 3.0f);
+}
+
+TEST(SparseSetSoA, ProxyAndFieldSpans)
+{
+	TSoA::Set set{};
+	set.ReserveSparseSize(16);
+	for (uint32_t i = 0; i < 16; i++)
+	{
+		set.Add(TSoA::h(i), { float(i), 0.0f, int(i) });
+	}
+
+	auto ref = set.Get(TSoA::h(3));
+	ref.Get<&TSoA::Particle::y>() = 7.0f;
+	*set.TryGet(TSoA::h(4)) = TSoA::Particle{ 40.0f, 41.0f, 42 };
+	set.Get(TSoA::h(5)) = set.Get(TSoA::h(4));
+
+	std::span<float> xs = set.Field<&TSoA::Particle::x>();
+	std::span<float> ys = set.Field<&TSoA::Particle::y>();
+	std::span<const TSoA::Handle> owners = set.DenseOwners();
+	ASSERT_EQ(xs.size(), 16u);
+	for (size_t i = 0; i < xs.size(); i++)
+	{
+		xs[i] += ys[i];
+	}
+
+	ASSERT_EQ(xs[3], 10.0f);
+	ASSERT_EQ(xs[4], 81.0f);
+	ASSERT_EQ(owners[5].GetIndex(), 5u);
+	ASSERT_EQ(set.Get(TSoA::h(5)).Get<&TSoA::Particle::id>(), 42);
+	ASSERT_EQ(set.Get(TSoA::h(6)).Load().x, 6.0f);
+	std::span<const float> read_xs = set.ReadField<&TSoA::Particle::x>();
+	ASSERT_EQ(read_xs[4], 81.0f);
+	lcs::SoARef<const TSoA::Particle> read_ref = set.Get(TSoA::h(4));
+	ASSERT_EQ(read_ref.Get<&TSoA::Particle::id>(), 42);
+
+	set.Clear();
+	ASSERT_EQ(set.DenseSize(), 0u);
+	ASSERT_EQ(set.Field<&TSoA::Particle::x>().size(), 0u);
+}
@@ -0,0 +1,146 @@
+#pragma once
+#include <gtest/gtest.h>
+#include <lutra-ecs/CommandBuffer.h>
+#include <lutra-ecs/SystemScheduler.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <vector>
+
+namespace TSystemScheduler
+{
+	using EntityID = lcs::Handle<uint32_t, 16>;
+
+	struct Position
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Component;
+		int x, y;
+	};
+	struct Velocity
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Component;
+		int x, y;
+	};
+	struct Heat
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::ComponentChunked;
+		int kelvin;
+	};
+	struct IsHot
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Tag;
+	};
+
+	using ECS = lcs::ECSManager<EntityID, Position, Velocity, Heat, IsHot>;
+	using Scheduler = lcs::SystemScheduler<ECS>;
+	using Commands = lcs::ParallelCommandBuffer<EntityID, Position, Velocity, Heat, IsHot>;
+}
+
+TEST(SystemScheduler, BuildsWavesFromConflicts)
+{
+	using namespace TSystemScheduler;
+	Scheduler scheduler{};
+	const auto noop = [](ECS&) {};
+
+	const auto move = scheduler.AddSystem("Move", lcs::Reads<Velocity>{}, lcs::Writes<Position>{}, noop);
+	const auto heat = scheduler.AddSystem("Heat", lcs::Reads<>{}, lcs::Writes<Heat>{}, noop);
+	const auto render = scheduler.AddSystem("Render", lcs::Reads<Position, Heat>{}, lcs::Writes<>{}, noop);
+	const auto audio = scheduler.AddSystem("Audio", lcs::Reads<Position, Velocity>{}, lcs::Writes<>{}, noop);
+	const auto steer = scheduler.AddSystem("Steer", lcs::Reads<Position>{}, lcs::Writes<Velocity>{}, noop);
+
+	/* Readers of the same types share a wave, writers wait for every earlier reader and writer */
+	ASSERT_TRUE(scheduler.Dependencies(move).empty());
+	ASSERT_TRUE(scheduler.Dependencies(heat).empty());
+	ASSERT_TRUE(std::ranges::equal(scheduler.Dependencies(render), std::vector<uint32_t>{ move, heat }));
+	ASSERT_TRUE(std::ranges::equal(scheduler.Dependencies(audio), std::vector<uint32_t>{ move }));
+	ASSERT_TRUE(std::ranges::equal(scheduler.Dependencies(steer), std::vector<uint32_t>{ move, audio }));
+	ASSERT_EQ(scheduler.WaveCount(), 3u);
+}
+
+TEST(SystemScheduler, RunsInDependencyOrder)
+{
+	using namespace TSystemScheduler;
+	lcs::ThreadPool pool{ 3 };
+	ECS ecs{};
+	Commands commands{};
+
+	std::vector<EntityID> entities(1000);
+	ecs.CreateEntities(1000, entities);
+	for (uint32_t i = 0; i < 1000; i++)
+	{
+		ecs.AddComponent<Position>(entities[i], { 0, 0 });
+		ecs.AddComponent<Velocity>(entities[i], { 1, 2 });
+		ecs.AddComponent<Heat>(entities[i], { int(i) });
+	}
+
+	Scheduler scheduler{};
+	std::atomic<int64_t> position_sum{ 0 };
+	std::atomic<uint32_t> hot_count{ 0 };
+	scheduler.AddSystem("Move", lcs::Reads<Velocity>{}, lcs::Writes<Position>{}, [](ECS& ecs)
+		{
+			for (auto [e, p, v] : ecs.View<Position, Velocity>()) { p.x += v.x; p.y += v.y; }
+		});
+	scheduler.AddSystem("Cool", lcs::Reads<>{}, lcs::Writes<Heat>{}, [](ECS& ecs)
+		{
+			for (auto [e, h] : ecs.CView<Heat>()) h.kelvin -= 1;
+		});
+	scheduler.AddSystem("SumPositions", lcs::Reads<Position>{}, lcs::Writes<>{}, [&](ECS& ecs)
+		{
+			int64_t sum = 0;
+			for (auto [e, p] : ecs.CView<Position>()) sum += p.x + p.y;
+			position_sum = sum;
+		});
+	scheduler.AddSystem("MarkHot", lcs::Reads<Heat>{}, lcs::Writes<>{}, [&](ECS& ecs)
+		{
+			for (auto [e, h] : ecs.CView<Heat>())
+			{
+				if (h.kelvin >= 899) hot_count++;
+				if (h.kelvin == 899) commands.Local().AddTag<IsHot>(e);
+			}
+		});
+
+	for (int frame = 1; frame <= 3; frame++)
+	{
+		hot_count = 0;
+		scheduler.Run(ecs, pool);
+		commands.Flush(ecs);
+		ASSERT_EQ(position_sum.load(), int64_t(1000) * 3 * frame);
+		for (const EntityID e : entities) ASSERT_EQ(ecs.GetComponent<Position>(e).x, frame);
+	}
+	/* Cool ran before MarkHot in every frame */
+	ASSERT_EQ(hot_count.load(), 98u);
+	for (uint32_t i = 899; i < 1000; i++) ASSERT_EQ(ecs.HasTag<IsHot>(entities[i]), i >= 900 && i <= 902);
+}
+
+TEST(SystemScheduler, Timings)
+{
+	using namespace TSystemScheduler;
+	lcs::ThreadPool pool{ 2 };
+	ECS ecs{};
+	Scheduler scheduler{};
+	const auto busy = [](ECS&) { volatile uint32_t sink = 0; for (uint32_t i = 0; i < 200000; i++) sink = sink + i; };
+
+	scheduler.AddSystem("A", lcs::Reads<>{}, lcs::Writes<Position>{}, busy);
+	scheduler.AddSystem("B", lcs::Reads<>{}, lcs::Writes<Velocity>{}, busy);
+	scheduler.AddSystem("C", lcs::Reads<Position>{}, lcs::Writes<Heat>{}, busy);
+	scheduler.Run(ecs, pool);
+
+	const auto timings = scheduler.Timings();
+	ASSERT_EQ(timings.size(), 3u);
+	ASSERT_EQ(timings[2].wave, 1u);
+	ASSERT_GE(timings[2].start_us, timings[0].start_us + timings[0].duration_us);
+
+	/* B runs alone and can be preempted for longer than A and C together, the path follows the measured durations */
+	const double chain_us = timings[0].duration_us + timings[2].duration_us;
+	const bool chain_critical = chain_us > timings[1].duration_us;
+	ASSERT_EQ(timings[0].on_critical_path, chain_critical);
+	ASSERT_EQ(timings[2].on_critical_path, chain_critical);
+	ASSERT_EQ(timings[1].on_critical_path, !chain_critical);
+	ASSERT_DOUBLE_EQ(scheduler.CriticalPathMicroseconds(), std::max(chain_us, timings[1].duration_us));
+	ASSERT_LE(scheduler.CriticalPathMicroseconds(), scheduler.FrameMicroseconds());
+
+	std::FILE* out = std::tmpfile();
+	scheduler.PrintTimings(out);
+	ASSERT_GT(std::ftell(out), 0);
+	std::fclose(out);
+}
@@ -0,0 +1,178 @@
+#pragma once
+#include <gtest/gtest.h>
+#include <lutra-ecs/ECSManager.h>
+#include <lutra-ecs/CommandBuffer.h>
+#include <lutra-ecs/TagBitset.h>
+#include <vector>
+
+namespace TTagBitset
+{
+	using Handle = lcs::Handle<uint32_t, 16>;
+
+	struct IsWet
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::TagBitset;
+	};
+	struct IsHot
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::TagBitset;
+	};
+	struct IsFrozen
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::TagBitset;
+	};
+	struct IsLoud
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Tag;
+	};
+	struct Position
+	{
+		static constexpr lcs::ComponentType component_type = lcs::ComponentType::Component;
+		int x, y;
+	};
+
+	using ECS = lcs::ECSManager<Handle, Position, IsWet, IsHot, IsFrozen, IsLoud>;
+}
+
+TEST(TagBitset, AddRemoveHas)
+{
+	using Handle = TTagBitset::Handle;
+	lcs::TagBitset<Handle> set{};
+	set.ReserveSparseSize(10000);
+	ASSERT_GE(set.SparseSize(), 10000u);
+
+	set.Add(Handle::CreateNew(3));
+	set.Add(Handle::CreateNew(64));
+	set.Add(Handle::CreateNew(9000));
+	ASSERT_EQ(set.Size(), 3u);
+	ASSERT_TRUE(set.Has(Handle::CreateNew(3)));
+	ASSERT_TRUE(set.Has(Handle::CreateNew(64)));
+	ASSERT_TRUE(set.Has(Handle::CreateNew(9000)));
+	ASSERT_TRUE(!set.Has(Handle::CreateNew(4)));
+
+	/* Summary bits follow the words: word 0, word 1 and word 140 */
+	ASSERT_EQ(set.SummaryWords()[0], 0b11u);
+	ASSERT_EQ(set.SummaryWords()[2], uint64_t(1) << (140 - 128));
+
+	set.Remove(Handle::CreateNew(64));
+	ASSERT_TRUE(!set.Has(Handle::CreateNew(64)));
+	ASSERT_EQ(set.SummaryWords()[0], 0b1u);
+
+	const std::vector<Handle> removed{ Handle::CreateNew(3), Handle::CreateNew(9000) };
+	set.RemoveMany(removed);
+	ASSERT_EQ(set.Size(), 0u);
+	for (const uint64_t word : set.SummaryWords()) ASSERT_EQ(word, 0u);
+}
+
+TEST(TagBitset, Queries)
+{
+	using namespace TTagBitset;
+	ECS ecs{};
+	std::vector<Handle> entities(10000);
+	ecs.CreateEntities(10000, entities);
+	for (uint32_t i = 0; i < 10000; i++)
+	{
+		if (i % 2 == 0) ecs.AddTag<IsWet>(entities[i]);
+		if (i % 3 == 0) ecs.AddTag<IsHot>(entities[i]);
+		if (i % 5 == 0) ecs.AddTag<IsFrozen>(entities[i]);
+		if (i < 5000) ecs.AddComponent<Position>(entities[i], { int(i), 0 });
+	}
+
+	/* Destroyed entities drop out of every query */
+	ecs.DestroyEntity(entities[6]);
+	const std::vector<Handle> destroyed{ entities[12], entities[9000] };
+	ecs.DestroyEntities(destroyed);
+	const auto alive = [](uint32_t i) { return i != 6 && i != 12 && i != 9000; };
+
+	std::vector<Handle> expected{};
+	for (uint32_t i = 0; i < 10000; i++)
+	{
+		if (alive(i) && i % 2 == 0 && i % 3 == 0 && i % 5 != 0) expected.push_back(entities[i]);
+	}
+	const auto query = ecs.QueryTags<IsWet, IsHot>(lcs::Exclude<IsFrozen>{});
+	const std::vector<Handle> found(query.begin(), query.end());
+	ASSERT_EQ(found, expected);
+	ASSERT_EQ(query.Count(), uint32_t(expected.size()));
+
+	uint32_t wet_count = 0;
+	for (const Handle e : ecs.TView<IsWet>())
+	{
+		ASSERT_TRUE(ecs.HasTag<IsWet>(e));
+		wet_count++;
+	}
+	ASSERT_EQ(wet_count, 5000u - 3u);
+
+	ecs.RemoveTag<IsWet>(entities[0]);
+	ASSERT_TRUE(!ecs.HasTag<IsWet>(entities[0]));
+	ASSERT_EQ(*ecs.QueryTags<IsWet>().begin(), entities[2]);
+
+	/* An empty query walks nothing */
+	for (const Handle e : entities) if (ecs.Entities().IsCurrent(e) && ecs.HasTag<IsFrozen>(e)) ecs.RemoveTag<IsFrozen>(e);
+	const auto frozen = ecs.QueryTags<IsFrozen>();
+	ASSERT_TRUE(frozen.begin() == frozen.end());
+	ASSERT_EQ(frozen.Count(), 0u);
+}
+
+TEST(TagBitset, AnyOfQueries)
+{
+	using namespace TTagBitset;
+	ECS ecs{};
+	std::vector<Handle> entities(10000);
+	ecs.CreateEntities(10000, entities);
+
+	/* Two clusters far apart, the summaries skip everything in between */
+	for (uint32_t i = 0; i < 10000; i++)
+	{
+		if (i % 2 == 0) ecs.AddTag<IsWet>(entities[i]);
+		if (i >= 100 && i < 200) ecs.AddTag<IsHot>(entities[i]);
+		if (i >= 8000 && i < 8100 && i % 3 == 0) ecs.AddTag<IsFrozen>(entities[i]);
+	}
+	ecs.DestroyEntity(entities[150]);
+	const auto in_any = [](uint32_t i) { return i != 150 && ((i >= 100 && i < 200) || (i >= 8000 && i < 8100 && i % 3 == 0)); };
+
+	std::vector<Handle> expected_any{}, expected_wet{}, expected_dry{};
+	for (uint32_t i = 0; i < 10000; i++)
+	{
+		if (!in_any(i)) continue;
+		expected_any.push_back(entities[i]);
+		(i % 2 == 0 ? expected_wet : expected_dry).push_back(entities[i]);
+	}
+
+	const auto any = ecs.QueryTags<>(lcs::AnyOf<IsHot, IsFrozen>{});
+	ASSERT_EQ(std::vector<Handle>(any.begin(), any.end()), expected_any);
+	ASSERT_EQ(any.Count(), uint32_t(expected_any.size()));
+
+	const auto wet = ecs.QueryTags<IsWet>(lcs::AnyOf<IsHot, IsFrozen>{});
+	ASSERT_EQ(std::vector<Handle>(wet.begin(), wet.end()), expected_wet);
+
+	const auto dry = ecs.QueryTags<>(lcs::AnyOf<IsFrozen, IsHot>{}, lcs::Exclude<IsWet>{});
+	ASSERT_EQ(std::vector<Handle>(dry.begin(), dry.end()), expected_dry);
+	ASSERT_EQ(dry.Count(), uint32_t(expected_dry.size()));
+}
+
+TEST(TagBitset, CommandBufferAndClear)
+{
+	using namespace TTagBitset;
+	ECS ecs{};
+	lcs::CommandBuffer<Handle, Position, IsWet, IsHot, IsFrozen, IsLoud> commands{};
+	const Handle e = ecs.CreateEntity();
+	commands.AddTag<IsHot>(e);
+	commands.AddTag<IsLoud>(e);
+	const auto pending = commands.CreateEntity();
+	commands.AddTag<IsHot>(pending);
+	commands.Flush(ecs);
+
+	ASSERT_TRUE(ecs.HasTag<IsHot>(e));
+	ASSERT_TRUE(ecs.HasTag<IsLoud>(e));
+	ASSERT_EQ(ecs.QueryTags<IsHot>().Count(), 2u);
+
+	commands.RemoveTag<IsHot>(e);
+	commands.Flush(ecs);
+	ASSERT_EQ(ecs.QueryTags<IsHot>().Count(), 1u);
+
+	ecs.Clear();
+	ASSERT_EQ(ecs.QueryTags<IsHot>().Count(), 0u);
+	const Handle after_clear = ecs.CreateEntity();
+	ecs.AddTag<IsHot>(after_clear);
+	ASSERT_EQ(*ecs.QueryTags<IsHot>().begin(), after_clear);
+}
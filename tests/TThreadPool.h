@@ -0,0 +1,86 @@
+#pragma once
+#include <gtest/gtest.h>
+#include <lutra-ecs/ThreadPool.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+TEST(ThreadPool, RunsEveryTaskOnce)
+{
+	lcs::ThreadPool pool{ 3 };
+
+	std::vector<std::atomic<uint32_t>> counters(1000);
+	pool.ParallelFor(uint32_t(counters.size()), [&](uint32_t task_index) { counters[task_index]++; });
+
+	for (const auto& counter : counters)
+	{
+		ASSERT_EQ(counter.load(), 1u);
+	}
+}
+
+TEST(ThreadPool, NoWorkers)
+{
+	lcs::ThreadPool pool{ 0 };
+
+	uint32_t sum = 0;
+	pool.ParallelFor(10, [&](uint32_t task_index) { sum += task_index; });
+	ASSERT_EQ(sum, 45u);
+}
+
+TEST(ThreadPool, NestedParallelFor)
+{
+	lcs::ThreadPool pool{ 2 };
+
+	std::atomic<uint32_t> sum{ 0 };
+	pool.ParallelFor(8, [&](uint32_t outer_index)
+		{
+			pool.ParallelFor(8, [&](uint32_t inner_index) { sum += outer_index * 8 + inner_index; });
+		});
+	ASSERT_EQ(sum.load(), 63u * 64u / 2u);
+}
+
+TEST(ThreadPool, RepeatedJobs)
+{
+	lcs::ThreadPool pool{ 4 };
+
+	std::atomic<uint32_t> count{ 0 };
+	for (uint32_t i = 0; i < 200; i++)
+	{
+		pool.ParallelFor(i % 17, [&](uint32_t) { count++; });
+	}
+
+	uint32_t expected = 0;
+	for (uint32_t i = 0; i < 200; i++) expected += i % 17;
+	ASSERT_EQ(count.load(), expected);
+}
+
+TEST(ThreadPool, RethrowsOnCaller)
+{
+	for (uint32_t worker_count : { 0u, 3u })
+	{
+		lcs::ThreadPool pool{ worker_count };
+
+		std::atomic<uint32_t> count{ 0 };
+		bool caught = false;
+		try
+		{
+			pool.ParallelFor(64, [&](uint32_t task_index)
+				{
+					count++;
+					if (task_index % 8 == 0) throw std::runtime_error("task failed");
+				});
+		}
+		catch (const std::runtime_error&)
+		{
+			caught = true;
+		}
+		ASSERT_TRUE(caught);
+		ASSERT_EQ(count.load(), 64u);
+
+		/* The pool stays usable afterwards */
+		count = 0;
+		pool.ParallelFor(64, [&](uint32_t) { count++; });
+		ASSERT_EQ(count.load(), 64u);
+	}
+}
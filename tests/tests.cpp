@@ -1,10 +1,19 @@
 #include <gtest/gtest.h>
 
+#include "TArchetypeStorage.h"
 #include "TBitMask.h"
+#include "TCachedQuery.h"
+#include "TChangeEvents.h"
 #include "TECS.h"
 #include "THandleFreeList.h"
+#include "TPagedIndexArray.h"
 #include "TSparseSet.h"
+#include "TSparseSetSoA.h"
+#include "TSnapshot.h"
 #include "TSparseTagSet.h"
+#include "TSystemScheduler.h"
+#include "TTagBitset.h"
+#include "TThreadPool.h"
 
 int main(int argc, char** argv)
 {